@@ -0,0 +1,20 @@
+/**
+ * @file backlight.h
+ * PWM backlight on TFT_BL (GPIO 21 on the CYD) via an LEDC channel.
+ * TFT_eSPI switches the pin fully on in tft.init(); BacklightInit() takes it over afterwards.
+ */
+#ifndef BACKLIGHT_H
+#define BACKLIGHT_H
+
+#include <stdint.h>
+
+/** Attach the LEDC channel to TFT_BL and set full brightness. Call after tft.init(). */
+void BacklightInit(void);
+
+/** Brightness 0..100 %. 0 switches the LED off completely. */
+void BacklightSetPercent(uint8_t pct);
+
+/** Last brightness set. */
+uint8_t BacklightGetPercent(void);
+
+#endif /* BACKLIGHT_H */
@@ -0,0 +1,76 @@
+/**
+ * @file ble_telemetry.h
+ * Generic BLE telemetry service (NimBLE GATT server), not Victron-compatible; see docs/BLE_GATT.md
+ * and ble_telemetry_format.h for the characteristic encodings.
+ *
+ * Design:
+ * - One task owns the BLE stack: it starts and stops NimBLE when BLE is switched on or off, so the
+ *   UI and the console never block on it, and a disabled stack costs no heap.
+ * - Value characteristics (V, I, P, energy, SOC, temperature) are refreshed from live_snapshot.h once
+ *   a second and notified to subscribers; reads never touch I2C.
+ * - The samples characteristic is fed from the sensor ring every BLE_NOTIFY_MS while a client is
+ *   subscribed. Points are packed into batches sized to the negotiated MTU; each point averages
+ *   enough raw samples to keep notifications at or below BLE_NOTIFY_MAX_HZ (every sample at
+ *   MTU 247, 20 points/s at the default MTU 23). A failed notify (controller buffers full) doubles
+ *   the averaging; a run of good ones halves it again.
+ * - One connection at a time; advertising resumes on disconnect.
+ *
+ * BLE on/off and the device name live in NVS (namespace "cyd_ble"), set from Settings > Integration
+ * or the serial console ("ble").
+ */
+#ifndef BLE_TELEMETRY_H
+#define BLE_TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef BLE_NAME_MAX
+#define BLE_NAME_MAX 24                /* fits the scan response next to the flags */
+#endif
+#ifndef BLE_NOTIFY_MS
+#define BLE_NOTIFY_MS 100              /* samples batch flush period */
+#endif
+#ifndef BLE_NOTIFY_MAX_HZ
+#define BLE_NOTIFY_MAX_HZ 20           /* samples notifications per second, at most */
+#endif
+#ifndef BLE_VALUES_MS
+#define BLE_VALUES_MS 1000             /* value characteristics refresh */
+#endif
+#ifndef BLE_RECOVER_NOTIFIES
+#define BLE_RECOVER_NOTIFIES 50        /* good notifies before the averaging halves */
+#endif
+
+typedef struct {
+  bool     enabled;
+  bool     running;            /* stack up and advertising or connected */
+  bool     connected;
+  bool     subscribed;         /* samples characteristic */
+  uint16_t mtu;                /* ATT MTU of the connection (23 until negotiated) */
+  uint16_t decim;              /* raw samples per point */
+  uint32_t connects;
+  uint32_t notifies;           /* samples notifications sent */
+  uint32_t points;
+  uint32_t notify_failures;    /* batch dropped, averaging doubled */
+  uint32_t samples_dropped;    /* ring overrun: the task fell behind the sampler */
+} BleTelemetryStats;
+
+/** Load settings and start the BLE task; the stack comes up if BLE is enabled. */
+void BleTelemetryInit(void);
+
+/** Switch BLE on or off (saved in NVS). Returns at once; the task starts or stops the stack. */
+void BleTelemetrySetEnabled(bool on);
+bool BleTelemetryGetEnabled(void);
+
+/** Set the advertised name (saved in NVS; truncated to BLE_NAME_MAX). Empty = "CYD Shunt <id>". */
+void BleTelemetrySetName(const char *name);
+
+/** Copy of the advertised name. */
+void BleTelemetryGetName(char *buf, size_t len);
+
+void BleTelemetryGetStats(BleTelemetryStats *out);
+
+/** One-line status, e.g. "CYD Shunt 3a9f10 connected, MTU 247, 100 pts/s" or "off". */
+void BleTelemetryGetInfo(char *buf, size_t len);
+
+#endif /* BLE_TELEMETRY_H */
@@ -0,0 +1,178 @@
+/**
+ * @file ble_telemetry_format.h
+ * Characteristic encodings of the generic BLE telemetry service (docs/BLE_GATT.md), shared by the
+ * firmware and host tests (test/ble_pack). Header-only and free of Arduino dependencies.
+ *
+ * Values are packed little-endian integers in fixed units, so a client needs no float parsing:
+ *   voltage int32 mV, current int32 mA (positive = charging), power int32 mW, energy int32 mWh,
+ *   SOC uint16 0.01 % (BLE_TLM_SOC_UNKNOWN if not known), temperature int16 0.01 degC
+ *   (BLE_TLM_TEMP_UNKNOWN while no sensor is connected).
+ *
+ * The samples characteristic packs as many points as fit into one notification:
+ *   u8 version, u8 count, u16 point_ms, u32 first_seq, u32 t0_ms, then count x (int32 mV, int32 mA).
+ * Point k is the mean of the point_ms / sample-period raw samples from t0_ms + k * point_ms on;
+ * first_seq is the sensor ring sequence number of the first of them. Batches continue at
+ * first_seq + count * (point_ms / period) unless samples were lost in between.
+ */
+#ifndef BLE_TELEMETRY_FORMAT_H
+#define BLE_TELEMETRY_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+/* Service and characteristic UUIDs: project-specific base, not Victron's */
+#define BLE_TLM_SERVICE_UUID     "c7d50000-4e2b-4f6a-9b1e-53a4b3c2d1e0"
+#define BLE_TLM_VOLTAGE_UUID     "c7d50001-4e2b-4f6a-9b1e-53a4b3c2d1e0"
+#define BLE_TLM_CURRENT_UUID     "c7d50002-4e2b-4f6a-9b1e-53a4b3c2d1e0"
+#define BLE_TLM_POWER_UUID       "c7d50003-4e2b-4f6a-9b1e-53a4b3c2d1e0"
+#define BLE_TLM_ENERGY_UUID      "c7d50004-4e2b-4f6a-9b1e-53a4b3c2d1e0"
+#define BLE_TLM_SOC_UUID         "c7d50005-4e2b-4f6a-9b1e-53a4b3c2d1e0"
+#define BLE_TLM_TEMPERATURE_UUID "c7d50006-4e2b-4f6a-9b1e-53a4b3c2d1e0"
+#define BLE_TLM_SAMPLES_UUID     "c7d50007-4e2b-4f6a-9b1e-53a4b3c2d1e0"
+
+#define BLE_TLM_SOC_UNKNOWN      0xFFFF
+#define BLE_TLM_TEMP_UNKNOWN     INT16_MIN
+#define BLE_TLM_BATCH_VERSION    1
+#define BLE_TLM_BATCH_HEADER     12
+#define BLE_TLM_BATCH_RECORD     8
+#define BLE_TLM_ATT_OVERHEAD     3    /* notification payload = ATT MTU - 3 */
+
+/* ─── Little-endian primitives ─── */
+static inline void BleTlmPutU16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void BleTlmPutU32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint16_t BleTlmGetU16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t BleTlmGetU32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/** x * scale rounded to the nearest integer, saturated to [lo, hi]; NaN maps to 0. */
+static inline int32_t BleTlmScale(double x, double scale, int32_t lo, int32_t hi) {
+  double q = x * scale;
+  if (!(q == q)) return 0;
+  if (q >= (double)hi) return hi;
+  if (q <= (double)lo) return lo;
+  return (int32_t)lround(q);
+}
+
+/* ─── Value characteristics; each returns the encoded length ─── */
+static inline size_t BleTlmPackVoltage(uint8_t out[4], float volts) {
+  BleTlmPutU32(out, (uint32_t)BleTlmScale(volts, 1e3, INT32_MIN, INT32_MAX));
+  return 4;
+}
+
+static inline size_t BleTlmPackCurrent(uint8_t out[4], float amps) {
+  BleTlmPutU32(out, (uint32_t)BleTlmScale(amps, 1e3, INT32_MIN, INT32_MAX));
+  return 4;
+}
+
+static inline size_t BleTlmPackPower(uint8_t out[4], float watts) {
+  BleTlmPutU32(out, (uint32_t)BleTlmScale(watts, 1e3, INT32_MIN, INT32_MAX));
+  return 4;
+}
+
+static inline size_t BleTlmPackEnergy(uint8_t out[4], double watt_hours) {
+  BleTlmPutU32(out, (uint32_t)BleTlmScale(watt_hours, 1e3, INT32_MIN, INT32_MAX));
+  return 4;
+}
+
+static inline size_t BleTlmPackSoc(uint8_t out[2], float percent) {
+  uint16_t v = percent == percent ? (uint16_t)BleTlmScale(percent, 100.0, 0, 10000) : BLE_TLM_SOC_UNKNOWN;
+  BleTlmPutU16(out, v);
+  return 2;
+}
+
+static inline size_t BleTlmPackTemperature(uint8_t out[2], float celsius) {
+  /* INT16_MIN is the "unknown" sentinel, so real values saturate one above it */
+  int16_t v = celsius == celsius ? (int16_t)BleTlmScale(celsius, 100.0, INT16_MIN + 1, INT16_MAX)
+                                 : (int16_t)BLE_TLM_TEMP_UNKNOWN;
+  BleTlmPutU16(out, (uint16_t)v);
+  return 2;
+}
+
+/* ─── Samples characteristic ─── */
+
+/** Points that fit a notification at this ATT MTU (0 if not even one; at most 255). */
+static inline size_t BleTlmBatchCapacity(uint16_t att_mtu) {
+  if (att_mtu < BLE_TLM_ATT_OVERHEAD + BLE_TLM_BATCH_HEADER + BLE_TLM_BATCH_RECORD) return 0;
+  size_t n = (att_mtu - BLE_TLM_ATT_OVERHEAD - BLE_TLM_BATCH_HEADER) / BLE_TLM_BATCH_RECORD;
+  return n > 255 ? 255 : n;
+}
+
+typedef struct {
+  uint8_t *buf;       /* BLE_TLM_BATCH_HEADER + capacity * BLE_TLM_BATCH_RECORD bytes */
+  size_t   capacity;
+  size_t   count;
+} BleTlmBatch;
+
+static inline void BleTlmBatchBegin(BleTlmBatch *b, uint8_t *buf, size_t capacity, uint32_t first_seq,
+                                    uint32_t t0_ms, uint16_t point_ms) {
+  b->buf = buf;
+  b->capacity = capacity > 255 ? 255 : capacity;
+  b->count = 0;
+  buf[0] = BLE_TLM_BATCH_VERSION;
+  buf[1] = 0;
+  BleTlmPutU16(buf + 2, point_ms);
+  BleTlmPutU32(buf + 4, first_seq);
+  BleTlmPutU32(buf + 8, t0_ms);
+}
+
+/** Append one point; false (batch unchanged) when it is full. */
+static inline bool BleTlmBatchAdd(BleTlmBatch *b, float volts, float amps) {
+  if (b->count >= b->capacity) return false;
+  uint8_t *p = b->buf + BLE_TLM_BATCH_HEADER + b->count * BLE_TLM_BATCH_RECORD;
+  BleTlmPackVoltage(p, volts);
+  BleTlmPackCurrent(p + 4, amps);
+  b->count++;
+  b->buf[1] = (uint8_t)b->count;
+  return true;
+}
+
+static inline bool BleTlmBatchFull(const BleTlmBatch *b) {
+  return b->count >= b->capacity;
+}
+
+/** Encoded length of the batch so far. */
+static inline size_t BleTlmBatchLength(const BleTlmBatch *b) {
+  return BLE_TLM_BATCH_HEADER + b->count * BLE_TLM_BATCH_RECORD;
+}
+
+typedef struct {
+  uint8_t  count;
+  uint16_t point_ms;
+  uint32_t first_seq;
+  uint32_t t0_ms;
+} BleTlmBatchInfo;
+
+/** Parse a received batch header; false if the version is unknown or the length does not match. */
+static inline bool BleTlmBatchParse(const uint8_t *p, size_t len, BleTlmBatchInfo *out) {
+  if (len < BLE_TLM_BATCH_HEADER || p[0] != BLE_TLM_BATCH_VERSION) return false;
+  if (len != BLE_TLM_BATCH_HEADER + (size_t)p[1] * BLE_TLM_BATCH_RECORD) return false;
+  out->count = p[1];
+  out->point_ms = BleTlmGetU16(p + 2);
+  out->first_seq = BleTlmGetU32(p + 4);
+  out->t0_ms = BleTlmGetU32(p + 8);
+  return true;
+}
+
+/** Point k of a parsed batch, in mV and mA. */
+static inline void BleTlmBatchPoint(const uint8_t *p, size_t k, int32_t *mv, int32_t *ma) {
+  const uint8_t *r = p + BLE_TLM_BATCH_HEADER + k * BLE_TLM_BATCH_RECORD;
+  *mv = (int32_t)BleTlmGetU32(r);
+  *ma = (int32_t)BleTlmGetU32(r + 4);
+}
+
+#endif /* BLE_TELEMETRY_FORMAT_H */
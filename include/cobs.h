@@ -0,0 +1,51 @@
+/**
+ * @file cobs.h
+ * Consistent Overhead Byte Stuffing: removes every 0x00 from a frame so 0x00 can delimit frames
+ * on a byte stream, for at most 1 byte of overhead per 254. Used by the USB sample stream.
+ * Header-only and free of Arduino dependencies so host-side tools can include it too.
+ */
+#ifndef COBS_H
+#define COBS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Worst-case encoded length of n bytes (without the 0x00 delimiter). */
+#define COBS_MAX_ENCODED(n) ((n) + (n) / 254 + 1)
+
+/** Encode len bytes into out (COBS_MAX_ENCODED(len) bytes); returns the encoded length. */
+static inline size_t CobsEncode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t code_at = 0, o = 1;
+  uint8_t code = 1;
+  for (size_t k = 0; k < len; k++) {
+    if (in[k]) {
+      out[o++] = in[k];
+      code++;
+    }
+    if (!in[k] || code == 0xFF) {
+      out[code_at] = code;
+      code_at = o++;
+      code = 1;
+    }
+  }
+  out[code_at] = code;
+  return o;
+}
+
+/** Decode len bytes (one frame, delimiter stripped) into out (len bytes); returns the decoded
+ *  length, or SIZE_MAX if the input is not valid COBS. */
+static inline size_t CobsDecode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t i = 0, o = 0;
+  while (i < len) {
+    uint8_t code = in[i++];
+    if (code == 0 || i + code - 1 > len) return SIZE_MAX;
+    for (uint8_t k = 1; k < code; k++) {
+      if (in[i] == 0) return SIZE_MAX;
+      out[o++] = in[i++];
+    }
+    if (code != 0xFF && i < len) out[o++] = 0;
+  }
+  return o;
+}
+
+#endif /* COBS_H */
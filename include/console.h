@@ -0,0 +1,54 @@
+/**
+ * @file console.h
+ * Line-based command console on the USB serial port (type "help").
+ *
+ * ConsolePoll() is called from loop() and never blocks:
+ * - Input is read only as far as Serial.available() and assembled into a line.
+ * - Output goes into a RAM queue (CONSOLE_TX_BYTES). Each poll moves only what the UART can take
+ *   without waiting (Serial.availableForWrite()), so a slow or absent terminal delays nothing.
+ * - Long listings (history) are produced a few rows per poll, while the queue has room.
+ * If the queue overflows, the excess is dropped and a "[N bytes dropped]" note follows.
+ *
+ * While the USB sample stream runs (usb_stream.h), input is not parsed: a USB_STREAM_CMD_TOGGLE
+ * byte stops the stream.
+ */
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef CONSOLE_TX_BYTES
+#define CONSOLE_TX_BYTES 4096
+#endif
+#ifndef CONSOLE_LINE_MAX
+#define CONSOLE_LINE_MAX 160                 /* an InfluxDB token alone is 88 characters */
+#endif
+#ifndef CONSOLE_ECHO
+#define CONSOLE_ECHO 1                   /* echo typed characters (serial monitors rarely do) */
+#endif
+
+typedef struct {
+  uint32_t commands;
+  uint32_t tx_bytes;
+  uint32_t tx_dropped;                   /* queue overflow */
+  uint16_t tx_peak;                      /* most bytes queued at once */
+  uint32_t poll_gap_us_max;              /* longest time between two polls: loop() latency */
+  uint32_t poll_gap_us_avg;
+} ConsoleStats;
+
+/** Print the prompt. Call once at the end of setup(). */
+void ConsoleInit(void);
+
+/** Read input, run complete commands and drain queued output. Call from loop(). */
+void ConsolePoll(void);
+
+/** Queue formatted output (truncated to 256 bytes per call). Safe from any task. */
+void ConsolePrintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/** Queue raw bytes. Safe from any task. */
+void ConsoleWrite(const char *s, size_t len);
+
+void ConsoleGetStats(ConsoleStats *out);
+
+#endif /* CONSOLE_H */
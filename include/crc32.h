@@ -0,0 +1,34 @@
+/**
+ * @file crc32.h
+ * CRC-32 (IEEE 802.3, reflected, poly 0xEDB88320) used by the on-flash history log.
+ * Header-only and free of Arduino dependencies so host-side tools can include it too.
+ * Nibble-table implementation: 64 bytes of table, ~2x faster than bitwise.
+ */
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Continue a CRC over len bytes. Start with crc = 0; the result is the final CRC. */
+static inline uint32_t Crc32Update(uint32_t crc, const void *data, size_t len) {
+  static const uint32_t k_nibble[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+  };
+  const uint8_t *p = (const uint8_t *)data;
+  crc = ~crc;
+  while (len--) {
+    crc ^= *p++;
+    crc = (crc >> 4) ^ k_nibble[crc & 0x0F];
+    crc = (crc >> 4) ^ k_nibble[crc & 0x0F];
+  }
+  return ~crc;
+}
+
+/** CRC-32 of a single buffer. */
+static inline uint32_t Crc32(const void *data, size_t len) {
+  return Crc32Update(0, data, len);
+}
+
+#endif /* CRC32_H */
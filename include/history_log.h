@@ -0,0 +1,69 @@
+/**
+ * @file history_log.h
+ * Persistent, append-only history log in the dedicated "history" flash partition.
+ *
+ * Design:
+ * - The partition is a ring of 4 KB pages (one flash sector each), written round-robin so every
+ *   sector sees the same number of erases (wear levelling without a translation layer).
+ * - A page is a CRC-protected header followed by fixed-size blocks of records. Records are batched
+ *   in RAM and written one whole block at a time, so a power cut loses at most one block.
+ * - Boot recovery reads only the page headers (plus the blocks of the newest page) to find the head.
+ * - Readers page records in by index on demand; nothing is mirrored in RAM.
+ * - Full blocks are handed to a low-priority writer task, which does the flash writes and page erases.
+ *   HistoryLogPush() never waits for flash.
+ * - All calls are thread-safe: the log has its own mutex, held for bookkeeping and one block read,
+ *   never across an erase or a write. Callers need no other lock.
+ *
+ * Records are averaged from HISTORY_LOG_DECIMATION history samples (1 s at the 200 ms UI rate); the
+ * feed period is passed to HistoryLogInit() and stamped into every page header.
+ * See docs/HISTORY_LOG.md for the on-flash layout.
+ */
+#ifndef HISTORY_LOG_H
+#define HISTORY_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** History samples averaged into one stored record. */
+#define HISTORY_LOG_DECIMATION 5
+
+/** One stored record: means over the decimation window (energy is the last value). */
+typedef struct {
+  float voltage_V;
+  float current_A;
+  float power_W;
+  float energy_Wh;
+} HistoryLogRecord;
+
+/**
+ * Mount the partition and recover the write position. sample_ms: period of the HistoryLogPush() feed
+ * (UI_SAMPLE_PERIOD_MS). Returns false if the partition is missing.
+ */
+bool HistoryLogInit(uint32_t sample_ms);
+
+/** True after a successful HistoryLogInit(). */
+bool HistoryLogIsReady(void);
+
+/** Feed one history sample; every HISTORY_LOG_DECIMATION samples one record is queued for flash. */
+void HistoryLogPush(float voltage_V, float current_A, float power_W, double energy_Wh);
+
+/** Write the partially filled RAM block now (unused slots read back as NaN gaps). */
+void HistoryLogFlush(void);
+
+/** Number of record slots stored, oldest first. Includes gaps from flushes or torn writes. */
+uint32_t HistoryLogCount(void);
+
+/**
+ * Read up to n records starting at index first (0 = oldest stored). Slots that were never written
+ * or failed their CRC come back as NaN. Returns the number of slots filled.
+ */
+size_t HistoryLogRead(uint32_t first, HistoryLogRecord *out, size_t n);
+
+/** Milliseconds between stored records (for axis labels). */
+uint32_t HistoryLogIntervalMs(void);
+
+/** Fill buf with a one-line status, e.g. "12/32 pages, 2880 rec". */
+void HistoryLogGetInfo(char *buf, size_t len);
+
+#endif /* HISTORY_LOG_H */
@@ -0,0 +1,63 @@
+/**
+ * @file http_api.h
+ * HTTP server on port 80 (see docs/HTTP_API.md): Prometheus /metrics, JSON /api/snapshot and
+ * /api/history, a small dashboard at /, and the WebSocket sample stream at /ws with its /live page
+ * (ws_stream.h).
+ *
+ * Design:
+ * - ESPAsyncWebServer: requests are handled in the AsyncTCP task, never in loop() or the UI task.
+ * - Handlers read live_snapshot.h and session_stats.h, never the sensor, so requests never touch I2C.
+ * - /metrics and /api/history are chunked responses generated a line at a time into the TCP send
+ *   buffer; per request only a small cursor (values captured at request time, a few history
+ *   records) is allocated, whatever the response size.
+ * - At most HTTP_MAX_ACTIVE responses are in flight; further requests get 503 with Retry-After,
+ *   which bounds the heap a burst of scrapes can take.
+ * - The server starts on the first Wi-Fi connection (wifi_link.h).
+ */
+#ifndef HTTP_API_H
+#define HTTP_API_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef HTTP_PORT
+#define HTTP_PORT 80
+#endif
+#ifndef HTTP_MAX_ACTIVE
+#define HTTP_MAX_ACTIVE 4           /* responses in flight before 503 */
+#endif
+#ifndef HTTP_HISTORY_DEFAULT
+#define HTTP_HISTORY_DEFAULT 300    /* /api/history records without ?n= */
+#endif
+
+typedef enum {
+  HTTP_PATH_DASHBOARD = 0,
+  HTTP_PATH_METRICS,
+  HTTP_PATH_SNAPSHOT,
+  HTTP_PATH_HISTORY,
+  HTTP_PATH_LIVE,
+  HTTP_PATH_OTHER,                  /* 404s */
+  HTTP_PATH_COUNT
+} HttpPath;
+
+typedef struct {
+  bool     running;
+  uint32_t requests[HTTP_PATH_COUNT];
+  uint32_t rejected;                /* 503: HTTP_MAX_ACTIVE reached */
+  uint32_t bytes;                   /* body bytes of streamed responses */
+  uint8_t  active;
+  uint8_t  active_peak;
+  uint32_t fill_us_max;             /* slowest chunk generation (includes waiting for the history lock) */
+  uint32_t heap_low;                /* lowest free heap seen while serving (0 = nothing served yet) */
+} HttpApiStats;
+
+/** Register handlers; the server starts listening once Wi-Fi is up. */
+void HttpApiInit(void);
+
+void HttpApiGetStats(HttpApiStats *out);
+
+/** One-line status, e.g. "http://192.168.1.40/ 1234 requests, peak 3 active" or "waiting for Wi-Fi". */
+void HttpApiGetInfo(char *buf, size_t len);
+
+#endif /* HTTP_API_H */
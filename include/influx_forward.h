@@ -0,0 +1,217 @@
+/**
+ * @file influx_forward.h
+ * Batching and store-and-forward policy of the InfluxDB uploader (docs/INFLUX.md), shared by the
+ * firmware (influx_up.cpp) and the host test (test/influx_up). Header-only and free of Arduino
+ * dependencies; the HTTP POST and the clock are callbacks.
+ *
+ * - Point lines are appended to a live batch. It is sealed at batch_points lines, after batch_ms,
+ *   or when the next line does not fit the buffer.
+ * - A sealed batch is posted right away while the link is up and no backoff is running. Otherwise,
+ *   or when the post fails, it goes to the spool (influx_spool.h).
+ * - The spool drains oldest first, at most one batch per poll and at most drain_Bps on average (a
+ *   token bucket with one second of burst). The live batch is always handled before the backlog in a
+ *   poll, so a long catch-up never delays current data by more than one post.
+ * - A failed post (no answer, 5xx, 401/403/404, 408, 429) starts an exponential backoff from
+ *   backoff_min_ms to backoff_max_ms; while it runs, new batches are spooled. Any other 4xx means
+ *   the server will never take the batch (bad line protocol, too large, outside the retention
+ *   period): it is dropped and counted instead of blocking the backlog.
+ */
+#ifndef INFLUX_FORWARD_H
+#define INFLUX_FORWARD_H
+
+#include "influx_spool.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/** POST one batch. Returns the HTTP status, or a negative value when no answer arrived. */
+typedef int (*InfluxPostFn)(void *ctx, const char *body, size_t len);
+
+typedef struct {
+  uint32_t batch_points;
+  uint32_t batch_ms;
+  uint32_t drain_Bps;          /* catch-up budget, body bytes per second */
+  uint32_t backoff_min_ms;
+  uint32_t backoff_max_ms;
+  uint32_t rate_window_ms;     /* catch-up throughput is averaged over this window */
+} InfluxForwardConfig;
+
+typedef struct {
+  uint32_t posts;              /* batches the server took */
+  uint32_t post_failures;
+  uint32_t batches_rejected;   /* dropped on a permanent 4xx */
+  int      status_last;        /* HTTP status of the last post, <0 = no answer */
+  uint32_t points_live;        /* delivered when sealed */
+  uint32_t points_drained;     /* delivered from the spool */
+  uint32_t points_spooled;
+  uint32_t points_dropped;     /* rejected by the server, or the spool could not store them */
+  uint32_t post_ms_last;
+  uint32_t post_ms_max;
+  uint32_t drain_Bps;          /* catch-up throughput over the last rate window */
+  uint32_t drain_pps;          /* points per second, same window */
+  uint32_t backoff_ms;         /* time left before the next post is allowed */
+} InfluxForwardStats;
+
+typedef struct {
+  InfluxForwardConfig cfg;
+  InfluxSpool *spool;
+  InfluxPostFn post;
+  void        *post_ctx;
+  uint32_t   (*clock_ms)(void);
+
+  char        *live;           /* batch being filled */
+  uint32_t     live_cap;
+  uint32_t     live_len;
+  uint32_t     live_points;
+  uint32_t     live_start_ms;
+  char        *scratch;        /* spooled batch being sent */
+  uint32_t     scratch_cap;
+
+  bool         link_up;        /* as of the last poll */
+  int64_t      tokens;         /* drain budget, bytes */
+  uint32_t     pace_ms;
+  uint32_t     backoff;
+  uint32_t     retry_ms;
+  uint32_t     win_start_ms;
+  uint32_t     win_bytes;
+  uint32_t     win_points;
+  InfluxForwardStats stats;
+} InfluxForward;
+
+/** live and scratch must each hold the largest batch; the spool must be initialised. */
+static inline void InfluxForwardInit(InfluxForward *f, const InfluxForwardConfig *cfg, InfluxSpool *spool,
+                                     char *live, uint32_t live_cap, char *scratch, uint32_t scratch_cap,
+                                     InfluxPostFn post, void *post_ctx, uint32_t (*clock_ms)(void)) {
+  memset(f, 0, sizeof(*f));
+  f->cfg = *cfg;
+  f->spool = spool;
+  f->live = live;
+  f->live_cap = live_cap;
+  f->scratch = scratch;
+  f->scratch_cap = scratch_cap;
+  f->post = post;
+  f->post_ctx = post_ctx;
+  f->clock_ms = clock_ms;
+  f->pace_ms = f->win_start_ms = f->retry_ms = clock_ms();
+}
+
+/* 2xx = taken; a permanent 4xx = never will be; everything else is worth retrying */
+static inline bool influx_status_ok(int status) {
+  return status >= 200 && status < 300;
+}
+
+static inline bool influx_status_permanent(int status) {
+  return status >= 400 && status < 500 && status != 401 && status != 403 && status != 404 && status != 408 &&
+         status != 429;
+}
+
+static inline bool influx_can_post(const InfluxForward *f, uint32_t now) {
+  return f->link_up && (int32_t)(now - f->retry_ms) >= 0;
+}
+
+/* Post, time it and classify the answer. Returns the status. */
+static inline int influx_post(InfluxForward *f, const char *body, uint32_t len) {
+  uint32_t t0 = f->clock_ms();
+  int status = f->post(f->post_ctx, body, len);
+  uint32_t now = f->clock_ms();
+  uint32_t dt = now - t0;
+  f->stats.status_last = status;
+  f->stats.post_ms_last = dt;
+  if (dt > f->stats.post_ms_max) f->stats.post_ms_max = dt;
+  if (influx_status_ok(status)) {
+    f->stats.posts++;
+    f->backoff = 0;
+  } else if (influx_status_permanent(status)) {
+    f->stats.batches_rejected++;
+  } else {
+    f->stats.post_failures++;
+    f->backoff = f->backoff ? f->backoff * 2 : f->cfg.backoff_min_ms;
+    if (f->backoff > f->cfg.backoff_max_ms) f->backoff = f->cfg.backoff_max_ms;
+    f->retry_ms = now + f->backoff;
+  }
+  return status;
+}
+
+/* Post the live batch, or spool it, and start a new one */
+static inline void influx_seal(InfluxForward *f, uint32_t now) {
+  if (!f->live_points) return;
+  bool done = false;
+  if (influx_can_post(f, now)) {
+    int status = influx_post(f, f->live, f->live_len);
+    if (influx_status_ok(status)) {
+      f->stats.points_live += f->live_points;
+      done = true;
+    } else if (influx_status_permanent(status)) {
+      f->stats.points_dropped += f->live_points;
+      done = true;
+    }
+  }
+  if (!done) {
+    if (InfluxSpoolPut(f->spool, f->live, f->live_len, f->live_points)) {
+      f->stats.points_spooled += f->live_points;
+    } else {
+      f->stats.points_dropped += f->live_points;
+    }
+  }
+  f->live_len = 0;
+  f->live_points = 0;
+}
+
+/** Append one point line (from InfluxFormatPoint). A full batch is sealed first. */
+static inline void InfluxForwardAdd(InfluxForward *f, const char *line, size_t len) {
+  if (len > f->live_cap) return;
+  uint32_t now = f->clock_ms();
+  if (f->live_len + len > f->live_cap) influx_seal(f, now);
+  if (!f->live_points) f->live_start_ms = now;
+  memcpy(f->live + f->live_len, line, len);
+  f->live_len += (uint32_t)len;
+  f->live_points++;
+  if (f->live_points >= f->cfg.batch_points) influx_seal(f, now);
+}
+
+/** Seal a due batch, then send at most one spooled batch within the drain budget. Call often
+ *  (every 100 ms or so): the drain rate is bounded by the budget, not by the call rate. */
+static inline void InfluxForwardPoll(InfluxForward *f, bool link_up) {
+  uint32_t now = f->clock_ms();
+  f->link_up = link_up;
+
+  /* Drain budget: refill, with at most one second of burst. A batch larger than that is still sent
+   * once the bucket is positive; the debt it leaves is paid before the next one. */
+  f->tokens += (int64_t)f->cfg.drain_Bps * (now - f->pace_ms) / 1000;
+  if (f->tokens > (int64_t)f->cfg.drain_Bps) f->tokens = f->cfg.drain_Bps;
+  f->pace_ms = now;
+
+  if (f->live_points && now - f->live_start_ms >= f->cfg.batch_ms) influx_seal(f, now);
+
+  now = f->clock_ms();
+  if (f->spool->batches && f->tokens > 0 && influx_can_post(f, now)) {
+    uint32_t len, points;
+    if (InfluxSpoolPeek(f->spool, f->scratch, f->scratch_cap, &len, &points)) {
+      int status = influx_post(f, f->scratch, len);
+      if (influx_status_ok(status) || influx_status_permanent(status)) {
+        InfluxSpoolPop(f->spool);
+        f->tokens -= len;  /* may go negative: the debt is paid before the next batch */
+        if (influx_status_ok(status)) {
+          f->stats.points_drained += points;
+          f->win_bytes += len;
+          f->win_points += points;
+        } else {
+          f->stats.points_dropped += points;
+        }
+      }
+    }
+  }
+
+  now = f->clock_ms();
+  uint32_t span = now - f->win_start_ms;
+  if (span >= f->cfg.rate_window_ms) {
+    f->stats.drain_Bps = (uint32_t)((uint64_t)f->win_bytes * 1000 / span);
+    f->stats.drain_pps = (uint32_t)((uint64_t)f->win_points * 1000 / span);
+    f->win_bytes = f->win_points = 0;
+    f->win_start_ms = now;
+  }
+  f->stats.backoff_ms = (int32_t)(f->retry_ms - now) > 0 ? f->retry_ms - now : 0;
+}
+
+#endif /* INFLUX_FORWARD_H */
@@ -0,0 +1,119 @@
+/**
+ * @file influx_line.h
+ * InfluxDB line protocol for the uploader (docs/INFLUX.md), shared by the firmware (influx_up.cpp)
+ * and the host test (test/influx_up). Header-only and free of Arduino dependencies.
+ *
+ * One point per sample, timestamps in Unix milliseconds (the write URL carries precision=ms):
+ *
+ *   shunt,device=3a9f10,site=north v=13.2140,i=-2.3110,p=-30.530,wh=-112.402,soc=81.2,t=24.50 1760601600000
+ *
+ * Fields that are unknown (NaN: no SOC model, sensor without a die thermometer) are left out of the
+ * line rather than written as a value.
+ */
+#ifndef INFLUX_LINE_H
+#define INFLUX_LINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define INFLUX_LINE_MAX 192     /* longest point line, series key included */
+#define INFLUX_SERIES_MAX 96    /* measurement and tag set */
+
+typedef struct {
+  int64_t t_ms;                 /* Unix time */
+  float   v;                    /* means over the sample period */
+  float   i;
+  float   p;
+  double  wh;
+  float   soc;                  /* %, NaN = unknown */
+  float   temp_C;               /* NaN = unknown */
+} InfluxPoint;
+
+/** Tag set as typed on the console, e.g. "site=north,bank=a": key=value pairs separated by commas,
+ *  neither side empty, no spaces, quotes, backslashes or '=' inside a key or value. Empty is valid. */
+static inline bool InfluxTagsValid(const char *tags) {
+  if (!tags) return false;
+  bool in_value = false;
+  size_t run = 0;
+  for (const char *c = tags; *c; c++) {
+    if (*c == ' ' || *c == '"' || *c == '\\' || (unsigned char)*c < 0x20) return false;
+    if (*c == '=') {
+      if (in_value || run == 0) return false;
+      in_value = true;
+      run = 0;
+    } else if (*c == ',') {
+      if (!in_value || run == 0) return false;
+      in_value = false;
+      run = 0;
+    } else {
+      run++;
+    }
+  }
+  return tags[0] == '\0' || (in_value && run > 0);
+}
+
+/** Series key "<measurement>,device=<id>[,<tags>]". The measurement and id must not need escaping
+ *  (the firmware uses a fixed name and hex digits); tags must pass InfluxTagsValid(). Returns the
+ *  length, or 0 when it does not fit. */
+static inline size_t InfluxSeries(char *dst, size_t cap, const char *measurement, const char *device,
+                                  const char *tags) {
+  int n = snprintf(dst, cap, "%s,device=%s%s%s", measurement, device, (tags && tags[0]) ? "," : "",
+                   tags ? tags : "");
+  if (n < 0 || (size_t)n >= cap) return 0;
+  return (size_t)n;
+}
+
+/** One point line, newline included. Returns the length, or 0 when it does not fit or when a field
+ *  that is always written (v, i, p, wh) is not finite. */
+static inline size_t InfluxFormatPoint(char *dst, size_t cap, const char *series, const InfluxPoint *pt) {
+  if (!isfinite(pt->v) || !isfinite(pt->i) || !isfinite(pt->p) || !isfinite(pt->wh)) return 0;
+  int n = snprintf(dst, cap, "%s v=%.4f,i=%.4f,p=%.3f,wh=%.3f", series, (double)pt->v, (double)pt->i,
+                   (double)pt->p, pt->wh);
+  if (n < 0 || (size_t)n >= cap) return 0;
+  size_t len = (size_t)n;
+  if (isfinite(pt->soc)) {
+    n = snprintf(dst + len, cap - len, ",soc=%.1f", (double)pt->soc);
+    if (n < 0 || (size_t)n >= cap - len) return 0;
+    len += (size_t)n;
+  }
+  if (isfinite(pt->temp_C)) {
+    n = snprintf(dst + len, cap - len, ",t=%.2f", (double)pt->temp_C);
+    if (n < 0 || (size_t)n >= cap - len) return 0;
+    len += (size_t)n;
+  }
+  n = snprintf(dst + len, cap - len, " %lld\n", (long long)pt->t_ms);
+  if (n < 0 || (size_t)n >= cap - len) return 0;
+  return len + (size_t)n;
+}
+
+/** Days from 1970-01-01 to y-m-d (proleptic Gregorian). */
+static inline int64_t InfluxDaysFromCivil(int y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const int era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = (unsigned)(y - era * 400);
+  const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return (int64_t)era * 146097 + (int64_t)doe - 719468;
+}
+
+/** HTTP Date header (RFC 7231 IMF-fixdate, "Thu, 16 Oct 2026 09:12:44 GMT") to Unix seconds.
+ *  Used to set the clock from the server's answers when NTP is unreachable. */
+static inline bool InfluxParseHttpDate(const char *s, int64_t *unix_s) {
+  static const char k_months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  char mon[4];
+  int day, year, hh, mm, ss;
+  if (!s || sscanf(s, "%*3s, %d %3s %d %d:%d:%d GMT", &day, mon, &year, &hh, &mm, &ss) != 6) return false;
+  const char *m = strstr(k_months, mon);
+  if (!m || strlen(mon) != 3 || (m - k_months) % 3) return false;
+  if (day < 1 || day > 31 || year < 1970 || hh > 23 || mm > 59 || ss > 60 || hh < 0 || mm < 0 || ss < 0)
+    return false;
+  unsigned month = (unsigned)((m - k_months) / 3 + 1);
+  *unix_s = InfluxDaysFromCivil(year, month, (unsigned)day) * 86400 + hh * 3600 + mm * 60 + ss;
+  return true;
+}
+
+#endif /* INFLUX_LINE_H */
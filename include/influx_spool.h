@@ -0,0 +1,413 @@
+/**
+ * @file influx_spool.h
+ * Store-and-forward spool of line-protocol batches for the InfluxDB uploader (docs/INFLUX.md), shared
+ * by the firmware (influx_up.cpp) and the host test (test/influx_up). Header-only and free of Arduino
+ * dependencies: the directory backend uses POSIX calls, which the ESP32 VFS maps onto the SD card.
+ *
+ * A spool is a FIFO of batches, each stored as an InfluxSpoolHdr followed by the batch body. Readers
+ * peek the oldest batch, post it, and pop it only once the server took it.
+ *
+ * Backends:
+ * - RAM: a byte ring. When a batch does not fit, the oldest batches are evicted and counted.
+ * - Directory: files NNNNNNNN.IFX of up to file_bytes each, appended one batch at a time and synced.
+ *   A file is deleted once every batch in it is popped; when the spool exceeds max_bytes the oldest
+ *   file is evicted and its batches counted. After a restart the read position starts over at the
+ *   oldest file, so batches popped from it before the restart are sent again (InfluxDB keeps one
+ *   value per series and timestamp, so a repeat is harmless). A batch torn by a power cut at the end
+ *   of the newest file is cut off when the spool is opened; a body that fails its CRC is skipped.
+ *
+ * Optional lock()/unlock() hooks wrap every card access (the SD card shares its SPI bus).
+ */
+#ifndef INFLUX_SPOOL_H
+#define INFLUX_SPOOL_H
+
+#include "crc32.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define INFLUX_SPOOL_MAGIC    0x42584649u  /* "IFXB" */
+#define INFLUX_SPOOL_BODY_MAX 65536u       /* sanity bound when reading headers back */
+
+typedef struct {
+  uint32_t magic;
+  uint32_t len;        /* body bytes */
+  uint32_t points;     /* lines in the body */
+  uint32_t crc;        /* CRC-32 of the body */
+} InfluxSpoolHdr;
+
+typedef enum {
+  INFLUX_SPOOL_NONE = 0,
+  INFLUX_SPOOL_RAM,
+  INFLUX_SPOOL_DIR
+} InfluxSpoolKind;
+
+typedef struct {
+  InfluxSpoolKind kind;
+
+  /* Depth, headers included in bytes */
+  uint32_t batches;
+  uint32_t points;
+  uint64_t bytes;
+  uint32_t dropped_batches;  /* evicted to make room */
+  uint32_t dropped_points;
+  uint32_t errors;           /* failed writes, unreadable batches */
+
+  /* RAM ring */
+  uint8_t *mem;
+  uint32_t cap;
+  uint32_t head;             /* oldest batch */
+  uint32_t used;
+
+  /* Directory */
+  char     dir[48];
+  uint64_t max_bytes;
+  uint32_t file_bytes;
+  uint32_t rd_file;          /* oldest file and read offset in it */
+  uint32_t rd_off;
+  uint32_t wr_file;          /* file being appended and its length */
+  uint32_t wr_off;
+  bool   (*lock)(void);
+  void   (*unlock)(void);
+
+  /* Last successful peek, consumed by pop */
+  uint32_t peek_size;
+  uint32_t peek_points;
+  bool     peeked;
+} InfluxSpool;
+
+/* ─── RAM ring ─── */
+static inline void InfluxSpoolInitRam(InfluxSpool *sp, uint8_t *mem, uint32_t cap) {
+  memset(sp, 0, sizeof(*sp));
+  sp->kind = INFLUX_SPOOL_RAM;
+  sp->mem = mem;
+  sp->cap = cap;
+}
+
+static inline void influx_ring_write(InfluxSpool *sp, uint32_t off, const void *src, uint32_t n) {
+  off %= sp->cap;
+  uint32_t first = sp->cap - off < n ? sp->cap - off : n;
+  memcpy(sp->mem + off, src, first);
+  memcpy(sp->mem, (const uint8_t *)src + first, n - first);
+}
+
+static inline void influx_ring_read(const InfluxSpool *sp, uint32_t off, void *dst, uint32_t n) {
+  off %= sp->cap;
+  uint32_t first = sp->cap - off < n ? sp->cap - off : n;
+  memcpy(dst, sp->mem + off, first);
+  memcpy((uint8_t *)dst + first, sp->mem, n - first);
+}
+
+static inline void influx_ring_drop_oldest(InfluxSpool *sp, bool evicted) {
+  InfluxSpoolHdr h;
+  influx_ring_read(sp, sp->head, &h, sizeof(h));
+  uint32_t size = (uint32_t)sizeof(h) + h.len;
+  sp->head = (sp->head + size) % sp->cap;
+  sp->used -= size;
+  sp->batches--;
+  sp->points -= h.points;
+  sp->bytes -= size;
+  if (evicted) {
+    sp->dropped_batches++;
+    sp->dropped_points += h.points;
+    sp->peeked = false;
+  }
+}
+
+static inline bool influx_ring_put(InfluxSpool *sp, const char *body, uint32_t len, uint32_t points) {
+  InfluxSpoolHdr h = {INFLUX_SPOOL_MAGIC, len, points, Crc32(body, len)};
+  uint32_t size = (uint32_t)sizeof(h) + len;
+  if (size > sp->cap) return false;
+  while (sp->cap - sp->used < size) influx_ring_drop_oldest(sp, true);
+  uint32_t tail = sp->head + sp->used;
+  influx_ring_write(sp, tail, &h, sizeof(h));
+  influx_ring_write(sp, tail + sizeof(h), body, len);
+  sp->used += size;
+  sp->batches++;
+  sp->points += points;
+  sp->bytes += size;
+  return true;
+}
+
+static inline int influx_ring_peek(InfluxSpool *sp, char *buf, uint32_t cap, uint32_t *len, uint32_t *points) {
+  while (sp->batches) {
+    InfluxSpoolHdr h;
+    influx_ring_read(sp, sp->head, &h, sizeof(h));
+    if (h.len > cap) {  /* larger than the reader's buffer: it can never be sent */
+      influx_ring_drop_oldest(sp, false);
+      sp->errors++;
+      continue;
+    }
+    influx_ring_read(sp, sp->head + sizeof(h), buf, h.len);
+    *len = h.len;
+    *points = h.points;
+    sp->peek_size = (uint32_t)sizeof(h) + h.len;
+    sp->peek_points = h.points;
+    return 1;
+  }
+  return 0;
+}
+
+/* ─── Directory ─── */
+static inline void influx_dir_path(const InfluxSpool *sp, uint32_t idx, char *buf, size_t len) {
+  snprintf(buf, len, "%s/%08lu.IFX", sp->dir, (unsigned long)idx);
+}
+
+static inline bool influx_hdr_ok(const InfluxSpoolHdr *h, uint32_t off, uint32_t file_size) {
+  return h->magic == INFLUX_SPOOL_MAGIC && h->len <= INFLUX_SPOOL_BODY_MAX &&
+         (uint64_t)off + sizeof(*h) + h->len <= file_size;
+}
+
+/* Walk the headers of one file from off. Returns the offset after the last whole batch. */
+static inline uint32_t influx_dir_walk(int fd, uint32_t off, uint32_t file_size, uint32_t *batches,
+                                       uint32_t *points) {
+  InfluxSpoolHdr h;
+  while (pread(fd, &h, sizeof(h), (off_t)off) == (ssize_t)sizeof(h) && influx_hdr_ok(&h, off, file_size)) {
+    off += (uint32_t)sizeof(h) + h.len;
+    (*batches)++;
+    *points += h.points;
+  }
+  return off;
+}
+
+static inline uint32_t influx_file_size(int fd) {
+  struct stat st;
+  return fstat(fd, &st) == 0 ? (uint32_t)st.st_size : 0;
+}
+
+/** Open (or create) the spool in dir and count what is already in it. False if dir is unusable. */
+static inline bool InfluxSpoolInitDir(InfluxSpool *sp, const char *dir, uint64_t max_bytes, uint32_t file_bytes,
+                                      bool (*lock)(void), void (*unlock)(void)) {
+  memset(sp, 0, sizeof(*sp));
+  snprintf(sp->dir, sizeof(sp->dir), "%s", dir);
+  sp->max_bytes = max_bytes;
+  sp->file_bytes = file_bytes;
+  sp->lock = lock;
+  sp->unlock = unlock;
+  if (sp->lock && !sp->lock()) return false;
+  mkdir(sp->dir, 0755);
+  DIR *d = opendir(sp->dir);
+  bool ok = d != NULL;
+  uint32_t lo = UINT32_MAX, hi = 0;
+  if (d) {
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+      char *end = NULL;
+      unsigned long idx = strtoul(e->d_name, &end, 10);
+      if (end == e->d_name || strcasecmp(end, ".IFX") != 0) continue;
+      if (idx < lo) lo = (uint32_t)idx;
+      if (idx > hi) hi = (uint32_t)idx;
+    }
+    closedir(d);
+  }
+  if (!ok || hi == 0) {
+    sp->rd_file = sp->wr_file = 1;
+  } else {
+    sp->rd_file = lo;
+    sp->wr_file = hi;
+    for (uint32_t idx = lo; idx <= hi; idx++) {
+      char path[64];
+      influx_dir_path(sp, idx, path, sizeof(path));
+      int fd = open(path, idx == hi ? O_RDWR : O_RDONLY);
+      if (fd < 0) continue;
+      uint32_t size = influx_file_size(fd);
+      uint32_t b = 0, p = 0;
+      uint32_t end = influx_dir_walk(fd, 0, size, &b, &p);
+      if (end < size) {
+        sp->errors++;
+        if (idx == hi) ftruncate(fd, (off_t)end);  /* torn by a power cut */
+      }
+      close(fd);
+      sp->batches += b;
+      sp->points += p;
+      sp->bytes += end;
+      if (idx == hi) sp->wr_off = end;
+    }
+  }
+  if (sp->unlock) sp->unlock();
+  if (ok) sp->kind = INFLUX_SPOOL_DIR;
+  return ok;
+}
+
+/* Everything was read (or the files and the counters disagree): drop what is left, start a fresh file */
+static inline void influx_dir_reset(InfluxSpool *sp) {
+  for (uint32_t idx = sp->rd_file; idx <= sp->wr_file; idx++) {
+    char path[64];
+    influx_dir_path(sp, idx, path, sizeof(path));
+    unlink(path);
+  }
+  sp->batches = 0;
+  sp->points = 0;
+  sp->bytes = 0;
+  sp->rd_file = ++sp->wr_file;
+  sp->rd_off = sp->wr_off = 0;
+}
+
+/* Delete the oldest file, counting the batches in it that were never popped */
+static inline void influx_dir_evict(InfluxSpool *sp) {
+  char path[64];
+  influx_dir_path(sp, sp->rd_file, path, sizeof(path));
+  int fd = open(path, O_RDONLY);
+  if (fd >= 0) {
+    uint32_t b = 0, p = 0;
+    uint32_t size = influx_file_size(fd);
+    uint32_t end = influx_dir_walk(fd, sp->rd_off, size, &b, &p);
+    close(fd);
+    sp->batches -= b < sp->batches ? b : sp->batches;
+    sp->points -= p < sp->points ? p : sp->points;
+    uint64_t gone = end > sp->rd_off ? end - sp->rd_off : 0;
+    sp->bytes -= gone < sp->bytes ? gone : sp->bytes;
+    sp->dropped_batches += b;
+    sp->dropped_points += p;
+  }
+  unlink(path);
+  sp->rd_file++;
+  sp->rd_off = 0;
+  sp->peeked = false;
+}
+
+static inline bool influx_dir_put(InfluxSpool *sp, const char *body, uint32_t len, uint32_t points) {
+  InfluxSpoolHdr h = {INFLUX_SPOOL_MAGIC, len, points, Crc32(body, len)};
+  uint32_t size = (uint32_t)sizeof(h) + len;
+  if (size > sp->file_bytes || size > sp->max_bytes) return false;
+  if (sp->wr_off && sp->wr_off + size > sp->file_bytes) {
+    sp->wr_file++;
+    sp->wr_off = 0;
+  }
+  while (sp->bytes + size > sp->max_bytes && sp->rd_file < sp->wr_file) influx_dir_evict(sp);
+  char path[64];
+  influx_dir_path(sp, sp->wr_file, path, sizeof(path));
+  int fd = open(path, O_WRONLY | O_CREAT, 0644);
+  if (fd < 0) return false;
+  /* Write at the known end: a batch torn by an earlier failure is overwritten */
+  bool ok = lseek(fd, (off_t)sp->wr_off, SEEK_SET) >= 0 && write(fd, &h, sizeof(h)) == (ssize_t)sizeof(h) &&
+            write(fd, body, len) == (ssize_t)len && fsync(fd) == 0;
+  if (!ok) ftruncate(fd, (off_t)sp->wr_off);
+  close(fd);
+  if (!ok) return false;
+  sp->wr_off += size;
+  sp->batches++;
+  sp->points += points;
+  sp->bytes += size;
+  return true;
+}
+
+static inline int influx_dir_peek(InfluxSpool *sp, char *buf, uint32_t cap, uint32_t *len, uint32_t *points) {
+  while (sp->batches) {
+    if (sp->rd_file > sp->wr_file) break;
+    char path[64];
+    influx_dir_path(sp, sp->rd_file, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    uint32_t size = fd >= 0 ? influx_file_size(fd) : 0;
+    if (sp->rd_off >= size) {
+      if (fd >= 0) close(fd);
+      if (sp->rd_file == sp->wr_file) break;  /* counters ran ahead of the files */
+      unlink(path);
+      sp->rd_file++;
+      sp->rd_off = 0;
+      continue;
+    }
+    InfluxSpoolHdr h;
+    bool hdr = pread(fd, &h, sizeof(h), (off_t)sp->rd_off) == (ssize_t)sizeof(h) &&
+               influx_hdr_ok(&h, sp->rd_off, size);
+    if (!hdr) {  /* the rest of this file cannot be framed: give it up */
+      close(fd);
+      sp->errors++;
+      if (sp->rd_file == sp->wr_file) break;
+      influx_dir_evict(sp);
+      continue;
+    }
+    uint32_t frame = (uint32_t)sizeof(h) + h.len;
+    bool body = h.len <= cap && pread(fd, buf, h.len, (off_t)(sp->rd_off + sizeof(h))) == (ssize_t)h.len &&
+                Crc32(buf, h.len) == h.crc;
+    close(fd);
+    if (!body) {  /* skip it as if it had been popped */
+      sp->errors++;
+      sp->rd_off += frame;
+      sp->batches--;
+      sp->points -= h.points < sp->points ? h.points : sp->points;
+      sp->bytes -= frame < sp->bytes ? frame : sp->bytes;
+      continue;
+    }
+    sp->peek_size = frame;
+    sp->peek_points = h.points;
+    *len = h.len;
+    *points = h.points;
+    return 1;
+  }
+  if (sp->batches) influx_dir_reset(sp);  /* files and counters disagree: start clean */
+  return 0;
+}
+
+static inline void influx_dir_pop(InfluxSpool *sp) {
+  sp->rd_off += sp->peek_size;
+  sp->batches--;
+  sp->points -= sp->peek_points < sp->points ? sp->peek_points : sp->points;
+  sp->bytes -= sp->peek_size < sp->bytes ? sp->peek_size : sp->bytes;
+  char path[64];
+  influx_dir_path(sp, sp->rd_file, path, sizeof(path));
+  if (sp->rd_file == sp->wr_file) {
+    if (sp->rd_off >= sp->wr_off) influx_dir_reset(sp);  /* caught up: the next batch starts a fresh file */
+    return;
+  }
+  int fd = open(path, O_RDONLY);
+  uint32_t size = fd >= 0 ? influx_file_size(fd) : 0;
+  if (fd >= 0) close(fd);
+  if (sp->rd_off >= size) {
+    unlink(path);
+    sp->rd_file++;
+    sp->rd_off = 0;
+  }
+}
+
+/* ─── Either backend ─── */
+/** Append a batch. False if it cannot be stored (larger than the spool, write error); the caller
+ *  counts it as lost. Older batches may be evicted to make room. */
+static inline bool InfluxSpoolPut(InfluxSpool *sp, const char *body, uint32_t len, uint32_t points) {
+  bool ok = false;
+  if (sp->kind == INFLUX_SPOOL_RAM) {
+    ok = influx_ring_put(sp, body, len, points);
+  } else if (sp->kind == INFLUX_SPOOL_DIR && (!sp->lock || sp->lock())) {
+    ok = influx_dir_put(sp, body, len, points);
+    if (sp->unlock) sp->unlock();
+  }
+  if (!ok && sp->kind != INFLUX_SPOOL_NONE) sp->errors++;
+  return ok;
+}
+
+/** Copy the oldest batch into buf. Returns 1 with *len and *points set, 0 when the spool is empty
+ *  (or the card is busy). Batches that cannot be read are skipped and counted in errors. */
+static inline int InfluxSpoolPeek(InfluxSpool *sp, char *buf, uint32_t cap, uint32_t *len, uint32_t *points) {
+  int r = 0;
+  sp->peeked = false;
+  if (sp->kind == INFLUX_SPOOL_RAM) {
+    r = influx_ring_peek(sp, buf, cap, len, points);
+  } else if (sp->kind == INFLUX_SPOOL_DIR && (!sp->lock || sp->lock())) {
+    r = influx_dir_peek(sp, buf, cap, len, points);
+    if (sp->unlock) sp->unlock();
+  }
+  sp->peeked = r == 1;
+  return r;
+}
+
+/** Remove the batch returned by the last InfluxSpoolPeek(). */
+static inline void InfluxSpoolPop(InfluxSpool *sp) {
+  if (!sp->peeked) return;
+  sp->peeked = false;
+  if (sp->kind == INFLUX_SPOOL_RAM) {
+    influx_ring_drop_oldest(sp, false);
+  } else if (sp->kind == INFLUX_SPOOL_DIR && (!sp->lock || sp->lock())) {
+    influx_dir_pop(sp);
+    if (sp->unlock) sp->unlock();
+  }
+}
+
+#endif /* INFLUX_SPOOL_H */
@@ -0,0 +1,124 @@
+/**
+ * @file influx_up.h
+ * InfluxDB uploader with store-and-forward (see docs/INFLUX.md).
+ *
+ * Design:
+ * - One task takes a sample every INFLUX_SAMPLE_MS by default (sensor window means for V/I/P, energy,
+ *   SOC and temperature from the live snapshot), formats it as a line-protocol point
+ *   (influx_line.h) and hands it to the forwarder (influx_forward.h), which batches, POSTs and spools.
+ * - HTTP POSTs block only this task, at the lowest priority on core 1.
+ * - Batches that cannot be sent go to a spool: /sd/influx on the microSD card when one is mounted
+ *   (sd_log.h), else a RAM ring of INFLUX_RAM_SPOOL_BYTES. The backlog drains oldest first at up to
+ *   INFLUX_DRAIN_BPS, after the live batch in every cycle.
+ * - Points carry Unix timestamps. The clock is set by NTP once Wi-Fi is up, or from the Date header
+ *   of the server's answers if NTP is unreachable. Until then samples wait in a RAM queue of
+ *   INFLUX_PENDING_POINTS and are stamped once the clock is known.
+ *
+ * Settings live in NVS (namespace "cyd_influx") and are set from the serial console ("influx").
+ * Off until switched on.
+ */
+#ifndef INFLUX_UP_H
+#define INFLUX_UP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef INFLUX_MEASUREMENT
+#define INFLUX_MEASUREMENT "shunt"
+#endif
+#ifndef INFLUX_SAMPLE_MS
+#define INFLUX_SAMPLE_MS 10000            /* default; "influx every" changes it */
+#endif
+#ifndef INFLUX_BATCH_POINTS
+#define INFLUX_BATCH_POINTS 60
+#endif
+#ifndef INFLUX_BATCH_MS
+#define INFLUX_BATCH_MS 60000             /* a batch is sent at least this often */
+#endif
+#ifndef INFLUX_BATCH_BYTES
+#define INFLUX_BATCH_BYTES 6144           /* largest batch body */
+#endif
+#ifndef INFLUX_DRAIN_BPS
+#define INFLUX_DRAIN_BPS 8192             /* default catch-up budget; "influx drain" changes it */
+#endif
+#ifndef INFLUX_RAM_SPOOL_BYTES
+#define INFLUX_RAM_SPOOL_BYTES 24576      /* without a card: ~40 min of backlog at 10 s */
+#endif
+#ifndef INFLUX_SPOOL_MAX_MB
+#define INFLUX_SPOOL_MAX_MB 64            /* on the card: months at 10 s */
+#endif
+#ifndef INFLUX_SPOOL_FILE_BYTES
+#define INFLUX_SPOOL_FILE_BYTES 65536
+#endif
+#ifndef INFLUX_PENDING_POINTS
+#define INFLUX_PENDING_POINTS 180         /* samples held while the clock is unknown */
+#endif
+#ifndef INFLUX_HTTP_TIMEOUT_MS
+#define INFLUX_HTTP_TIMEOUT_MS 5000
+#endif
+#ifndef INFLUX_BACKOFF_MIN_MS
+#define INFLUX_BACKOFF_MIN_MS 2000
+#endif
+#ifndef INFLUX_BACKOFF_MAX_MS
+#define INFLUX_BACKOFF_MAX_MS 60000
+#endif
+#ifndef INFLUX_NTP_SERVER
+#define INFLUX_NTP_SERVER "pool.ntp.org"
+#endif
+
+typedef struct {
+  bool     enabled;
+  bool     clock_set;
+  bool     spool_on_card;      /* false = RAM spool */
+  uint32_t interval_s;         /* sample period */
+  uint32_t drain_budget_Bps;   /* catch-up budget */
+  uint32_t posts;
+  uint32_t post_failures;
+  uint32_t batches_rejected;   /* dropped on a permanent 4xx (bad data) */
+  int      status_last;        /* HTTP status of the last post, <0 = no answer */
+  uint32_t post_ms_last;
+  uint32_t post_ms_max;
+  uint32_t backoff_ms;
+  uint32_t points_live;        /* delivered as soon as their batch was sealed */
+  uint32_t points_drained;     /* delivered from the spool */
+  uint32_t points_spooled;
+  uint32_t points_dropped;     /* rejected, spool write failed, or pending queue overflow */
+  uint16_t points_pending;     /* waiting for the clock */
+  uint32_t spool_batches;      /* current depth */
+  uint32_t spool_points;
+  uint32_t spool_bytes;
+  uint32_t spool_evicted;      /* points evicted from a full spool */
+  uint32_t spool_errors;
+  uint32_t drain_Bps;          /* catch-up throughput over the last 10 s */
+  uint32_t drain_pps;
+} InfluxUpStats;
+
+/** Load settings and start the uploader task (idle while disabled). */
+void InfluxUpInit(void);
+
+/** Save the write URL: the full endpoint, e.g. "http://nas:8086/api/v2/write?org=home&bucket=energy"
+ *  or "http://nas:8086/write?db=energy". precision=ms is added when missing. Plain http only: false
+ *  if the URL does not start with http://, is too long or asks for another precision. Empty = none. */
+bool InfluxUpSetUrl(const char *url);
+
+/** Save the API token, sent as "Authorization: Token <token>" (empty = none). */
+void InfluxUpSetToken(const char *token);
+
+/** Extra tags added to every point, e.g. "site=north" (empty = none). False if not valid. */
+bool InfluxUpSetTags(const char *tags);
+
+/** Sample period, 1..3600 s. False if out of range. */
+bool InfluxUpSetInterval(uint32_t seconds);
+
+/** Catch-up budget, 512..262144 B/s. False if out of range. */
+bool InfluxUpSetDrainRate(uint32_t bytes_per_s);
+
+void InfluxUpSetEnabled(bool on);
+
+void InfluxUpGetStats(InfluxUpStats *out);
+
+/** One-line status, e.g. "nas:8086 ok, spool 12 batches on SD" or "off". */
+void InfluxUpGetInfo(char *buf, size_t len);
+
+#endif /* INFLUX_UP_H */
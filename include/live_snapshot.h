@@ -0,0 +1,34 @@
+/**
+ * @file live_snapshot.h
+ * Latest readings for the network interfaces (HTTP, BLE, and later ones), refreshed from loop() with the
+ * VE.Direct report (every UPDATE_INTERVAL_MS).
+ *
+ * Request handlers read the snapshot instead of the sensor: a copy under a spinlock, no I2C, so a
+ * busy bus or a slow sensor never delays a response and a burst of requests never loads the bus.
+ */
+#ifndef LIVE_SNAPSHOT_H
+#define LIVE_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+  uint32_t seq;             /* +1 per refresh; 0 = never refreshed */
+  uint32_t t_ms;            /* millis() at refresh */
+  uint32_t op_s;            /* operating seconds (session_stats.h) */
+  float    voltage_V;       /* means since the previous refresh */
+  float    current_A;
+  float    power_W;
+  double   energy_Wh;
+  float    temperature_C;   /* die temperature; 0 on chips without one (INA226/219) */
+  float    soc_percent;     /* state of charge; NAN while no SOC model is configured */
+  bool     sensor_connected;
+  uint32_t sample_rate_hz;
+} LiveSnapshot;
+
+void LiveSnapshotPublish(const LiveSnapshot *s);
+
+/** Copy of the latest snapshot (seq 0 before the first refresh). */
+void LiveSnapshotGet(LiveSnapshot *out);
+
+#endif /* LIVE_SNAPSHOT_H */
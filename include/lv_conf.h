@@ -88,11 +88,16 @@
  * - LV_OS_RTTHREAD
  * - LV_OS_WINDOWS
  * - LV_OS_CUSTOM */
-#define LV_USE_OS   LV_OS_NONE
+#define LV_USE_OS   LV_OS_FREERTOS
 
 #if LV_USE_OS == LV_OS_CUSTOM
     #define LV_OS_CUSTOM_INCLUDE <stdint.h>
 #endif
+#if LV_USE_OS == LV_OS_FREERTOS
+    /*LVGL runs in one dedicated task (ui_lvgl.cpp), so it can be woken by a direct task notification
+     *instead of a binary semaphore (faster and uses less RAM).*/
+    #define LV_USE_FREERTOS_TASK_NOTIFY 1
+#endif
 
 /*========================
  * RENDERING CONFIGURATION
@@ -104,12 +109,22 @@
 /*Align the start address of draw_buf addresses to this bytes*/
 #define LV_DRAW_BUF_ALIGN                       4
 
+/*Stack size of each draw unit thread (only used when LV_DRAW_SW_DRAW_UNIT_CNT > 1 / an OS is enabled)*/
+#define LV_DRAW_THREAD_STACK_SIZE    (8 * 1024)   /*[bytes]*/
+
 #define LV_USE_DRAW_SW 1
 #if LV_USE_DRAW_SW == 1
     /* Set the number of draw unit.
      * > 1 requires an operating system enabled in `LV_USE_OS`
-     * > 1 means multiply threads will render the screen in parallel */
-    #define LV_DRAW_SW_DRAW_UNIT_CNT    1
+     * > 1 means multiply threads will render the screen in parallel
+     * CYD: build env "cyd-2du" sets CYD_LVGL_DRAW_UNITS=2 so both ESP32 cores rasterise. */
+    #ifndef CYD_LVGL_DRAW_UNITS
+    #define CYD_LVGL_DRAW_UNITS         1
+    #endif
+    #define LV_DRAW_SW_DRAW_UNIT_CNT    CYD_LVGL_DRAW_UNITS
+    #if LV_DRAW_SW_DRAW_UNIT_CNT > 1 && LV_USE_OS == LV_OS_NONE
+    #error "CYD_LVGL_DRAW_UNITS > 1 needs LV_USE_OS (LV_OS_FREERTOS)"
+    #endif
 
     /* Use Arm-2D to accelerate the sw render */
     #define LV_USE_DRAW_ARM2D_SYNC      0
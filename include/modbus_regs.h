@@ -0,0 +1,355 @@
+/**
+ * @file modbus_regs.h
+ * Register map and request handling of the Modbus slave (docs/MODBUS.md), shared by the firmware
+ * (modbus_slave.cpp) and the host test (test/modbus_regs). Header-only and free of Arduino
+ * dependencies.
+ *
+ * The slave answers from a precomputed image of MB_REG_COUNT registers. MbBuildImage() fills it from
+ * plain values. MbHandlePdu() serves reads from it and never computes a value. Input registers
+ * (FC 04) and holding registers (FC 03) read the same image, for masters that only support one
+ * of the two. The only writable register is the command register MB_HREG_COMMAND (FC 06 / FC 16).
+ *
+ * 32-bit values take two registers, high word first. Scaled integers saturate and never wrap.
+ * "Unknown" values read 0xFFFF (unsigned) or 0x8000 (signed) in the scaled form, and NaN in the
+ * float block.
+ */
+#ifndef MODBUS_REGS_H
+#define MODBUS_REGS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#define MB_MAP_VERSION      1
+#define MB_REG_COUNT        128    /* image size: input and holding registers 0..127 */
+#define MB_READ_MAX         125    /* registers per read request (protocol limit) */
+#define MB_PDU_MAX          253
+#define MB_RTU_ADU_MAX      256    /* address + PDU + CRC */
+#define MB_TCP_MBAP         7      /* transaction, protocol, length, unit */
+#define MB_TCP_ADU_MAX      (MB_TCP_MBAP + MB_PDU_MAX)
+
+/* ─── Register map ─── */
+enum {
+  /* Status */
+  MB_REG_MAP_VERSION = 0,    /* u16, MB_MAP_VERSION */
+  MB_REG_STATUS      = 1,    /* u16, MB_STATUS_* bits */
+  MB_REG_AGE_MS      = 2,    /* u16, age of the readings when the image was built (saturates) */
+  MB_REG_RATE_HZ     = 3,    /* u16, acquisition rate */
+  MB_REG_SEQ         = 4,    /* u32, +1 per refresh of the readings */
+  MB_REG_OP_S        = 6,    /* u32, operating seconds */
+
+  /* Live readings, scaled integers */
+  MB_REG_VOLTAGE     = 16,   /* i32, mV */
+  MB_REG_CURRENT     = 18,   /* i32, mA, positive = charging */
+  MB_REG_POWER       = 20,   /* i32, mW */
+  MB_REG_ENERGY      = 22,   /* i32, mWh */
+  MB_REG_SOC         = 24,   /* u16, 0.01 %, 0xFFFF = unknown */
+  MB_REG_TEMPERATURE = 25,   /* i16, 0.01 degC, 0x8000 = unknown */
+
+  /* Live readings, IEEE 754 float32 */
+  MB_REG_F_VOLTAGE     = 32, /* V */
+  MB_REG_F_CURRENT     = 34, /* A */
+  MB_REG_F_POWER       = 36, /* W */
+  MB_REG_F_ENERGY      = 38, /* Wh */
+  MB_REG_F_TEMPERATURE = 40, /* degC, NaN = unknown */
+  MB_REG_F_SOC         = 42, /* %, NaN = unknown */
+
+  /* Statistics: one MB_ST_SIZE block per scope */
+  MB_REG_SESSION  = 64,
+  MB_REG_LIFETIME = 96,
+};
+
+/* Offsets in a statistics block */
+enum {
+  MB_ST_AH_IN        = 0,    /* u32, mAh into the battery */
+  MB_ST_AH_OUT       = 2,    /* u32, mAh out */
+  MB_ST_PEAK_POWER   = 4,    /* i32, mW, largest |P| */
+  MB_ST_V_MIN        = 6,    /* i32, mV */
+  MB_ST_V_MAX        = 8,
+  MB_ST_V_MEAN       = 10,
+  MB_ST_I_MIN        = 12,   /* i32, mA */
+  MB_ST_I_MAX        = 14,
+  MB_ST_I_MEAN       = 16,
+  MB_ST_CHARGE_S     = 18,   /* u32, seconds charging */
+  MB_ST_DISCHARGE_S  = 20,   /* u32, seconds discharging */
+  MB_ST_IDLE_S       = 22,   /* u32, seconds idle */
+  MB_ST_START_S      = 24,   /* u32, operating seconds when the scope started */
+  MB_ST_SAMPLES      = 26,   /* u32, samples in the scope */
+  MB_ST_SIZE         = 32,
+};
+
+#define MB_STATUS_SENSOR      0x0001  /* sensor connected */
+#define MB_STATUS_STALE       0x0002  /* readings older than MB_STALE_MS */
+#define MB_STATUS_NO_DATA     0x0004  /* no readings since boot */
+#define MB_STATUS_SOC         0x0008  /* SOC known */
+#define MB_STALE_MS           5000
+
+#define MB_HREG_COMMAND       256     /* write-only holding register, reads 0 */
+#define MB_CMD_RESET_SESSION  1       /* clear the session statistics */
+
+/* Function and exception codes */
+#define MB_FC_READ_HOLDING    0x03
+#define MB_FC_READ_INPUT      0x04
+#define MB_FC_WRITE_SINGLE    0x06
+#define MB_FC_WRITE_MULTIPLE  0x10
+#define MB_EX_ILLEGAL_FUNCTION 0x01
+#define MB_EX_ILLEGAL_ADDRESS  0x02
+#define MB_EX_ILLEGAL_VALUE    0x03
+
+/* ─── Image ─── */
+typedef struct {
+  double   ah_in;
+  double   ah_out;
+  float    peak_power_W;
+  float    v_min, v_max, v_mean;
+  float    i_min, i_max, i_mean;
+  uint32_t charge_s;
+  uint32_t discharge_s;
+  uint32_t idle_s;
+  uint32_t start_s;
+  uint32_t samples;
+} MbStatsValues;
+
+typedef struct {
+  uint32_t seq;              /* 0 = no readings yet */
+  uint32_t age_ms;
+  uint32_t op_s;
+  uint32_t rate_hz;
+  bool     sensor_connected;
+  float    voltage_V;
+  float    current_A;
+  float    power_W;
+  double   energy_Wh;
+  float    temperature_C;    /* NaN = unknown */
+  float    soc_percent;      /* NaN = unknown */
+  MbStatsValues session;
+  MbStatsValues lifetime;
+} MbValues;
+
+/** x * scale rounded to the nearest integer, saturated to [lo, hi]; NaN maps to nan_value. */
+static inline int32_t MbScale(double x, double scale, int32_t lo, int32_t hi, int32_t nan_value) {
+  double q = x * scale;
+  if (!(q == q)) return nan_value;
+  if (q >= (double)hi) return hi;
+  if (q <= (double)lo) return lo;
+  return (int32_t)lround(q);
+}
+
+static inline void MbPut32(uint16_t *r, uint32_t v) {
+  r[0] = (uint16_t)(v >> 16);
+  r[1] = (uint16_t)v;
+}
+
+static inline uint32_t MbGet32(const uint16_t *r) {
+  return ((uint32_t)r[0] << 16) | r[1];
+}
+
+static inline void MbPutI32(uint16_t *r, double x, double scale) {
+  MbPut32(r, (uint32_t)MbScale(x, scale, INT32_MIN, INT32_MAX, 0));
+}
+
+static inline void MbPutU32(uint16_t *r, double x, double scale) {
+  /* Full uint32 range: charge counters must not clip at INT32_MAX */
+  double q = x * scale;
+  uint32_t v = !(q == q) || q <= 0 ? 0 : q >= 4294967295.0 ? 0xFFFFFFFFu : (uint32_t)llround(q);
+  MbPut32(r, v);
+}
+
+static inline void MbPutFloat(uint16_t *r, float f) {
+  uint32_t u;
+  memcpy(&u, &f, sizeof(u));
+  MbPut32(r, u);
+}
+
+static inline float MbGetFloat(const uint16_t *r) {
+  uint32_t u = MbGet32(r);
+  float f;
+  memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+static inline void MbBuildStats(uint16_t *b, const MbStatsValues *s) {
+  MbPutU32(b + MB_ST_AH_IN, s->ah_in, 1e3);
+  MbPutU32(b + MB_ST_AH_OUT, s->ah_out, 1e3);
+  MbPutI32(b + MB_ST_PEAK_POWER, s->peak_power_W, 1e3);
+  MbPutI32(b + MB_ST_V_MIN, s->v_min, 1e3);
+  MbPutI32(b + MB_ST_V_MAX, s->v_max, 1e3);
+  MbPutI32(b + MB_ST_V_MEAN, s->v_mean, 1e3);
+  MbPutI32(b + MB_ST_I_MIN, s->i_min, 1e3);
+  MbPutI32(b + MB_ST_I_MAX, s->i_max, 1e3);
+  MbPutI32(b + MB_ST_I_MEAN, s->i_mean, 1e3);
+  MbPut32(b + MB_ST_CHARGE_S, s->charge_s);
+  MbPut32(b + MB_ST_DISCHARGE_S, s->discharge_s);
+  MbPut32(b + MB_ST_IDLE_S, s->idle_s);
+  MbPut32(b + MB_ST_START_S, s->start_s);
+  MbPut32(b + MB_ST_SAMPLES, s->samples);
+}
+
+/** Fill the whole image; unused registers read 0. */
+static inline void MbBuildImage(const MbValues *v, uint16_t regs[MB_REG_COUNT]) {
+  memset(regs, 0, MB_REG_COUNT * sizeof(uint16_t));
+  uint16_t status = 0;
+  if (v->sensor_connected) status |= MB_STATUS_SENSOR;
+  if (!v->seq) status |= MB_STATUS_NO_DATA;
+  else if (v->age_ms > MB_STALE_MS) status |= MB_STATUS_STALE;
+  if (v->soc_percent == v->soc_percent) status |= MB_STATUS_SOC;
+  regs[MB_REG_MAP_VERSION] = MB_MAP_VERSION;
+  regs[MB_REG_STATUS] = status;
+  regs[MB_REG_AGE_MS] = (uint16_t)(v->age_ms > 0xFFFF ? 0xFFFF : v->age_ms);
+  regs[MB_REG_RATE_HZ] = (uint16_t)(v->rate_hz > 0xFFFF ? 0xFFFF : v->rate_hz);
+  MbPut32(regs + MB_REG_SEQ, v->seq);
+  MbPut32(regs + MB_REG_OP_S, v->op_s);
+
+  MbPutI32(regs + MB_REG_VOLTAGE, v->voltage_V, 1e3);
+  MbPutI32(regs + MB_REG_CURRENT, v->current_A, 1e3);
+  MbPutI32(regs + MB_REG_POWER, v->power_W, 1e3);
+  MbPutI32(regs + MB_REG_ENERGY, v->energy_Wh, 1e3);
+  regs[MB_REG_SOC] = (uint16_t)MbScale(v->soc_percent, 100.0, 0, 10000, 0xFFFF);
+  /* 0x8000 is the "unknown" marker, so real values saturate one above it */
+  regs[MB_REG_TEMPERATURE] = (uint16_t)(int16_t)MbScale(v->temperature_C, 100.0, INT16_MIN + 1, INT16_MAX, INT16_MIN);
+
+  MbPutFloat(regs + MB_REG_F_VOLTAGE, v->voltage_V);
+  MbPutFloat(regs + MB_REG_F_CURRENT, v->current_A);
+  MbPutFloat(regs + MB_REG_F_POWER, v->power_W);
+  MbPutFloat(regs + MB_REG_F_ENERGY, (float)v->energy_Wh);
+  MbPutFloat(regs + MB_REG_F_TEMPERATURE, v->temperature_C);
+  MbPutFloat(regs + MB_REG_F_SOC, v->soc_percent);
+
+  MbBuildStats(regs + MB_REG_SESSION, &v->session);
+  MbBuildStats(regs + MB_REG_LIFETIME, &v->lifetime);
+}
+
+/* ─── Requests ─── */
+static inline uint16_t MbGetU16BE(const uint8_t *p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline void MbPutU16BE(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+static inline size_t MbException(uint8_t *resp, uint8_t fc, uint8_t code) {
+  resp[0] = (uint8_t)(fc | 0x80);
+  resp[1] = code;
+  return 2;
+}
+
+/**
+ * Answer one request PDU (function code + data) from the image into resp (MB_PDU_MAX bytes).
+ * Returns the response PDU length, exceptions included; 0 for a request too short to parse.
+ * A valid write of the command register stores its value in *command (left alone otherwise).
+ */
+static inline size_t MbHandlePdu(const uint16_t image[MB_REG_COUNT], const uint8_t *req, size_t len,
+                                 uint8_t *resp, uint16_t *command) {
+  if (len < 1) return 0;
+  uint8_t fc = req[0];
+  switch (fc) {
+    case MB_FC_READ_HOLDING:
+    case MB_FC_READ_INPUT: {
+      if (len != 5) return MbException(resp, fc, MB_EX_ILLEGAL_VALUE);
+      uint16_t addr = MbGetU16BE(req + 1);
+      uint16_t qty = MbGetU16BE(req + 3);
+      if (qty < 1 || qty > MB_READ_MAX) return MbException(resp, fc, MB_EX_ILLEGAL_VALUE);
+      resp[0] = fc;
+      resp[1] = (uint8_t)(qty * 2);
+      if (fc == MB_FC_READ_HOLDING && addr == MB_HREG_COMMAND && qty == 1) {
+        MbPutU16BE(resp + 2, 0);
+        return 4;
+      }
+      if ((uint32_t)addr + qty > MB_REG_COUNT) return MbException(resp, fc, MB_EX_ILLEGAL_ADDRESS);
+      for (uint16_t k = 0; k < qty; k++) MbPutU16BE(resp + 2 + 2 * k, image[addr + k]);
+      return 2 + 2 * (size_t)qty;
+    }
+    case MB_FC_WRITE_SINGLE: {
+      if (len != 5) return MbException(resp, fc, MB_EX_ILLEGAL_VALUE);
+      uint16_t addr = MbGetU16BE(req + 1);
+      uint16_t value = MbGetU16BE(req + 3);
+      if (addr != MB_HREG_COMMAND) return MbException(resp, fc, MB_EX_ILLEGAL_ADDRESS);
+      if (value != MB_CMD_RESET_SESSION) return MbException(resp, fc, MB_EX_ILLEGAL_VALUE);
+      *command = value;
+      memcpy(resp, req, 5);  /* echo */
+      return 5;
+    }
+    case MB_FC_WRITE_MULTIPLE: {
+      if (len < 6 || len != 6 + (size_t)req[5]) return MbException(resp, fc, MB_EX_ILLEGAL_VALUE);
+      uint16_t addr = MbGetU16BE(req + 1);
+      uint16_t qty = MbGetU16BE(req + 3);
+      if (qty < 1 || req[5] != qty * 2) return MbException(resp, fc, MB_EX_ILLEGAL_VALUE);
+      if (addr != MB_HREG_COMMAND || qty != 1) return MbException(resp, fc, MB_EX_ILLEGAL_ADDRESS);
+      uint16_t value = MbGetU16BE(req + 6);
+      if (value != MB_CMD_RESET_SESSION) return MbException(resp, fc, MB_EX_ILLEGAL_VALUE);
+      *command = value;
+      memcpy(resp, req, 5);  /* function, address, quantity */
+      return 5;
+    }
+    default:
+      return MbException(resp, fc, MB_EX_ILLEGAL_FUNCTION);
+  }
+}
+
+/* ─── RTU ─── */
+
+/** CRC-16/MODBUS (poly 0xA001 reflected, init 0xFFFF); sent low byte first. */
+static inline uint16_t MbCrc16(const uint8_t *p, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= p[i];
+    for (int b = 0; b < 8; b++) crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+  }
+  return crc;
+}
+
+#define MB_RTU_IGNORED   0     /* for another slave, or a broadcast (executed, never answered) */
+#define MB_RTU_BAD_FRAME (-1)  /* too short or CRC mismatch: dropped without an answer */
+
+/**
+ * Handle one RTU frame (address, PDU, CRC) addressed to unit (1..247). Returns the reply length
+ * written to out (MB_RTU_ADU_MAX bytes), MB_RTU_IGNORED or MB_RTU_BAD_FRAME.
+ */
+static inline int MbRtuHandle(uint8_t unit, const uint16_t image[MB_REG_COUNT], const uint8_t *frame, size_t len,
+                              uint8_t *out, uint16_t *command) {
+  if (len < 4 || len > MB_RTU_ADU_MAX) return MB_RTU_BAD_FRAME;
+  uint16_t crc = (uint16_t)(frame[len - 2] | (frame[len - 1] << 8));
+  if (MbCrc16(frame, len - 2) != crc) return MB_RTU_BAD_FRAME;
+  uint8_t addr = frame[0];
+  if (addr != unit && addr != 0) return MB_RTU_IGNORED;
+  size_t n = MbHandlePdu(image, frame + 1, len - 3, out + 1, command);
+  if (addr == 0 || !n) return MB_RTU_IGNORED;
+  out[0] = unit;
+  uint16_t c = MbCrc16(out, n + 1);
+  out[n + 1] = (uint8_t)c;
+  out[n + 2] = (uint8_t)(c >> 8);
+  return (int)(n + 3);
+}
+
+/* ─── TCP ─── */
+
+/**
+ * Length of the ADU at the start of a TCP receive buffer: 0 while the MBAP header or the body is
+ * still incomplete, -1 if the header is invalid (the connection should be closed).
+ */
+static inline int MbTcpFrameLength(const uint8_t *buf, size_t avail) {
+  if (avail < MB_TCP_MBAP) return 0;
+  uint16_t proto = MbGetU16BE(buf + 2);
+  uint16_t len = MbGetU16BE(buf + 4);  /* unit + PDU */
+  if (proto != 0 || len < 2 || len > 1 + MB_PDU_MAX) return -1;
+  size_t total = 6 + (size_t)len;
+  return avail < total ? 0 : (int)total;
+}
+
+/**
+ * Answer one complete TCP ADU (MbTcpFrameLength() > 0) into out (MB_TCP_ADU_MAX bytes). The unit
+ * id is echoed and not checked: over TCP the device is the end point. Returns the reply length.
+ */
+static inline size_t MbTcpHandle(const uint16_t image[MB_REG_COUNT], const uint8_t *adu, size_t len, uint8_t *out,
+                                 uint16_t *command) {
+  size_t n = MbHandlePdu(image, adu + MB_TCP_MBAP, len - MB_TCP_MBAP, out + MB_TCP_MBAP, command);
+  memcpy(out, adu, 4);                      /* transaction and protocol id */
+  MbPutU16BE(out + 4, (uint16_t)(n + 1));
+  out[6] = adu[6];                          /* unit id */
+  return MB_TCP_MBAP + n;
+}
+
+#endif /* MODBUS_REGS_H */
@@ -0,0 +1,100 @@
+/**
+ * @file modbus_slave.h
+ * Modbus RTU and TCP slave (see docs/MODBUS.md and modbus_regs.h for the register map).
+ *
+ * Design:
+ * - One task refreshes a precomputed register image every MODBUS_REFRESH_MS from live_snapshot.h and
+ *   session_stats.h. Requests are answered by copying registers out of that image: no request ever
+ *   touches I2C or computes a value, so the answer time does not depend on the sensor or the bus.
+ * - RTU: Serial2 on configurable pins, baud rate and parity, with an optional RS-485 driver-enable
+ *   pin driven by the UART itself. The UART reports the end of a frame (RX idle for ~4 characters);
+ *   the same task parses and answers it.
+ * - TCP: port MODBUS_TCP_PORT over Wi-Fi (wifi_link.h), served from the AsyncTCP task, up to
+ *   MODBUS_TCP_MAX_CLIENTS connections. Several requests in one segment are answered in order.
+ * - A write of the command register (reset session statistics) is only queued by the handler; the
+ *   task carries it out.
+ *
+ * Settings live in NVS (namespace "cyd_modbus") and are set from the serial console ("modbus").
+ * Both sides are off until switched on.
+ */
+#ifndef MODBUS_SLAVE_H
+#define MODBUS_SLAVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef MODBUS_REFRESH_MS
+#define MODBUS_REFRESH_MS 250          /* register image rebuild period */
+#endif
+#ifndef MODBUS_TCP_PORT
+#define MODBUS_TCP_PORT 502
+#endif
+#ifndef MODBUS_TCP_MAX_CLIENTS
+#define MODBUS_TCP_MAX_CLIENTS 4
+#endif
+#ifndef MODBUS_TCP_IDLE_S
+#define MODBUS_TCP_IDLE_S 120          /* a master silent this long is disconnected */
+#endif
+/* RTU pins: none by default. The CYD has no free output pin that is not used by the display, touch,
+ * microSD, the sensor's I2C bus or VE.Direct, so RTU stays closed until `modbus uart` sets pins the
+ * board has freed. */
+#ifndef MODBUS_RTU_RX_PIN
+#define MODBUS_RTU_RX_PIN -1
+#endif
+#ifndef MODBUS_RTU_TX_PIN
+#define MODBUS_RTU_TX_PIN -1
+#endif
+
+typedef struct {
+  uint32_t baud;
+  char     parity;                     /* 'N', 'E' or 'O'; 8 data bits, 1 stop bit */
+  int8_t   rx_pin;
+  int8_t   tx_pin;
+  int8_t   de_pin;                     /* RS-485 driver enable, -1 = none (auto-direction transceiver) */
+} ModbusRtuConfig;
+
+typedef struct {
+  bool     rtu_enabled;
+  bool     tcp_enabled;
+  bool     tcp_listening;
+  uint8_t  unit;
+  uint8_t  tcp_clients;
+  uint32_t refreshes;                  /* register image rebuilds */
+  uint32_t rtu_requests;               /* frames answered */
+  uint32_t rtu_bad_frames;             /* CRC errors, runts */
+  uint32_t rtu_other_unit;             /* for another slave, or broadcast */
+  uint32_t tcp_requests;
+  uint32_t tcp_rejected;               /* connections over MODBUS_TCP_MAX_CLIENTS, bad headers */
+  uint32_t exceptions;                 /* answered with an exception code */
+  uint32_t commands;                   /* command register writes carried out */
+  uint32_t rtu_answer_us_max;          /* end of request frame to reply queued */
+  uint32_t tcp_answer_us_max;          /* request received to reply queued */
+} ModbusSlaveStats;
+
+/** Load settings, build the first image and start the task (RTU and TCP come up if enabled). */
+void ModbusSlaveInit(void);
+
+/** Switch RTU or TCP on or off (saved in NVS). */
+void ModbusSlaveSetRtu(bool on);
+void ModbusSlaveSetTcp(bool on);
+
+/** Slave address for RTU, 1..247 (saved in NVS). False if out of range. */
+bool ModbusSlaveSetUnit(uint8_t unit);
+
+/**
+ * RTU line settings (saved in NVS; the UART is reopened). False if a value is out of range or a pin
+ * is already used on the CYD (display, touch, microSD, I2C, VE.Direct, USB console, flash).
+ * RX, TX and DE all -1 leaves RTU without pins: it stays closed while switched on.
+ */
+bool ModbusSlaveSetRtuConfig(const ModbusRtuConfig *cfg);
+/** Pin check used by ModbusSlaveSetRtuConfig(): free, output-capable for TX and DE, all distinct. */
+bool ModbusSlaveRtuPinsOk(const ModbusRtuConfig *cfg);
+void ModbusSlaveGetRtuConfig(ModbusRtuConfig *out);
+
+void ModbusSlaveGetStats(ModbusSlaveStats *out);
+
+/** One-line status, e.g. "unit 1, RTU 19200 8E1 RX35 TX22, TCP :502 1 client" or "off". */
+void ModbusSlaveGetInfo(char *buf, size_t len);
+
+#endif /* MODBUS_SLAVE_H */
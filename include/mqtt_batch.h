@@ -0,0 +1,280 @@
+/**
+ * @file mqtt_batch.h
+ * Sample queue, message formats and publish policy of the MQTT publisher (docs/MQTT.md), shared by
+ * the firmware (mqtt_pub.cpp) and the host test (test/mqtt_pub). Header-only and free of Arduino
+ * dependencies; the caller owns the clock and the connection.
+ *
+ * - Samples go into a ring queue; when it is full the oldest is dropped and counted. Every sample
+ *   has a sequence number, so a receiver can spot gaps.
+ * - A batch (up to batch_max samples, column layout) is due when batch_max samples are queued
+ *   (catch-up after an outage) or once per interval. The interval starts at sample_ms and doubles
+ *   after a slow or failed publish, up to interval_max_ms; it halves again after a fast one.
+ * - Connection attempts back off exponentially from backoff_min_ms to backoff_max_ms, with up to 25 %
+ *   of jitter so boards restarted by one power cut do not retry in lockstep.
+ */
+#ifndef MQTT_BATCH_H
+#define MQTT_BATCH_H
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+  uint32_t t_ms;
+  float    v;
+  float    i;
+  float    p;
+} MqttSample;
+
+/* ─── Queue ─── */
+typedef struct {
+  MqttSample *buf;
+  uint16_t    cap;
+  uint16_t    head;     /* oldest */
+  uint16_t    count;
+  uint16_t    peak;
+  uint32_t    seq;      /* sequence number of the oldest queued sample */
+  uint32_t    dropped;
+} MqttQueue;
+
+static inline void MqttQueueInit(MqttQueue *q, MqttSample *buf, uint16_t cap) {
+  memset(q, 0, sizeof(*q));
+  q->buf = buf;
+  q->cap = cap;
+}
+
+/** Append a sample. False if the queue was full and the oldest sample was dropped for it. */
+static inline bool MqttQueuePush(MqttQueue *q, const MqttSample *smp) {
+  q->buf[(q->head + q->count) % q->cap] = *smp;
+  if (q->count == q->cap) {
+    q->head = (uint16_t)((q->head + 1) % q->cap);  /* overwrite the oldest */
+    q->seq++;
+    q->dropped++;
+    return false;
+  }
+  q->count++;
+  if (q->count > q->peak) q->peak = q->count;
+  return true;
+}
+
+/** k-th oldest queued sample, k < count. */
+static inline const MqttSample *MqttQueueAt(const MqttQueue *q, uint16_t k) {
+  return &q->buf[(q->head + k) % q->cap];
+}
+
+static inline void MqttQueuePop(MqttQueue *q, uint16_t n) {
+  if (n > q->count) n = q->count;
+  q->head = (uint16_t)((q->head + n) % q->cap);
+  q->count = (uint16_t)(q->count - n);
+  q->seq += n;
+}
+
+/** Drop everything; the sequence number skips the dropped samples. */
+static inline void MqttQueueClear(MqttQueue *q) {
+  MqttQueuePop(q, q->count);
+}
+
+/* ─── Message text ─── */
+typedef struct {
+  char  *buf;
+  size_t cap;
+  size_t len;
+} MqttMsg;
+
+static inline void MqttMsgInit(MqttMsg *m, char *buf, size_t cap) {
+  m->buf = buf;
+  m->cap = cap;
+  m->len = 0;
+  if (cap) buf[0] = '\0';
+}
+
+/** Append formatted text; returns false (and leaves the message as it was) when it does not fit. */
+static inline bool MqttMsgAppend(MqttMsg *m, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static inline bool MqttMsgAppend(MqttMsg *m, const char *fmt, ...) {
+  if (m->len >= m->cap) return false;
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(m->buf + m->len, m->cap - m->len, fmt, ap);
+  va_end(ap);
+  if (n < 0 || (size_t)n >= m->cap - m->len) {
+    m->buf[m->len] = '\0';
+    return false;
+  }
+  m->len += (size_t)n;
+  return true;
+}
+
+/** "key":x with the given decimals. JSON has no NaN: unknown values (no temperature sensor) are null. */
+static inline bool MqttMsgNum(MqttMsg *m, const char *key, double x, int decimals) {
+  if (!isfinite(x)) return MqttMsgAppend(m, "\"%s\":null", key);
+  return MqttMsgAppend(m, "\"%s\":%.*f", key, decimals, x);
+}
+
+/** The n oldest queued samples as one "samples" message:
+ *  {"seq":S,"n":N,"ms":[...],"v":[...],"i":[...],"p":[...]}, keys once per message, not per sample.
+ *  False if it does not fit. */
+static inline bool MqttFormatBatch(MqttMsg *m, const MqttQueue *q, uint16_t n) {
+  static const char *const cols[] = {"ms", "v", "i", "p"};
+  if (n > q->count) n = q->count;
+  m->len = 0;
+  if (!MqttMsgAppend(m, "{\"seq\":%lu,\"n\":%u", (unsigned long)q->seq, (unsigned)n)) return false;
+  for (size_t c = 0; c < 4; c++) {
+    if (!MqttMsgAppend(m, ",\"%s\":[", cols[c])) return false;
+    for (uint16_t k = 0; k < n; k++) {
+      const MqttSample *s = MqttQueueAt(q, k);
+      bool ok;
+      switch (c) {
+        case 0:  ok = MqttMsgAppend(m, "%s%lu", k ? "," : "", (unsigned long)s->t_ms); break;
+        case 1:  ok = MqttMsgAppend(m, "%s%.3f", k ? "," : "", (double)s->v); break;
+        case 2:  ok = MqttMsgAppend(m, "%s%.3f", k ? "," : "", (double)s->i); break;
+        default: ok = MqttMsgAppend(m, "%s%.2f", k ? "," : "", (double)s->p); break;
+      }
+      if (!ok) return false;
+    }
+    if (!MqttMsgAppend(m, "]")) return false;
+  }
+  return MqttMsgAppend(m, "}");
+}
+
+/** Latest values for Home Assistant, the retained "state" message. */
+static inline bool MqttFormatState(MqttMsg *m, float v, float i, float p, double wh, float temp_C) {
+  m->len = 0;
+  return MqttMsgAppend(m, "{") && MqttMsgNum(m, "v", v, 3) && MqttMsgAppend(m, ",") && MqttMsgNum(m, "i", i, 3) &&
+         MqttMsgAppend(m, ",") && MqttMsgNum(m, "p", p, 2) && MqttMsgAppend(m, ",") && MqttMsgNum(m, "wh", wh, 3) &&
+         MqttMsgAppend(m, ",") && MqttMsgNum(m, "t", temp_C, 1) && MqttMsgAppend(m, "}");
+}
+
+/* ─── Home Assistant discovery ─── */
+typedef struct {
+  const char *key;    /* object id and JSON field */
+  const char *name;
+  const char *unit;
+  const char *dev_class;
+  const char *state_class;
+  const char *leaf;   /* state topic under the base */
+  const char *tpl;    /* value template */
+} MqttHaSensor;
+
+static const MqttHaSensor k_mqtt_ha_sensors[] = {
+    {"v",      "Voltage",         "V",    "voltage",     "measurement",      "state", "{{ value_json.v }}"},
+    {"i",      "Current",         "A",    "current",     "measurement",      "state", "{{ value_json.i }}"},
+    {"p",      "Power",           "W",    "power",       "measurement",      "state", "{{ value_json.p }}"},
+    {"wh",     "Energy",          "Wh",   "energy",      "total",            "state", "{{ value_json.wh }}"},
+    {"t",      "Temperature",     "\xC2\xB0""C", "temperature", "measurement", "state", "{{ value_json.t }}"},
+    {"ah_in",  "Charge in",       "Ah",   NULL,          "total_increasing", "stats", "{{ value_json.life.ah_in }}"},
+    {"ah_out", "Charge out",      "Ah",   NULL,          "total_increasing", "stats", "{{ value_json.life.ah_out }}"},
+};
+#define MQTT_HA_SENSOR_COUNT (sizeof(k_mqtt_ha_sensors) / sizeof(k_mqtt_ha_sensors[0]))
+
+/** Retained discovery config of sensor k (< MQTT_HA_SENSOR_COUNT): its topic into topic[], its JSON
+ *  into m. base is "<prefix>/<device id>", model the sensor chip. False if either does not fit. */
+static inline bool MqttFormatDiscovery(MqttMsg *m, char *topic, size_t topic_cap, size_t k, const char *base,
+                                       const char *id, const char *model) {
+  const MqttHaSensor *s = &k_mqtt_ha_sensors[k];
+  int n = snprintf(topic, topic_cap, "homeassistant/sensor/cyd_shunt_%s/%s/config", id, s->key);
+  if (n < 0 || (size_t)n >= topic_cap) return false;
+  m->len = 0;
+  if (!MqttMsgAppend(m,
+                     "{\"name\":\"%s\",\"uniq_id\":\"cyd_shunt_%s_%s\",\"stat_t\":\"%s/%s\",\"val_tpl\":\"%s\","
+                     "\"unit_of_meas\":\"%s\",\"stat_cla\":\"%s\",\"avty_t\":\"%s/status\",",
+                     s->name, id, s->key, base, s->leaf, s->tpl, s->unit, s->state_class, base))
+    return false;
+  if (s->dev_class && !MqttMsgAppend(m, "\"dev_cla\":\"%s\",", s->dev_class)) return false;
+  return MqttMsgAppend(m, "\"dev\":{\"ids\":[\"cyd_shunt_%s\"],\"name\":\"CYD shunt %s\",\"mdl\":\"%s\"}}", id, id,
+                       model);
+}
+
+/* ─── Publish policy ─── */
+typedef struct {
+  uint32_t sample_ms;          /* also the shortest batch interval */
+  uint16_t batch_max;          /* samples per message */
+  uint32_t interval_max_ms;
+  uint32_t slow_publish_us;    /* a publish slower than this widens the interval */
+  uint32_t backoff_min_ms;
+  uint32_t backoff_max_ms;
+  uint32_t stats_ms;           /* statistics message period */
+} MqttPolicyConfig;
+
+typedef struct {
+  MqttPolicyConfig cfg;
+  uint32_t interval;           /* current batch interval */
+  uint32_t last_batch;
+  uint32_t last_stats;
+  uint32_t backoff;            /* 0 = next attempt is the first after a success */
+  uint32_t next_attempt;
+  bool     was_connected;
+} MqttPolicy;
+
+static inline void MqttPolicyInit(MqttPolicy *p, const MqttPolicyConfig *cfg, uint32_t now) {
+  memset(p, 0, sizeof(*p));
+  p->cfg = *cfg;
+  p->interval = cfg->sample_ms;
+  p->next_attempt = now;
+}
+
+/** Settings changed: connect again right away. */
+static inline void MqttPolicyReset(MqttPolicy *p, uint32_t now) {
+  p->backoff = 0;
+  p->next_attempt = now;
+}
+
+static inline bool MqttPolicyConnectDue(const MqttPolicy *p, uint32_t now) {
+  return (int32_t)(now - p->next_attempt) >= 0;
+}
+
+/** Connected: statistics go out right away. */
+static inline void MqttPolicyConnected(MqttPolicy *p, uint32_t now) {
+  p->was_connected = true;
+  p->backoff = 0;
+  p->last_stats = now - p->cfg.stats_ms;
+}
+
+/** Attempt failed at now; rnd is any random number, for the jitter. */
+static inline void MqttPolicyConnectFailed(MqttPolicy *p, uint32_t now, uint32_t rnd) {
+  p->backoff = p->backoff ? p->backoff * 2 : p->cfg.backoff_min_ms;
+  if (p->backoff > p->cfg.backoff_max_ms) p->backoff = p->cfg.backoff_max_ms;
+  p->next_attempt = now + p->backoff + rnd % (p->backoff / 4 + 1);
+}
+
+/** Call while not connected: a connection that was up and dropped waits backoff_min_ms. */
+static inline void MqttPolicyDisconnected(MqttPolicy *p, uint32_t now) {
+  if (!p->was_connected) return;
+  p->was_connected = false;
+  p->backoff = p->cfg.backoff_min_ms;
+  p->next_attempt = now + p->backoff;
+}
+
+/** Samples to send now (0 = not due): a full batch right away, otherwise what is queued once per interval. */
+static inline uint16_t MqttPolicyBatchDue(const MqttPolicy *p, const MqttQueue *q, uint32_t now) {
+  if (q->count >= p->cfg.batch_max) return p->cfg.batch_max;
+  if (q->count && now - p->last_batch >= p->interval) return q->count;
+  return 0;
+}
+
+/** After a batch publish started at now: adapt the interval to how it went. */
+static inline void MqttPolicyBatchDone(MqttPolicy *p, uint32_t now, bool ok, uint32_t publish_us) {
+  p->last_batch = now;
+  if (!ok || publish_us > p->cfg.slow_publish_us) {
+    /* Slow link: wider interval, so more samples per message and fewer messages */
+    p->interval = p->interval * 2 > p->cfg.interval_max_ms ? p->cfg.interval_max_ms : p->interval * 2;
+  } else if (p->interval > p->cfg.sample_ms) {
+    p->interval = p->interval / 2 < p->cfg.sample_ms ? p->cfg.sample_ms : p->interval / 2;
+  }
+}
+
+static inline bool MqttPolicyStatsDue(MqttPolicy *p, uint32_t now) {
+  if (now - p->last_stats < p->cfg.stats_ms) return false;
+  p->last_stats = now;
+  return true;
+}
+
+/** Time left before the next attempt, 0 while connected. */
+static inline uint32_t MqttPolicyBackoffLeft(const MqttPolicy *p, uint32_t now, bool connected) {
+  return (connected || (int32_t)(p->next_attempt - now) < 0) ? 0 : p->next_attempt - now;
+}
+
+#endif /* MQTT_BATCH_H */
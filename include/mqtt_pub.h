@@ -0,0 +1,90 @@
+/**
+ * @file mqtt_pub.h
+ * MQTT publisher with Home Assistant discovery (see docs/MQTT.md).
+ *
+ * Design:
+ * - One task owns the connection (Wi-Fi via wifi_link.h). Connecting, DNS and socket writes block
+ *   only that task, never the UI, the sampler or loop().
+ * - Every MQTT_SAMPLE_MS the task takes its sensor window (sensor.h, per-consumer means) as one
+ *   sample into a RAM queue of MQTT_QUEUE_SAMPLES. Samples are queued whether or not the broker is
+ *   reachable; when the queue is full the oldest is dropped and counted.
+ * - Queued samples go out as one batch message per interval. The interval starts at MQTT_SAMPLE_MS
+ *   (one sample per message) and doubles while publishes are slow or fail, up to
+ *   MQTT_BATCH_INTERVAL_MAX_MS, so a slow link gets fewer, larger messages; it halves again once
+ *   publishes are fast.
+ * - Broker reconnects back off exponentially from MQTT_BACKOFF_MIN_MS to MQTT_BACKOFF_MAX_MS.
+ * - Queue, message formats and policy are in mqtt_batch.h, shared with the host test (test/mqtt_pub).
+ *
+ * Settings live in NVS (namespace "cyd_mqtt") and are set from the serial console ("mqtt").
+ */
+#ifndef MQTT_PUB_H
+#define MQTT_PUB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef MQTT_TOPIC_PREFIX
+#define MQTT_TOPIC_PREFIX "cyd-shunt"     /* base topic: <prefix>/<device id> */
+#endif
+#ifndef MQTT_SAMPLE_MS
+#define MQTT_SAMPLE_MS 1000
+#endif
+#ifndef MQTT_QUEUE_SAMPLES
+#define MQTT_QUEUE_SAMPLES 600            /* 10 min at the default rate */
+#endif
+#ifndef MQTT_BATCH_MAX
+#define MQTT_BATCH_MAX 60                 /* samples per message */
+#endif
+#ifndef MQTT_BATCH_INTERVAL_MAX_MS
+#define MQTT_BATCH_INTERVAL_MAX_MS 30000
+#endif
+#ifndef MQTT_SLOW_PUBLISH_MS
+#define MQTT_SLOW_PUBLISH_MS 250          /* a publish slower than this widens the batch interval */
+#endif
+#ifndef MQTT_STATS_MS
+#define MQTT_STATS_MS 60000               /* statistics message period */
+#endif
+#ifndef MQTT_BACKOFF_MIN_MS
+#define MQTT_BACKOFF_MIN_MS 1000
+#endif
+#ifndef MQTT_BACKOFF_MAX_MS
+#define MQTT_BACKOFF_MAX_MS 60000
+#endif
+#ifndef MQTT_BUFFER_BYTES
+#define MQTT_BUFFER_BYTES 4096            /* largest message, topic included */
+#endif
+
+typedef struct {
+  bool     enabled;
+  bool     connected;
+  uint32_t connects;
+  uint32_t connect_failures;
+  uint32_t backoff_ms;         /* wait before the next attempt (0 while connected) */
+  uint32_t messages;
+  uint32_t publish_failures;
+  uint32_t samples_sent;
+  uint16_t queued;
+  uint16_t queue_peak;
+  uint32_t samples_dropped;    /* queue overflow while the broker was unreachable or slow */
+  uint16_t batch_last;         /* samples in the last batch message */
+  uint16_t batch_max;
+  uint32_t batch_interval_ms;  /* current adaptive interval */
+  uint32_t publish_us_last;
+  uint32_t publish_us_max;
+} MqttPubStats;
+
+/** Load settings and start the publisher task (idle while disabled or offline). */
+void MqttPubInit(void);
+
+/** Save broker address and credentials (NULL/empty user = anonymous) and reconnect. */
+void MqttPubConfigure(const char *host, uint16_t port, const char *user, const char *pass);
+
+void MqttPubSetEnabled(bool on);
+
+void MqttPubGetStats(MqttPubStats *out);
+
+/** One-line status, e.g. "connected to 192.168.1.5:1883, 3 queued" or "off". */
+void MqttPubGetInfo(char *buf, size_t len);
+
+#endif /* MQTT_PUB_H */
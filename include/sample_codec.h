@@ -0,0 +1,96 @@
+/**
+ * @file sample_codec.h
+ * Delta / zigzag-varint coding of quantised (time, voltage, current) samples for the SD log.
+ * Header-only and free of Arduino dependencies so host-side tools can include it too.
+ *
+ * A record is three LEB128 varints relative to the previous sample: the time step in ms (unsigned),
+ * then the zigzag-mapped voltage and current steps in quantum units. A steady reading with a few
+ * LSB of noise costs 3 bytes instead of 12. Deltas use wrapping 32-bit arithmetic, so every
+ * quantised value round-trips exactly.
+ */
+#ifndef SAMPLE_CODEC_H
+#define SAMPLE_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+/** Longest encoded record: three 5-byte varints. */
+#define SAMPLE_CODEC_MAX_RECORD 15
+
+/** One sample in quantum units (value = q * lsb micro-units). */
+typedef struct {
+  uint32_t t_ms;
+  int32_t  v;
+  int32_t  i;
+} SampleCodecPoint;
+
+static inline uint32_t SampleCodecZigzag(int32_t x) {
+  return ((uint32_t)x << 1) ^ (uint32_t)(x >> 31);
+}
+
+static inline int32_t SampleCodecUnzigzag(uint32_t u) {
+  return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+static inline size_t SampleCodecPutVarint(uint8_t *p, uint32_t u) {
+  size_t n = 0;
+  while (u >= 0x80) {
+    p[n++] = (uint8_t)(u | 0x80);
+    u >>= 7;
+  }
+  p[n++] = (uint8_t)u;
+  return n;
+}
+
+/** Returns the bytes consumed, 0 if the varint is truncated or longer than 5 bytes. */
+static inline size_t SampleCodecGetVarint(const uint8_t *p, size_t avail, uint32_t *u) {
+  uint32_t v = 0;
+  for (size_t n = 0; n < avail && n < 5; n++) {
+    v |= (uint32_t)(p[n] & 0x7F) << (7 * n);
+    if (!(p[n] & 0x80)) {
+      *u = v;
+      return n + 1;
+    }
+  }
+  return 0;
+}
+
+/** Physical value -> quantum units (lsb in micro-units, e.g. 100 uV). NaN maps to 0. */
+static inline int32_t SampleCodecQuantise(float x, uint32_t lsb_micro) {
+  double q = (double)x * 1e6 / (double)lsb_micro;
+  if (!(q == q)) return 0;
+  if (q > 2147483647.0) return INT32_MAX;
+  if (q < -2147483648.0) return INT32_MIN;
+  return (int32_t)lround(q);
+}
+
+static inline float SampleCodecDequantise(int32_t q, uint32_t lsb_micro) {
+  return (float)((double)q * (double)lsb_micro * 1e-6);
+}
+
+/** Encode cur relative to prev into out (SAMPLE_CODEC_MAX_RECORD bytes); returns the length. */
+static inline size_t SampleCodecEncode(const SampleCodecPoint *prev, const SampleCodecPoint *cur, uint8_t *out) {
+  size_t n = SampleCodecPutVarint(out, cur->t_ms - prev->t_ms);
+  n += SampleCodecPutVarint(out + n, SampleCodecZigzag((int32_t)((uint32_t)cur->v - (uint32_t)prev->v)));
+  n += SampleCodecPutVarint(out + n, SampleCodecZigzag((int32_t)((uint32_t)cur->i - (uint32_t)prev->i)));
+  return n;
+}
+
+/** Decode one record after prev; returns the bytes consumed, 0 on a malformed record. */
+static inline size_t SampleCodecDecode(const SampleCodecPoint *prev, const uint8_t *in, size_t avail,
+                                       SampleCodecPoint *out) {
+  uint32_t dt, dv, di;
+  size_t a = SampleCodecGetVarint(in, avail, &dt);
+  if (!a) return 0;
+  size_t b = SampleCodecGetVarint(in + a, avail - a, &dv);
+  if (!b) return 0;
+  size_t c = SampleCodecGetVarint(in + a + b, avail - a - b, &di);
+  if (!c) return 0;
+  out->t_ms = prev->t_ms + dt;
+  out->v = (int32_t)((uint32_t)prev->v + (uint32_t)SampleCodecUnzigzag(dv));
+  out->i = (int32_t)((uint32_t)prev->i + (uint32_t)SampleCodecUnzigzag(di));
+  return a + b + c;
+}
+
+#endif /* SAMPLE_CODEC_H */
@@ -0,0 +1,92 @@
+/**
+ * @file sd_log.h
+ * microSD data logger: every sensor sample, in rotating binary files.
+ *
+ * Design:
+ * - A collector task drains the sensor sample ring (sensor.h) into SD_LOG_BLOCK_BYTES RAM blocks
+ *   (whole card sectors, word aligned). Sealed blocks are queued to a writer task that writes each
+ *   one as a single sector-aligned write.
+ * - The sampling path never waits on the card: the sampler only fills the lock-free ring. A stalled
+ *   write backs up into the block pool (SD_LOG_BLOCKS); only when the pool is exhausted are samples
+ *   dropped, and those are counted.
+ * - Samples are quantised (SD_LOG_V_LSB_UV, SD_LOG_I_LSB_UA) and delta/varint coded (sample_codec.h);
+ *   each block starts from a keyframe, so any block decodes on its own.
+ * - Files grow in SD_LOG_PREALLOC_BYTES steps so cluster allocation is paid once per step, not inside
+ *   block writes. A file is truncated to its written length when it is closed.
+ * - A new file starts at every boot and every SD_LOG_ROTATE_S of operating time (daily; the board
+ *   has no real-time clock). The oldest files are deleted while free space is below SD_LOG_MIN_FREE_MB.
+ *
+ * The card shares the VSPI host with touch (spi_bus.h). See docs/SD_LOG.md for the file layout.
+ */
+#ifndef SD_LOG_H
+#define SD_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* CYD microSD slot (VSPI default pins) */
+#define SD_CS_PIN    5
+#define SD_SCK_PIN   18
+#define SD_MISO_PIN  19
+#define SD_MOSI_PIN  23
+
+#ifndef SD_SPI_HZ
+#define SD_SPI_HZ 20000000
+#endif
+#ifndef SD_LOG_BLOCK_BYTES
+#define SD_LOG_BLOCK_BYTES 4096          /* 8 sectors; every block is a keyframe */
+#endif
+#ifndef SD_LOG_BLOCKS
+#define SD_LOG_BLOCKS 6                  /* RAM pool: ~20 s of samples at the default rate */
+#endif
+#ifndef SD_LOG_V_LSB_UV
+#define SD_LOG_V_LSB_UV 100              /* stored voltage quantum; INA228 bus LSB is 195 uV */
+#endif
+#ifndef SD_LOG_I_LSB_UA
+#define SD_LOG_I_LSB_UA 10               /* stored current quantum */
+#endif
+#ifndef SD_LOG_PREALLOC_BYTES
+#define SD_LOG_PREALLOC_BYTES (1024UL * 1024UL)
+#endif
+#ifndef SD_LOG_ROTATE_S
+#define SD_LOG_ROTATE_S 86400
+#endif
+#ifndef SD_LOG_MIN_FREE_MB
+#define SD_LOG_MIN_FREE_MB 64
+#endif
+#ifndef SD_LOG_POLL_MS
+#define SD_LOG_POLL_MS 100               /* collector: ring drain period */
+#endif
+#ifndef SD_LOG_REPORT_MS
+#define SD_LOG_REPORT_MS 60000           /* serial summary period, 0 = off */
+#endif
+
+typedef struct {
+  bool     mounted;
+  uint32_t file_index;       /* current file, /log/NNNNNNNN.BIN */
+  uint64_t bytes_written;
+  uint32_t rate_Bps;         /* sustained over the last report window */
+  uint32_t write_us_last;
+  uint32_t write_us_max;     /* worst single block write since boot, incl. stalls */
+  uint8_t  blocks_total;
+  uint8_t  blocks_hwm;       /* most blocks waiting for the card at once (incl. the one filling) */
+  uint32_t samples_logged;
+  uint32_t samples_dropped;  /* pool exhausted or ring overrun */
+  uint32_t write_errors;
+  uint32_t encode_ns;        /* collector cost per sample (quantise + encode), average since boot */
+  uint16_t ratio_x100;       /* 12-byte raw records vs card bytes used, x100, over sealed blocks */
+} SdLogStats;
+
+/** Mount the card and start logging. spi_instance: main's VSPI SPIClass. False if no card. */
+bool SdLogInit(void *spi_instance);
+
+/** True while a card is mounted and the logger is running. */
+bool SdLogIsReady(void);
+
+void SdLogGetStats(SdLogStats *out);
+
+/** One-line status, e.g. "file 12, 310 B/s, 3.9x, max 310 ms, buf 2/6" or "no card". */
+void SdLogGetInfo(char *buf, size_t len);
+
+#endif /* SD_LOG_H */
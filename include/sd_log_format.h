@@ -0,0 +1,60 @@
+/**
+ * @file sd_log_format.h
+ * On-card block layout of the microSD sample log (docs/SD_LOG.md), shared by the firmware writer
+ * and the host decoder (tools/sdlog_decode). Arduino-free; all fields little-endian.
+ *
+ * Version 1 blocks hold raw 12-byte records. Version 2 (written now) holds a keyframe in the header
+ * and delta-coded records (sample_codec.h) in the payload.
+ */
+#ifndef SD_LOG_FORMAT_H
+#define SD_LOG_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SDLOG_MAGIC       0x44535943  /* "CYSD" */
+#define SDLOG_BLOCK_SIZE  4096        /* default SD_LOG_BLOCK_BYTES: 8 card sectors, written whole */
+
+/* ─── Version 1: raw records ─── */
+typedef struct {
+  uint32_t t_ms;       /* sampler millis() */
+  float    voltage_V;
+  float    current_A;
+} SdLogRecordV1;
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;     /* 1 */
+  uint16_t record_size; /* 12 */
+  uint32_t file_index;  /* must match the file name: pre-allocated space may hold old blocks */
+  uint32_t block_no;    /* 0, 1, 2 ... within the file */
+  uint32_t first_seq;   /* sensor ring sequence number of record 0 */
+  uint32_t op_time_s;   /* operating seconds (session_stats.h) when record 0 was taken */
+  uint16_t count;       /* records used; the rest of the block is 0xFF */
+  uint16_t reserved;
+  uint32_t crc;         /* CRC-32 of the 28 header bytes above, then the used records */
+} SdLogBlockHeaderV1;
+
+/* ─── Version 2: keyframe + delta/zigzag-varint records ─── */
+typedef struct {
+  uint32_t magic;
+  uint16_t version;      /* 2 */
+  uint16_t payload_len;  /* bytes of encoded records after the header */
+  uint32_t file_index;
+  uint32_t block_no;
+  uint32_t first_seq;
+  uint32_t op_time_s;
+  uint16_t count;        /* records including the keyframe */
+  uint16_t v_lsb_uv;     /* voltage quantum, uV */
+  uint16_t i_lsb_ua;     /* current quantum, uA */
+  uint16_t reserved;
+  uint32_t key_t_ms;     /* record 0, absolute: the block is decodable on its own */
+  int32_t  key_v;
+  int32_t  key_i;
+  uint32_t crc;          /* CRC-32 of the 44 header bytes above, then the payload */
+} SdLogBlockHeaderV2;
+
+static_assert(sizeof(SdLogBlockHeaderV1) == 32, "v1 block header must stay 32 bytes");
+static_assert(sizeof(SdLogBlockHeaderV2) == 48, "v2 block header must stay 48 bytes");
+
+#endif /* SD_LOG_FORMAT_H */
@@ -26,6 +26,7 @@ bool  INA228_IsConnected(void);
 int   INA228_SetShunt(float maxCurrent_A, float shunt_Ohm);
 void  INA228_ResetEnergy(void);
 void  INA228_CycleAveraging(void);
+bool  INA228_SetAveraging(uint16_t samples);
 const char *INA228_GetAveragingString(void);
 const char *INA228_GetDriverName(void);
 
@@ -41,6 +42,7 @@ bool  INA226_IsConnected(void);
 int   INA226_SetShunt(float maxCurrent_A, float shunt_Ohm);
 void  INA226_ResetEnergy(void);
 void  INA226_CycleAveraging(void);
+bool  INA226_SetAveraging(uint16_t samples);
 const char *INA226_GetAveragingString(void);
 const char *INA226_GetDriverName(void);
 
@@ -55,6 +57,7 @@ bool  INA219_IsConnected(void);
 int   INA219_SetShunt(float maxCurrent_A, float shunt_Ohm);
 void  INA219_ResetEnergy(void);
 void  INA219_CycleAveraging(void);
+bool  INA219_SetAveraging(uint16_t samples);
 const char *INA219_GetAveragingString(void);
 const char *INA219_GetDriverName(void);
 
@@ -0,0 +1,86 @@
+/**
+ * @file session_stats.h
+ * Running statistics over every sensor sample, in two scopes: this session (since boot or the
+ * last reset) and lifetime (persisted in NVS).
+ *
+ * Each sample costs O(1): Welford mean/variance and min/max per channel, peak |power|, Ah in/out and
+ * time charging/discharging/idle. Positive current is charging (Victron convention). Timestamps are
+ * operating seconds, a lifetime counter that only runs while the device is on, so "how long ago"
+ * works across reboots without a real-time clock.
+ *
+ * Fed by the sensor sampler task with every full-rate sample (SENSOR_SAMPLE_PERIOD_MS), so extremes
+ * and peak |P| catch events of one sample, independent of the UI. SessionStatsGet() may be called
+ * from any task; the periodic NVS save runs from SessionStatsPoll() in loop().
+ */
+#ifndef SESSION_STATS_H
+#define SESSION_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** |current| below this counts as idle, neither charging nor discharging. */
+#ifndef STATS_IDLE_A
+#define STATS_IDLE_A 0.05f
+#endif
+
+/** Lifetime scope is written to NVS this often (and on reset). */
+#ifndef STATS_SAVE_PERIOD_S
+#define STATS_SAVE_PERIOD_S 600
+#endif
+
+typedef enum {
+  STATS_SESSION = 0,
+  STATS_LIFETIME,
+  STATS_SCOPE_COUNT
+} StatsScope;
+
+/** One measured quantity. */
+typedef struct {
+  uint32_t n;
+  double   mean;
+  double   m2;        /* sum of squared deviations (Welford) */
+  float    min;
+  float    max;
+  uint32_t min_t_s;   /* operating seconds at min/max */
+  uint32_t max_t_s;
+} StatsChannel;
+
+typedef struct {
+  StatsChannel voltage;
+  StatsChannel current;
+  StatsChannel power;
+  float    peak_power_W;   /* largest |P| (charge or discharge) */
+  uint32_t peak_power_t_s;
+  double   ah_in;          /* charge into the battery */
+  double   ah_out;
+  uint64_t charge_ms;      /* time with current > STATS_IDLE_A */
+  uint64_t discharge_ms;   /* time with current < -STATS_IDLE_A */
+  uint64_t idle_ms;
+  uint32_t start_t_s;      /* operating seconds when the scope was (re)started */
+} SessionStats;
+
+/** Load the lifetime scope and operating time from NVS. Call once before the first push. */
+void SessionStatsInit(void);
+
+/** Feed one sample (sampler task). Time since the previous push (capped) weights the Ah and time totals. */
+void SessionStatsPush(float voltage_V, float current_A, float power_W);
+
+/** Write the lifetime scope to NVS once STATS_SAVE_PERIOD_S has passed. Call periodically from loop(). */
+void SessionStatsPoll(void);
+
+/** Snapshot of one scope. */
+void SessionStatsGet(StatsScope scope, SessionStats *out);
+
+/** Clear one scope (lifetime reset is written to NVS immediately). */
+void SessionStatsReset(StatsScope scope);
+
+/** Operating seconds now (lifetime, persisted). */
+uint32_t SessionStatsNow(void);
+
+/** Sample standard deviation of a channel (0 below two samples). */
+float SessionStatsStdDev(const StatsChannel *ch);
+
+/** Persist the lifetime scope now (e.g. before a planned restart). */
+void SessionStatsSave(void);
+
+#endif /* SESSION_STATS_H */
@@ -0,0 +1,37 @@
+/**
+ * @file spi_bus.h
+ * Arbitration for the VSPI host, shared by the touch controller and the microSD slot.
+ *
+ * On the CYD the two sit on different pins (touch 25/39/32, SD 18/19/23), so the host is re-routed
+ * through the GPIO matrix when the other user takes it. The touch read never waits: if the SD
+ * writer holds the bus (a card write can stall for hundreds of ms), the touch read is skipped and
+ * the last state is reported.
+ */
+#ifndef SPI_BUS_H
+#define SPI_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+  SPI_BUS_TOUCH = 0,
+  SPI_BUS_SD,
+  SPI_BUS_USER_COUNT
+} SpiBusUser;
+
+/** Pins for one user (CS is driven by the user). */
+void SpiBusSetPins(SpiBusUser user, int8_t sck, int8_t miso, int8_t mosi);
+
+/** Take over main's SPIClass, currently begun on owner's pins. Call before any other SpiBus call. */
+void SpiBusInit(void *spi_instance, SpiBusUser owner);
+
+/** Lock the bus for user, re-routing the pins if needed. timeout_ms 0 = do not wait.
+ *  Without SpiBusInit() there is nothing to share and this always succeeds. */
+bool SpiBusAcquire(SpiBusUser user, uint32_t timeout_ms);
+
+void SpiBusRelease(void);
+
+/** Times the pins were switched between users. */
+uint32_t SpiBusSwitches(void);
+
+#endif /* SPI_BUS_H */
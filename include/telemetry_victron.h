@@ -17,6 +17,11 @@
 #include <Arduino.h>
 #include <stddef.h>
 
+// ESP32 Serial1 pins (single source of truth for Integration settings display).
+// CYD / many ESP32 boards: UART1 = RX 16, TX 17. Use -1 for core default.
+static constexpr int VE_UART_RX_PIN = 16;
+static constexpr int VE_UART_TX_PIN = 17;
+
 struct TelemetryState {
   float  voltage_V     = 0.0f;
   float  current_A     = 0.0f;
@@ -12,38 +12,117 @@
 #define TOUCH_DISPLAY_WIDTH  320
 #define TOUCH_DISPLAY_HEIGHT 240
 
-/** Calibration limits from NVS (same keys as main). */
+#ifndef TOUCH_SCLK_PIN
+#define TOUCH_SCLK_PIN 25
+#endif
+#ifndef TOUCH_MOSI_PIN
+#define TOUCH_MOSI_PIN 32
+#endif
+#ifndef TOUCH_MISO_PIN
+#define TOUCH_MISO_PIN 39
+#endif
+#ifndef TOUCH_CS_PIN
+#define TOUCH_CS_PIN  33
+#endif
+#ifndef TOUCH_IRQ_PIN
+#define TOUCH_IRQ_PIN 36
+#endif
+
+/* Read pipeline tuning (raw 12-bit units unless noted) */
+#ifndef TOUCH_BURST
+#define TOUCH_BURST      5     /* X/Y pairs per read, median taken */
+#endif
+#ifndef TOUCH_Z_PRESS
+#define TOUCH_Z_PRESS    400   /* pressure to start a press */
+#endif
+#ifndef TOUCH_Z_RELEASE
+#define TOUCH_Z_RELEASE  250   /* pressure below which a held press ends (hysteresis) */
+#endif
+#ifndef TOUCH_MAX_SPREAD
+#define TOUCH_MAX_SPREAD 60    /* max spread of the inner burst samples before it is rejected */
+#endif
+#ifndef TOUCH_IIR_ALPHA
+#define TOUCH_IIR_ALPHA  0.5f  /* smoothing while held; 1 = off */
+#endif
+#define TOUCH_SPI_HZ     2000000
+
+/**
+ * Affine raw-to-screen transform, least-squares fitted by the calibration screen:
+ *   sx = a*rx + b*ry + c,  sy = d*rx + e*ry + f
+ * Covers offset, scale, rotation/shear and swapped or mirrored axes, so no per-board mapping edits.
+ */
 typedef struct {
-  int16_t xMin;
-  int16_t xMax;
-  int16_t yMin;
-  int16_t yMax;
-  bool    isValid;
+  float a, b, c;
+  float d, e, f;
+  bool  isValid;
 } TouchCalibration_t;
 
-/** Use main's XPT2046 instance: call after ts.begin(mySpi) and ts.setRotation(1). */
-void TouchInit(void *ts_instance);
+#define TOUCH_CAL_POINTS_MAX 9
+
+/** Read-path counters (LVGL task). Jitter sums are |dx|+|dy| in pixels between consecutive held reads. */
+typedef struct {
+  uint32_t reads;          /* LVGL indev reads */
+  uint32_t spi_reads;      /* reads that ran a burst (pen down or PENIRQ latched) */
+  uint32_t presses;
+  uint32_t rejected;       /* bursts dropped for sample spread */
+  uint32_t held_reads;     /* reads contributing to the jitter sums */
+  uint32_t jitter_raw_px;  /* single sample, unfiltered */
+  uint32_t jitter_filt_px; /* median + IIR output */
+  uint32_t busy_us;        /* time in reads that ran a burst */
+  uint32_t busy_max_us;
+  uint32_t idle_us;        /* time in reads that only checked PENIRQ */
+  uint32_t bus_busy;       /* reads skipped because the SD logger held the shared SPI bus */
+  uint32_t wake_checks;    /* TouchConfirmPress() pressure reads (display blanked) */
+  uint32_t wake_rejected;  /* ... that found no pressure: PENIRQ noise, not a tap */
+} TouchStats_t;
 
-/** Set calibration used by TouchRawToScreen. Call after loading from NVS. */
+/**
+ * Use main's XPT2046 instance and its SPI bus: call after ts.begin(mySpi) and ts.setRotation(1).
+ * Construct ts without the IRQ pin: the touch layer owns PENIRQ (TOUCH_IRQ_PIN) from here on.
+ */
+void TouchInit(void *ts_instance, void *spi_instance);
+
+/** Set calibration used by TouchRawToScreen (NVS load, or live while the calibration screen verifies). */
 void TouchSetCalibration(const TouchCalibration_t *cal);
 
+/** Current calibration; returns its isValid. */
+bool TouchGetCalibration(TouchCalibration_t *out);
+
+/** Min/max box from the old 4-corner calibration, as an equivalent affine transform (NVS migration). */
+void TouchCalibrationFromBox(int16_t x_min, int16_t x_max, int16_t y_min, int16_t y_max, TouchCalibration_t *out);
+
 /**
- * Map raw XPT2046 coordinates to screen coordinates.
- * 1) Normalize raw to [0,1] using cal min/max and clamp.
- * 2) Apply mapping (swap/invert) to get screen x,y.
- *
- * To fix mirrored or wrong-handed touch, edit the "Mapping variant" block below
- * in touch.cpp:
- *   - Swap X/Y: use ny for x, nx for y.
- *   - Invert X: use (1.f - nx) for x.
- *   - Invert Y: use (1.f - ny) for y.
+ * Least-squares affine fit of n >= 3 raw/screen point pairs (n <= TOUCH_CAL_POINTS_MAX).
+ * Returns false if the points are degenerate (e.g. collinear). rms_px: residual error in pixels.
  */
+bool TouchCalibrationSolve(const int16_t *raw_x, const int16_t *raw_y, const int16_t *scr_x, const int16_t *scr_y,
+                           int n, TouchCalibration_t *out, float *rms_px);
+
+/** Map raw XPT2046 coordinates to screen coordinates with the affine calibration, clamped to the panel. */
 void TouchRawToScreen(int16_t raw_x, int16_t raw_y, int16_t *screen_x, int16_t *screen_y);
 
 /** If true, log raw and mapped coords on press (optional diagnostic). */
 void TouchSetDiagnostic(bool on);
 
-/** Read current touch: screen coords and pressed state. For LVGL indev. */
+/** True while the pen is down or once touched since the last read (XPT2046 PENIRQ). Does not touch SPI. */
+bool TouchIrqPending(void);
+
+/**
+ * Confirm a PENIRQ with one Z (pressure) read: true if the pen presses at least TOUCH_Z_PRESS.
+ * Clears the PENIRQ latch. False without clearing it if the SD logger holds the SPI bus (retry later).
+ */
+bool TouchConfirmPress(void);
+
+/**
+ * Read current touch for the LVGL indev: filtered screen coords and pressed state.
+ * No SPI while the pen is up; on release the last pressed point is returned.
+ */
 void TouchGetScreenPoint(int16_t *x, int16_t *y, bool *pressed);
 
+/** Last filtered raw point of the read path (no SPI); meaningful while the indev reports pressed. */
+void TouchGetRawPoint(int16_t *raw_x, int16_t *raw_y);
+
+/** Copy of the read-path counters. */
+void TouchGetStats(TouchStats_t *out);
+
 #endif /* TOUCH_H */
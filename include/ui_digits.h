@@ -0,0 +1,28 @@
+/**
+ * @file ui_digits.h
+ * Pre-rendered glyph cache for the large dashboard values (Current, Voltage).
+ *
+ * The digits, '.', '-', ' ' and the unit letters are rasterised once, anti-aliased against the tile
+ * background, into RGB565 buffers outside the LVGL heap. A digits widget then draws its text as plain
+ * opaque image copies instead of running the font rasteriser on every 200 ms update. Characters
+ * outside the cached set fall back to normal label drawing, so any text still renders.
+ */
+#ifndef UI_DIGITS_H
+#define UI_DIGITS_H
+
+#include <lvgl.h>
+#include <stdbool.h>
+
+/** Rasterise the glyph set in font/fg over bg (the tile colour). Call once after the display exists. */
+bool ui_digits_init(const lv_font_t *font, lv_color_t fg, lv_color_t bg);
+
+/** Create a value widget (not clickable: taps go to the parent tile). Height is the font line height. */
+lv_obj_t *ui_digits_create(lv_obj_t *parent);
+
+/** Set the text; invalidates only when it changed. Copied (up to 23 chars). */
+void ui_digits_set_text(lv_obj_t *obj, const char *text);
+
+/** Current text of a digits widget. */
+const char *ui_digits_get_text(lv_obj_t *obj);
+
+#endif /* UI_DIGITS_H */
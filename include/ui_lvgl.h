@@ -2,22 +2,31 @@
  * @file ui_lvgl.h
  * LVGL UI for CYD Smart Shunt: init, Monitoring/Settings screens, nav, INA228 update timer.
  * Expects: tft inited + setRotation(1), TouchInit + TouchSetCalibration done.
+ * With LV_USE_OS == LV_OS_FREERTOS (lv_conf.h) LVGL runs in its own task started by ui_lvgl_init();
+ * other tasks must wrap any LVGL call in ui_lvgl_lock() / ui_lvgl_unlock().
  */
 #ifndef UI_LVGL_H
 #define UI_LVGL_H
 
 #include <stdbool.h>
 
-/** Call after display + touch init and calibration. Creates display/indev and screens. */
+/** Sensor sampling / history rate of the UI, in every display state (also the flash history log's feed). */
+#define UI_SAMPLE_PERIOD_MS 200
+
+/** Call after display + touch init and calibration. Creates display/indev and the dashboard (other screens are built on first use). */
 void ui_lvgl_init(void);
 
 /** Call when touch calibration was re-done (e.g. after LVGL calibration flow) to refresh mapping. */
 void ui_lvgl_on_touch_calibration_done(void);
 
-/** Call every ~5 ms from loop: advances LVGL tick and runs timer handler. */
+/** Single-task builds (LV_OS_NONE) only: call every ~5 ms from loop to run the timer handler. No-op otherwise. */
 void ui_lvgl_poll(void);
 
-/** Clear history buffers (call when energy/data is reset). */
+/** Take / release the LVGL lock before touching UI objects from outside the LVGL task (recursive). */
+void ui_lvgl_lock(void);
+void ui_lvgl_unlock(void);
+
+/** Clear the RAM history ring (call when energy/data is reset). The flash history log is kept; its open block is flushed. */
 void ui_history_clear(void);
 
 #endif /* UI_LVGL_H */
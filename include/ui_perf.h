@@ -0,0 +1,39 @@
+/**
+ * @file ui_perf.h
+ * LVGL render/flush instrumentation (replaces the sysmon perf/mem monitors, which stay disabled).
+ *
+ * Recorded per frame in the LVGL task: render time, flush time and dirty area, kept in a rolling
+ * window of the last UI_PERF_FRAMES frames. LVGL heap used/free/fragmentation is sampled once a
+ * second into a rolling window of UI_PERF_HEAP_SAMPLES. Recording is a handful of stores per frame;
+ * histograms and text are only built when the overlay, the System > Performance page or a serial
+ * dump asks for them.
+ */
+#ifndef UI_PERF_H
+#define UI_PERF_H
+
+#include <lvgl.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define UI_PERF_FRAMES       128  /* frames in the rolling window */
+#define UI_PERF_HEAP_SAMPLES 60   /* 1 Hz heap samples (one minute) */
+
+/** Hook the display's refresh events and start the 1 Hz heap sampler. Call once after the display exists. */
+void ui_perf_init(lv_display_t *disp);
+
+/** From the flush callback: pixels pushed and time spent (byte swap + SPI) for one flushed area. */
+void ui_perf_on_flush(uint32_t px, uint32_t us);
+
+/** Show/hide the one-line overlay on the top layer (refreshed once a second). */
+void ui_perf_set_overlay(bool on);
+bool ui_perf_overlay_enabled(void);
+
+/** Multi-line summary for the System > Performance page. LVGL task only. */
+void ui_perf_format(char *buf, size_t len);
+
+/** Queue full histograms on the serial console (console.h). Safe from any task: copies a snapshot
+ *  under the UI lock first. */
+void ui_perf_dump(void);
+
+#endif /* UI_PERF_H */
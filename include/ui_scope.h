@@ -0,0 +1,61 @@
+/**
+ * @file ui_scope.h
+ * Live voltage/current scope: a canvas redrawn at SCOPE_FRAME_MS from the sensor sample ring.
+ *
+ * Traces are rasterised straight into the canvas pixels (Bresenham, no lv_draw_line tasks) and
+ * only the canvas area is invalidated, so a frame costs one partial refresh of the plot. The pixel
+ * buffer is on the system heap and freed with the widget. LVGL task only.
+ */
+#ifndef UI_SCOPE_H
+#define UI_SCOPE_H
+
+#include <lvgl.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef SCOPE_FRAME_MS
+#define SCOPE_FRAME_MS 40  /* 25 fps target */
+#endif
+
+/** Horizontal divisions across the plot; the timebase is per division. */
+#define SCOPE_DIVS_X 10
+#define SCOPE_DIVS_Y 8
+
+typedef enum {
+  SCOPE_CH_CURRENT = 0,
+  SCOPE_CH_VOLTAGE,
+  SCOPE_CH_COUNT
+} ui_scope_channel_t;
+
+typedef struct {
+  uint32_t fps_x10;            /* frames that reached the screen, last second */
+  uint32_t samples_new;        /* ring samples taken in per frame (average, last second) */
+  uint32_t samples_shown;      /* samples across the plot */
+  uint32_t render_us;          /* rasterise time of the last frame */
+  uint32_t render_max_us;
+  bool     triggered;          /* last frame was aligned on a trigger edge (else free-running) */
+  float    trigger_level;
+  ui_scope_channel_t trigger_ch;
+  float    per_div[SCOPE_CH_COUNT];  /* current vertical scale, units per division */
+  uint32_t timebase_ms;              /* per division */
+} ui_scope_stats_t;
+
+/** Create a w x h scope. Returns NULL if the pixel buffer cannot be allocated. */
+lv_obj_t *ui_scope_create(lv_obj_t *parent, int32_t w, int32_t h);
+
+/** Run: follow the ring. Stop: keep the last frame on screen. */
+void ui_scope_set_running(lv_obj_t *scope, bool run);
+bool ui_scope_is_running(lv_obj_t *scope);
+
+/** Step through the timebase table (ms per division); returns the new setting. */
+uint32_t ui_scope_timebase_step(lv_obj_t *scope, int dir);
+
+/** Move the trigger level by whole vertical divisions of the trigger channel's scale. */
+void ui_scope_trigger_step(lv_obj_t *scope, int divs);
+
+/** Trigger on the other channel (level reset to the middle of its scale). */
+void ui_scope_trigger_toggle_channel(lv_obj_t *scope);
+
+void ui_scope_get_stats(lv_obj_t *scope, ui_scope_stats_t *out);
+
+#endif /* UI_SCOPE_H */
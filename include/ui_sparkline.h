@@ -0,0 +1,39 @@
+/**
+ * @file ui_sparkline.h
+ * Tiny live trend line on a canvas, updated incrementally.
+ *
+ * Each push shifts the pixel buffer left by one column and draws only the new column (a vertical
+ * segment from the previous sample's row to the new one). The whole canvas is re-rendered from the
+ * value ring only when the autoscale range has to change. The pixel buffer lives on the system heap,
+ * not in the LVGL pool. LVGL task only.
+ */
+#ifndef UI_SPARKLINE_H
+#define UI_SPARKLINE_H
+
+#include <lvgl.h>
+#include <stdint.h>
+
+/**
+ * Create a w x h sparkline (one column per sample). min_span: smallest vertical range in value
+ * units, so noise on a flat signal is not blown up to full height. Returns NULL if out of memory.
+ */
+lv_obj_t *ui_sparkline_create(lv_obj_t *parent, int32_t w, int32_t h, float min_span,
+                              lv_color_t fg, lv_color_t bg);
+
+/** Append one sample (NaN leaves a gap) and invalidate the canvas. */
+void ui_sparkline_push(lv_obj_t *spark, float v);
+
+/**
+ * Append one sample to the pixel buffer only, without any LVGL call (display blanked). Call
+ * ui_sparkline_refresh() once before the canvas is shown again.
+ */
+void ui_sparkline_append(lv_obj_t *spark, float v);
+void ui_sparkline_refresh(lv_obj_t *spark);
+
+/** Forget all samples and clear the canvas. */
+void ui_sparkline_clear(lv_obj_t *spark);
+
+/** Full redraws caused by rescaling since creation (for the cost report). */
+uint32_t ui_sparkline_rescales(lv_obj_t *spark);
+
+#endif /* UI_SPARKLINE_H */
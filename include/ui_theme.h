@@ -0,0 +1,58 @@
+/**
+ * @file ui_theme.h
+ * Shared look of the LVGL UI: layout/colour tokens and statically allocated styles.
+ * Widgets that share a look attach the same lv_style_t with lv_obj_add_style() instead of
+ * setting local style properties, so the look is stored once rather than per widget in the
+ * LVGL heap. Keep lv_obj_set_style_*() for one-off or runtime-changing properties only.
+ */
+#ifndef UI_THEME_H
+#define UI_THEME_H
+
+#include <lvgl.h>
+
+/* ─── UX constants (CYD: 320×240, 8px grid, resistive touch) ─── */
+#define DISP_W    320
+#define DISP_H    240
+#define GRID      8
+#define MARGIN    4
+#define MARGIN_L  16
+#define GAP       4
+#define PAD       4
+#define HEADER_H  32
+#define MIN_TAP_W 44
+#define MIN_TAP_H 28
+#define BTN_W     56
+#define BTN_H     32
+#define CARD_R    6
+#define ROW_H     36
+#define LIST_ITEM_H 44
+
+/* Colors: black BG, dark grey cards, cyan accent, red/green. Muted brighter for contrast. */
+#define COL_BG      0x000000
+#define COL_CARD    0x252525
+#define COL_HEADER  0x1a1a1a
+#define COL_ACCENT  0x00D4FF
+#define COL_ERROR   0xE63946
+#define COL_OK      0x00AA00
+#define COL_TEXT    0xFFFFFF
+#define COL_MUTED   0xB0B0B0
+
+/** Screen / plain container background (COL_BG). */
+extern lv_style_t ui_style_bg;
+/** Scrolling list container: COL_BG, MARGIN padding, GAP between rows. */
+extern lv_style_t ui_style_list;
+/** Header bar: COL_HEADER, square corners, no padding. */
+extern lv_style_t ui_style_header;
+/** Card / row / modal: COL_CARD with CARD_R corners. */
+extern lv_style_t ui_style_card;
+/** Text colours: primary, muted (labels, hints), accent (titles, chevrons). */
+extern lv_style_t ui_style_text;
+extern lv_style_t ui_style_text_muted;
+extern lv_style_t ui_style_text_accent;
+/** Large value text (Montserrat 20). */
+extern lv_style_t ui_style_text_large;
+
+/** Initialise the shared styles. Call once after lv_init(), before building any screen. */
+void ui_theme_init(void);
+
+#endif /* UI_THEME_H */
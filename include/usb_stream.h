@@ -0,0 +1,55 @@
+/**
+ * @file usb_stream.h
+ * Binary streaming of every sensor sample over the USB serial port.
+ *
+ * The port runs at 115200 for boot, log text and the console (console.h). The console command
+ * "s" (or "stream") switches it to USB_STREAM_BAUD, and a task sends the sample ring (sensor.h) as
+ * COBS-framed, CRC-checked frames of delta-coded samples every USB_STREAM_POLL_MS. A single 's'
+ * byte (USB_STREAM_CMD_TOGGLE) at the stream baud stops it and returns to 115200. Log text printed while streaming arrives between
+ * frames and is passed through by the receiver. See docs/USB_STREAM.md and tools/usb_stream_rx.
+ */
+#ifndef USB_STREAM_H
+#define USB_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_stream_format.h"
+
+#ifndef USB_STREAM_BAUD
+#define USB_STREAM_BAUD 2000000          /* CH340C limit; use 921600 for a CP2102 (non-N) bridge */
+#endif
+#ifndef USB_STREAM_POLL_MS
+#define USB_STREAM_POLL_MS 20
+#endif
+#ifndef USB_STREAM_FRAME_SAMPLES
+#define USB_STREAM_FRAME_SAMPLES 64      /* max samples per frame */
+#endif
+#ifndef USB_STREAM_V_LSB_UV
+#define USB_STREAM_V_LSB_UV 100
+#endif
+#ifndef USB_STREAM_I_LSB_UA
+#define USB_STREAM_I_LSB_UA 10
+#endif
+
+typedef struct {
+  bool     active;
+  uint32_t frames;
+  uint32_t samples;
+  uint64_t bytes;            /* on the wire, framing included */
+  uint32_t samples_dropped;  /* ring overrun: the link or the task fell behind the sampler */
+  uint32_t write_us_max;     /* slowest frame write (blocks while the UART FIFO drains) */
+  uint32_t duration_ms;      /* of the current or last run */
+} UsbStreamStats;
+
+/** Switch the port to USB_STREAM_BAUD and start sending frames. Call from the task that owns
+ *  Serial input (the console in loop()). No-op if already streaming. */
+void UsbStreamStart(void);
+
+/** Stop after the frame in flight and return the port to 115200. */
+void UsbStreamStop(void);
+
+bool UsbStreamIsActive(void);
+
+void UsbStreamGetStats(UsbStreamStats *out);
+
+#endif /* USB_STREAM_H */
@@ -0,0 +1,40 @@
+/**
+ * @file usb_stream_format.h
+ * Frame layout of the USB sample stream (docs/USB_STREAM.md), shared by the firmware sender and
+ * the host receiver (tools/usb_stream_rx). Arduino-free; all fields little-endian.
+ *
+ * On the wire: 0x00, COBS(header + payload + u32 CRC-32), 0x00. The payload holds count - 1
+ * delta records (sample_codec.h) after the keyframe in the header.
+ */
+#ifndef USB_STREAM_FORMAT_H
+#define USB_STREAM_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define USB_STREAM_FRAME_TYPE  0xA5  /* first byte of a sample frame */
+#define USB_STREAM_VERSION     1
+#define USB_STREAM_CMD_TOGGLE  's'   /* host -> device: console line "s" starts (115200), a bare
+                                        's' byte at the stream baud stops */
+
+typedef struct {
+  uint8_t  type;        /* USB_STREAM_FRAME_TYPE */
+  uint8_t  version;     /* USB_STREAM_VERSION */
+  uint16_t frame_no;    /* +1 per frame (wraps): a gap means frames were lost on the link */
+  uint32_t first_seq;   /* sensor ring sequence number of record 0; a jump with no frame gap
+                           means the device dropped samples before sending */
+  uint16_t count;       /* records, including the keyframe */
+  uint16_t v_lsb_uv;    /* voltage quantum, uV */
+  uint16_t i_lsb_ua;    /* current quantum, uA */
+  uint16_t reserved;
+  uint32_t key_t_ms;    /* record 0, absolute */
+  int32_t  key_v;
+  int32_t  key_i;
+} UsbStreamFrameHeader;
+
+static_assert(sizeof(UsbStreamFrameHeader) == 28, "stream frame header must stay 28 bytes");
+
+/* Largest frame: header + (max samples - 1) worst-case records + CRC */
+#define USB_STREAM_FRAME_MAX(samples) (sizeof(UsbStreamFrameHeader) + ((samples) - 1) * 15 + 4)
+
+#endif /* USB_STREAM_FORMAT_H */
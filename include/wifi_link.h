@@ -0,0 +1,31 @@
+/**
+ * @file wifi_link.h
+ * Wi-Fi station shared by the network integrations (MQTT and later ones).
+ *
+ * Credentials live in NVS (namespace "cyd_wifi") and are set from the serial console ("wifi").
+ * Without credentials the radio stays off. The station reconnects on its own after a drop; users
+ * check WifiLinkIsUp() and never wait for the link.
+ */
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Load credentials and start connecting in the background. False if none are stored. */
+bool WifiLinkInit(void);
+
+/** Save credentials and reconnect; an empty ssid turns Wi-Fi off. */
+void WifiLinkSetCredentials(const char *ssid, const char *pass);
+
+/** Associated and holding an IP address. */
+bool WifiLinkIsUp(void);
+
+/** Six hex digits from the station MAC, stable per board (topics, host name). */
+const char *WifiLinkDeviceId(void);
+
+/** One-line status, e.g. "myssid 192.168.1.40 -61 dBm", "connecting to myssid" or "off". */
+void WifiLinkGetInfo(char *buf, size_t len);
+
+#endif /* WIFI_LINK_H */
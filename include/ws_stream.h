@@ -0,0 +1,73 @@
+/**
+ * @file ws_stream.h
+ * WebSocket sample stream at /ws on the HTTP server (http_api.h), rendered by the /live page.
+ * See docs/WS_STREAM.md and tools/ws_bench.
+ *
+ * Design:
+ * - A low-priority task on core 1 reads the sensor ring (sensor.h) every WS_STREAM_POLL_MS and
+ *   folds each raw sample into every client's current point; a point is the mean of `decim` raw
+ *   samples. The task sleeps while no client is connected.
+ * - Each client picks its rate with a text message "rate <hz>" (1 .. 1000 / SENSOR_SAMPLE_PERIOD_MS,
+ *   default WS_STREAM_RATE_DEFAULT_HZ). The device answers with a JSON hello giving the rate it set.
+ * - Backpressure per client: a frame is queued only while the client has fewer than
+ *   WS_STREAM_QUEUE_HIGH messages waiting in the server. Otherwise its points wait in its own buffer;
+ *   when that fills, neighbouring points are merged and its decimation doubles. A slow browser thus
+ *   gets coarser data, never a stalled sender or a stall for the other clients. After a run of
+ *   sends into an empty queue the decimation halves again, down to the requested rate.
+ */
+#ifndef WS_STREAM_H
+#define WS_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ws_stream_format.h"
+
+#ifndef WS_STREAM_PATH
+#define WS_STREAM_PATH "/ws"
+#endif
+#ifndef WS_STREAM_MAX_CLIENTS
+#define WS_STREAM_MAX_CLIENTS 4          /* further connects are closed with 1013 (try again later) */
+#endif
+#ifndef WS_STREAM_RATE_DEFAULT_HZ
+#define WS_STREAM_RATE_DEFAULT_HZ 20
+#endif
+#ifndef WS_STREAM_POLL_MS
+#define WS_STREAM_POLL_MS 50             /* frame interval at full speed */
+#endif
+#ifndef WS_STREAM_POINTS
+#define WS_STREAM_POINTS 128             /* per-client point buffer; also the largest frame */
+#endif
+#ifndef WS_STREAM_QUEUE_HIGH
+#define WS_STREAM_QUEUE_HIGH 2           /* server-side messages queued before a client counts as slow */
+#endif
+#ifndef WS_STREAM_RECOVER_SENDS
+#define WS_STREAM_RECOVER_SENDS 20       /* sends into an empty queue before decimation halves */
+#endif
+
+typedef struct {
+  uint8_t  clients;
+  uint8_t  clients_peak;
+  uint32_t connects;
+  uint32_t rejected;         /* connects refused: WS_STREAM_MAX_CLIENTS reached */
+  uint32_t frames;
+  uint32_t points;
+  uint64_t bytes;            /* WebSocket payload */
+  uint32_t coarsened;        /* buffer merges: a client lagged and its decimation doubled */
+  uint32_t deferred;         /* polls a client had points but a full queue */
+  uint32_t samples_dropped;  /* ring overrun: the task fell behind the sampler */
+  uint16_t decim_max;        /* coarsest decimation any client reached */
+  uint32_t send_us_max;      /* slowest pass over all clients */
+} WsStreamStats;
+
+class AsyncWebServer;
+
+/** Register the /ws handler on the HTTP server and start the (idle) sender task. */
+void WsStreamAttach(AsyncWebServer *server);
+
+void WsStreamGetStats(WsStreamStats *out);
+
+/** One-line status, e.g. "2 clients (peak 3, 0 refused), 1834 frames, 3 coarsened, max decim 20, 0 lost". */
+void WsStreamGetInfo(char *buf, size_t len);
+
+#endif /* WS_STREAM_H */
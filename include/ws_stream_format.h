@@ -0,0 +1,44 @@
+/**
+ * @file ws_stream_format.h
+ * Binary frame layout of the WebSocket sample stream (docs/WS_STREAM.md), shared by the firmware
+ * sender, the /live page and the host benchmark (tools/ws_bench). Arduino-free; all fields
+ * little-endian, no padding.
+ *
+ * One WebSocket binary message = header + count points. Each point is the mean of `decim` raw
+ * sampler readings, so a client at a reduced rate (or one that fell behind and was decimated
+ * further) still sees the true average, not an aliased pick.
+ */
+#ifndef WS_STREAM_FORMAT_H
+#define WS_STREAM_FORMAT_H
+
+#include <stdint.h>
+
+#define WS_STREAM_FRAME_TYPE  0x5A  /* first byte of a sample frame */
+#define WS_STREAM_VERSION     1
+
+#define WS_STREAM_FLAG_GAP    0x01  /* samples inside this frame's span were lost (ring overrun, or
+                                       the client lagged past the coarsest decimation) */
+
+typedef struct {
+  uint8_t  type;        /* WS_STREAM_FRAME_TYPE */
+  uint8_t  version;     /* WS_STREAM_VERSION */
+  uint8_t  flags;       /* WS_STREAM_FLAG_* */
+  uint8_t  reserved;
+  uint32_t frame_no;    /* +1 per frame to this client */
+  uint32_t first_seq;   /* sensor ring sequence number of the first raw sample in point 0 */
+  uint32_t samples;     /* raw samples covered: the next frame starts at first_seq + samples */
+  uint16_t count;       /* points that follow */
+  uint16_t decim;       /* raw samples per point when sent (points older in the frame may be finer) */
+  uint32_t sent_ms;     /* device millis() when queued: sent_ms - last point t_ms = age at send */
+} WsStreamFrameHeader;
+
+typedef struct {
+  uint32_t t_ms;        /* millis() of the last raw sample in the point */
+  float    voltage;     /* V, mean */
+  float    current;     /* A, mean */
+} WsStreamPoint;
+
+static_assert(sizeof(WsStreamFrameHeader) == 24, "ws frame header must stay 24 bytes");
+static_assert(sizeof(WsStreamPoint) == 12, "ws point must stay 12 bytes");
+
+#endif /* WS_STREAM_FORMAT_H */
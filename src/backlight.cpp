@@ -0,0 +1,44 @@
+/**
+ * @file backlight.cpp
+ * PWM backlight on TFT_BL (see backlight.h).
+ */
+#include "backlight.h"
+#include <Arduino.h>
+
+#ifndef TFT_BL
+#define TFT_BL 21
+#endif
+
+#define BACKLIGHT_LEDC_CHANNEL 7      /* TFT_eSPI and the rest of the firmware use no LEDC */
+#define BACKLIGHT_PWM_FREQ     5000   /* Hz: above visible flicker, low switching loss */
+#define BACKLIGHT_PWM_BITS     8
+
+static uint8_t s_pct = 100;
+static bool s_ready = false;
+
+void BacklightInit(void) {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  ledcAttachChannel(TFT_BL, BACKLIGHT_PWM_FREQ, BACKLIGHT_PWM_BITS, BACKLIGHT_LEDC_CHANNEL);
+#else
+  ledcSetup(BACKLIGHT_LEDC_CHANNEL, BACKLIGHT_PWM_FREQ, BACKLIGHT_PWM_BITS);
+  ledcAttachPin(TFT_BL, BACKLIGHT_LEDC_CHANNEL);
+#endif
+  s_ready = true;
+  BacklightSetPercent(100);
+}
+
+void BacklightSetPercent(uint8_t pct) {
+  if (pct > 100) pct = 100;
+  s_pct = pct;
+  if (!s_ready) return;
+  uint32_t duty = ((1u << BACKLIGHT_PWM_BITS) - 1) * pct / 100;
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  ledcWrite(TFT_BL, duty);
+#else
+  ledcWrite(BACKLIGHT_LEDC_CHANNEL, duty);
+#endif
+}
+
+uint8_t BacklightGetPercent(void) {
+  return s_pct;
+}
@@ -0,0 +1,405 @@
+/**
+ * @file ble_telemetry.cpp
+ * Generic BLE telemetry service (see ble_telemetry.h and docs/BLE_GATT.md).
+ */
+#include "ble_telemetry.h"
+#include "ble_telemetry_format.h"
+#include "live_snapshot.h"
+#include "sensor.h"
+#include "wifi_link.h"
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include <Preferences.h>
+#include <stdio.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define BLE_NVS_NAMESPACE "cyd_ble"
+#define BLE_NVS_KEY_ON    "on"
+#define BLE_NVS_KEY_NAME  "name"
+
+#define BLE_MTU_WANTED    247   /* one LE data-length-extended packet */
+#define BLE_MTU_DEFAULT   23
+#define BLE_BATCH_POINTS  ((BLE_MTU_WANTED - BLE_TLM_ATT_OVERHEAD - BLE_TLM_BATCH_HEADER) / BLE_TLM_BATCH_RECORD)
+#define BLE_MAX_HZ        (1000 / SENSOR_SAMPLE_PERIOD_MS)
+#define BLE_DECIM_MAX     BLE_MAX_HZ   /* 1 point per second at the coarsest */
+#define BLE_READ_CHUNK    32
+
+enum { CH_VOLTAGE, CH_CURRENT, CH_POWER, CH_ENERGY, CH_SOC, CH_TEMPERATURE, CH_SAMPLES, CH_COUNT };
+
+static TaskHandle_t          s_task = NULL;
+static volatile bool         s_want = false;
+static volatile bool         s_restart = false;  /* name changed: bring the stack down and up again */
+static char                  s_name[BLE_NAME_MAX + 1] = "";
+static BleTelemetryStats     s_stats;
+static portMUX_TYPE          s_mux = portMUX_INITIALIZER_UNLOCKED;  /* s_name, s_stats */
+static NimBLECharacteristic *s_chr[CH_COUNT];
+
+/* Connection state, written by the NimBLE host callbacks */
+static volatile bool     s_connected = false;
+static volatile bool     s_subscribed = false;
+static volatile uint16_t s_mtu = BLE_MTU_DEFAULT;
+
+/* Samples state (BLE task) */
+static uint32_t     s_seq = 0;
+static uint16_t     s_decim = 1;
+static uint16_t     s_base_decim = 1;
+static uint16_t     s_good = 0;
+static float        s_sum_v = 0, s_sum_i = 0;
+static uint16_t     s_acc_n = 0;
+static uint32_t     s_acc_seq = 0;   /* first raw sample of the point being built */
+static uint32_t     s_acc_t_ms = 0;
+static BleTlmBatch  s_batch;
+static uint8_t      s_batch_buf[BLE_TLM_BATCH_HEADER + BLE_BATCH_POINTS * BLE_TLM_BATCH_RECORD];
+static SensorSample s_chunk[BLE_READ_CHUNK];
+
+static void stats_connection(void) {
+  portENTER_CRITICAL(&s_mux);
+  s_stats.connected = s_connected;
+  s_stats.subscribed = s_subscribed;
+  s_stats.mtu = s_mtu;
+  portEXIT_CRITICAL(&s_mux);
+}
+
+/* ─── NimBLE callbacks (host task) ─── */
+class ServerCallbacks : public NimBLEServerCallbacks {
+  void onConnect(NimBLEServer *server, NimBLEConnInfo &info) override {
+    (void)server;
+    s_mtu = info.getMTU();
+    s_connected = true;
+    portENTER_CRITICAL(&s_mux);
+    s_stats.connects++;
+    portEXIT_CRITICAL(&s_mux);
+    stats_connection();
+    if (s_task) xTaskNotifyGive(s_task);
+  }
+
+  void onDisconnect(NimBLEServer *server, NimBLEConnInfo &info, int reason) override {
+    (void)server;
+    (void)info;
+    (void)reason;
+    s_connected = false;
+    s_subscribed = false;
+    s_mtu = BLE_MTU_DEFAULT;
+    stats_connection();  /* advertising restarts by itself (advertiseOnDisconnect) */
+  }
+
+  void onMTUChange(uint16_t mtu, NimBLEConnInfo &info) override {
+    (void)info;
+    s_mtu = mtu;
+    stats_connection();
+  }
+};
+
+class SamplesCallbacks : public NimBLECharacteristicCallbacks {
+  void onSubscribe(NimBLECharacteristic *chr, NimBLEConnInfo &info, uint16_t sub_value) override {
+    (void)chr;
+    (void)info;
+    s_subscribed = (sub_value & 0x0001) != 0;
+    stats_connection();
+  }
+};
+
+/* ─── Stack start/stop (BLE task only) ─── */
+typedef struct {
+  const char *uuid;
+  const char *description;
+  uint8_t     format;     /* 0x2904 presentation format */
+  int8_t      exponent;
+  uint16_t    unit;       /* Bluetooth SIG unit UUID */
+} ble_chr_def_t;
+
+static const ble_chr_def_t k_chr_defs[CH_COUNT] = {
+    {BLE_TLM_VOLTAGE_UUID,     "Voltage, mV",          NimBLE2904::FORMAT_SINT32, -3, 0x2728},  /* volt */
+    {BLE_TLM_CURRENT_UUID,     "Current, mA",          NimBLE2904::FORMAT_SINT32, -3, 0x2704},  /* ampere */
+    {BLE_TLM_POWER_UUID,       "Power, mW",            NimBLE2904::FORMAT_SINT32, -3, 0x2726},  /* watt */
+    {BLE_TLM_ENERGY_UUID,      "Energy, mWh",          NimBLE2904::FORMAT_SINT32, -6, 0x27AB},  /* kilowatt hour */
+    {BLE_TLM_SOC_UUID,         "State of charge, 0.01 %", NimBLE2904::FORMAT_UINT16, -2, 0x27AD},  /* percentage */
+    {BLE_TLM_TEMPERATURE_UUID, "Temperature, 0.01 C",  NimBLE2904::FORMAT_SINT16, -2, 0x272F},  /* celsius */
+    {BLE_TLM_SAMPLES_UUID,     "Sample batch (docs/BLE_GATT.md)", NimBLE2904::FORMAT_OPAQUE, 0, 0x2700},
+};
+
+static bool stack_start(void) {
+  char name[BLE_NAME_MAX + 1];
+  BleTelemetryGetName(name, sizeof(name));
+  if (!NimBLEDevice::init(name)) return false;
+  NimBLEDevice::setMTU(BLE_MTU_WANTED);
+
+  NimBLEServer *server = NimBLEDevice::createServer();
+  server->setCallbacks(new ServerCallbacks(), true);  /* deleted with the server by deinit() */
+  server->advertiseOnDisconnect(true);
+  NimBLEService *svc = server->createService(BLE_TLM_SERVICE_UUID);
+  for (int k = 0; k < CH_COUNT; k++) {
+    const ble_chr_def_t *d = &k_chr_defs[k];
+    uint32_t props = k == CH_SAMPLES ? NIMBLE_PROPERTY::NOTIFY : NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY;
+    NimBLECharacteristic *chr = svc->createCharacteristic(d->uuid, props);
+    NimBLEDescriptor *desc = chr->createDescriptor("2901", NIMBLE_PROPERTY::READ, strlen(d->description));
+    desc->setValue(d->description);
+    NimBLE2904 *fmt = chr->create2904();
+    fmt->setFormat(d->format);
+    fmt->setExponent(d->exponent);
+    fmt->setUnit(d->unit);
+    s_chr[k] = chr;
+  }
+  s_chr[CH_SAMPLES]->setCallbacks(new SamplesCallbacks());
+  svc->start();
+
+  /* 128-bit UUID in the advertisement, name in the scan response (both would not fit in 31 bytes) */
+  NimBLEAdvertisementData adv_data, scan_data;
+  adv_data.setFlags(BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP);
+  adv_data.addServiceUUID(NimBLEUUID(BLE_TLM_SERVICE_UUID));
+  scan_data.setName(name);
+  NimBLEAdvertising *adv = NimBLEDevice::getAdvertising();
+  adv->setAdvertisementData(adv_data);
+  adv->setScanResponseData(scan_data);
+  return adv->start();
+}
+
+static void stack_stop(void) {
+  NimBLEDevice::deinit(true);  /* frees the host stack and all GATT objects */
+  for (int k = 0; k < CH_COUNT; k++) s_chr[k] = NULL;
+  s_connected = false;
+  s_subscribed = false;
+  s_mtu = BLE_MTU_DEFAULT;
+  stats_connection();
+}
+
+/* ─── Value characteristics ─── */
+static void chr_publish(int ch, const uint8_t *val, size_t len) {
+  s_chr[ch]->setValue(val, len);
+  s_chr[ch]->notify();  /* no-op for clients that did not subscribe */
+}
+
+static void values_update(void) {
+  LiveSnapshot s;
+  LiveSnapshotGet(&s);
+  if (!s.seq) return;
+  uint8_t b[4];
+  chr_publish(CH_VOLTAGE, b, BleTlmPackVoltage(b, s.voltage_V));
+  chr_publish(CH_CURRENT, b, BleTlmPackCurrent(b, s.current_A));
+  chr_publish(CH_POWER, b, BleTlmPackPower(b, s.power_W));
+  chr_publish(CH_ENERGY, b, BleTlmPackEnergy(b, s.energy_Wh));
+  chr_publish(CH_SOC, b, BleTlmPackSoc(b, s.soc_percent));
+  chr_publish(CH_TEMPERATURE, b, BleTlmPackTemperature(b, s.sensor_connected ? s.temperature_C : NAN));
+}
+
+/* ─── Samples characteristic ─── */
+static void acc_reset(void) {
+  s_sum_v = s_sum_i = 0;
+  s_acc_n = 0;
+}
+
+static void batch_flush(void) {
+  if (!s_batch.count) return;
+  bool ok = s_chr[CH_SAMPLES]->notify(s_batch_buf, BleTlmBatchLength(&s_batch));
+  portENTER_CRITICAL(&s_mux);
+  if (ok) {
+    s_stats.notifies++;
+    s_stats.points += s_batch.count;
+  } else {
+    s_stats.notify_failures++;
+  }
+  portEXIT_CRITICAL(&s_mux);
+  s_batch.count = 0;
+  if (!ok) {  /* controller buffers full: the link cannot take this rate */
+    s_good = 0;
+    if (s_decim * 2 <= BLE_DECIM_MAX) s_decim *= 2;
+  } else if (s_decim > s_base_decim && ++s_good >= BLE_RECOVER_NOTIFIES) {
+    s_decim = s_decim / 2 > s_base_decim ? s_decim / 2 : s_base_decim;
+    s_good = 0;
+  }
+}
+
+/* Points per notification follow the MTU; average enough samples to stay under BLE_NOTIFY_MAX_HZ */
+static void decim_for_mtu(void) {
+  size_t cap = BleTlmBatchCapacity(s_mtu);
+  if (cap > BLE_BATCH_POINTS) cap = BLE_BATCH_POINTS;
+  if (!cap) cap = 1;
+  uint32_t allowed = (uint32_t)cap * BLE_NOTIFY_MAX_HZ;
+  uint16_t base = (uint16_t)((BLE_MAX_HZ + allowed - 1) / allowed);
+  if (s_batch.capacity != cap || s_base_decim != base) {
+    batch_flush();
+    s_batch.capacity = cap;
+    s_base_decim = base;
+    if (s_decim < base) s_decim = base;
+  }
+}
+
+static void samples_pump(void) {
+  if (!s_subscribed) {
+    s_seq = SensorRingHead();
+    acc_reset();
+    s_batch.count = 0;
+    return;
+  }
+  decim_for_mtu();
+  for (;;) {
+    uint32_t before = s_seq;
+    uint32_t got = SensorRingRead(&s_seq, s_chunk, BLE_READ_CHUNK);
+    uint32_t lost = (s_seq - before) - got;
+    if (lost) {  /* the batch cannot span the hole: send what is there and start over */
+      batch_flush();
+      acc_reset();
+      portENTER_CRITICAL(&s_mux);
+      s_stats.samples_dropped += lost;
+      portEXIT_CRITICAL(&s_mux);
+    }
+    if (!got) break;
+    uint32_t seq0 = s_seq - got;
+    for (uint32_t k = 0; k < got; k++) {
+      if (!s_acc_n) {
+        s_acc_seq = seq0 + k;
+        s_acc_t_ms = s_chunk[k].t_ms;
+      }
+      s_sum_v += s_chunk[k].voltage;
+      s_sum_i += s_chunk[k].current;
+      if (++s_acc_n < s_decim) continue;
+      if (!s_batch.count)
+        BleTlmBatchBegin(&s_batch, s_batch_buf, s_batch.capacity, s_acc_seq, s_acc_t_ms,
+                         (uint16_t)(s_decim * SENSOR_SAMPLE_PERIOD_MS));
+      BleTlmBatchAdd(&s_batch, s_sum_v / s_acc_n, s_sum_i / s_acc_n);
+      acc_reset();
+      if (BleTlmBatchFull(&s_batch)) batch_flush();
+    }
+  }
+  batch_flush();  /* partial batch: latency stays within BLE_NOTIFY_MS */
+  portENTER_CRITICAL(&s_mux);
+  s_stats.decim = s_decim;
+  portEXIT_CRITICAL(&s_mux);
+}
+
+/* ─── Task ─── */
+static void ble_task(void *arg) {
+  (void)arg;
+  bool running = false;
+  uint32_t last_values = 0;
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    if (s_restart) {
+      s_restart = false;
+      if (running) {
+        stack_stop();
+        running = false;
+      }
+    }
+    if (s_want != running) {
+      if (running) {
+        stack_stop();
+        running = false;
+      } else if (stack_start()) {
+        running = true;
+      } else {
+        Serial.println("BLE: start failed");
+        NimBLEDevice::deinit(true);
+      }
+      portENTER_CRITICAL(&s_mux);
+      s_stats.running = running;
+      portEXIT_CRITICAL(&s_mux);
+      if (s_want != running) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);  /* retry on the next switch */
+        continue;
+      }
+    }
+    if (!running || !s_connected) {
+      ulTaskNotifyTake(pdTRUE, running ? pdMS_TO_TICKS(1000) : portMAX_DELAY);
+      wake = xTaskGetTickCount();
+      last_values = millis() - BLE_VALUES_MS;  /* fresh values right after a connect */
+      s_seq = SensorRingHead();
+      continue;
+    }
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(BLE_NOTIFY_MS));
+    if (millis() - last_values >= BLE_VALUES_MS) {
+      last_values = millis();
+      values_update();
+    }
+    samples_pump();
+  }
+}
+
+/* ─── Public API ─── */
+void BleTelemetryInit(void) {
+  if (s_task) return;
+  Preferences prefs;
+  if (prefs.begin(BLE_NVS_NAMESPACE, true)) {
+    s_want = prefs.getBool(BLE_NVS_KEY_ON, false);
+    prefs.getString(BLE_NVS_KEY_NAME, s_name, sizeof(s_name));
+    prefs.end();
+  }
+  portENTER_CRITICAL(&s_mux);
+  s_stats.enabled = s_want;
+  s_stats.mtu = BLE_MTU_DEFAULT;
+  portEXIT_CRITICAL(&s_mux);
+  s_batch.buf = s_batch_buf;
+  /* Lowest priority on the sampler's core, with the other network senders */
+  if (xTaskCreatePinnedToCore(ble_task, "ble", 4096, NULL, 1, &s_task, 1) != pdPASS)
+    Serial.println("BLE: out of memory");
+}
+
+void BleTelemetrySetEnabled(bool on) {
+  Preferences prefs;
+  if (prefs.begin(BLE_NVS_NAMESPACE, false)) {
+    prefs.putBool(BLE_NVS_KEY_ON, on);
+    prefs.end();
+  }
+  s_want = on;
+  portENTER_CRITICAL(&s_mux);
+  s_stats.enabled = on;
+  portEXIT_CRITICAL(&s_mux);
+  if (s_task) xTaskNotifyGive(s_task);
+}
+
+bool BleTelemetryGetEnabled(void) {
+  return s_want;
+}
+
+void BleTelemetrySetName(const char *name) {
+  char n[BLE_NAME_MAX + 1];
+  snprintf(n, sizeof(n), "%s", name ? name : "");
+  Preferences prefs;
+  if (prefs.begin(BLE_NVS_NAMESPACE, false)) {
+    prefs.putString(BLE_NVS_KEY_NAME, n);
+    prefs.end();
+  }
+  portENTER_CRITICAL(&s_mux);
+  memcpy(s_name, n, sizeof(s_name));
+  portEXIT_CRITICAL(&s_mux);
+  /* The name is fixed at stack start: the task restarts the stack if it is up */
+  s_restart = true;
+  if (s_task) xTaskNotifyGive(s_task);
+}
+
+void BleTelemetryGetName(char *buf, size_t len) {
+  if (!buf || !len) return;
+  portENTER_CRITICAL(&s_mux);
+  bool custom = s_name[0] != '\0';
+  if (custom) snprintf(buf, len, "%s", s_name);
+  portEXIT_CRITICAL(&s_mux);
+  if (!custom) snprintf(buf, len, "CYD Shunt %s", WifiLinkDeviceId());
+}
+
+void BleTelemetryGetStats(BleTelemetryStats *out) {
+  if (!out) return;
+  portENTER_CRITICAL(&s_mux);
+  *out = s_stats;
+  portEXIT_CRITICAL(&s_mux);
+}
+
+void BleTelemetryGetInfo(char *buf, size_t len) {
+  if (!buf || !len) return;
+  BleTelemetryStats st;
+  BleTelemetryGetStats(&st);
+  char name[BLE_NAME_MAX + 1];
+  BleTelemetryGetName(name, sizeof(name));
+  if (!st.enabled) {
+    snprintf(buf, len, "off");
+  } else if (!st.running) {
+    snprintf(buf, len, "%s, starting", name);
+  } else if (!st.connected) {
+    snprintf(buf, len, "%s, advertising", name);
+  } else {
+    unsigned pts = st.subscribed && st.decim ? BLE_MAX_HZ / st.decim : 0;
+    snprintf(buf, len, "%s connected, MTU %u, %u pts/s%s", name, (unsigned)st.mtu, pts,
+             st.subscribed ? "" : " (not subscribed)");
+  }
+}
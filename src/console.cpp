@@ -0,0 +1,629 @@
+/**
+ * @file console.cpp
+ * Serial command console (see console.h).
+ */
+#include "console.h"
+#include "sensor.h"
+#include "session_stats.h"
+#include "history_log.h"
+#include "sd_log.h"
+#include "usb_stream.h"
+#include "wifi_link.h"
+#include "mqtt_pub.h"
+#include "http_api.h"
+#include "ws_stream.h"
+#include "ble_telemetry.h"
+#include "modbus_slave.h"
+#include "influx_up.h"
+#include "ui_perf.h"
+#include <Arduino.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Owned by main.cpp (shared with the settings screens) */
+extern float maxCurrent;
+extern float shuntResistance;
+extern void saveShuntCalibration(void);
+extern bool get_vedirect_enabled(void);
+extern void set_vedirect_enabled(bool on);
+
+#define CONSOLE_RX_PER_POLL  64    /* input bytes handled per poll */
+#define CONSOLE_JOB_ROOM     512   /* queue space a listing job needs before it adds rows */
+#define CONSOLE_MAX_ARGS     6
+
+/* ─── Output queue ─── */
+static char         s_tx[CONSOLE_TX_BYTES];
+static uint32_t     s_tx_head = 0;  /* total bytes queued */
+static uint32_t     s_tx_tail = 0;  /* total bytes sent */
+static uint32_t     s_tx_drop_note = 0;
+static portMUX_TYPE s_tx_mux = portMUX_INITIALIZER_UNLOCKED;
+static ConsoleStats s_stats;
+
+/* Input line and poll timing (loop task only) */
+static char     s_line[CONSOLE_LINE_MAX];
+static size_t   s_line_len = 0;
+static bool     s_last_cr = false;
+static uint32_t s_last_poll_us = 0;
+static uint64_t s_gap_sum_us = 0;
+static uint32_t s_gap_n = 0;
+
+/* Listing in progress: returns false when finished */
+typedef bool (*console_job_t)(void);
+static console_job_t s_job = NULL;
+
+/* 'stream' typed: ConsolePoll() switches once the queued text has gone out at the console baud */
+static bool s_stream_pending = false;
+
+void ConsoleWrite(const char *s, size_t len) {
+  portENTER_CRITICAL(&s_tx_mux);
+  uint32_t room = CONSOLE_TX_BYTES - (s_tx_head - s_tx_tail);
+  size_t n = len < room ? len : room;
+  for (size_t k = 0; k < n; k++) s_tx[(s_tx_head + k) % CONSOLE_TX_BYTES] = s[k];
+  s_tx_head += n;
+  if (n < len) {
+    s_stats.tx_dropped += len - n;
+    s_tx_drop_note += len - n;
+  }
+  uint32_t queued = s_tx_head - s_tx_tail;
+  if (queued > s_stats.tx_peak) s_stats.tx_peak = (uint16_t)queued;
+  portEXIT_CRITICAL(&s_tx_mux);
+}
+
+void ConsolePrintf(const char *fmt, ...) {
+  char buf[256];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (n <= 0) return;
+  ConsoleWrite(buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+}
+
+static uint32_t tx_room(void) {
+  portENTER_CRITICAL(&s_tx_mux);
+  uint32_t room = CONSOLE_TX_BYTES - (s_tx_head - s_tx_tail);
+  portEXIT_CRITICAL(&s_tx_mux);
+  return room;
+}
+
+/* Send only what the UART takes without blocking */
+static void tx_drain(void) {
+  for (;;) {
+    int can = Serial.availableForWrite();
+    if (can <= 0) return;
+    portENTER_CRITICAL(&s_tx_mux);
+    uint32_t queued = s_tx_head - s_tx_tail;
+    uint32_t at = s_tx_tail % CONSOLE_TX_BYTES;
+    uint32_t n = CONSOLE_TX_BYTES - at;  /* contiguous part */
+    if (n > queued) n = queued;
+    if (n > (uint32_t)can) n = (uint32_t)can;
+    portEXIT_CRITICAL(&s_tx_mux);
+    if (n == 0) break;
+    Serial.write((const uint8_t *)&s_tx[at], n);  /* only this task advances the tail */
+    portENTER_CRITICAL(&s_tx_mux);
+    s_tx_tail += n;
+    s_stats.tx_bytes += n;
+    portEXIT_CRITICAL(&s_tx_mux);
+  }
+  uint32_t dropped = 0;
+  portENTER_CRITICAL(&s_tx_mux);
+  if (s_tx_drop_note && s_tx_head == s_tx_tail) {
+    dropped = s_tx_drop_note;
+    s_tx_drop_note = 0;
+  }
+  portEXIT_CRITICAL(&s_tx_mux);
+  if (dropped) ConsolePrintf("[%lu bytes dropped]\n", (unsigned long)dropped);
+}
+
+static void prompt(void) {
+  ConsoleWrite("> ", 2);
+}
+
+/* ─── Commands ─── */
+static void print_channel(const char *name, const char *unit, const StatsChannel *ch) {
+  if (!ch->n) {
+    ConsolePrintf("  %-8s -\n", name);
+    return;
+  }
+  ConsolePrintf("  %-8s mean %.4f %s, sd %.4f, min %.4f (t=%lu s), max %.4f (t=%lu s), n %lu\n", name, ch->mean,
+                unit, (double)SessionStatsStdDev(ch), (double)ch->min, (unsigned long)ch->min_t_s, (double)ch->max,
+                (unsigned long)ch->max_t_s, (unsigned long)ch->n);
+}
+
+static void print_scope(StatsScope scope) {
+  SessionStats st;
+  SessionStatsGet(scope, &st);
+  ConsolePrintf("%s (since t=%lu s, now t=%lu s):\n", scope == STATS_SESSION ? "Session" : "Lifetime",
+                (unsigned long)st.start_t_s, (unsigned long)SessionStatsNow());
+  print_channel("voltage", "V", &st.voltage);
+  print_channel("current", "A", &st.current);
+  print_channel("power", "W", &st.power);
+  ConsolePrintf("  peak |P| %.2f W (t=%lu s), in %.4f Ah, out %.4f Ah\n", (double)st.peak_power_W,
+                (unsigned long)st.peak_power_t_s, st.ah_in, st.ah_out);
+  ConsolePrintf("  charging %llu s, discharging %llu s, idle %llu s\n", (unsigned long long)(st.charge_ms / 1000),
+                (unsigned long long)(st.discharge_ms / 1000), (unsigned long long)(st.idle_ms / 1000));
+}
+
+static void cmd_read(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  if (!SensorIsConnected()) {
+    ConsolePrintf("%s: not connected\n", SensorGetDriverName());
+    return;
+  }
+  float v = SensorGetBusVoltage();
+  float i = SensorGetCurrent();
+  ConsolePrintf("%s  %.4f V  %.4f A  %.3f W  %.3f Wh  %.1f C\n", SensorGetDriverName(), (double)v, (double)i,
+                (double)SensorGetPower(), SensorGetWattHour(), (double)SensorGetTemperature());
+  ConsolePrintf("sampler %lu Hz, averaging %s\n", (unsigned long)SensorSampleRate(), SensorGetAveragingString());
+}
+
+static void cmd_stats(int argc, char **argv) {
+  bool life = argc > 1 && !strcmp(argv[1], "life");
+  bool session = argc > 1 && !strcmp(argv[1], "session");
+  if (argc > 2 && !strcmp(argv[1], "reset")) {
+    if (!strcmp(argv[2], "session")) SessionStatsReset(STATS_SESSION);
+    else if (!strcmp(argv[2], "life")) SessionStatsReset(STATS_LIFETIME);
+    else {
+      ConsolePrintf("usage: stats reset session|life\n");
+      return;
+    }
+    ConsolePrintf("%s statistics cleared\n", argv[2]);
+    return;
+  }
+  if (!life) print_scope(STATS_SESSION);
+  if (!session) print_scope(STATS_LIFETIME);
+}
+
+/* history: CSV rows, a few per poll */
+static uint32_t s_hist_next = 0;
+static uint32_t s_hist_end = 0;
+
+static bool job_history(void) {
+  HistoryLogRecord rec[8];
+  uint32_t n = s_hist_end - s_hist_next;
+  if (n > 8) n = 8;
+  size_t got = HistoryLogRead(s_hist_next, rec, n);
+  for (size_t k = 0; k < got; k++) {
+    const HistoryLogRecord *r = &rec[k];
+    if (isnan(r->voltage_V)) {
+      ConsolePrintf("%lu,,,,\n", (unsigned long)(s_hist_next + k));
+      continue;
+    }
+    ConsolePrintf("%lu,%.4f,%.4f,%.3f,%.3f\n", (unsigned long)(s_hist_next + k), (double)r->voltage_V,
+                  (double)r->current_A, (double)r->power_W, (double)r->energy_Wh);
+  }
+  s_hist_next += got;
+  return got == n && s_hist_next < s_hist_end;
+}
+
+static void cmd_history(int argc, char **argv) {
+  if (!HistoryLogIsReady()) {
+    ConsolePrintf("no history partition\n");
+    return;
+  }
+  uint32_t want = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 60;
+  uint32_t count = HistoryLogCount();
+  if (want == 0 || want > count) want = count;
+  s_hist_end = count;
+  s_hist_next = count - want;
+  ConsolePrintf("# last %lu of %lu records, %lu ms apart, oldest first\nindex,voltage_V,current_A,power_W,energy_Wh\n",
+                (unsigned long)want, (unsigned long)count, (unsigned long)HistoryLogIntervalMs());
+  if (want) s_job = job_history;
+}
+
+static void cmd_avg(int argc, char **argv) {
+  if (argc > 1 && !strcmp(argv[1], "next")) {
+    SensorCycleAveraging();
+  } else if (argc > 1) {
+    char *end;
+    unsigned long n = strtoul(argv[1], &end, 10);
+    if (*end || n > 0xFFFF || !SensorSetAveraging((uint16_t)n)) {
+      ConsolePrintf("usage: avg [next|<samples>] (INA228/INA226: 1, 4, 16, 64..1024; INA219: 1..16)\n");
+      return;
+    }
+  }
+  ConsolePrintf("averaging %s\n", SensorGetAveragingString());
+}
+
+static void cmd_shunt(int argc, char **argv) {
+  if (argc == 3) {
+    float max_a = strtof(argv[1], NULL);
+    float r_ohm = strtof(argv[2], NULL) / 1000.0f;
+    if (max_a <= 0 || max_a > 200 || r_ohm <= 0 || r_ohm > 0.1f) {  /* as loadShuntCalibration() */
+      ConsolePrintf("out of range: 0 < max A <= 200, 0 < shunt mOhm <= 100\n");
+      return;
+    }
+    maxCurrent = max_a;
+    shuntResistance = r_ohm;
+    saveShuntCalibration();
+    int rc = SensorSetShunt(maxCurrent, shuntResistance);
+    if (rc != 0) ConsolePrintf("sensor rejected the shunt (code %d)\n", rc);
+  } else if (argc != 1) {
+    ConsolePrintf("usage: shunt [max_A shunt_mOhm]\n");
+    return;
+  }
+  ConsolePrintf("shunt %.3f mOhm, max %.1f A\n", (double)(shuntResistance * 1000.0f), (double)maxCurrent);
+}
+
+static void cmd_vedirect(int argc, char **argv) {
+  if (argc > 1 && !strcmp(argv[1], "on")) set_vedirect_enabled(true);
+  else if (argc > 1 && !strcmp(argv[1], "off")) set_vedirect_enabled(false);
+  else if (argc > 1) {
+    ConsolePrintf("usage: vedirect [on|off]\n");
+    return;
+  }
+  ConsolePrintf("VE.Direct %s\n", get_vedirect_enabled() ? "on" : "off");
+}
+
+static void cmd_energy(int argc, char **argv) {
+  if (argc != 2 || strcmp(argv[1], "reset") != 0) {
+    ConsolePrintf("usage: energy reset\n");
+    return;
+  }
+  HistoryLogFlush();
+  SensorResetEnergy();
+  ConsolePrintf("energy and charge cleared\n");
+}
+
+static void cmd_wifi(int argc, char **argv) {
+  if (argc > 1) {
+    if (!strcmp(argv[1], "off")) WifiLinkSetCredentials("", "");
+    else WifiLinkSetCredentials(argv[1], argc > 2 ? argv[2] : "");
+  }
+  char info[64];
+  WifiLinkGetInfo(info, sizeof(info));
+  ConsolePrintf("Wi-Fi %s, device id %s\n", info, WifiLinkDeviceId());
+}
+
+static void cmd_mqtt(int argc, char **argv) {
+  if (argc == 2 && !strcmp(argv[1], "on")) {
+    MqttPubSetEnabled(true);
+  } else if (argc == 2 && !strcmp(argv[1], "off")) {
+    MqttPubSetEnabled(false);
+  } else if (argc >= 3 && argc != 5 && !strcmp(argv[1], "broker")) {
+    long port = argc > 3 ? strtol(argv[3], NULL, 10) : 1883;
+    if (port <= 0 || port > 65535) {
+      ConsolePrintf("bad port\n");
+      return;
+    }
+    MqttPubConfigure(argv[2], (uint16_t)port, argc > 5 ? argv[4] : NULL, argc > 5 ? argv[5] : NULL);
+  } else if (argc > 1) {
+    ConsolePrintf("usage: mqtt [on|off] | mqtt broker <host> [port [user pass]]\n");
+    return;
+  }
+  char info[80];
+  MqttPubStats m;
+  MqttPubGetInfo(info, sizeof(info));
+  MqttPubGetStats(&m);
+  ConsolePrintf("MQTT %s\n", info);
+  ConsolePrintf("  %lu connects, %lu failed, %lu messages (%lu failed), %lu samples sent, %lu dropped\n",
+                (unsigned long)m.connects, (unsigned long)m.connect_failures, (unsigned long)m.messages,
+                (unsigned long)m.publish_failures, (unsigned long)m.samples_sent, (unsigned long)m.samples_dropped);
+  ConsolePrintf("  queue %u/%u (peak %u), batch %u (max %u) every %lu ms, publish %lu us (max %lu us)\n",
+                (unsigned)m.queued, (unsigned)MQTT_QUEUE_SAMPLES, (unsigned)m.queue_peak, (unsigned)m.batch_last,
+                (unsigned)m.batch_max, (unsigned long)m.batch_interval_ms, (unsigned long)m.publish_us_last,
+                (unsigned long)m.publish_us_max);
+}
+
+static void cmd_ble(int argc, char **argv) {
+  if (argc == 2 && !strcmp(argv[1], "on")) {
+    BleTelemetrySetEnabled(true);
+  } else if (argc == 2 && !strcmp(argv[1], "off")) {
+    BleTelemetrySetEnabled(false);
+  } else if (argc >= 2 && !strcmp(argv[1], "name")) {
+    /* The console splits on spaces: join the words back; no words = default name */
+    char name[BLE_NAME_MAX + 1] = "";
+    size_t n = 0;
+    for (int k = 2; k < argc && n < BLE_NAME_MAX; k++)
+      n += snprintf(name + n, sizeof(name) - n, "%s%s", k > 2 ? " " : "", argv[k]);
+    BleTelemetrySetName(name);
+  } else if (argc > 1) {
+    ConsolePrintf("usage: ble [on|off] | ble name [name]\n");
+    return;
+  }
+  char info[96];
+  BleTelemetryStats b;
+  BleTelemetryGetInfo(info, sizeof(info));
+  BleTelemetryGetStats(&b);
+  ConsolePrintf("BLE %s\n", info);
+  ConsolePrintf("  %lu connects, %lu notifies, %lu points, %lu notify failures, %lu samples dropped, decim %u\n",
+                (unsigned long)b.connects, (unsigned long)b.notifies, (unsigned long)b.points,
+                (unsigned long)b.notify_failures, (unsigned long)b.samples_dropped, (unsigned)b.decim);
+}
+
+static void cmd_modbus(int argc, char **argv) {
+  bool on = argc == 3 && !strcmp(argv[2], "on");
+  bool off = argc == 3 && !strcmp(argv[2], "off");
+  if (argc == 3 && !strcmp(argv[1], "rtu") && (on || off)) {
+    ModbusSlaveSetRtu(on);
+  } else if (argc == 3 && !strcmp(argv[1], "tcp") && (on || off)) {
+    ModbusSlaveSetTcp(on);
+  } else if (argc == 3 && !strcmp(argv[1], "unit")) {
+    long unit = strtol(argv[2], NULL, 10);
+    if (unit < 1 || unit > 247 || !ModbusSlaveSetUnit((uint8_t)unit)) {
+      ConsolePrintf("unit must be 1..247\n");
+      return;
+    }
+  } else if (argc >= 3 && argc != 5 && argc <= 7 && !strcmp(argv[1], "uart")) {
+    ModbusRtuConfig c;
+    ModbusSlaveGetRtuConfig(&c);
+    c.baud = (uint32_t)strtoul(argv[2], NULL, 10);
+    if (argc > 3) c.parity = (char)toupper((unsigned char)argv[3][0]);
+    if (argc > 5) {
+      c.rx_pin = (int8_t)atoi(argv[4]);
+      c.tx_pin = (int8_t)atoi(argv[5]);
+      c.de_pin = argc > 6 ? (int8_t)atoi(argv[6]) : -1;
+    }
+    if (!ModbusSlaveRtuPinsOk(&c)) {
+      ConsolePrintf("pins must be free on the CYD (not display, touch, SD, I2C 22/27 or VE.Direct), TX and DE below 34\n");
+      return;
+    }
+    if (!ModbusSlaveSetRtuConfig(&c)) {
+      ConsolePrintf("bad baud rate or parity (N, E, O)\n");
+      return;
+    }
+  } else if (argc > 1) {
+    ConsolePrintf("usage: modbus [rtu|tcp on|off] | modbus unit <1-247> | modbus uart <baud> [N|E|O [rx tx [de]]]\n");
+    return;
+  }
+  char info[96];
+  ModbusSlaveStats m;
+  ModbusSlaveGetInfo(info, sizeof(info));
+  ModbusSlaveGetStats(&m);
+  ConsolePrintf("Modbus %s\n", info);
+  ConsolePrintf("  RTU %lu answered, %lu bad frames, %lu for other units, answer max %lu us\n",
+                (unsigned long)m.rtu_requests, (unsigned long)m.rtu_bad_frames, (unsigned long)m.rtu_other_unit,
+                (unsigned long)m.rtu_answer_us_max);
+  ConsolePrintf("  TCP %lu answered, %lu refused, answer max %lu us | %lu exceptions, %lu commands, %lu refreshes\n",
+                (unsigned long)m.tcp_requests, (unsigned long)m.tcp_rejected, (unsigned long)m.tcp_answer_us_max,
+                (unsigned long)m.exceptions, (unsigned long)m.commands, (unsigned long)m.refreshes);
+}
+
+static void cmd_influx(int argc, char **argv) {
+  if (argc == 2 && !strcmp(argv[1], "on")) {
+    InfluxUpSetEnabled(true);
+  } else if (argc == 2 && !strcmp(argv[1], "off")) {
+    InfluxUpSetEnabled(false);
+  } else if (argc == 3 && !strcmp(argv[1], "url")) {
+    if (!InfluxUpSetUrl(strcmp(argv[2], "-") ? argv[2] : "")) {
+      ConsolePrintf("URL must start with http:// (no https), be shorter than 144 characters and use precision=ms\n");
+      return;
+    }
+  } else if (argc == 3 && !strcmp(argv[1], "token")) {
+    InfluxUpSetToken(strcmp(argv[2], "-") ? argv[2] : "");
+  } else if (argc == 3 && !strcmp(argv[1], "tags")) {
+    if (!InfluxUpSetTags(strcmp(argv[2], "-") ? argv[2] : "")) {
+      ConsolePrintf("tags are key=value pairs separated by commas, no spaces or quotes\n");
+      return;
+    }
+  } else if (argc == 3 && !strcmp(argv[1], "every")) {
+    if (!InfluxUpSetInterval((uint32_t)strtoul(argv[2], NULL, 10))) {
+      ConsolePrintf("period must be 1..3600 s\n");
+      return;
+    }
+  } else if (argc == 3 && !strcmp(argv[1], "drain")) {
+    if (!InfluxUpSetDrainRate((uint32_t)strtoul(argv[2], NULL, 10))) {
+      ConsolePrintf("drain rate must be 512..262144 B/s\n");
+      return;
+    }
+  } else if (argc > 1) {
+    ConsolePrintf("usage: influx [on|off] | influx url|token|tags <value|-> | influx every <s> | influx drain <B/s>\n");
+    return;
+  }
+  char info[96];
+  InfluxUpStats st;
+  InfluxUpGetInfo(info, sizeof(info));
+  InfluxUpGetStats(&st);
+  ConsolePrintf("Influx %s\n", info);
+  ConsolePrintf("  every %lu s, %lu posts (%lu failed, %lu rejected), last %d in %lu ms (max %lu ms)\n",
+                (unsigned long)st.interval_s, (unsigned long)st.posts, (unsigned long)st.post_failures,
+                (unsigned long)st.batches_rejected, st.status_last, (unsigned long)st.post_ms_last,
+                (unsigned long)st.post_ms_max);
+  ConsolePrintf("  points: %lu live, %lu spooled, %lu drained, %lu dropped, %u waiting for the clock\n",
+                (unsigned long)st.points_live, (unsigned long)st.points_spooled, (unsigned long)st.points_drained,
+                (unsigned long)st.points_dropped, (unsigned)st.points_pending);
+  ConsolePrintf("  spool %lu batches, %lu points, %lu B %s, %lu evicted, %lu errors\n",
+                (unsigned long)st.spool_batches, (unsigned long)st.spool_points, (unsigned long)st.spool_bytes,
+                st.spool_on_card ? "on SD" : "in RAM", (unsigned long)st.spool_evicted,
+                (unsigned long)st.spool_errors);
+  ConsolePrintf("  catch-up %lu B/s, %lu points/s (budget %lu B/s)", (unsigned long)st.drain_Bps,
+                (unsigned long)st.drain_pps, (unsigned long)st.drain_budget_Bps);
+  if (st.spool_batches && st.drain_Bps)
+    ConsolePrintf(", backlog clear in ~%lu s", (unsigned long)(st.spool_bytes / st.drain_Bps));
+  ConsolePrintf("\n");
+}
+
+static void cmd_sys(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  char info[96];
+  ConsoleStats cs;
+  ConsoleGetStats(&cs);
+  ConsolePrintf("uptime %lu s, operating time %lu s, %u tasks\n", (unsigned long)(millis() / 1000),
+                (unsigned long)SessionStatsNow(), (unsigned)uxTaskGetNumberOfTasks());
+  ConsolePrintf("heap free %lu B, min free %lu B, largest block %lu B\n", (unsigned long)ESP.getFreeHeap(),
+                (unsigned long)ESP.getMinFreeHeap(), (unsigned long)ESP.getMaxAllocHeap());
+  ConsolePrintf("loop() gap avg %lu us, max %lu us | sampler %lu Hz\n", (unsigned long)cs.poll_gap_us_avg,
+                (unsigned long)cs.poll_gap_us_max, (unsigned long)SensorSampleRate());
+  ConsolePrintf("console: %lu commands, %lu B sent, queue peak %u/%u B, %lu B dropped\n",
+                (unsigned long)cs.commands, (unsigned long)cs.tx_bytes, cs.tx_peak, (unsigned)CONSOLE_TX_BYTES,
+                (unsigned long)cs.tx_dropped);
+  HistoryLogGetInfo(info, sizeof(info));
+  ConsolePrintf("history: %s\n", HistoryLogIsReady() ? info : "RAM only");
+  SdLogGetInfo(info, sizeof(info));
+  ConsolePrintf("SD log: %s\n", info);
+  ConsolePrintf("VE.Direct %s\n", get_vedirect_enabled() ? "on" : "off");
+  WifiLinkGetInfo(info, sizeof(info));
+  ConsolePrintf("Wi-Fi %s\n", info);
+  MqttPubGetInfo(info, sizeof(info));
+  ConsolePrintf("MQTT %s\n", info);
+  HttpApiGetInfo(info, sizeof(info));
+  ConsolePrintf("HTTP %s\n", info);
+  WsStreamGetInfo(info, sizeof(info));
+  ConsolePrintf("WebSocket %s\n", info);
+  BleTelemetryGetInfo(info, sizeof(info));
+  ConsolePrintf("BLE %s\n", info);
+  ModbusSlaveGetInfo(info, sizeof(info));
+  ConsolePrintf("Modbus %s\n", info);
+  InfluxUpGetInfo(info, sizeof(info));
+  ConsolePrintf("Influx %s\n", info);
+}
+
+static void cmd_perf(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  ui_perf_dump();
+}
+
+static void cmd_stream(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  /* The stream switches the port's baud rate: ConsolePoll() starts it once the queue is empty */
+  s_stream_pending = true;
+}
+
+static void cmd_help(int argc, char **argv);
+
+typedef struct {
+  const char *name;
+  const char *alias;
+  const char *args;
+  const char *help;
+  void (*fn)(int argc, char **argv);
+} console_cmd_t;
+
+static const console_cmd_t k_cmds[] = {
+  {"read",     "r",  "",               "sensor snapshot",                                   cmd_read},
+  {"stats",    NULL, "[session|life]", "statistics; 'stats reset session|life' clears one", cmd_stats},
+  {"history",  NULL, "[n]",            "last n stored records as CSV (default 60, 0 = all)", cmd_history},
+  {"avg",      NULL, "[next|<n>]",     "show, cycle or set (samples) the sensor averaging", cmd_avg},
+  {"shunt",    NULL, "[A mOhm]",       "show or set max current and shunt resistance",      cmd_shunt},
+  {"vedirect", NULL, "[on|off]",       "show or switch VE.Direct output",                   cmd_vedirect},
+  {"energy",   NULL, "reset",          "clear energy and charge counters",                  cmd_energy},
+  {"wifi",     NULL, "[ssid [pass]]",  "show or set Wi-Fi; 'wifi off' turns it off",        cmd_wifi},
+  {"mqtt",     NULL, "[on|off]",       "MQTT status; 'mqtt broker <host> [port [user pass]]'", cmd_mqtt},
+  {"ble",      NULL, "[on|off]",       "BLE status; 'ble name [name]' sets the advertised name", cmd_ble},
+  {"modbus",   NULL, "[rtu|tcp on|off]","Modbus status; 'modbus unit <n>', 'modbus uart <baud> [N|E|O [rx tx [de]]]'", cmd_modbus},
+  {"influx",   NULL, "[on|off]",       "InfluxDB status; 'influx url|token|tags <v|->', 'influx every <s>', 'influx drain <B/s>'", cmd_influx},
+  {"sys",      NULL, "",               "heap, loop timing, logger and network status",      cmd_sys},
+  {"perf",     "p",  "",               "UI render/flush/heap histograms",                   cmd_perf},
+  {"stream",   "s",  "",               "binary sample stream (docs/USB_STREAM.md)",         cmd_stream},
+  {"help",     "?",  "",               "this list",                                         cmd_help},
+};
+
+static void cmd_help(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  for (size_t k = 0; k < sizeof(k_cmds) / sizeof(k_cmds[0]); k++) {
+    const console_cmd_t *c = &k_cmds[k];
+    ConsolePrintf("  %-8s %-3s %-15s %s\n", c->name, c->alias ? c->alias : "", c->args, c->help);
+  }
+}
+
+static void run_line(char *line) {
+  char *argv[CONSOLE_MAX_ARGS];
+  int argc = 0;
+  char *save = NULL;
+  for (char *tok = strtok_r(line, " \t", &save); tok && argc < CONSOLE_MAX_ARGS; tok = strtok_r(NULL, " \t", &save))
+    argv[argc++] = tok;
+  if (argc == 0) return;
+  s_job = NULL;  /* a new command ends any listing still running */
+  for (size_t k = 0; k < sizeof(k_cmds) / sizeof(k_cmds[0]); k++) {
+    const console_cmd_t *c = &k_cmds[k];
+    if (!strcmp(argv[0], c->name) || (c->alias && !strcmp(argv[0], c->alias))) {
+      s_stats.commands++;
+      c->fn(argc, argv);
+      return;
+    }
+  }
+  ConsolePrintf("unknown command '%s' (try help)\n", argv[0]);
+}
+
+/* ─── Polling ─── */
+static void rx_byte(char c) {
+  bool lf_after_cr = c == '\n' && s_last_cr;
+  s_last_cr = c == '\r';
+  if (lf_after_cr) return;
+  if (c == '\r' || c == '\n') {
+#if CONSOLE_ECHO
+    ConsoleWrite("\r\n", 2);
+#endif
+    s_line[s_line_len] = '\0';
+    s_line_len = 0;
+    run_line(s_line);
+    if (!s_job && !s_stream_pending && !UsbStreamIsActive()) prompt();
+    return;
+  }
+  if (c == '\b' || c == 0x7F) {
+    if (s_line_len) {
+      s_line_len--;
+#if CONSOLE_ECHO
+      ConsoleWrite("\b \b", 3);
+#endif
+    }
+    return;
+  }
+  if ((uint8_t)c < 0x20 || s_line_len >= CONSOLE_LINE_MAX - 1) return;
+  s_line[s_line_len++] = c;
+#if CONSOLE_ECHO
+  ConsoleWrite(&c, 1);
+#endif
+}
+
+void ConsoleInit(void) {
+  s_last_poll_us = micros();
+  ConsolePrintf("Console ready, type 'help'.\n");
+  prompt();
+}
+
+void ConsolePoll(void) {
+  uint32_t now = micros();
+  uint32_t gap = now - s_last_poll_us;
+  s_last_poll_us = now;
+  s_gap_sum_us += gap;
+  s_gap_n++;
+  if (gap > s_stats.poll_gap_us_max) s_stats.poll_gap_us_max = gap;
+
+  for (int k = 0; k < CONSOLE_RX_PER_POLL && Serial.available(); k++) {
+    int c = Serial.read();
+    if (c < 0) break;
+    if (UsbStreamIsActive()) {
+      /* Binary frames are going out: no line editing, only the stop byte */
+      if (c == USB_STREAM_CMD_TOGGLE) {
+        UsbStreamStop();
+        s_line_len = 0;
+        prompt();
+      }
+      continue;
+    }
+    rx_byte((char)c);
+  }
+
+  if (s_job && tx_room() >= CONSOLE_JOB_ROOM && !s_job()) {
+    s_job = NULL;
+    prompt();
+  }
+  tx_drain();
+  if (s_stream_pending) {
+    portENTER_CRITICAL(&s_tx_mux);
+    bool empty = s_tx_head == s_tx_tail;
+    portEXIT_CRITICAL(&s_tx_mux);
+    if (empty) {
+      s_stream_pending = false;
+      UsbStreamStart();
+    }
+  }
+}
+
+void ConsoleGetStats(ConsoleStats *out) {
+  if (!out) return;
+  portENTER_CRITICAL(&s_tx_mux);
+  *out = s_stats;
+  portEXIT_CRITICAL(&s_tx_mux);
+  out->poll_gap_us_avg = s_gap_n ? (uint32_t)(s_gap_sum_us / s_gap_n) : 0;
+}
@@ -0,0 +1,329 @@
+/**
+ * @file history_log.cpp
+ * Log-structured history store on the "history" data partition (see history_log.h, docs/HISTORY_LOG.md).
+ */
+#include "history_log.h"
+#include "crc32.h"
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <math.h>
+#include <string.h>
+
+#define HISTLOG_PARTITION_LABEL "history"
+#define HISTLOG_MAGIC           0x4C485943u  /* "CYHL" little-endian */
+#define HISTLOG_VERSION         1
+#define HISTLOG_PAGE_SIZE       4096u        /* one flash sector */
+#define HISTLOG_BLOCK_RECORDS   8u           /* records per flash write */
+#define HISTLOG_QUEUE_BLOCKS    4u           /* sealed blocks waiting for the writer task (32 s at 1 rec/s) */
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t record_size;
+  uint32_t seq;         /* page sequence; the newest page has the highest */
+  uint32_t first_rec;   /* absolute record number of the first slot in this page */
+  uint32_t interval_ms;
+  uint32_t reserved[2];
+  uint32_t crc;         /* CRC32 of the preceding header bytes */
+} histlog_page_hdr_t;
+
+typedef struct {
+  HistoryLogRecord rec[HISTLOG_BLOCK_RECORDS];
+  uint32_t crc;         /* CRC32 of rec[] */
+} histlog_block_t;
+
+static_assert(sizeof(histlog_page_hdr_t) == 32, "page header must stay 32 bytes");
+static_assert(sizeof(histlog_block_t) % 4 == 0, "flash writes must be word aligned");
+
+#define HISTLOG_PAGE_BLOCKS  ((HISTLOG_PAGE_SIZE - sizeof(histlog_page_hdr_t)) / sizeof(histlog_block_t))
+#define HISTLOG_PAGE_RECORDS (HISTLOG_PAGE_BLOCKS * HISTLOG_BLOCK_RECORDS)
+
+static const esp_partition_t *s_part = NULL;
+static bool     s_ready = false;      /* set once by HistoryLogInit() at boot, before any other task uses the log */
+static uint32_t s_sample_ms = 0;      /* HistoryLogPush() feed period, from HistoryLogInit() */
+static SemaphoreHandle_t s_lock = NULL;  /* everything below; never held across a flash erase or write */
+static QueueHandle_t s_write_q = NULL;   /* sealed blocks (by value) for writer_task */
+static uint32_t s_dropped = 0;        /* blocks lost: queue full or page erase failed */
+static uint32_t s_pages = 0;          /* sectors in the partition */
+static int32_t  s_head = -1;          /* sector being filled, -1 = log empty */
+static uint32_t s_head_seq = 0;
+static uint32_t s_head_first_rec = 0;
+static uint32_t s_head_blocks = 0;    /* blocks written (or skipped) in the head page; readers stop here */
+static uint32_t s_pages_used = 0;     /* contiguous valid pages ending at s_head */
+
+/* RAM batch: filled record by record, written as one block */
+static histlog_block_t s_block;
+static uint32_t s_block_fill = 0;
+
+/* Decimation accumulator */
+static double   s_acc_v = 0, s_acc_i = 0, s_acc_p = 0;
+static uint32_t s_acc_n = 0;
+
+/* Last block read (sequential readers hit it HISTLOG_BLOCK_RECORDS-1 times out of HISTLOG_BLOCK_RECORDS) */
+static histlog_block_t s_rd_block;
+static int32_t  s_rd_sector = -1;
+static uint32_t s_rd_index = 0;
+static bool     s_rd_valid = false;
+
+static uint32_t sector_offset(uint32_t sector) {
+  return sector * HISTLOG_PAGE_SIZE;
+}
+
+static uint32_t block_offset(uint32_t sector, uint32_t blk) {
+  return sector_offset(sector) + sizeof(histlog_page_hdr_t) + blk * sizeof(histlog_block_t);
+}
+
+static bool read_header(uint32_t sector, histlog_page_hdr_t *h) {
+  if (esp_partition_read(s_part, sector_offset(sector), h, sizeof(*h)) != ESP_OK) return false;
+  if (h->magic != HISTLOG_MAGIC || h->version != HISTLOG_VERSION) return false;
+  if (h->record_size != sizeof(HistoryLogRecord)) return false;
+  return h->crc == Crc32(h, offsetof(histlog_page_hdr_t, crc));
+}
+
+static bool block_is_erased(const histlog_block_t *b) {
+  const uint32_t *w = (const uint32_t *)b;
+  for (size_t k = 0; k < sizeof(*b) / 4; k++)
+    if (w[k] != 0xFFFFFFFFu) return false;
+  return true;
+}
+
+static void clear_block(histlog_block_t *b) {
+  memset(b, 0xFF, sizeof(*b));  /* erased-flash pattern: unused float slots read as NaN */
+}
+
+/* Count written blocks in the head page. A block that fails its CRC (torn write at power loss)
+ * closes the page, since flash cannot be rewritten in place; its slots read back as gaps. */
+static uint32_t scan_head_blocks(uint32_t sector) {
+  histlog_block_t b;
+  for (uint32_t blk = 0; blk < HISTLOG_PAGE_BLOCKS; blk++) {
+    if (esp_partition_read(s_part, block_offset(sector, blk), &b, sizeof(b)) != ESP_OK)
+      return HISTLOG_PAGE_BLOCKS;
+    if (block_is_erased(&b)) return blk;
+    if (b.crc != Crc32(b.rec, sizeof(b.rec))) return HISTLOG_PAGE_BLOCKS;
+  }
+  return HISTLOG_PAGE_BLOCKS;
+}
+
+static void log_lock(void) {
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+}
+
+static void log_unlock(void) {
+  xSemaphoreGive(s_lock);
+}
+
+/* Writer task only (single writer of the head state). Erase the next sector in the ring and stamp its
+ * header. Overwrites the oldest page once full: that page leaves the readable range first, so the
+ * erase runs without the lock and readers never see a half-erased page. */
+static bool open_next_page(void) {
+  uint32_t sector = (s_head < 0) ? 0 : ((uint32_t)s_head + 1) % s_pages;
+  log_lock();
+  if ((int32_t)sector == s_rd_sector) s_rd_sector = -1;
+  if (s_pages_used == s_pages) s_pages_used--;
+  log_unlock();
+  if (esp_partition_erase_range(s_part, sector_offset(sector), HISTLOG_PAGE_SIZE) != ESP_OK)
+    return false;
+
+  histlog_page_hdr_t h;
+  memset(&h, 0xFF, sizeof(h));
+  h.magic       = HISTLOG_MAGIC;
+  h.version     = HISTLOG_VERSION;
+  h.record_size = sizeof(HistoryLogRecord);
+  h.seq         = (s_head < 0) ? 1 : s_head_seq + 1;
+  h.first_rec   = (s_head < 0) ? 0 : s_head_first_rec + HISTLOG_PAGE_RECORDS;
+  h.interval_ms = HistoryLogIntervalMs();
+  h.crc         = Crc32(&h, offsetof(histlog_page_hdr_t, crc));
+  if (esp_partition_write(s_part, sector_offset(sector), &h, sizeof(h)) != ESP_OK)
+    return false;
+
+  log_lock();
+  s_head = (int32_t)sector;
+  s_head_seq = h.seq;
+  s_head_first_rec = h.first_rec;
+  s_head_blocks = 0;
+  if (s_pages_used < s_pages) s_pages_used++;
+  log_unlock();
+  return true;
+}
+
+/* Lowest priority, like the SD writer: page erases (~45 ms) and block writes never run on the
+ * LVGL task, and readers only wait for the short bookkeeping around them. */
+static void writer_task(void *arg) {
+  (void)arg;
+  histlog_block_t b;
+  for (;;) {
+    if (xQueueReceive(s_write_q, &b, portMAX_DELAY) != pdTRUE) continue;
+    if (s_head < 0 || s_head_blocks >= HISTLOG_PAGE_BLOCKS) {
+      if (!open_next_page()) {
+        log_lock();
+        s_dropped++;
+        log_unlock();
+        continue;
+      }
+    }
+    /* Past s_head_blocks: no reader looks at this slot until the count below includes it */
+    esp_partition_write(s_part, block_offset((uint32_t)s_head, s_head_blocks), &b, sizeof(b));
+    log_lock();
+    s_head_blocks++;  /* on write failure the slot reads back as a CRC gap */
+    log_unlock();
+  }
+}
+
+/* Caller holds the lock. Hands the RAM block to the writer; never blocks. */
+static void seal_block(void) {
+  s_block.crc = Crc32(s_block.rec, sizeof(s_block.rec));
+  if (xQueueSend(s_write_q, &s_block, 0) != pdTRUE) s_dropped++;
+  clear_block(&s_block);
+  s_block_fill = 0;
+}
+
+static uint32_t count_locked(void) {
+  if (s_pages_used == 0) return 0;
+  return (s_pages_used - 1) * HISTLOG_PAGE_RECORDS + s_head_blocks * HISTLOG_BLOCK_RECORDS;
+}
+
+bool HistoryLogInit(uint32_t sample_ms) {
+  s_ready = false;
+  s_sample_ms = sample_ms;
+  if (!s_lock) s_lock = xSemaphoreCreateMutex();
+  if (!s_write_q) s_write_q = xQueueCreate(HISTLOG_QUEUE_BLOCKS, sizeof(histlog_block_t));
+  if (!s_lock || !s_write_q) return false;
+  s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, HISTLOG_PARTITION_LABEL);
+  if (!s_part) return false;
+  s_pages = s_part->size / HISTLOG_PAGE_SIZE;
+  if (s_pages < 2) return false;
+
+  /* Pass 1: headers only, find the newest page */
+  histlog_page_hdr_t h;
+  s_head = -1;
+  for (uint32_t sec = 0; sec < s_pages; sec++) {
+    if (!read_header(sec, &h)) continue;
+    if (s_head < 0 || (int32_t)(h.seq - s_head_seq) > 0) {
+      s_head = (int32_t)sec;
+      s_head_seq = h.seq;
+      s_head_first_rec = h.first_rec;
+    }
+  }
+
+  /* Pass 2: walk back while pages are valid and consecutive */
+  s_pages_used = 0;
+  s_head_blocks = 0;
+  if (s_head >= 0) {
+    s_pages_used = 1;
+    for (uint32_t back = 1; back < s_pages; back++) {
+      uint32_t sec = ((uint32_t)s_head + s_pages - back) % s_pages;
+      if (!read_header(sec, &h) || h.seq != s_head_seq - back) break;
+      s_pages_used++;
+    }
+    s_head_blocks = scan_head_blocks((uint32_t)s_head);
+  }
+
+  clear_block(&s_block);
+  s_block_fill = 0;
+  s_acc_n = 0;
+  s_rd_sector = -1;
+  if (xTaskCreatePinnedToCore(writer_task, "histlog", 3072, NULL, 1, NULL, 1) != pdPASS) return false;
+  s_ready = true;
+  return true;
+}
+
+bool HistoryLogIsReady(void) {
+  return s_ready;
+}
+
+void HistoryLogPush(float voltage_V, float current_A, float power_W, double energy_Wh) {
+  if (!s_ready) return;
+  log_lock();
+  s_acc_v += voltage_V;
+  s_acc_i += current_A;
+  s_acc_p += power_W;
+  if (++s_acc_n < HISTORY_LOG_DECIMATION) {
+    log_unlock();
+    return;
+  }
+
+  HistoryLogRecord &r = s_block.rec[s_block_fill];
+  r.voltage_V = (float)(s_acc_v / s_acc_n);
+  r.current_A = (float)(s_acc_i / s_acc_n);
+  r.power_W   = (float)(s_acc_p / s_acc_n);
+  r.energy_Wh = (float)energy_Wh;
+  s_acc_v = s_acc_i = s_acc_p = 0;
+  s_acc_n = 0;
+
+  if (++s_block_fill >= HISTLOG_BLOCK_RECORDS) seal_block();
+  log_unlock();
+}
+
+void HistoryLogFlush(void) {
+  if (!s_ready) return;
+  log_lock();
+  if (s_block_fill > 0) seal_block();
+  log_unlock();
+}
+
+uint32_t HistoryLogCount(void) {
+  if (!s_ready) return 0;
+  log_lock();
+  uint32_t count = count_locked();
+  log_unlock();
+  return count;
+}
+
+size_t HistoryLogRead(uint32_t first, HistoryLogRecord *out, size_t n) {
+  if (!s_ready || !out) return 0;
+  log_lock();
+  uint32_t count = count_locked();
+  if (first >= count) {
+    log_unlock();
+    return 0;
+  }
+  if (n > count - first) n = count - first;
+
+  uint32_t oldest = ((uint32_t)s_head + s_pages - (s_pages_used - 1)) % s_pages;
+  size_t done = 0;
+  while (done < n) {
+    uint32_t idx    = first + (uint32_t)done;
+    uint32_t sector = (oldest + idx / HISTLOG_PAGE_RECORDS) % s_pages;
+    uint32_t in_pg  = idx % HISTLOG_PAGE_RECORDS;
+    uint32_t blk    = in_pg / HISTLOG_BLOCK_RECORDS;
+    uint32_t slot   = in_pg % HISTLOG_BLOCK_RECORDS;
+
+    if (s_rd_sector != (int32_t)sector || s_rd_index != blk) {
+      s_rd_valid = esp_partition_read(s_part, block_offset(sector, blk), &s_rd_block, sizeof(s_rd_block)) == ESP_OK &&
+                   s_rd_block.crc == Crc32(s_rd_block.rec, sizeof(s_rd_block.rec));
+      s_rd_sector = (int32_t)sector;
+      s_rd_index = blk;
+    }
+    for (; slot < HISTLOG_BLOCK_RECORDS && done < n; slot++, done++) {
+      if (s_rd_valid) {
+        out[done] = s_rd_block.rec[slot];
+      } else {
+        out[done].voltage_V = out[done].current_A = out[done].power_W = out[done].energy_Wh = NAN;
+      }
+    }
+  }
+  log_unlock();
+  return done;
+}
+
+uint32_t HistoryLogIntervalMs(void) {
+  return HISTORY_LOG_DECIMATION * s_sample_ms;
+}
+
+void HistoryLogGetInfo(char *buf, size_t len) {
+  if (!buf || len == 0) return;
+  if (!s_ready) {
+    snprintf(buf, len, "No history partition");
+    return;
+  }
+  log_lock();
+  uint32_t used = s_pages_used, count = count_locked(), dropped = s_dropped;
+  log_unlock();
+  int n = snprintf(buf, len, "%lu/%lu pages, %lu rec", (unsigned long)used, (unsigned long)s_pages,
+                   (unsigned long)count);
+  if (dropped && n > 0 && (size_t)n < len) snprintf(buf + n, len - n, ", %lu blk lost", (unsigned long)dropped);
+}
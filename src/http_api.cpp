@@ -0,0 +1,476 @@
+/**
+ * @file http_api.cpp
+ * HTTP server: Prometheus metrics, JSON API and dashboard (see http_api.h and docs/HTTP_API.md).
+ */
+#include "http_api.h"
+#include "http_dashboard.h"
+#include "ws_dashboard.h"
+#include "live_snapshot.h"
+#include "session_stats.h"
+#include "history_log.h"
+#include "mqtt_pub.h"
+#include "ws_stream.h"
+#include "sensor.h"
+#include "wifi_link.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <ESPAsyncWebServer.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <memory>
+
+#define HTTP_LINE_MAX       192  /* longest generated line */
+#define HTTP_HISTORY_CHUNK  8    /* records read per history lock */
+
+static AsyncWebServer s_server(HTTP_PORT);
+static bool           s_started = false;
+static HttpApiStats   s_stats;
+static portMUX_TYPE   s_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void note_heap(void) {
+  uint32_t free_now = ESP.getFreeHeap();
+  portENTER_CRITICAL(&s_stats_mux);
+  if (!s_stats.heap_low || free_now < s_stats.heap_low) s_stats.heap_low = free_now;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+/* ─── Streamed responses ───
+ * A cursor produces the body one line at a time; fill() copies lines into the buffer the server
+ * hands over (the free TCP send window) and carries a partial line over to the next call. */
+typedef struct http_cursor http_cursor_t;
+typedef size_t (*http_line_fn)(http_cursor_t *c, char *buf, size_t len);  /* 0 = end of body */
+
+struct http_cursor {
+  http_line_fn next_line;
+  char         line[HTTP_LINE_MAX];
+  size_t       line_len;
+  size_t       line_off;
+  bool         done;
+  uint32_t     k;            /* line counter, for the generator */
+  void        *state;        /* generator state, freed with the cursor */
+};
+
+static void cursor_free(http_cursor_t *c) {
+  free(c->state);
+  free(c);
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.active--;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+static size_t cursor_fill(http_cursor_t *c, uint8_t *buf, size_t max) {
+  uint32_t t0 = micros();
+  size_t n = 0;
+  while (n < max) {
+    if (c->line_off == c->line_len) {
+      if (c->done) break;
+      c->line_len = c->next_line(c, c->line, sizeof(c->line));
+      c->line_off = 0;
+      c->k++;
+      if (!c->line_len) {
+        c->done = true;
+        break;
+      }
+    }
+    size_t take = c->line_len - c->line_off;
+    if (take > max - n) take = max - n;
+    memcpy(buf + n, c->line + c->line_off, take);
+    c->line_off += take;
+    n += take;
+  }
+  uint32_t dt = micros() - t0;
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.bytes += n;
+  if (dt > s_stats.fill_us_max) s_stats.fill_us_max = dt;
+  portEXIT_CRITICAL(&s_stats_mux);
+  note_heap();
+  return n;  /* 0 ends the chunked response */
+}
+
+/* Count a request; false (and a 503 sent) when HTTP_MAX_ACTIVE responses are already in flight. */
+static bool admit(AsyncWebServerRequest *req, HttpPath path) {
+  bool ok;
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.requests[path]++;
+  ok = s_stats.active < HTTP_MAX_ACTIVE;
+  if (!ok) s_stats.rejected++;
+  portEXIT_CRITICAL(&s_stats_mux);
+  note_heap();
+  if (!ok) {
+    AsyncWebServerResponse *r = req->beginResponse(503, "text/plain", "busy\n");
+    r->addHeader("Retry-After", "1");
+    req->send(r);
+  }
+  return ok;
+}
+
+/* Send a chunked response driven by fn; state (malloc'd, may be NULL) is freed with the response. */
+static void send_stream(AsyncWebServerRequest *req, const char *type, http_line_fn fn, void *state) {
+  http_cursor_t *raw = (http_cursor_t *)calloc(1, sizeof(http_cursor_t));
+  if (!raw) {
+    free(state);
+    req->send(503, "text/plain", "out of memory\n");
+    return;
+  }
+  raw->next_line = fn;
+  raw->state = state;
+  portENTER_CRITICAL(&s_stats_mux);
+  if (++s_stats.active > s_stats.active_peak) s_stats.active_peak = s_stats.active;
+  portEXIT_CRITICAL(&s_stats_mux);
+  /* The filler owns the cursor: it is freed when the server deletes the response */
+  std::shared_ptr<http_cursor_t> cur(raw, cursor_free);
+  AsyncWebServerResponse *r = req->beginChunkedResponse(
+      type, [cur](uint8_t *buf, size_t max, size_t index) -> size_t {
+        (void)index;
+        return cursor_fill(cur.get(), buf, max);
+      });
+  r->addHeader("Cache-Control", "no-store");
+  req->send(r);
+}
+
+static size_t line_printf(char *buf, size_t len, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+static size_t line_printf(char *buf, size_t len, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, len, fmt, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  return (size_t)n < len ? (size_t)n : len - 1;
+}
+
+/* ─── /metrics ───
+ * Values are captured into a row table when the request arrives, so one scrape is consistent; the
+ * text is generated from the table as the client reads. */
+typedef struct {
+  const char *name;
+  const char *type;
+  const char *help;
+} metric_family_t;
+
+enum {
+  MF_VOLTAGE, MF_CURRENT, MF_POWER, MF_ENERGY, MF_TEMPERATURE, MF_SENSOR_UP, MF_SAMPLE_RATE, MF_AGE,
+  MF_VOLTAGE_MIN, MF_VOLTAGE_MAX, MF_PEAK_POWER, MF_CHARGE, MF_STATE_TIME,
+  MF_UPTIME, MF_OPERATING, MF_HEAP_FREE, MF_HEAP_MIN, MF_HEAP_BLOCK, MF_WIFI_RSSI,
+  MF_HTTP_REQUESTS, MF_HTTP_REJECTED, MF_HTTP_ACTIVE_PEAK, MF_HTTP_HEAP_LOW,
+  MF_MQTT_SENT, MF_MQTT_DROPPED, MF_MQTT_QUEUED,
+  MF_WS_CLIENTS, MF_WS_FRAMES, MF_WS_COARSENED,
+  MF_COUNT
+};
+
+static const metric_family_t k_families[MF_COUNT] = {
+    {"cyd_shunt_voltage_volts",            "gauge",   "Bus voltage, mean since the previous refresh"},
+    {"cyd_shunt_current_amperes",          "gauge",   "Shunt current, positive = charging"},
+    {"cyd_shunt_power_watts",              "gauge",   "Power, mean of per-sample V*I"},
+    {"cyd_shunt_energy_watt_hours",        "gauge",   "Accumulated energy since the last reset"},
+    {"cyd_shunt_temperature_celsius",      "gauge",   "Sensor die temperature (0 without one)"},
+    {"cyd_shunt_sensor_up",                "gauge",   "1 if the INA2xx answers on I2C"},
+    {"cyd_shunt_sample_rate_hertz",        "gauge",   "Sensor sampler rate"},
+    {"cyd_shunt_snapshot_age_seconds",     "gauge",   "Age of the readings above"},
+    {"cyd_shunt_voltage_min_volts",        "gauge",   "Lowest voltage in the scope"},
+    {"cyd_shunt_voltage_max_volts",        "gauge",   "Highest voltage in the scope"},
+    {"cyd_shunt_power_peak_watts",         "gauge",   "Largest |power| in the scope"},
+    {"cyd_shunt_charge_ampere_hours",      "gauge",   "Charge moved in the scope"},
+    {"cyd_shunt_state_seconds",            "gauge",   "Time charging, discharging and idle in the scope"},
+    {"cyd_shunt_uptime_seconds",           "gauge",   "Time since boot"},
+    {"cyd_shunt_operating_seconds_total",  "counter", "Lifetime powered-on time"},
+    {"cyd_shunt_heap_free_bytes",          "gauge",   "Free heap"},
+    {"cyd_shunt_heap_min_free_bytes",      "gauge",   "Lowest free heap since boot"},
+    {"cyd_shunt_heap_largest_block_bytes", "gauge",   "Largest allocatable heap block"},
+    {"cyd_shunt_wifi_rssi_dbm",            "gauge",   "Wi-Fi signal strength"},
+    {"cyd_shunt_http_requests_total",      "counter", "HTTP requests by path"},
+    {"cyd_shunt_http_rejected_total",      "counter", "HTTP requests refused with 503 (too many in flight)"},
+    {"cyd_shunt_http_active_peak",         "gauge",   "Most HTTP responses in flight at once"},
+    {"cyd_shunt_http_heap_low_bytes",      "gauge",   "Lowest free heap seen while serving HTTP"},
+    {"cyd_shunt_mqtt_samples_sent_total",  "counter", "Samples published over MQTT"},
+    {"cyd_shunt_mqtt_samples_dropped_total", "counter", "Samples dropped from the full MQTT queue"},
+    {"cyd_shunt_mqtt_queued_samples",      "gauge",   "Samples waiting for the MQTT broker"},
+    {"cyd_shunt_ws_clients",               "gauge",   "WebSocket stream clients connected"},
+    {"cyd_shunt_ws_frames_total",          "counter", "WebSocket stream frames sent"},
+    {"cyd_shunt_ws_coarsened_total",       "counter", "Times a lagging WebSocket client's decimation doubled"},
+};
+
+#define METRIC_ROWS_MAX 48
+
+typedef struct {
+  uint8_t     family;
+  const char *labels;   /* "" or e.g. "scope=\"session\",direction=\"in\"" */
+  double      value;
+} metric_row_t;
+
+typedef struct {
+  uint16_t     n;
+  uint16_t     row;     /* next row */
+  uint8_t      phase;   /* 0 HELP, 1 TYPE, 2 value */
+  metric_row_t rows[METRIC_ROWS_MAX];
+} metrics_state_t;
+
+static void row(metrics_state_t *m, uint8_t family, const char *labels, double value) {
+  if (m->n < METRIC_ROWS_MAX) m->rows[m->n++] = {family, labels, value};
+}
+
+static void scope_rows(metrics_state_t *m, StatsScope scope) {
+  static const char *const k_v[STATS_SCOPE_COUNT] = {"scope=\"session\"", "scope=\"lifetime\""};
+  static const char *const k_in[STATS_SCOPE_COUNT] = {"scope=\"session\",direction=\"in\"",
+                                                      "scope=\"lifetime\",direction=\"in\""};
+  static const char *const k_out[STATS_SCOPE_COUNT] = {"scope=\"session\",direction=\"out\"",
+                                                       "scope=\"lifetime\",direction=\"out\""};
+  static const char *const k_chg[STATS_SCOPE_COUNT] = {"scope=\"session\",state=\"charging\"",
+                                                       "scope=\"lifetime\",state=\"charging\""};
+  static const char *const k_dis[STATS_SCOPE_COUNT] = {"scope=\"session\",state=\"discharging\"",
+                                                       "scope=\"lifetime\",state=\"discharging\""};
+  static const char *const k_idle[STATS_SCOPE_COUNT] = {"scope=\"session\",state=\"idle\"",
+                                                        "scope=\"lifetime\",state=\"idle\""};
+  SessionStats st;
+  SessionStatsGet(scope, &st);
+  if (st.voltage.n) {
+    row(m, MF_VOLTAGE_MIN, k_v[scope], st.voltage.min);
+    row(m, MF_VOLTAGE_MAX, k_v[scope], st.voltage.max);
+  }
+  row(m, MF_PEAK_POWER, k_v[scope], st.peak_power_W);
+  row(m, MF_CHARGE, k_in[scope], st.ah_in);
+  row(m, MF_CHARGE, k_out[scope], st.ah_out);
+  row(m, MF_STATE_TIME, k_chg[scope], st.charge_ms / 1000.0);
+  row(m, MF_STATE_TIME, k_dis[scope], st.discharge_ms / 1000.0);
+  row(m, MF_STATE_TIME, k_idle[scope], st.idle_ms / 1000.0);
+}
+
+static void metrics_capture(metrics_state_t *m) {
+  static const char *const k_paths[HTTP_PATH_COUNT] = {"path=\"/\"", "path=\"/metrics\"", "path=\"/api/snapshot\"",
+                                                       "path=\"/api/history\"", "path=\"/live\"", "path=\"other\""};
+  LiveSnapshot snap;
+  LiveSnapshotGet(&snap);
+  if (snap.seq) {
+    row(m, MF_VOLTAGE, "", snap.voltage_V);
+    row(m, MF_CURRENT, "", snap.current_A);
+    row(m, MF_POWER, "", snap.power_W);
+    row(m, MF_ENERGY, "", snap.energy_Wh);
+    row(m, MF_TEMPERATURE, "", snap.temperature_C);
+    row(m, MF_SENSOR_UP, "", snap.sensor_connected ? 1 : 0);
+    row(m, MF_SAMPLE_RATE, "", snap.sample_rate_hz);
+    row(m, MF_AGE, "", (millis() - snap.t_ms) / 1000.0);
+  }
+  scope_rows(m, STATS_SESSION);
+  scope_rows(m, STATS_LIFETIME);
+  /* The exposition format wants all rows of a family together; scope_rows() interleaves them per
+     scope, so regroup with a stable sort by family */
+  for (uint16_t a = 1; a < m->n; a++) {
+    metric_row_t r = m->rows[a];
+    uint16_t b = a;
+    while (b > 0 && m->rows[b - 1].family > r.family) {
+      m->rows[b] = m->rows[b - 1];
+      b--;
+    }
+    m->rows[b] = r;
+  }
+  row(m, MF_UPTIME, "", millis() / 1000.0);
+  row(m, MF_OPERATING, "", SessionStatsNow());
+  row(m, MF_HEAP_FREE, "", ESP.getFreeHeap());
+  row(m, MF_HEAP_MIN, "", ESP.getMinFreeHeap());
+  row(m, MF_HEAP_BLOCK, "", ESP.getMaxAllocHeap());
+  if (WifiLinkIsUp()) row(m, MF_WIFI_RSSI, "", WiFi.RSSI());
+  HttpApiStats h;
+  HttpApiGetStats(&h);
+  for (int p = 0; p < HTTP_PATH_COUNT; p++) row(m, MF_HTTP_REQUESTS, k_paths[p], h.requests[p]);
+  row(m, MF_HTTP_REJECTED, "", h.rejected);
+  row(m, MF_HTTP_ACTIVE_PEAK, "", h.active_peak);
+  row(m, MF_HTTP_HEAP_LOW, "", h.heap_low);
+  MqttPubStats q;
+  MqttPubGetStats(&q);
+  if (q.enabled) {
+    row(m, MF_MQTT_SENT, "", q.samples_sent);
+    row(m, MF_MQTT_DROPPED, "", q.samples_dropped);
+    row(m, MF_MQTT_QUEUED, "", q.queued);
+  }
+  WsStreamStats w;
+  WsStreamGetStats(&w);
+  row(m, MF_WS_CLIENTS, "", w.clients);
+  row(m, MF_WS_FRAMES, "", w.frames);
+  row(m, MF_WS_COARSENED, "", w.coarsened);
+}
+
+static size_t metrics_line(http_cursor_t *c, char *buf, size_t len) {
+  metrics_state_t *m = (metrics_state_t *)c->state;
+  if (m->row >= m->n) return 0;
+  const metric_row_t *r = &m->rows[m->row];
+  const metric_family_t *f = &k_families[r->family];
+  bool first = m->row == 0 || m->rows[m->row - 1].family != r->family;
+  if (first && m->phase == 0) {
+    m->phase = 1;
+    return line_printf(buf, len, "# HELP %s %s\n", f->name, f->help);
+  }
+  if (first && m->phase == 1) {
+    m->phase = 2;
+    return line_printf(buf, len, "# TYPE %s %s\n", f->name, f->type);
+  }
+  m->row++;
+  m->phase = 0;
+  char val[24];
+  if (isnan(r->value)) snprintf(val, sizeof(val), "NaN");
+  else snprintf(val, sizeof(val), "%.9g", r->value);
+  if (r->labels[0]) return line_printf(buf, len, "%s{%s} %s\n", f->name, r->labels, val);
+  return line_printf(buf, len, "%s %s\n", f->name, val);
+}
+
+static void handle_metrics(AsyncWebServerRequest *req) {
+  if (!admit(req, HTTP_PATH_METRICS)) return;
+  metrics_state_t *m = (metrics_state_t *)calloc(1, sizeof(metrics_state_t));
+  if (!m) {
+    req->send(503, "text/plain", "out of memory\n");
+    return;
+  }
+  metrics_capture(m);
+  send_stream(req, "text/plain; version=0.0.4; charset=utf-8", metrics_line, m);
+}
+
+/* ─── /api/snapshot ─── */
+static void handle_snapshot(AsyncWebServerRequest *req) {
+  if (!admit(req, HTTP_PATH_SNAPSHOT)) return;
+  LiveSnapshot s;
+  LiveSnapshotGet(&s);
+  SessionStats ses, life;
+  SessionStatsGet(STATS_SESSION, &ses);
+  SessionStatsGet(STATS_LIFETIME, &life);
+  char body[384];
+  snprintf(body, sizeof(body),
+           "{\"seq\":%lu,\"age_ms\":%lu,\"op_s\":%lu,\"v\":%.4f,\"i\":%.4f,\"p\":%.3f,\"wh\":%.3f,\"t\":%.1f,"
+           "\"sensor\":%s,\"rate_hz\":%lu,\"driver\":\"%s\",\"session\":{\"ah_in\":%.4f,\"ah_out\":%.4f,"
+           "\"p_peak\":%.2f},\"life\":{\"ah_in\":%.4f,\"ah_out\":%.4f,\"p_peak\":%.2f}}\n",
+           (unsigned long)s.seq, (unsigned long)(millis() - s.t_ms), (unsigned long)s.op_s, (double)s.voltage_V,
+           (double)s.current_A, (double)s.power_W, s.energy_Wh, (double)s.temperature_C,
+           s.sensor_connected ? "true" : "false", (unsigned long)s.sample_rate_hz, SensorGetDriverName(), ses.ah_in,
+           ses.ah_out, (double)ses.peak_power_W, life.ah_in, life.ah_out, (double)life.peak_power_W);
+  AsyncWebServerResponse *r = req->beginResponse(200, "application/json", body);
+  r->addHeader("Cache-Control", "no-store");
+  req->send(r);
+}
+
+/* ─── /api/history ─── */
+typedef struct {
+  uint32_t         first;
+  uint32_t         end;
+  uint32_t         next;              /* next record to emit */
+  HistoryLogRecord cache[HTTP_HISTORY_CHUNK];
+  uint32_t         cache_first;
+  uint32_t         cache_n;
+  bool             closed;
+} history_state_t;
+
+static size_t history_line(http_cursor_t *c, char *buf, size_t len) {
+  history_state_t *h = (history_state_t *)c->state;
+  if (c->k == 0) {
+    return line_printf(buf, len,
+                       "{\"interval_ms\":%lu,\"first\":%lu,\"count\":%lu,"
+                       "\"fields\":[\"voltage_V\",\"current_A\",\"power_W\",\"energy_Wh\"],\"records\":[\n",
+                       (unsigned long)HistoryLogIntervalMs(), (unsigned long)h->first,
+                       (unsigned long)(h->end - h->first));
+  }
+  if (h->next >= h->end) {
+    if (h->closed) return 0;
+    h->closed = true;
+    return line_printf(buf, len, "]}\n");
+  }
+  if (h->next >= h->cache_first + h->cache_n) {
+    uint32_t n = h->end - h->next;
+    if (n > HTTP_HISTORY_CHUNK) n = HTTP_HISTORY_CHUNK;
+    size_t got = HistoryLogRead(h->next, h->cache, n);  /* the log's own lock; never the UI lock here */
+    h->cache_first = h->next;
+    h->cache_n = got;
+  }
+  const char *sep = h->next + 1 < h->end ? "," : "";
+  if (h->next >= h->cache_first + h->cache_n) {  /* log shrank under us (page recycled): keep the count */
+    h->next++;
+    return line_printf(buf, len, "null%s\n", sep);
+  }
+  const HistoryLogRecord *r = &h->cache[h->next - h->cache_first];
+  h->next++;
+  if (isnan(r->voltage_V)) return line_printf(buf, len, "null%s\n", sep);  /* gap: flush or torn write */
+  return line_printf(buf, len, "[%.4f,%.4f,%.3f,%.3f]%s\n", (double)r->voltage_V, (double)r->current_A,
+                     (double)r->power_W, (double)r->energy_Wh, sep);
+}
+
+static void handle_history(AsyncWebServerRequest *req) {
+  if (!admit(req, HTTP_PATH_HISTORY)) return;
+  if (!HistoryLogIsReady()) {
+    req->send(404, "application/json", "{\"error\":\"no history partition\"}\n");
+    return;
+  }
+  uint32_t want = HTTP_HISTORY_DEFAULT;
+  if (req->hasParam("n")) want = (uint32_t)strtoul(req->getParam("n")->value().c_str(), NULL, 10);
+  uint32_t count = HistoryLogCount();
+  if (want == 0 || want > count) want = count;
+  history_state_t *h = (history_state_t *)calloc(1, sizeof(history_state_t));
+  if (!h) {
+    req->send(503, "text/plain", "out of memory\n");
+    return;
+  }
+  h->first = h->next = h->cache_first = count - want;
+  h->end = count;
+  send_stream(req, "application/json", history_line, h);
+}
+
+/* ─── Dashboard and server ─── */
+static void handle_dashboard(AsyncWebServerRequest *req) {
+  if (!admit(req, HTTP_PATH_DASHBOARD)) return;
+  /* Served straight from flash, no copy */
+  req->send(req->beginResponse(200, "text/html", (const uint8_t *)k_http_dashboard_html,
+                               sizeof(k_http_dashboard_html) - 1));
+}
+
+static void handle_live(AsyncWebServerRequest *req) {
+  if (!admit(req, HTTP_PATH_LIVE)) return;
+  req->send(req->beginResponse(200, "text/html", (const uint8_t *)k_ws_dashboard_html,
+                               sizeof(k_ws_dashboard_html) - 1));
+}
+
+static void handle_not_found(AsyncWebServerRequest *req) {
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.requests[HTTP_PATH_OTHER]++;
+  portEXIT_CRITICAL(&s_stats_mux);
+  req->send(404, "text/plain", "not found\n");
+}
+
+static void on_got_ip(WiFiEvent_t event, WiFiEventInfo_t info) {
+  (void)event;
+  (void)info;
+  if (s_started) return;  /* the listening socket survives reconnects */
+  s_server.begin();
+  s_started = true;
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.running = true;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+void HttpApiInit(void) {
+  s_server.on("/", HTTP_GET, handle_dashboard);
+  s_server.on("/metrics", HTTP_GET, handle_metrics);
+  s_server.on("/api/snapshot", HTTP_GET, handle_snapshot);
+  s_server.on("/api/history", HTTP_GET, handle_history);
+  s_server.on("/live", HTTP_GET, handle_live);
+  WsStreamAttach(&s_server);
+  s_server.onNotFound(handle_not_found);
+  WiFi.onEvent(on_got_ip, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  if (WifiLinkIsUp()) on_got_ip(ARDUINO_EVENT_WIFI_STA_GOT_IP, WiFiEventInfo_t());
+}
+
+void HttpApiGetStats(HttpApiStats *out) {
+  if (!out) return;
+  portENTER_CRITICAL(&s_stats_mux);
+  *out = s_stats;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+void HttpApiGetInfo(char *buf, size_t len) {
+  if (!buf || !len) return;
+  HttpApiStats h;
+  HttpApiGetStats(&h);
+  uint32_t total = 0;
+  for (int p = 0; p < HTTP_PATH_COUNT; p++) total += h.requests[p];
+  if (!WifiLinkIsUp()) {
+    snprintf(buf, len, "waiting for Wi-Fi, %lu requests", (unsigned long)total);
+    return;
+  }
+  snprintf(buf, len, "http://%s/ %lu requests, %lu refused, peak %u active", WiFi.localIP().toString().c_str(),
+           (unsigned long)total, (unsigned long)h.rejected, (unsigned)h.active_peak);
+}
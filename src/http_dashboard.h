@@ -0,0 +1,55 @@
+/**
+ * @file http_dashboard.h
+ * Dashboard page served at / by http_api.cpp, straight from flash. It polls /api/snapshot once a
+ * second and seeds its chart from /api/history; no external scripts or fonts.
+ */
+#ifndef HTTP_DASHBOARD_H
+#define HTTP_DASHBOARD_H
+
+static const char k_http_dashboard_html[] = R"HTML(<!DOCTYPE html>
+<html><head><meta charset="utf-8"><meta name="viewport" content="width=device-width,initial-scale=1">
+<title>CYD shunt</title>
+<style>
+body{margin:0;font:15px system-ui,sans-serif;background:#111;color:#eee}
+header{padding:10px 14px;background:#222;display:flex;justify-content:space-between}
+#tiles{display:grid;grid-template-columns:repeat(auto-fit,minmax(140px,1fr));gap:8px;padding:8px}
+.t{background:#1c1c1c;border-radius:6px;padding:10px}.t b{display:block;font-size:28px}
+.t span{color:#888;font-size:13px}canvas{width:100%;height:240px;display:block}
+#st{color:#888}a{color:#6af}
+</style></head><body>
+<header><span>CYD shunt</span><span id="st">connecting</span></header>
+<div id="tiles">
+<div class="t"><span>Voltage</span><b id="v">-</b></div>
+<div class="t"><span>Current</span><b id="i">-</b></div>
+<div class="t"><span>Power</span><b id="p">-</b></div>
+<div class="t"><span>Energy</span><b id="wh">-</b></div>
+<div class="t"><span>Temperature</span><b id="t">-</b></div>
+<div class="t"><span>Charge in / out (life)</span><b id="ah">-</b></div>
+</div>
+<canvas id="c"></canvas>
+<p style="padding:0 14px"><a href="/live">live stream</a> &middot; <a href="/metrics">/metrics</a> &middot; <a href="/api/snapshot">/api/snapshot</a>
+&middot; <a href="/api/history?n=60">/api/history</a></p>
+<script>
+const N=600,pts=[];const $=id=>document.getElementById(id);
+function fx(x,d,u){return x==null?'-':x.toFixed(d)+' '+u}
+function draw(){const c=$('c'),g=c.getContext('2d'),w=c.width=c.clientWidth,h=c.height=c.clientHeight;
+ g.clearRect(0,0,w,h);if(pts.length<2)return;
+ for(const [k,col] of [[0,'#4c8'],[1,'#fa4']]){let lo=1e9,hi=-1e9;
+  for(const q of pts){if(q){lo=Math.min(lo,q[k]);hi=Math.max(hi,q[k])}}
+  if(hi-lo<1e-3){hi+=0.5;lo-=0.5}g.strokeStyle=col;g.beginPath();let pen=false;
+  pts.forEach((q,n)=>{if(!q){pen=false;return}const x=n*w/(N-1),y=h-4-(q[k]-lo)*(h-8)/(hi-lo);
+   pen?g.lineTo(x,y):g.moveTo(x,y);pen=true});g.stroke();
+  g.fillStyle=col;g.fillText((k?'I ':'V ')+lo.toFixed(2)+' .. '+hi.toFixed(2),6,14+k*14)}}
+function push(q){pts.push(q);if(pts.length>N)pts.shift()}
+async function poll(){try{const s=await (await fetch('/api/snapshot')).json();
+ $('v').textContent=fx(s.v,3,'V');$('i').textContent=fx(s.i,3,'A');$('p').textContent=fx(s.p,2,'W');
+ $('wh').textContent=fx(s.wh,2,'Wh');$('t').textContent=s.t?fx(s.t,1,'°C'):'-';
+ $('ah').textContent=s.life.ah_in.toFixed(2)+' / '+s.life.ah_out.toFixed(2)+' Ah';
+ $('st').textContent=s.sensor?s.driver+', '+s.rate_hz+' Hz':'sensor offline';push([s.v,s.i]);draw()}
+ catch(e){$('st').textContent='offline'}setTimeout(poll,1000)}
+fetch('/api/history?n='+N).then(r=>r.json()).then(h=>{for(const r of h.records)push(r&&[r[0],r[1]]);draw()})
+ .catch(()=>{}).finally(poll);window.onresize=draw;
+</script></body></html>
+)HTML";
+
+#endif /* HTTP_DASHBOARD_H */
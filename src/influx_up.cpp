@@ -0,0 +1,481 @@
+/**
+ * @file influx_up.cpp
+ * InfluxDB uploader (see influx_up.h and docs/INFLUX.md).
+ */
+#include "influx_up.h"
+#include "influx_line.h"
+#include "influx_spool.h"
+#include "influx_forward.h"
+#include "live_snapshot.h"
+#include "sd_log.h"
+#include "sensor.h"
+#include "spi_bus.h"
+#include "wifi_link.h"
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define INFLUX_NVS_NAMESPACE "cyd_influx"
+#define INFLUX_NVS_KEY_ON    "on"
+#define INFLUX_NVS_KEY_URL   "url"
+#define INFLUX_NVS_KEY_TOKEN "token"
+#define INFLUX_NVS_KEY_TAGS  "tags"
+#define INFLUX_NVS_KEY_EVERY "every"
+#define INFLUX_NVS_KEY_DRAIN "drain"
+
+#define INFLUX_TICK_MS        100          /* task wake-up: sampling, sealing and drain checks */
+#define INFLUX_SPOOL_DIR      "/sd/influx"
+#define INFLUX_CLOCK_VALID_S  1704067200   /* 2024-01-01: anything earlier is the unset clock */
+#define INFLUX_PROBE_MS       30000        /* clock from the server's Date header, while NTP has not answered */
+#define INFLUX_RATE_WINDOW_MS 10000
+
+static_assert(INFLUX_BATCH_BYTES >= INFLUX_LINE_MAX, "a batch must hold one point");
+static_assert(INFLUX_PENDING_POINTS <= 0xFFFF, "pending counter is 16-bit");
+
+/* Sample waiting for the clock; stamped from millis() once the Unix time is known */
+typedef struct {
+  uint32_t t_ms;
+  float    v;
+  float    i;
+  float    p;
+  double   wh;
+  float    soc;
+  float    temp_C;
+} influx_sample_t;
+
+/* Settings: written by the InfluxUpSet*() calls (console), read by the task */
+static portMUX_TYPE  s_cfg_mux = portMUX_INITIALIZER_UNLOCKED;
+static char          s_url[144] = "";
+static char          s_token[100] = "";
+static char          s_tags[48] = "";
+static uint32_t      s_interval_ms = INFLUX_SAMPLE_MS;
+static uint32_t      s_drain_Bps = INFLUX_DRAIN_BPS;
+static volatile bool s_enabled = false;
+static volatile bool s_reconfig = true;
+
+static InfluxUpStats s_stats;
+static portMUX_TYPE  s_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* Task state */
+static WiFiClient       s_net;
+static HTTPClient       s_http;
+static char             s_url_task[sizeof(s_url) + 16];  /* with precision=ms */
+static char             s_ping_url[sizeof(s_url)];
+static char             s_auth[sizeof(s_token) + 8];
+static char             s_series[INFLUX_SERIES_MAX];
+static InfluxSpool      s_spool;
+static InfluxForward    s_fwd;
+static char            *s_live = NULL;                   /* buffers are allocated on first enable */
+static char            *s_scratch = NULL;
+static influx_sample_t *s_pending = NULL;
+static uint16_t         s_p_head = 0;
+static uint16_t         s_p_count = 0;
+static uint32_t         s_p_dropped = 0;
+
+/* ─── Clock ─── */
+static bool clock_valid(void) {
+  return time(NULL) >= INFLUX_CLOCK_VALID_S;
+}
+
+static int64_t clock_unix_ms(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/* Second resolution, and only until NTP answers (it then takes over) */
+static void clock_from_date(void) {
+  if (clock_valid()) return;
+  int64_t unix_s;
+  if (!InfluxParseHttpDate(s_http.header("Date").c_str(), &unix_s) || unix_s < INFLUX_CLOCK_VALID_S) return;
+  struct timeval tv = {(time_t)unix_s, 0};
+  settimeofday(&tv, NULL);
+  Serial.printf("Influx: clock set from the server's Date header\n");
+}
+
+static uint32_t clock_ms(void) {
+  return millis();
+}
+
+/* ─── HTTP ─── */
+static bool http_begin(const char *url) {
+  static const char *k_headers[] = {"Date"};
+  if (!s_http.begin(s_net, url)) return false;
+  s_http.setReuse(true);
+  s_http.setConnectTimeout(INFLUX_HTTP_TIMEOUT_MS);
+  s_http.setTimeout(INFLUX_HTTP_TIMEOUT_MS);
+  s_http.collectHeaders(k_headers, 1);
+  return true;
+}
+
+/* InfluxPostFn: HTTP status, or HTTPClient's negative error code when no answer arrived */
+static int http_post(void *ctx, const char *body, size_t len) {
+  (void)ctx;
+  if (!http_begin(s_url_task)) return HTTPC_ERROR_CONNECTION_REFUSED;
+  s_http.addHeader("Content-Type", "text/plain; charset=utf-8");
+  if (s_auth[0]) s_http.addHeader("Authorization", s_auth);
+  int code = s_http.POST((uint8_t *)body, len);
+  if (code > 0) clock_from_date();
+  s_http.end();
+  return code;
+}
+
+/* GET /ping on the same server, only to read its Date header */
+static void clock_probe(void) {
+  if (!s_ping_url[0] || !http_begin(s_ping_url)) return;
+  if (s_http.GET() > 0) clock_from_date();
+  s_http.end();
+}
+
+/* ─── Spool on the card (shares the SPI bus with touch) ─── */
+static bool spool_lock(void) {
+  return SpiBusAcquire(SPI_BUS_SD, 2000);
+}
+
+static void spool_unlock(void) {
+  SpiBusRelease();
+}
+
+static bool buffers_init(void) {
+  if (s_live) return true;
+  s_live = (char *)malloc(INFLUX_BATCH_BYTES);
+  s_scratch = (char *)malloc(INFLUX_BATCH_BYTES);
+  s_pending = (influx_sample_t *)malloc(sizeof(influx_sample_t) * INFLUX_PENDING_POINTS);
+  bool card = SdLogIsReady() && InfluxSpoolInitDir(&s_spool, INFLUX_SPOOL_DIR,
+                                                   (uint64_t)INFLUX_SPOOL_MAX_MB * 1024 * 1024,
+                                                   INFLUX_SPOOL_FILE_BYTES, spool_lock, spool_unlock);
+  uint8_t *ram = card ? NULL : (uint8_t *)malloc(INFLUX_RAM_SPOOL_BYTES);
+  if (!s_live || !s_scratch || !s_pending || (!card && !ram)) {
+    free(s_live);
+    free(s_scratch);
+    free(s_pending);
+    free(ram);
+    s_live = s_scratch = NULL;
+    s_pending = NULL;
+    Serial.println("Influx: out of memory");
+    return false;
+  }
+  if (!card) InfluxSpoolInitRam(&s_spool, ram, INFLUX_RAM_SPOOL_BYTES);
+  InfluxForwardConfig cfg = {INFLUX_BATCH_POINTS, INFLUX_BATCH_MS, s_drain_Bps, INFLUX_BACKOFF_MIN_MS,
+                             INFLUX_BACKOFF_MAX_MS, INFLUX_RATE_WINDOW_MS};
+  InfluxForwardInit(&s_fwd, &cfg, &s_spool, s_live, INFLUX_BATCH_BYTES, s_scratch, INFLUX_BATCH_BYTES, http_post,
+                    NULL, clock_ms);
+  if (card && s_spool.batches)
+    Serial.printf("Influx: %lu batches (%lu points) spooled on the card\n", (unsigned long)s_spool.batches,
+                  (unsigned long)s_spool.points);
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.spool_on_card = card;
+  portEXIT_CRITICAL(&s_stats_mux);
+  return true;
+}
+
+/* Copy the settings for the task: URL with precision, /ping URL, auth header, series key */
+static void apply_config(void) {
+  char url[sizeof(s_url)], token[sizeof(s_token)], tags[sizeof(s_tags)];
+  portENTER_CRITICAL(&s_cfg_mux);
+  memcpy(url, s_url, sizeof(url));
+  memcpy(token, s_token, sizeof(token));
+  memcpy(tags, s_tags, sizeof(tags));
+  s_fwd.cfg.drain_Bps = s_drain_Bps;
+  portEXIT_CRITICAL(&s_cfg_mux);
+
+  s_url_task[0] = s_ping_url[0] = '\0';
+  if (url[0]) {
+    snprintf(s_url_task, sizeof(s_url_task), "%s%s", url,
+             strstr(url, "precision=") ? "" : (strchr(url, '?') ? "&precision=ms" : "?precision=ms"));
+    const char *path = strchr(url + 7, '/');  /* after "http://" */
+    int host_len = path ? (int)(path - url) : (int)strlen(url);
+    snprintf(s_ping_url, sizeof(s_ping_url), "%.*s/ping", host_len, url);
+  }
+  if (token[0]) snprintf(s_auth, sizeof(s_auth), "Token %s", token);
+  else s_auth[0] = '\0';
+  InfluxSeries(s_series, sizeof(s_series), INFLUX_MEASUREMENT, WifiLinkDeviceId(), tags);
+}
+
+/* ─── Samples ─── */
+static void emit(const influx_sample_t *smp, uint32_t now) {
+  InfluxPoint pt;
+  pt.t_ms = clock_unix_ms() - (int64_t)(now - smp->t_ms);
+  pt.v = smp->v;
+  pt.i = smp->i;
+  pt.p = smp->p;
+  pt.wh = smp->wh;
+  pt.soc = smp->soc;
+  pt.temp_C = smp->temp_C;
+  char line[INFLUX_LINE_MAX];
+  size_t n = InfluxFormatPoint(line, sizeof(line), s_series, &pt);
+  if (n) InfluxForwardAdd(&s_fwd, line, n);
+}
+
+static void take_sample(uint32_t now) {
+  LiveSnapshot ls;
+  LiveSnapshotGet(&ls);
+  SensorWindow w;
+  bool have_window = SensorReadWindow(SENSOR_CONSUMER_INFLUX, &w);  /* mean over the whole period */
+  if (!ls.seq || !ls.sensor_connected) return;
+  influx_sample_t smp;
+  smp.t_ms = now;
+  smp.v = have_window ? w.voltage.mean : ls.voltage_V;
+  smp.i = have_window ? w.current.mean : ls.current_A;
+  smp.p = have_window ? w.power.mean : ls.power_W;
+  smp.wh = ls.energy_Wh;
+  smp.soc = ls.soc_percent;
+  smp.temp_C = ls.temperature_C;
+
+  if (clock_valid() && !s_p_count) {
+    emit(&smp, now);
+    return;
+  }
+  /* No Unix time yet: hold the sample, the oldest goes when the queue is full */
+  s_pending[(s_p_head + s_p_count) % INFLUX_PENDING_POINTS] = smp;
+  if (s_p_count == INFLUX_PENDING_POINTS) {
+    s_p_head = (uint16_t)((s_p_head + 1) % INFLUX_PENDING_POINTS);
+    s_p_dropped++;
+  } else {
+    s_p_count++;
+  }
+}
+
+static void flush_pending(uint32_t now) {
+  while (s_p_count) {
+    emit(&s_pending[s_p_head], now);
+    s_p_head = (uint16_t)((s_p_head + 1) % INFLUX_PENDING_POINTS);
+    s_p_count--;
+  }
+}
+
+static void publish_stats(void) {
+  const InfluxForwardStats *f = &s_fwd.stats;
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.clock_set = clock_valid();
+  s_stats.posts = f->posts;
+  s_stats.post_failures = f->post_failures;
+  s_stats.batches_rejected = f->batches_rejected;
+  s_stats.status_last = f->status_last;
+  s_stats.post_ms_last = f->post_ms_last;
+  s_stats.post_ms_max = f->post_ms_max;
+  s_stats.backoff_ms = f->backoff_ms;
+  s_stats.points_live = f->points_live;
+  s_stats.points_drained = f->points_drained;
+  s_stats.points_spooled = f->points_spooled;
+  s_stats.points_dropped = f->points_dropped + s_p_dropped;
+  s_stats.points_pending = s_p_count;
+  s_stats.spool_batches = s_spool.batches;
+  s_stats.spool_points = s_spool.points;
+  s_stats.spool_bytes = (uint32_t)s_spool.bytes;
+  s_stats.spool_evicted = s_spool.dropped_points;
+  s_stats.spool_errors = s_spool.errors;
+  s_stats.drain_Bps = f->drain_Bps;
+  s_stats.drain_pps = f->drain_pps;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+static void influx_task(void *arg) {
+  (void)arg;
+  uint32_t next_sample = millis();
+  uint32_t next_probe = 0;
+  bool ntp_started = false;
+  bool was_enabled = false;
+
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(INFLUX_TICK_MS));
+    uint32_t now = millis();
+
+    if (!s_enabled || !buffers_init()) {
+      was_enabled = false;
+      next_sample = now;
+      continue;
+    }
+    if (!was_enabled) {
+      SensorWindow w;
+      SensorReadWindow(SENSOR_CONSUMER_INFLUX, &w);  /* the first point covers one period, not the time off */
+      was_enabled = true;
+      next_sample = now + s_interval_ms;
+    }
+    if (s_reconfig) {
+      s_reconfig = false;
+      apply_config();
+    }
+
+    bool link = WifiLinkIsUp();
+    if (link && !ntp_started) {
+      configTime(0, 0, INFLUX_NTP_SERVER);
+      ntp_started = true;
+    }
+    if (link && s_url_task[0] && !clock_valid() && (int32_t)(now - next_probe) >= 0) {
+      next_probe = now + INFLUX_PROBE_MS;
+      clock_probe();
+    }
+
+    /* Sampling continues offline: the spool carries the gap until the server is back */
+    if ((int32_t)(now - next_sample) >= 0) {
+      uint32_t interval = s_interval_ms;
+      next_sample += interval;
+      if ((int32_t)(now - next_sample) > (int32_t)interval) next_sample = now + interval;  /* stalled */
+      take_sample(now);
+    }
+    if (s_p_count && clock_valid()) flush_pending(millis());
+
+    InfluxForwardPoll(&s_fwd, link && s_url_task[0]);
+    publish_stats();
+  }
+}
+
+/* ─── Public API ─── */
+void InfluxUpInit(void) {
+  Preferences prefs;
+  if (prefs.begin(INFLUX_NVS_NAMESPACE, true)) {
+    s_enabled = prefs.getBool(INFLUX_NVS_KEY_ON, false);
+    prefs.getString(INFLUX_NVS_KEY_URL, s_url, sizeof(s_url));
+    prefs.getString(INFLUX_NVS_KEY_TOKEN, s_token, sizeof(s_token));
+    prefs.getString(INFLUX_NVS_KEY_TAGS, s_tags, sizeof(s_tags));
+    s_interval_ms = prefs.getULong(INFLUX_NVS_KEY_EVERY, INFLUX_SAMPLE_MS);
+    s_drain_Bps = prefs.getULong(INFLUX_NVS_KEY_DRAIN, INFLUX_DRAIN_BPS);
+    prefs.end();
+  }
+  if (!InfluxTagsValid(s_tags)) s_tags[0] = '\0';
+  if (s_interval_ms < 1000 || s_interval_ms > 3600000) s_interval_ms = INFLUX_SAMPLE_MS;
+  if (s_drain_Bps < 512 || s_drain_Bps > 262144) s_drain_Bps = INFLUX_DRAIN_BPS;
+  s_stats.enabled = s_enabled;
+  s_stats.interval_s = s_interval_ms / 1000;
+  s_stats.drain_budget_Bps = s_drain_Bps;
+  /* Lowest priority on core 1: a stalled POST or card write waits behind sampling and logging */
+  xTaskCreatePinnedToCore(influx_task, "influx", 6144, NULL, 1, NULL, 1);
+}
+
+bool InfluxUpSetUrl(const char *url) {
+  if (!url) url = "";
+  if ((url[0] && strncmp(url, "http://", 7) != 0) || strlen(url) >= sizeof(s_url)) return false;
+  const char *prec = strstr(url, "precision=");
+  if (prec && strncmp(prec + 10, "ms", 2) != 0) return false;  /* timestamps are in ms */
+  portENTER_CRITICAL(&s_cfg_mux);
+  snprintf(s_url, sizeof(s_url), "%s", url);
+  portEXIT_CRITICAL(&s_cfg_mux);
+  Preferences prefs;
+  if (prefs.begin(INFLUX_NVS_NAMESPACE, false)) {
+    prefs.putString(INFLUX_NVS_KEY_URL, url);
+    prefs.end();
+  }
+  s_reconfig = true;
+  return true;
+}
+
+void InfluxUpSetToken(const char *token) {
+  portENTER_CRITICAL(&s_cfg_mux);
+  snprintf(s_token, sizeof(s_token), "%s", token ? token : "");
+  portEXIT_CRITICAL(&s_cfg_mux);
+  Preferences prefs;
+  if (prefs.begin(INFLUX_NVS_NAMESPACE, false)) {
+    prefs.putString(INFLUX_NVS_KEY_TOKEN, token ? token : "");
+    prefs.end();
+  }
+  s_reconfig = true;
+}
+
+bool InfluxUpSetTags(const char *tags) {
+  if (!tags) tags = "";
+  if (!InfluxTagsValid(tags) || strlen(tags) >= sizeof(s_tags)) return false;
+  portENTER_CRITICAL(&s_cfg_mux);
+  snprintf(s_tags, sizeof(s_tags), "%s", tags);
+  portEXIT_CRITICAL(&s_cfg_mux);
+  Preferences prefs;
+  if (prefs.begin(INFLUX_NVS_NAMESPACE, false)) {
+    prefs.putString(INFLUX_NVS_KEY_TAGS, tags);
+    prefs.end();
+  }
+  s_reconfig = true;
+  return true;
+}
+
+bool InfluxUpSetInterval(uint32_t seconds) {
+  if (seconds < 1 || seconds > 3600) return false;
+  s_interval_ms = seconds * 1000;
+  Preferences prefs;
+  if (prefs.begin(INFLUX_NVS_NAMESPACE, false)) {
+    prefs.putULong(INFLUX_NVS_KEY_EVERY, s_interval_ms);
+    prefs.end();
+  }
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.interval_s = seconds;
+  portEXIT_CRITICAL(&s_stats_mux);
+  return true;
+}
+
+bool InfluxUpSetDrainRate(uint32_t bytes_per_s) {
+  if (bytes_per_s < 512 || bytes_per_s > 262144) return false;
+  portENTER_CRITICAL(&s_cfg_mux);
+  s_drain_Bps = bytes_per_s;
+  portEXIT_CRITICAL(&s_cfg_mux);
+  Preferences prefs;
+  if (prefs.begin(INFLUX_NVS_NAMESPACE, false)) {
+    prefs.putULong(INFLUX_NVS_KEY_DRAIN, bytes_per_s);
+    prefs.end();
+  }
+  s_reconfig = true;
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.drain_budget_Bps = bytes_per_s;
+  portEXIT_CRITICAL(&s_stats_mux);
+  return true;
+}
+
+void InfluxUpSetEnabled(bool on) {
+  Preferences prefs;
+  if (prefs.begin(INFLUX_NVS_NAMESPACE, false)) {
+    prefs.putBool(INFLUX_NVS_KEY_ON, on);
+    prefs.end();
+  }
+  s_enabled = on;
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.enabled = on;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+void InfluxUpGetStats(InfluxUpStats *out) {
+  if (!out) return;
+  portENTER_CRITICAL(&s_stats_mux);
+  *out = s_stats;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+void InfluxUpGetInfo(char *buf, size_t len) {
+  if (!buf || !len) return;
+  InfluxUpStats st;
+  InfluxUpGetStats(&st);
+  char host[48] = "";
+  portENTER_CRITICAL(&s_cfg_mux);
+  if (s_url[0]) {
+    const char *h = s_url + 7;
+    size_t n = strcspn(h, "/?");
+    snprintf(host, sizeof(host), "%.*s", (int)n, h);
+  }
+  portEXIT_CRITICAL(&s_cfg_mux);
+  char spool[40];
+  snprintf(spool, sizeof(spool), "spool %lu batches %s", (unsigned long)st.spool_batches,
+           st.spool_on_card ? "on SD" : "in RAM");
+  if (!st.enabled) {
+    snprintf(buf, len, "off");
+  } else if (!host[0]) {
+    snprintf(buf, len, "no URL set");
+  } else if (!WifiLinkIsUp()) {
+    snprintf(buf, len, "waiting for Wi-Fi, %s", spool);
+  } else if (!st.clock_set) {
+    snprintf(buf, len, "%s waiting for the clock, %u pending", host, (unsigned)st.points_pending);
+  } else if (st.backoff_ms) {
+    snprintf(buf, len, "%s retry in %lus (%d), %s", host, (unsigned long)(st.backoff_ms / 1000), st.status_last,
+             spool);
+  } else if (st.spool_batches) {
+    snprintf(buf, len, "%s catching up at %lu B/s, %s", host, (unsigned long)st.drain_Bps, spool);
+  } else {
+    snprintf(buf, len, "%s ok, %s", host, spool);
+  }
+}
@@ -0,0 +1,25 @@
+/**
+ * @file live_snapshot.cpp
+ * Latest readings for the network interfaces (see live_snapshot.h).
+ */
+#include "live_snapshot.h"
+#include <freertos/FreeRTOS.h>
+#include <string.h>
+
+static LiveSnapshot s_snap;
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void LiveSnapshotPublish(const LiveSnapshot *s) {
+  portENTER_CRITICAL(&s_mux);
+  uint32_t seq = s_snap.seq + 1;
+  s_snap = *s;
+  s_snap.seq = seq ? seq : 1;
+  portEXIT_CRITICAL(&s_mux);
+}
+
+void LiveSnapshotGet(LiveSnapshot *out) {
+  if (!out) return;
+  portENTER_CRITICAL(&s_mux);
+  *out = s_snap;
+  portEXIT_CRITICAL(&s_mux);
+}
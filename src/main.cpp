@@ -23,18 +23,31 @@
 #include "sensor.h"
 #include "telemetry_victron.h"
 #include "touch.h"
+#include "backlight.h"
+#include "history_log.h"
+#include "session_stats.h"
+#include "sd_log.h"
+#include "usb_stream.h"
+#include "console.h"
+#include "wifi_link.h"
+#include "mqtt_pub.h"
+#include "live_snapshot.h"
+#include "http_api.h"
+#include "ble_telemetry.h"
+#include "modbus_slave.h"
+#include "influx_up.h"
+#include "spi_bus.h"
 #include "ui_lvgl.h"
+#include "ui_perf.h"
 
-// Touch Screen pins (CYD uses non-default SPI pins)
-#define XPT2046_IRQ 36
-#define XPT2046_MOSI 32
-#define XPT2046_MISO 39
-#define XPT2046_CLK 25
-#define XPT2046_CS 33
+// Touch Screen pins (CYD uses non-default SPI pins; see touch.h)
+#define XPT2046_IRQ TOUCH_IRQ_PIN
+#define XPT2046_MOSI TOUCH_MOSI_PIN
+#define XPT2046_MISO TOUCH_MISO_PIN
+#define XPT2046_CLK TOUCH_SCLK_PIN
+#define XPT2046_CS TOUCH_CS_PIN
 
-// I2C pins for INA228 (CN1 connector)
-#define I2C_SDA 22
-#define I2C_SCL 27
+// I2C pins for INA228: I2C_SDA / I2C_SCL in sensor.h (CN1 connector)
 #define INA228_ADDRESS 0x40  // Default address, adjust if A0/A1 pins are configured
 
 // Default shunt specifications (50A/75mV) - can be overridden by calibration
@@ -45,12 +58,8 @@
 float maxCurrent = DEFAULT_MAX_CURRENT;
 float shuntResistance = DEFAULT_SHUNT_RESISTANCE;
 
-// Display dimensions
-#define DISPLAY_WIDTH 320
-#define DISPLAY_HEIGHT 240
-
-// Touch calibration (layout matches TouchCalibration_t in touch.h)
-TouchCalibration_t touchCal = {0, 0, 0, 0, false};
+// Touch calibration (affine, see TouchCalibration_t in touch.h); fitted by the LVGL calibration screen
+TouchCalibration_t touchCal = {0, 0, 0, 0, 0, 0, false};
 
 // NVS namespace for touch calibration
 #define NVS_NAMESPACE "cyd_shunt"
@@ -59,6 +68,7 @@ TouchCalibration_t touchCal = {0, 0, 0, 0, false};
 #define NVS_KEY_XMAX "xmax"
 #define NVS_KEY_YMIN "ymin"
 #define NVS_KEY_YMAX "ymax"
+#define NVS_KEY_TOUCH_AFFINE "touch_aff"  // 6 floats a..f; the min/max keys above are the pre-affine format
 
 // NVS keys for shunt calibration
 #define NVS_KEY_SHUNT_CALIBRATED "shunt_cal"
@@ -72,28 +82,32 @@ Preferences preferences;
 
 // Create SPI instance for touch screen (uses VSPI)
 SPIClass mySpi = SPIClass(VSPI);
-XPT2046_Touchscreen ts(XPT2046_CS, XPT2046_IRQ);
+XPT2046_Touchscreen ts(XPT2046_CS);  // no IRQ pin: touch.cpp owns PENIRQ (XPT2046_IRQ)
 
 // Create TFT display instance
 TFT_eSPI tft = TFT_eSPI();
 
-// Update interval for Victron telemetry (main loop); display uses LVGL timer (200 ms).
+// Update interval for Victron telemetry (main loop); display uses LVGL timer (200 ms) in the LVGL task.
 const unsigned long UPDATE_INTERVAL_MS = 500;
 
+// Telemetry latency report period (ms); 0 disables. Latency = how late a poll started plus how long it took.
+#ifndef TELEMETRY_LATENCY_REPORT_MS
+#define TELEMETRY_LATENCY_REPORT_MS 60000
+#endif
+
 // Forward declarations (used by LVGL or setup)
 void resetEnergyAccumulation();
 void cycleAveraging();
 String getAveragingString();
 bool loadTouchCalibration();
-void saveTouchCalibration();
-void performTouchCalibration();
-TS_Point calibrateTouchPoint(TS_Point raw);
+void saveTouchCalibration(const TouchCalibration_t *cal);
 bool loadShuntCalibration();
 void saveShuntCalibration();
 float getDefaultMaxCurrent();
 float getDefaultShuntResistance();
 bool get_vedirect_enabled(void);
 void set_vedirect_enabled(bool on);
+void trackTelemetryLatency(uint32_t latencyUs);
 
 void setup() {
   Serial.begin(115200);
@@ -106,27 +120,30 @@ void setup() {
   tft.init();
   tft.setRotation(1); // Landscape orientation
   tft.fillScreen(TFT_BLACK);
+  BacklightInit();     // PWM on TFT_BL so the idle manager can dim/blank
   
   // Initialize touch screen SPI and library
   Serial.println("Initializing touch screen...");
   mySpi.begin(XPT2046_CLK, XPT2046_MISO, XPT2046_MOSI, XPT2046_CS);
   ts.begin(mySpi);
   ts.setRotation(1); // Landscape orientation
-  TouchInit(&ts);
+  TouchInit(&ts, &mySpi);
+  // VSPI is shared with the microSD slot on other pins (sd_log.cpp); touch holds it by default
+  SpiBusSetPins(SPI_BUS_TOUCH, XPT2046_CLK, XPT2046_MISO, XPT2046_MOSI);
+  SpiBusInit(&mySpi, SPI_BUS_TOUCH);
 
   // Initialize NVS
   Serial.println("Initializing NVS...");
   preferences.begin(NVS_NAMESPACE, false);
   
-  // Load touch calibration or perform calibration if not found
+  // Load touch calibration; without one the UI opens the calibration screen first
   Serial.println("Loading touch calibration...");
   if (!loadTouchCalibration()) {
-    Serial.println("No calibration found. Starting calibration...");
-    performTouchCalibration();
+    Serial.println("No calibration found. The UI will start touch calibration.");
   } else {
     Serial.println("Touch calibration loaded successfully!");
-    Serial.print("X: "); Serial.print(touchCal.xMin); Serial.print(" - "); Serial.println(touchCal.xMax);
-    Serial.print("Y: "); Serial.print(touchCal.yMin); Serial.print(" - "); Serial.println(touchCal.yMax);
+    Serial.printf("X = %.4f*rx %+.4f*ry %+.1f\n", (double)touchCal.a, (double)touchCal.b, (double)touchCal.c);
+    Serial.printf("Y = %.4f*rx %+.4f*ry %+.1f\n", (double)touchCal.d, (double)touchCal.e, (double)touchCal.f);
   }
   TouchSetCalibration(&touchCal);
   
@@ -143,6 +160,9 @@ void setup() {
   }
   
   // Initialize I2C
+  // Session/lifetime statistics (lifetime scope persisted in NVS); the sampler feeds them from its first sample
+  SessionStatsInit();
+
   Serial.println("Initializing I2C...");
   Wire.begin(I2C_SDA, I2C_SCL);
   delay(100);
@@ -160,9 +180,26 @@ void setup() {
       Serial.print(result);
       Serial.println("). Using defaults.");
     }
+    SensorSamplerStart();
   }
   Serial.println("Setup complete!");
 
+  // Mount the persistent history log ("history" partition in partitions.csv)
+  Serial.println("Mounting history log...");
+  if (HistoryLogInit(UI_SAMPLE_PERIOD_MS)) {
+    char info[40];
+    HistoryLogGetInfo(info, sizeof(info));
+    Serial.print("History log: "); Serial.println(info);
+  } else {
+    Serial.println("No history partition - history is RAM only.");
+  }
+
+  // microSD logger: every sample from the sensor sampler, rotating files under /log
+  Serial.println("Mounting microSD...");
+  if (!SdLogInit(&mySpi)) {
+    Serial.println("No microSD card - sample logging off.");
+  }
+
   // Initialize Victron VE.Direct: load enable flag from NVS, then start UART if enabled
   {
     bool vedirectOn = preferences.getBool(NVS_KEY_VEDIRECT_ENABLED, true);
@@ -171,31 +208,102 @@ void setup() {
   }
 
   ui_lvgl_init();
+  ConsoleInit();
+
+  // Network: Wi-Fi station, MQTT publisher and HTTP API (idle until Wi-Fi is configured from the console)
+  WifiLinkInit();
+  MqttPubInit();
+  HttpApiInit();
+  // BLE GATT telemetry (stack only comes up when switched on)
+  BleTelemetryInit();
+  // Modbus RTU/TCP slave (off until switched on from the console)
+  ModbusSlaveInit();
+  // InfluxDB uploader with store-and-forward (off until switched on from the console)
+  InfluxUpInit();
 }
 
 void loop() {
-  ui_lvgl_poll();
+  ui_lvgl_poll();  // no-op when LVGL runs in its own task
+
+  // Serial command console (console.h): never blocks, output is queued
+  ConsolePoll();
 
   // Victron VE.Direct: feed latest readings (Victron TEXT mode expects ~1 Hz; we poll at 500 ms, module paces at 1 s)
   static unsigned long lastTelemetryPoll = 0;
   unsigned long now = millis();
   if (now - lastTelemetryPoll >= UPDATE_INTERVAL_MS) {
+    uint32_t startUs = micros();
     TelemetryState t;
-    t.voltage_V        = SensorGetBusVoltage();
-    t.current_A        = SensorGetCurrent();
-    t.power_W          = SensorGetPower();
+    SensorWindow w;
+    if (SensorReadWindow(SENSOR_CONSUMER_TELEMETRY, &w)) {  // averages since the previous report
+      t.voltage_V = w.voltage.mean;
+      t.current_A = w.current.mean;
+      t.power_W   = w.power.mean;
+    } else {
+      t.voltage_V = SensorGetBusVoltage();
+      t.current_A = SensorGetCurrent();
+      t.power_W   = SensorGetPower();
+    }
     t.energy_Wh        = SensorGetWattHour();
     t.temperature_C    = SensorGetTemperature();
     t.sensor_connected = SensorIsConnected();
+    SessionStats life;
+    SessionStatsGet(STATS_LIFETIME, &life);
+    if (life.voltage.n) {
+      t.min_voltage_V = life.voltage.min;
+      t.max_voltage_V = life.voltage.max;
+    }
+    t.total_Ah_charged    = life.ah_in;
+    t.total_Ah_discharged = life.ah_out;
+    SessionStatsPoll();  // lifetime NVS save when due, off the sampler task
     TelemetryVictronUpdate(t);
+
+    // Same readings for the HTTP API (live_snapshot.h): handlers never touch I2C
+    LiveSnapshot snap;
+    snap.t_ms             = now;
+    snap.op_s             = SessionStatsNow();
+    snap.voltage_V        = t.voltage_V;
+    snap.current_A        = t.current_A;
+    snap.power_W          = t.power_W;
+    snap.energy_Wh        = t.energy_Wh;
+    snap.temperature_C    = t.temperature_C;
+    snap.soc_percent      = t.soc_percent;
+    snap.sensor_connected = t.sensor_connected;
+    snap.sample_rate_hz   = SensorSampleRate();
+    LiveSnapshotPublish(&snap);
+    if (lastTelemetryPoll != 0)
+      trackTelemetryLatency((now - lastTelemetryPoll - UPDATE_INTERVAL_MS) * 1000UL + (micros() - startUs));
     lastTelemetryPoll = now;
   }
 
   delay(5);
 }
 
+// Worst-case telemetry latency per report window (sensor reads wait on the I2C lock while the LVGL
+// task samples; open heavy screens such as the History popup to measure under load).
+void trackTelemetryLatency(uint32_t latencyUs) {
+#if TELEMETRY_LATENCY_REPORT_MS > 0
+  static uint32_t worstUs = 0;
+  static uint32_t sumUs = 0;
+  static uint32_t polls = 0;
+  static unsigned long windowStart = 0;
+  if (latencyUs > worstUs) worstUs = latencyUs;
+  sumUs += latencyUs;
+  polls++;
+  if (millis() - windowStart >= TELEMETRY_LATENCY_REPORT_MS) {
+    Serial.printf("Telemetry latency: worst %lu us, mean %lu us over %lu polls\n",
+                  (unsigned long)worstUs, (unsigned long)(sumUs / polls), (unsigned long)polls);
+    worstUs = sumUs = polls = 0;
+    windowStart = millis();
+  }
+#else
+  (void)latencyUs;
+#endif
+}
+
 void resetEnergyAccumulation() {
   Serial.println("Resetting energy and charge accumulation...");
+  HistoryLogFlush();  // last records with the old energy count go to flash as they are
   SensorResetEnergy();
 }
 
@@ -222,158 +330,36 @@ bool loadTouchCalibration() {
   if (!preferences.getBool(NVS_KEY_CALIBRATED, false)) {
     return false;
   }
-  
-  // Load calibration values
-  touchCal.xMin = preferences.getInt(NVS_KEY_XMIN, 0);
-  touchCal.xMax = preferences.getInt(NVS_KEY_XMAX, 0);
-  touchCal.yMin = preferences.getInt(NVS_KEY_YMIN, 0);
-  touchCal.yMax = preferences.getInt(NVS_KEY_YMAX, 0);
-  
-  // Validate calibration values
-  if (touchCal.xMin >= touchCal.xMax || touchCal.yMin >= touchCal.yMax) {
+
+  float coeff[6];
+  if (preferences.getBytesLength(NVS_KEY_TOUCH_AFFINE) == sizeof(coeff) &&
+      preferences.getBytes(NVS_KEY_TOUCH_AFFINE, coeff, sizeof(coeff)) == sizeof(coeff)) {
+    touchCal.a = coeff[0]; touchCal.b = coeff[1]; touchCal.c = coeff[2];
+    touchCal.d = coeff[3]; touchCal.e = coeff[4]; touchCal.f = coeff[5];
+    touchCal.isValid = true;
+    return true;
+  }
+
+  // Older firmware stored a min/max box: convert it to the equivalent transform
+  TouchCalibrationFromBox(preferences.getInt(NVS_KEY_XMIN, 0), preferences.getInt(NVS_KEY_XMAX, 0),
+                          preferences.getInt(NVS_KEY_YMIN, 0), preferences.getInt(NVS_KEY_YMAX, 0), &touchCal);
+  if (!touchCal.isValid) {
     Serial.println("Invalid calibration data!");
     return false;
   }
-  
-  touchCal.isValid = true;
+  Serial.println("Touch calibration: converted legacy min/max box");
   return true;
 }
 
-void saveTouchCalibration() {
+void saveTouchCalibration(const TouchCalibration_t *cal) {
+  if (!cal || !cal->isValid) return;
+  touchCal = *cal;
+  float coeff[6] = {cal->a, cal->b, cal->c, cal->d, cal->e, cal->f};
+  preferences.putBytes(NVS_KEY_TOUCH_AFFINE, coeff, sizeof(coeff));
   preferences.putBool(NVS_KEY_CALIBRATED, true);
-  preferences.putInt(NVS_KEY_XMIN, touchCal.xMin);
-  preferences.putInt(NVS_KEY_XMAX, touchCal.xMax);
-  preferences.putInt(NVS_KEY_YMIN, touchCal.yMin);
-  preferences.putInt(NVS_KEY_YMAX, touchCal.yMax);
   Serial.println("Touch calibration saved to NVS");
 }
 
-void performTouchCalibration() {
-  tft.fillScreen(TFT_BLACK);
-  tft.setTextColor(TFT_WHITE, TFT_BLACK);
-  tft.setTextDatum(MC_DATUM);
-  
-  // Calibration points (corners of the display)
-  struct CalPoint {
-    int16_t x, y;
-    const char* label;
-  };
-  
-  CalPoint calPoints[] = {
-    {20, 20, "Top-Left"},
-    {DISPLAY_WIDTH - 20, 20, "Top-Right"},
-    {DISPLAY_WIDTH - 20, DISPLAY_HEIGHT - 20, "Bottom-Right"},
-    {20, DISPLAY_HEIGHT - 20, "Bottom-Left"}
-  };
-  
-  int16_t rawX[4] = {0};
-  int16_t rawY[4] = {0};
-  
-  // Collect calibration data for each corner
-  for (int i = 0; i < 4; i++) {
-    // Draw target
-    tft.fillScreen(TFT_BLACK);
-    tft.setTextColor(TFT_CYAN, TFT_BLACK);
-    tft.drawString("Touch Calibration", DISPLAY_WIDTH / 2, 30, 2);
-    tft.setTextColor(TFT_YELLOW, TFT_BLACK);
-    tft.drawString(calPoints[i].label, DISPLAY_WIDTH / 2, 60, 2);
-    tft.setTextColor(TFT_WHITE, TFT_BLACK);
-    tft.drawString("Touch the cross", DISPLAY_WIDTH / 2, 100, 2);
-    tft.drawString(String(i + 1) + " of 4", DISPLAY_WIDTH / 2, 120, 2);
-    
-    // Draw crosshair
-    tft.drawLine(calPoints[i].x - 10, calPoints[i].y, calPoints[i].x + 10, calPoints[i].y, TFT_RED);
-    tft.drawLine(calPoints[i].x, calPoints[i].y - 10, calPoints[i].x, calPoints[i].y + 10, TFT_RED);
-    tft.fillCircle(calPoints[i].x, calPoints[i].y, 3, TFT_RED);
-    
-    // Wait for touch
-    bool touched = false;
-    unsigned long startTime = millis();
-    while (!touched && (millis() - startTime < 30000)) { // 30 second timeout
-      if (ts.tirqTouched() && ts.touched()) {
-        TS_Point p = ts.getPoint();
-        rawX[i] = p.x;
-        rawY[i] = p.y;
-        touched = true;
-        
-        // Visual feedback
-        tft.fillCircle(calPoints[i].x, calPoints[i].y, 5, TFT_GREEN);
-        delay(500);
-        
-        Serial.print("Point "); Serial.print(i + 1);
-        Serial.print(": Raw X="); Serial.print(rawX[i]);
-        Serial.print(", Y="); Serial.println(rawY[i]);
-      }
-      delay(50);
-    }
-    
-    if (!touched) {
-      Serial.println("Calibration timeout!");
-      tft.fillScreen(TFT_RED);
-      tft.setTextColor(TFT_WHITE, TFT_RED);
-      tft.drawString("Calibration", DISPLAY_WIDTH / 2, DISPLAY_HEIGHT / 2 - 20, 2);
-      tft.drawString("Timeout!", DISPLAY_WIDTH / 2, DISPLAY_HEIGHT / 2 + 20, 2);
-      delay(3000);
-      return;
-    }
-  }
-  
-  // Calculate min/max values
-  touchCal.xMin = min(min(rawX[0], rawX[1]), min(rawX[2], rawX[3]));
-  touchCal.xMax = max(max(rawX[0], rawX[1]), max(rawX[2], rawX[3]));
-  touchCal.yMin = min(min(rawY[0], rawY[1]), min(rawY[2], rawY[3]));
-  touchCal.yMax = max(max(rawY[0], rawY[1]), max(rawY[2], rawY[3]));
-  
-  // Add small margin (5%)
-  int16_t xMargin = (touchCal.xMax - touchCal.xMin) * 0.05;
-  int16_t yMargin = (touchCal.yMax - touchCal.yMin) * 0.05;
-  touchCal.xMin -= xMargin;
-  touchCal.xMax += xMargin;
-  touchCal.yMin -= yMargin;
-  touchCal.yMax += yMargin;
-  
-  touchCal.isValid = true;
-
-  // Save to NVS and notify touch layer (for LVGL indev)
-  saveTouchCalibration();
-  TouchSetCalibration(&touchCal);
-
-  // Show success message
-  tft.fillScreen(TFT_GREEN);
-  tft.setTextColor(TFT_BLACK, TFT_GREEN);
-  tft.drawString("Calibration", DISPLAY_WIDTH / 2, DISPLAY_HEIGHT / 2 - 20, 2);
-  tft.drawString("Complete!", DISPLAY_WIDTH / 2, DISPLAY_HEIGHT / 2 + 20, 2);
-  delay(2000);
-  /* Clear to black before handing back to LVGL so it doesn't see leftover green */
-  tft.fillScreen(TFT_BLACK);
-
-  Serial.println("Calibration complete!");
-  Serial.print("X: "); Serial.print(touchCal.xMin); Serial.print(" - "); Serial.println(touchCal.xMax);
-  Serial.print("Y: "); Serial.print(touchCal.yMin); Serial.print(" - "); Serial.println(touchCal.yMax);
-}
-
-TS_Point calibrateTouchPoint(TS_Point raw) {
-  TS_Point calibrated;
-  
-  if (!touchCal.isValid) {
-    // Return raw point if calibration not available
-    return raw;
-  }
-  
-  // Map raw coordinates to display coordinates
-  calibrated.x = map(raw.x, touchCal.xMin, touchCal.xMax, 0, DISPLAY_WIDTH);
-  calibrated.y = map(raw.y, touchCal.yMin, touchCal.yMax, 0, DISPLAY_HEIGHT);
-  
-  // Clamp to display bounds
-  calibrated.x = constrain(calibrated.x, 0, DISPLAY_WIDTH - 1);
-  calibrated.y = constrain(calibrated.y, 0, DISPLAY_HEIGHT - 1);
-  
-  // Keep original Z (pressure) value
-  calibrated.z = raw.z;
-  
-  return calibrated;
-}
-
 bool loadShuntCalibration() {
   // Check if calibration exists
   if (!preferences.getBool(NVS_KEY_SHUNT_CALIBRATED, false)) {
@@ -396,6 +382,7 @@ bool loadShuntCalibration() {
 }
 
 void saveShuntCalibration() {
+  HistoryLogFlush();  // records measured with the old calibration stay in their own block
   preferences.putBool(NVS_KEY_SHUNT_CALIBRATED, true);
   preferences.putFloat(NVS_KEY_MAX_CURRENT, maxCurrent);
   preferences.putFloat(NVS_KEY_SHUNT_RESISTANCE, shuntResistance);
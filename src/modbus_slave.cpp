@@ -0,0 +1,522 @@
+/**
+ * @file modbus_slave.cpp
+ * Modbus RTU/TCP slave (see modbus_slave.h and docs/MODBUS.md).
+ */
+#include "modbus_slave.h"
+#include "modbus_regs.h"
+#include "live_snapshot.h"
+#include "sd_log.h"
+#include "sensor.h"
+#include "session_stats.h"
+#include "telemetry_victron.h"
+#include "touch.h"
+#include "wifi_link.h"
+#include <Arduino.h>
+#include <AsyncTCP.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define MB_NVS_NAMESPACE "cyd_modbus"
+#define MB_NVS_KEY_RTU   "rtu"
+#define MB_NVS_KEY_TCP   "tcp"
+#define MB_NVS_KEY_UNIT  "unit"
+#define MB_NVS_KEY_BAUD  "baud"
+#define MB_NVS_KEY_PAR   "par"
+#define MB_NVS_KEY_RX    "rx"
+#define MB_NVS_KEY_TX    "tx"
+#define MB_NVS_KEY_DE    "de"
+
+#define MB_RTU_RX_TIMEOUT_SYMBOLS 4    /* end of frame: RX idle for >= 3.5 characters */
+
+/* GPIOs the CYD already uses: display (build flags), touch, microSD, the sensor's I2C bus,
+ * VE.Direct on Serial1 and the USB console. 6..11 (SPI flash) are refused separately. */
+static const int8_t k_busy_pins[] = {
+  TFT_MISO, TFT_MOSI, TFT_SCLK, TFT_CS, TFT_DC, TFT_BL,
+  TOUCH_SCLK_PIN, TOUCH_MOSI_PIN, TOUCH_MISO_PIN, TOUCH_CS_PIN, TOUCH_IRQ_PIN,
+  SD_CS_PIN, SD_SCK_PIN, SD_MISO_PIN, SD_MOSI_PIN,
+  I2C_SDA, I2C_SCL,
+  VE_UART_RX_PIN, VE_UART_TX_PIN,
+  1, 3,
+};
+
+static HardwareSerial &MB_UART = Serial2;  /* Serial1 is VE.Direct */
+
+/* Settings: written by the setters (console), read by the task */
+static portMUX_TYPE    s_cfg_mux = portMUX_INITIALIZER_UNLOCKED;
+static ModbusRtuConfig s_rtu_cfg = {19200, 'E', MODBUS_RTU_RX_PIN, MODBUS_RTU_TX_PIN, -1};
+static volatile uint8_t s_unit = 1;
+static volatile bool   s_rtu_want = false;
+static volatile bool   s_tcp_want = false;
+static volatile bool   s_rtu_reopen = false;
+
+static ModbusSlaveStats s_stats;
+static portMUX_TYPE     s_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* Register image: rebuilt by the task, copied out by the request handlers */
+static uint16_t         s_image[MB_REG_COUNT];
+static portMUX_TYPE     s_image_mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint16_t s_command = 0;    /* queued by a handler, carried out by the task */
+
+static TaskHandle_t     s_task = NULL;
+static volatile uint32_t s_rtu_rx_us = 0;  /* micros() at the last end-of-frame event */
+
+#define STAT_ADD(field, n)                \
+  do {                                    \
+    portENTER_CRITICAL(&s_stats_mux);     \
+    s_stats.field += (n);                 \
+    portEXIT_CRITICAL(&s_stats_mux);      \
+  } while (0)
+
+static void stat_max(uint32_t *field, uint32_t v) {
+  portENTER_CRITICAL(&s_stats_mux);
+  if (v > *field) *field = v;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+static void image_copy(uint16_t *dst) {
+  portENTER_CRITICAL(&s_image_mux);
+  memcpy(dst, s_image, sizeof(s_image));
+  portEXIT_CRITICAL(&s_image_mux);
+}
+
+/* A handler accepted a command write: hand it to the task, which may block (NVS, locks) */
+static void command_queue(uint16_t cmd) {
+  if (!cmd) return;
+  s_command = cmd;
+  if (s_task) xTaskNotifyGive(s_task);
+}
+
+/* ─── Image refresh (task) ─── */
+static void stats_values(StatsScope scope, MbStatsValues *o) {
+  SessionStats s;
+  SessionStatsGet(scope, &s);
+  o->ah_in = s.ah_in;
+  o->ah_out = s.ah_out;
+  o->peak_power_W = s.peak_power_W;
+  bool any = s.voltage.n > 0;
+  o->v_min = any ? s.voltage.min : 0;
+  o->v_max = any ? s.voltage.max : 0;
+  o->v_mean = (float)s.voltage.mean;
+  o->i_min = any ? s.current.min : 0;
+  o->i_max = any ? s.current.max : 0;
+  o->i_mean = (float)s.current.mean;
+  o->charge_s = (uint32_t)(s.charge_ms / 1000);
+  o->discharge_s = (uint32_t)(s.discharge_ms / 1000);
+  o->idle_s = (uint32_t)(s.idle_ms / 1000);
+  o->start_s = s.start_t_s;
+  o->samples = s.voltage.n;
+}
+
+static void image_refresh(void) {
+  static uint16_t next[MB_REG_COUNT];  /* task only */
+  LiveSnapshot snap;
+  LiveSnapshotGet(&snap);
+  MbValues v;
+  memset(&v, 0, sizeof(v));
+  v.seq = snap.seq;
+  v.age_ms = snap.seq ? millis() - snap.t_ms : 0;
+  v.op_s = SessionStatsNow();
+  v.rate_hz = snap.sample_rate_hz;
+  v.sensor_connected = snap.sensor_connected;
+  v.voltage_V = snap.voltage_V;
+  v.current_A = snap.current_A;
+  v.power_W = snap.power_W;
+  v.energy_Wh = snap.energy_Wh;
+  v.temperature_C = snap.sensor_connected ? snap.temperature_C : NAN;
+  v.soc_percent = snap.soc_percent;
+  stats_values(STATS_SESSION, &v.session);
+  stats_values(STATS_LIFETIME, &v.lifetime);
+  MbBuildImage(&v, next);
+  portENTER_CRITICAL(&s_image_mux);
+  memcpy(s_image, next, sizeof(s_image));
+  portEXIT_CRITICAL(&s_image_mux);
+  STAT_ADD(refreshes, 1);
+}
+
+static void command_run(void) {
+  uint16_t cmd = s_command;
+  s_command = 0;
+  if (cmd == MB_CMD_RESET_SESSION) {
+    SessionStatsReset(STATS_SESSION);
+    STAT_ADD(commands, 1);
+    image_refresh();  /* a read right after the write sees the cleared scope */
+  }
+}
+
+/* ─── RTU (task) ─── */
+static bool s_rtu_open = false;
+
+static void rtu_on_receive(void) {  /* UART event task: a frame ended */
+  s_rtu_rx_us = micros();
+  if (s_task) xTaskNotifyGive(s_task);
+}
+
+static void rtu_open(void) {
+  ModbusRtuConfig c;
+  ModbusSlaveGetRtuConfig(&c);
+  uint32_t mode = c.parity == 'E' ? SERIAL_8E1 : c.parity == 'O' ? SERIAL_8O1 : SERIAL_8N1;
+  MB_UART.setRxBufferSize(2 * MB_RTU_ADU_MAX);
+  MB_UART.setTxBufferSize(2 * MB_RTU_ADU_MAX);  /* write() queues the reply and returns */
+  MB_UART.begin(c.baud, mode, c.rx_pin, c.tx_pin);
+  if (c.de_pin >= 0) {
+    /* The UART drives DE itself, released right after the stop bit of the last byte */
+    MB_UART.setPins(c.rx_pin, c.tx_pin, -1, c.de_pin);
+    MB_UART.setMode(UART_MODE_RS485_HALF_DUPLEX);
+  }
+  MB_UART.setRxTimeout(MB_RTU_RX_TIMEOUT_SYMBOLS);
+  MB_UART.onReceive(rtu_on_receive, true);
+  s_rtu_open = true;
+}
+
+static void rtu_close(void) {
+  MB_UART.onReceive(NULL);
+  MB_UART.end();
+  s_rtu_open = false;
+}
+
+static void rtu_poll(void) {
+  uint8_t frame[MB_RTU_ADU_MAX], out[MB_RTU_ADU_MAX];
+  uint16_t image[MB_REG_COUNT];
+  size_t n = 0;
+  while (MB_UART.available()) {
+    int b = MB_UART.read();
+    if (b < 0) break;
+    if (n < sizeof(frame)) frame[n] = (uint8_t)b;
+    n++;  /* an oversized frame is still drained, then dropped as bad */
+  }
+  if (!n) return;
+  uint16_t cmd = 0;
+  image_copy(image);
+  int r = n > sizeof(frame) ? MB_RTU_BAD_FRAME : MbRtuHandle(s_unit, image, frame, n, out, &cmd);
+  if (r > 0) {
+    MB_UART.write(out, (size_t)r);
+    stat_max(&s_stats.rtu_answer_us_max, micros() - s_rtu_rx_us);
+    STAT_ADD(rtu_requests, 1);
+    if (out[1] & 0x80) STAT_ADD(exceptions, 1);
+  } else if (r == MB_RTU_BAD_FRAME) {
+    STAT_ADD(rtu_bad_frames, 1);
+  } else {
+    STAT_ADD(rtu_other_unit, 1);
+  }
+  if (cmd) command_run();
+}
+
+/* ─── TCP (AsyncTCP task) ─── */
+typedef struct {
+  AsyncClient *client;
+  uint16_t     n;
+  uint8_t      buf[MB_TCP_ADU_MAX];  /* one partial request at most */
+} tcp_slot_t;
+
+static tcp_slot_t   s_slots[MODBUS_TCP_MAX_CLIENTS];
+static AsyncServer *s_server = NULL;
+static bool         s_listening = false;  /* task only */
+
+static void tcp_drop(void *arg, AsyncClient *c) {
+  (void)arg;
+  delete c;
+}
+
+static void tcp_on_disconnect(void *arg, AsyncClient *c) {
+  tcp_slot_t *slot = (tcp_slot_t *)arg;
+  slot->client = NULL;
+  slot->n = 0;
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.tcp_clients--;
+  portEXIT_CRITICAL(&s_stats_mux);
+  delete c;
+}
+
+static void tcp_on_data(void *arg, AsyncClient *c, void *data, size_t len) {
+  tcp_slot_t *slot = (tcp_slot_t *)arg;
+  uint32_t t0 = micros();
+  if (!s_tcp_want) {  /* switched off: existing connections end on their next request */
+    c->close();
+    return;
+  }
+  uint16_t image[MB_REG_COUNT];
+  bool have_image = false;
+  uint8_t out[MB_TCP_ADU_MAX];
+  const uint8_t *p = (const uint8_t *)data;
+  uint32_t answered = 0, exceptions = 0;
+  while (len) {
+    size_t take = sizeof(slot->buf) - slot->n;
+    if (take > len) take = len;
+    memcpy(slot->buf + slot->n, p, take);
+    slot->n += take;
+    p += take;
+    len -= take;
+    int flen;
+    while ((flen = MbTcpFrameLength(slot->buf, slot->n)) > 0) {
+      if (!have_image) {
+        image_copy(image);
+        have_image = true;
+      }
+      uint16_t cmd = 0;
+      size_t m = MbTcpHandle(image, slot->buf, (size_t)flen, out, &cmd);
+      if (c->space() < m) {  /* the master sends faster than it reads answers */
+        flen = -1;
+        break;
+      }
+      c->add((const char *)out, m);
+      answered++;
+      if (out[MB_TCP_MBAP] & 0x80) exceptions++;
+      command_queue(cmd);
+      slot->n -= (uint16_t)flen;
+      memmove(slot->buf, slot->buf + flen, slot->n);
+    }
+    if (flen < 0) {
+      STAT_ADD(tcp_rejected, 1);
+      c->close();
+      return;
+    }
+  }
+  if (!answered) return;
+  c->send();
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.tcp_requests += answered;
+  s_stats.exceptions += exceptions;
+  if (micros() - t0 > s_stats.tcp_answer_us_max) s_stats.tcp_answer_us_max = micros() - t0;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+static void tcp_on_client(void *arg, AsyncClient *c) {
+  (void)arg;
+  tcp_slot_t *slot = NULL;
+  for (int k = 0; k < MODBUS_TCP_MAX_CLIENTS && !slot; k++)
+    if (!s_slots[k].client) slot = &s_slots[k];
+  if (!slot || !s_tcp_want) {
+    STAT_ADD(tcp_rejected, 1);
+    c->onDisconnect(tcp_drop, NULL);
+    c->close();
+    return;
+  }
+  slot->client = c;
+  slot->n = 0;
+  c->setNoDelay(true);  /* one small answer per request: do not wait for Nagle */
+  c->setRxTimeout(MODBUS_TCP_IDLE_S);
+  c->onData(tcp_on_data, slot);
+  c->onDisconnect(tcp_on_disconnect, slot);
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.tcp_clients++;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+static void tcp_update(void) {  /* task */
+  if (s_tcp_want && !s_listening && WifiLinkIsUp()) {
+    if (!s_server) {
+      s_server = new AsyncServer(MODBUS_TCP_PORT);
+      s_server->setNoDelay(true);
+      s_server->onClient(tcp_on_client, NULL);
+    }
+    s_server->begin();
+    s_listening = true;
+  } else if (!s_tcp_want && s_listening) {
+    s_server->end();
+    s_listening = false;
+  }
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.tcp_listening = s_listening;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+static void on_got_ip(WiFiEvent_t event, WiFiEventInfo_t info) {
+  (void)event;
+  (void)info;
+  if (s_task) xTaskNotifyGive(s_task);
+}
+
+/* ─── Task ─── */
+/* True if the RTU line has both pins; there are no default pins (MODBUS_RTU_RX_PIN/TX_PIN). */
+static bool rtu_has_pins(void) {
+  portENTER_CRITICAL(&s_cfg_mux);
+  bool ok = s_rtu_cfg.rx_pin >= 0 && s_rtu_cfg.tx_pin >= 0;
+  portEXIT_CRITICAL(&s_cfg_mux);
+  return ok;
+}
+
+static void modbus_task(void *arg) {
+  (void)arg;
+  uint32_t last_refresh = millis() - MODBUS_REFRESH_MS;
+  for (;;) {
+    if (s_rtu_reopen) {
+      s_rtu_reopen = false;
+      if (s_rtu_open) rtu_close();
+    }
+    bool rtu = s_rtu_want && rtu_has_pins();
+    if (rtu != s_rtu_open) {
+      if (s_rtu_open) rtu_close();
+      else rtu_open();
+    }
+    tcp_update();
+    if (s_command) command_run();
+    if (!rtu && !s_tcp_want) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);  /* nothing to serve: no refreshes either */
+      last_refresh = millis() - MODBUS_REFRESH_MS;
+      continue;
+    }
+    uint32_t since = millis() - last_refresh;
+    if (since >= MODBUS_REFRESH_MS) {
+      image_refresh();
+      last_refresh = millis();
+      since = 0;
+    }
+    if (s_rtu_open) rtu_poll();
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MODBUS_REFRESH_MS - since));
+  }
+}
+
+/* ─── Public API ─── */
+void ModbusSlaveInit(void) {
+  if (s_task) return;
+  Preferences prefs;
+  if (prefs.begin(MB_NVS_NAMESPACE, true)) {
+    s_rtu_want = prefs.getBool(MB_NVS_KEY_RTU, false);
+    s_tcp_want = prefs.getBool(MB_NVS_KEY_TCP, false);
+    s_unit = prefs.getUChar(MB_NVS_KEY_UNIT, 1);
+    s_rtu_cfg.baud = prefs.getULong(MB_NVS_KEY_BAUD, s_rtu_cfg.baud);
+    s_rtu_cfg.parity = (char)prefs.getUChar(MB_NVS_KEY_PAR, (uint8_t)s_rtu_cfg.parity);
+    s_rtu_cfg.rx_pin = prefs.getChar(MB_NVS_KEY_RX, s_rtu_cfg.rx_pin);
+    s_rtu_cfg.tx_pin = prefs.getChar(MB_NVS_KEY_TX, s_rtu_cfg.tx_pin);
+    s_rtu_cfg.de_pin = prefs.getChar(MB_NVS_KEY_DE, s_rtu_cfg.de_pin);
+    prefs.end();
+  }
+  if (!ModbusSlaveRtuPinsOk(&s_rtu_cfg)) {  /* saved by an older build, or the board's pins moved */
+    Serial.printf("Modbus: RTU pins RX%d TX%d DE%d are in use, RTU needs pins\n", s_rtu_cfg.rx_pin,
+                  s_rtu_cfg.tx_pin, s_rtu_cfg.de_pin);
+    s_rtu_cfg.rx_pin = s_rtu_cfg.tx_pin = s_rtu_cfg.de_pin = -1;
+  }
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.rtu_enabled = s_rtu_want;
+  s_stats.tcp_enabled = s_tcp_want;
+  s_stats.unit = s_unit;
+  portEXIT_CRITICAL(&s_stats_mux);
+  WiFi.onEvent(on_got_ip, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  /* Above the network senders: an RTU master times out if the answer waits behind a batch upload.
+   * The work per wake-up is a few microseconds. */
+  if (xTaskCreatePinnedToCore(modbus_task, "modbus", 4096, NULL, 2, &s_task, 1) != pdPASS)
+    Serial.println("Modbus: out of memory");
+}
+
+static void save_bool(const char *key, bool on) {
+  Preferences prefs;
+  if (prefs.begin(MB_NVS_NAMESPACE, false)) {
+    prefs.putBool(key, on);
+    prefs.end();
+  }
+}
+
+void ModbusSlaveSetRtu(bool on) {
+  save_bool(MB_NVS_KEY_RTU, on);
+  s_rtu_want = on;
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.rtu_enabled = on;
+  portEXIT_CRITICAL(&s_stats_mux);
+  if (s_task) xTaskNotifyGive(s_task);
+}
+
+void ModbusSlaveSetTcp(bool on) {
+  save_bool(MB_NVS_KEY_TCP, on);
+  s_tcp_want = on;
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.tcp_enabled = on;
+  portEXIT_CRITICAL(&s_stats_mux);
+  if (s_task) xTaskNotifyGive(s_task);
+}
+
+bool ModbusSlaveSetUnit(uint8_t unit) {
+  if (unit < 1 || unit > 247) return false;
+  Preferences prefs;
+  if (prefs.begin(MB_NVS_NAMESPACE, false)) {
+    prefs.putUChar(MB_NVS_KEY_UNIT, unit);
+    prefs.end();
+  }
+  s_unit = unit;
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.unit = unit;
+  portEXIT_CRITICAL(&s_stats_mux);
+  return true;
+}
+
+static bool pin_free(int pin, bool output) {
+  if (pin < 0 || pin > 39 || (output && pin > 33)) return false;   /* 34..39 are input-only */
+  if ((pin >= 6 && pin <= 11) || pin == 20 || pin == 24 || (pin >= 28 && pin <= 31)) return false;
+  for (size_t i = 0; i < sizeof(k_busy_pins) / sizeof(k_busy_pins[0]); i++)
+    if (pin == k_busy_pins[i]) return false;
+  return true;
+}
+
+bool ModbusSlaveRtuPinsOk(const ModbusRtuConfig *cfg) {
+  if (!cfg) return false;
+  if (cfg->rx_pin < 0 && cfg->tx_pin < 0 && cfg->de_pin < 0) return true;  /* not configured yet */
+  if (!pin_free(cfg->rx_pin, false) || !pin_free(cfg->tx_pin, true)) return false;
+  if (cfg->rx_pin == cfg->tx_pin) return false;
+  if (cfg->de_pin >= 0 && (!pin_free(cfg->de_pin, true) || cfg->de_pin == cfg->rx_pin || cfg->de_pin == cfg->tx_pin))
+    return false;
+  return true;
+}
+
+bool ModbusSlaveSetRtuConfig(const ModbusRtuConfig *cfg) {
+  if (!cfg || cfg->baud < 1200 || cfg->baud > 921600) return false;
+  if (cfg->parity != 'N' && cfg->parity != 'E' && cfg->parity != 'O') return false;
+  if (!ModbusSlaveRtuPinsOk(cfg)) return false;
+  Preferences prefs;
+  if (prefs.begin(MB_NVS_NAMESPACE, false)) {
+    prefs.putULong(MB_NVS_KEY_BAUD, cfg->baud);
+    prefs.putUChar(MB_NVS_KEY_PAR, (uint8_t)cfg->parity);
+    prefs.putChar(MB_NVS_KEY_RX, cfg->rx_pin);
+    prefs.putChar(MB_NVS_KEY_TX, cfg->tx_pin);
+    prefs.putChar(MB_NVS_KEY_DE, cfg->de_pin);
+    prefs.end();
+  }
+  portENTER_CRITICAL(&s_cfg_mux);
+  s_rtu_cfg = *cfg;
+  portEXIT_CRITICAL(&s_cfg_mux);
+  s_rtu_reopen = true;
+  if (s_task) xTaskNotifyGive(s_task);
+  return true;
+}
+
+void ModbusSlaveGetRtuConfig(ModbusRtuConfig *out) {
+  if (!out) return;
+  portENTER_CRITICAL(&s_cfg_mux);
+  *out = s_rtu_cfg;
+  portEXIT_CRITICAL(&s_cfg_mux);
+}
+
+void ModbusSlaveGetStats(ModbusSlaveStats *out) {
+  if (!out) return;
+  portENTER_CRITICAL(&s_stats_mux);
+  *out = s_stats;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+void ModbusSlaveGetInfo(char *buf, size_t len) {
+  if (!buf || !len) return;
+  ModbusSlaveStats st;
+  ModbusRtuConfig c;
+  ModbusSlaveGetStats(&st);
+  ModbusSlaveGetRtuConfig(&c);
+  if (!st.rtu_enabled && !st.tcp_enabled) {
+    snprintf(buf, len, "off");
+    return;
+  }
+  char rtu[40] = "RTU off", tcp[32] = "TCP off";
+  if (st.rtu_enabled && c.rx_pin < 0) {
+    snprintf(rtu, sizeof(rtu), "RTU needs pins (modbus uart)");
+  } else if (st.rtu_enabled) {
+    int n = snprintf(rtu, sizeof(rtu), "RTU %lu 8%c1 RX%d TX%d", (unsigned long)c.baud, c.parity, c.rx_pin, c.tx_pin);
+    if (c.de_pin >= 0 && n > 0 && (size_t)n < sizeof(rtu)) snprintf(rtu + n, sizeof(rtu) - n, " DE%d", c.de_pin);
+  }
+  if (st.tcp_enabled && st.tcp_listening)
+    snprintf(tcp, sizeof(tcp), "TCP :%u %u client%s", (unsigned)MODBUS_TCP_PORT, (unsigned)st.tcp_clients,
+             st.tcp_clients == 1 ? "" : "s");
+  else if (st.tcp_enabled)
+    snprintf(tcp, sizeof(tcp), "TCP waiting for Wi-Fi");
+  snprintf(buf, len, "unit %u, %s, %s", (unsigned)st.unit, rtu, tcp);
+}
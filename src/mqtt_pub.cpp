@@ -0,0 +1,352 @@
+/**
+ * @file mqtt_pub.cpp
+ * MQTT publisher (see mqtt_pub.h and docs/MQTT.md).
+ */
+#include "mqtt_pub.h"
+#include "mqtt_batch.h"
+#include "wifi_link.h"
+#include "sensor.h"
+#include "session_stats.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define MQTT_NVS_NAMESPACE "cyd_mqtt"
+#define MQTT_NVS_KEY_ON    "on"
+#define MQTT_NVS_KEY_HOST  "host"
+#define MQTT_NVS_KEY_PORT  "port"
+#define MQTT_NVS_KEY_USER  "user"
+#define MQTT_NVS_KEY_PASS  "pass"
+
+#define MQTT_TICK_MS        100   /* task wake-up: keepalive, sampling and publish checks */
+#define MQTT_SOCKET_TIMEOUT 5     /* s; PubSubClient's default of 15 s is too long for a retry loop */
+#define MQTT_KEEPALIVE      30    /* s */
+
+static_assert(MQTT_BATCH_MAX >= 1 && MQTT_BATCH_MAX <= MQTT_QUEUE_SAMPLES, "batch size");
+static_assert(MQTT_QUEUE_SAMPLES <= 0xFFFF, "queue counters are 16-bit");
+
+/* Settings: written by MqttPubConfigure()/MqttPubSetEnabled() (console), read by the task */
+static portMUX_TYPE  s_cfg_mux = portMUX_INITIALIZER_UNLOCKED;
+static char          s_host[64] = "";
+static uint16_t      s_port = 1883;
+static char          s_user[32] = "";
+static char          s_pass[64] = "";
+static volatile bool s_enabled = false;
+static volatile bool s_reconfig = false;
+
+static MqttPubStats s_stats;
+static portMUX_TYPE s_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* Task state */
+static WiFiClient    s_net;
+static PubSubClient  s_client(s_net);
+static char          s_host_task[64];  /* PubSubClient keeps the pointer, not a copy */
+static char          s_base[32];       /* <prefix>/<device id> */
+static MqttSample    s_queue_buf[MQTT_QUEUE_SAMPLES];
+static MqttQueue     s_queue;
+static MqttPolicy    s_policy;
+static char          s_msg_buf[MQTT_BUFFER_BYTES - 64];
+static MqttMsg       s_msg;
+static char          s_topic[96];
+
+static void publish_queue_stats(void) {
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.samples_dropped = s_queue.dropped;
+  s_stats.queued = s_queue.count;
+  s_stats.queue_peak = s_queue.peak;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+static void take_sample(void) {
+  MqttSample smp;
+  SensorWindow w;
+  if (SensorReadWindow(SENSOR_CONSUMER_MQTT, &w)) {  /* mean over the whole period */
+    smp.v = w.voltage.mean;
+    smp.i = w.current.mean;
+    smp.p = w.power.mean;
+  } else {
+    smp.v = SensorGetBusVoltage();
+    smp.i = SensorGetCurrent();
+    smp.p = SensorGetPower();
+  }
+  smp.t_ms = millis();
+  MqttQueuePush(&s_queue, &smp);
+  publish_queue_stats();
+}
+
+static const char *topic(const char *leaf) {
+  snprintf(s_topic, sizeof(s_topic), "%s/%s", s_base, leaf);
+  return s_topic;
+}
+
+/* Publish s_msg; updates timing and counters. */
+static bool publish(const char *t, bool retained, uint32_t *dt_us) {
+  uint32_t t0 = micros();
+  bool ok = s_client.publish(t, (const uint8_t *)s_msg.buf, (unsigned)s_msg.len, retained);
+  uint32_t dt = micros() - t0;
+  if (dt_us) *dt_us = dt;
+  portENTER_CRITICAL(&s_stats_mux);
+  if (ok) {
+    s_stats.messages++;
+  } else {
+    s_stats.publish_failures++;
+  }
+  s_stats.publish_us_last = dt;
+  if (dt > s_stats.publish_us_max) s_stats.publish_us_max = dt;
+  portEXIT_CRITICAL(&s_stats_mux);
+  return ok;
+}
+
+/* ─── Home Assistant discovery ─── */
+static void publish_discovery(void) {
+  char t[96];
+  for (size_t k = 0; k < MQTT_HA_SENSOR_COUNT; k++) {
+    if (MqttFormatDiscovery(&s_msg, t, sizeof(t), k, s_base, WifiLinkDeviceId(), SensorGetDriverName()))
+      publish(t, true, NULL);
+  }
+}
+
+/* ─── Messages ─── */
+/* The n oldest queued samples as one message; pops them on success. */
+static bool publish_batch(uint16_t n, uint32_t *dt_us) {
+  if (!MqttFormatBatch(&s_msg, &s_queue, n)) return false;  /* MQTT_BATCH_MAX too large for MQTT_BUFFER_BYTES */
+  if (!publish(topic("samples"), false, dt_us)) return false;
+  const MqttSample last = *MqttQueueAt(&s_queue, (uint16_t)(n - 1));
+  MqttQueuePop(&s_queue, n);
+  publish_queue_stats();
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.samples_sent += n;
+  s_stats.batch_last = n;
+  if (n > s_stats.batch_max) s_stats.batch_max = n;
+  portEXIT_CRITICAL(&s_stats_mux);
+
+  /* Latest values for Home Assistant: energy and temperature go over I2C, once per batch only */
+  MqttFormatState(&s_msg, last.v, last.i, last.p, SensorGetWattHour(), SensorGetTemperature());
+  publish(topic("state"), true, NULL);
+  return true;
+}
+
+static void stats_scope(const char *name, StatsScope scope) {
+  SessionStats st;
+  SessionStatsGet(scope, &st);
+  MqttMsgAppend(&s_msg, "\"%s\":{\"n\":%lu,", name, (unsigned long)st.voltage.n);
+  MqttMsgNum(&s_msg, "v_min", st.voltage.n ? st.voltage.min : NAN, 3);
+  MqttMsgAppend(&s_msg, ",");
+  MqttMsgNum(&s_msg, "v_max", st.voltage.n ? st.voltage.max : NAN, 3);
+  MqttMsgAppend(&s_msg, ",");
+  MqttMsgNum(&s_msg, "i_mean", st.current.n ? st.current.mean : NAN, 3);
+  MqttMsgAppend(&s_msg, ",");
+  MqttMsgNum(&s_msg, "p_peak", st.peak_power_W, 2);
+  MqttMsgAppend(&s_msg, ",");
+  MqttMsgNum(&s_msg, "ah_in", st.ah_in, 4);
+  MqttMsgAppend(&s_msg, ",");
+  MqttMsgNum(&s_msg, "ah_out", st.ah_out, 4);
+  MqttMsgAppend(&s_msg, ",\"start_s\":%lu}", (unsigned long)st.start_t_s);
+}
+
+static void publish_stats(void) {
+  MqttPubStats m;
+  MqttPubGetStats(&m);
+  s_msg.len = 0;
+  MqttMsgAppend(&s_msg, "{\"op_s\":%lu,", (unsigned long)SessionStatsNow());
+  stats_scope("session", STATS_SESSION);
+  MqttMsgAppend(&s_msg, ",");
+  stats_scope("life", STATS_LIFETIME);
+  MqttMsgAppend(&s_msg, ",\"mqtt\":{\"sent\":%lu,\"queued\":%u,\"dropped\":%lu,\"batch_ms\":%lu,\"connects\":%lu}}",
+                (unsigned long)m.samples_sent, (unsigned)m.queued, (unsigned long)m.samples_dropped,
+                (unsigned long)m.batch_interval_ms, (unsigned long)m.connects);
+  publish(topic("stats"), true, NULL);
+}
+
+/* ─── Connection ─── */
+static bool broker_connect(void) {
+  char user[sizeof(s_user)], pass[sizeof(s_pass)];
+  uint16_t port;
+  portENTER_CRITICAL(&s_cfg_mux);
+  memcpy(s_host_task, s_host, sizeof(s_host_task));
+  memcpy(user, s_user, sizeof(user));
+  memcpy(pass, s_pass, sizeof(pass));
+  port = s_port;
+  portEXIT_CRITICAL(&s_cfg_mux);
+  if (!s_host_task[0]) return false;
+
+  char client_id[24];
+  snprintf(client_id, sizeof(client_id), "cyd-shunt-%s", WifiLinkDeviceId());
+  s_client.setServer(s_host_task, port);
+  /* Blocks this task only: DNS, TCP connect and CONNACK, bounded by MQTT_SOCKET_TIMEOUT */
+  bool ok = s_client.connect(client_id, user[0] ? user : NULL, user[0] ? pass : NULL, topic("status"), 0, true,
+                             "offline");
+  if (!ok) return false;
+  s_msg.len = 0;
+  MqttMsgAppend(&s_msg, "online");
+  publish(topic("status"), true, NULL);
+  publish_discovery();
+  return true;
+}
+
+static void mqtt_task(void *arg) {
+  (void)arg;
+  uint32_t next_sample = millis();
+
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(MQTT_TICK_MS));
+    uint32_t now = millis();
+
+    if (s_reconfig) {
+      s_reconfig = false;
+      if (s_client.connected()) s_client.disconnect();
+      MqttPolicyReset(&s_policy, now);
+    }
+    if (!s_enabled) {
+      if (s_client.connected()) s_client.disconnect();
+      MqttQueueClear(&s_queue);
+      s_policy.was_connected = false;
+      publish_queue_stats();
+      portENTER_CRITICAL(&s_stats_mux);
+      s_stats.connected = false;
+      portEXIT_CRITICAL(&s_stats_mux);
+      next_sample = now;
+      continue;
+    }
+
+    /* Sampling continues while offline: the queue carries the gap until the broker is back */
+    if ((int32_t)(now - next_sample) >= 0) {
+      next_sample += MQTT_SAMPLE_MS;
+      if ((int32_t)(now - next_sample) > MQTT_SAMPLE_MS) next_sample = now + MQTT_SAMPLE_MS;  /* stalled */
+      take_sample();
+    }
+
+    bool connected = s_client.connected();
+    if (!connected) {
+      MqttPolicyDisconnected(&s_policy, now);
+      if (WifiLinkIsUp() && MqttPolicyConnectDue(&s_policy, now)) {
+        if (broker_connect()) {
+          connected = true;
+          MqttPolicyConnected(&s_policy, now);
+          portENTER_CRITICAL(&s_stats_mux);
+          s_stats.connects++;
+          portEXIT_CRITICAL(&s_stats_mux);
+        } else {
+          MqttPolicyConnectFailed(&s_policy, millis(), esp_random());
+          portENTER_CRITICAL(&s_stats_mux);
+          s_stats.connect_failures++;
+          portEXIT_CRITICAL(&s_stats_mux);
+        }
+      }
+    }
+
+    if (connected) {
+      s_client.loop();  /* keepalive */
+      now = millis();
+      uint16_t n = MqttPolicyBatchDue(&s_policy, &s_queue, now);
+      if (n) {
+        uint32_t dt_us = 0;
+        bool ok = publish_batch(n, &dt_us);
+        MqttPolicyBatchDone(&s_policy, now, ok, dt_us);
+        if (!ok) s_client.disconnect();  /* samples stay queued; reconnect with backoff */
+      }
+      if (s_client.connected() && MqttPolicyStatsDue(&s_policy, now)) publish_stats();
+    }
+
+    portENTER_CRITICAL(&s_stats_mux);
+    s_stats.connected = s_client.connected();
+    s_stats.backoff_ms = MqttPolicyBackoffLeft(&s_policy, now, s_stats.connected);
+    s_stats.batch_interval_ms = s_policy.interval;
+    portEXIT_CRITICAL(&s_stats_mux);
+  }
+}
+
+/* ─── Public API ─── */
+void MqttPubInit(void) {
+  Preferences prefs;
+  if (prefs.begin(MQTT_NVS_NAMESPACE, true)) {
+    s_enabled = prefs.getBool(MQTT_NVS_KEY_ON, false);
+    prefs.getString(MQTT_NVS_KEY_HOST, s_host, sizeof(s_host));
+    s_port = prefs.getUShort(MQTT_NVS_KEY_PORT, 1883);
+    prefs.getString(MQTT_NVS_KEY_USER, s_user, sizeof(s_user));
+    prefs.getString(MQTT_NVS_KEY_PASS, s_pass, sizeof(s_pass));
+    prefs.end();
+  }
+  snprintf(s_base, sizeof(s_base), "%s/%s", MQTT_TOPIC_PREFIX, WifiLinkDeviceId());
+  MqttQueueInit(&s_queue, s_queue_buf, MQTT_QUEUE_SAMPLES);
+  MqttMsgInit(&s_msg, s_msg_buf, sizeof(s_msg_buf));
+  const MqttPolicyConfig cfg = {MQTT_SAMPLE_MS,      MQTT_BATCH_MAX,      MQTT_BATCH_INTERVAL_MAX_MS,
+                                MQTT_SLOW_PUBLISH_MS * 1000u,  MQTT_BACKOFF_MIN_MS, MQTT_BACKOFF_MAX_MS, MQTT_STATS_MS};
+  MqttPolicyInit(&s_policy, &cfg, millis());
+  s_client.setBufferSize(MQTT_BUFFER_BYTES);
+  s_client.setSocketTimeout(MQTT_SOCKET_TIMEOUT);
+  s_client.setKeepAlive(MQTT_KEEPALIVE);
+  s_stats.enabled = s_enabled;
+  s_stats.batch_interval_ms = MQTT_SAMPLE_MS;
+  /* Lowest priority on core 1: a stalled socket write waits behind sampling and logging */
+  xTaskCreatePinnedToCore(mqtt_task, "mqtt", 5120, NULL, 1, NULL, 1);
+}
+
+void MqttPubConfigure(const char *host, uint16_t port, const char *user, const char *pass) {
+  portENTER_CRITICAL(&s_cfg_mux);
+  snprintf(s_host, sizeof(s_host), "%s", host ? host : "");
+  s_port = port ? port : 1883;
+  snprintf(s_user, sizeof(s_user), "%s", user ? user : "");
+  snprintf(s_pass, sizeof(s_pass), "%s", pass ? pass : "");
+  portEXIT_CRITICAL(&s_cfg_mux);
+  Preferences prefs;
+  if (prefs.begin(MQTT_NVS_NAMESPACE, false)) {
+    prefs.putString(MQTT_NVS_KEY_HOST, s_host);
+    prefs.putUShort(MQTT_NVS_KEY_PORT, s_port);
+    prefs.putString(MQTT_NVS_KEY_USER, s_user);
+    prefs.putString(MQTT_NVS_KEY_PASS, s_pass);
+    prefs.end();
+  }
+  s_reconfig = true;
+}
+
+void MqttPubSetEnabled(bool on) {
+  Preferences prefs;
+  if (prefs.begin(MQTT_NVS_NAMESPACE, false)) {
+    prefs.putBool(MQTT_NVS_KEY_ON, on);
+    prefs.end();
+  }
+  s_enabled = on;
+  s_reconfig = true;
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.enabled = on;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+void MqttPubGetStats(MqttPubStats *out) {
+  if (!out) return;
+  portENTER_CRITICAL(&s_stats_mux);
+  *out = s_stats;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+void MqttPubGetInfo(char *buf, size_t len) {
+  if (!buf || !len) return;
+  MqttPubStats m;
+  MqttPubGetStats(&m);
+  char host[sizeof(s_host)];
+  uint16_t port;
+  portENTER_CRITICAL(&s_cfg_mux);
+  memcpy(host, s_host, sizeof(host));
+  port = s_port;
+  portEXIT_CRITICAL(&s_cfg_mux);
+  if (!m.enabled) {
+    snprintf(buf, len, "off");
+  } else if (!host[0]) {
+    snprintf(buf, len, "no broker set");
+  } else if (m.connected) {
+    snprintf(buf, len, "connected to %s:%u, %u queued", host, (unsigned)port, (unsigned)m.queued);
+  } else if (!WifiLinkIsUp()) {
+    snprintf(buf, len, "waiting for Wi-Fi, %u queued", (unsigned)m.queued);
+  } else {
+    snprintf(buf, len, "%s:%u retry in %lus, %u queued", host, (unsigned)port,
+             (unsigned long)(m.backoff_ms / 1000), (unsigned)m.queued);
+  }
+}
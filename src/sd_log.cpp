@@ -0,0 +1,370 @@
+/**
+ * @file sd_log.cpp
+ * microSD logger (see sd_log.h and docs/SD_LOG.md).
+ */
+#include "sd_log.h"
+#include "sensor.h"
+#include "session_stats.h"
+#include "spi_bus.h"
+#include "crc32.h"
+#include "sample_codec.h"
+#include "sd_log_format.h"
+#include <Arduino.h>
+#include <SD.h>
+#include <SPI.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#define SDLOG_VERSION  2
+#define SDLOG_MOUNT    "/sd"
+#define SDLOG_DIR      SDLOG_MOUNT "/log"
+#if SD_LOG_REPORT_MS > 0
+#define SDLOG_WINDOW_MS SD_LOG_REPORT_MS  /* sustained-rate window */
+#else
+#define SDLOG_WINDOW_MS 60000
+#endif
+
+typedef SdLogBlockHeaderV2 sdlog_block_hdr_t;
+
+static_assert(SD_LOG_BLOCK_BYTES % 512 == 0, "blocks must be whole card sectors");
+static_assert(SD_LOG_BLOCK_BYTES - sizeof(sdlog_block_hdr_t) <= UINT16_MAX, "payload_len is 16 bits");
+static_assert(SD_LOG_V_LSB_UV > 0 && SD_LOG_V_LSB_UV <= UINT16_MAX, "quantum is stored in 16 bits");
+static_assert(SD_LOG_I_LSB_UA > 0 && SD_LOG_I_LSB_UA <= UINT16_MAX, "quantum is stored in 16 bits");
+
+#define SDLOG_PAYLOAD_BYTES (SD_LOG_BLOCK_BYTES - sizeof(sdlog_block_hdr_t))
+
+static uint8_t      *s_pool = NULL;           /* SD_LOG_BLOCKS x SD_LOG_BLOCK_BYTES */
+static QueueHandle_t s_free_q = NULL;         /* block indices ready to fill */
+static QueueHandle_t s_full_q = NULL;         /* sealed blocks waiting for the card */
+static SdLogStats    s_stats;
+static portMUX_TYPE  s_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* Collector state (collector task only) */
+static int      s_cur = -1;                   /* block being filled */
+static uint32_t s_seq = 0;                    /* next ring sequence number */
+static SampleCodecPoint s_prev;               /* last sample in the current block */
+static uint64_t s_enc_us = 0;                 /* encode cost and sample count since boot */
+static uint64_t s_enc_samples = 0;
+static uint64_t s_sealed_samples = 0;         /* compression ratio: samples vs blocks sealed */
+static uint32_t s_sealed_blocks = 0;
+
+/* Writer state (writer task only, after init) */
+static int      s_fd = -1;
+static uint32_t s_file_index = 0;
+static uint32_t s_block_no = 0;
+static uint32_t s_file_bytes = 0;
+static uint32_t s_file_alloc = 0;
+static uint32_t s_file_start_s = 0;
+static uint32_t s_window_start_ms = 0;
+static uint32_t s_window_bytes = 0;
+
+static inline uint8_t *block_ptr(int idx) {
+  return s_pool + (size_t)idx * SD_LOG_BLOCK_BYTES;
+}
+
+/* ─── Collector: sensor ring -> RAM blocks ─── */
+static void block_seal(void) {
+  if (s_cur < 0) return;
+  sdlog_block_hdr_t *h = (sdlog_block_hdr_t *)block_ptr(s_cur);
+  size_t used = sizeof(*h) + h->payload_len;
+  memset(block_ptr(s_cur) + used, 0xFF, SD_LOG_BLOCK_BYTES - used);
+  s_sealed_samples += h->count;
+  s_sealed_blocks++;
+  uint16_t ratio = (uint16_t)(s_sealed_samples * sizeof(SdLogRecordV1) * 100 /
+                              ((uint64_t)s_sealed_blocks * SD_LOG_BLOCK_BYTES));
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.ratio_x100 = ratio;
+  portEXIT_CRITICAL(&s_stats_mux);
+  uint8_t idx = (uint8_t)s_cur;
+  xQueueSend(s_full_q, &idx, 0);  /* sized for the whole pool: never full */
+  s_cur = -1;
+}
+
+/* The first sample of a block is its keyframe, stored absolute in the header */
+static bool block_open(uint32_t seq, const SampleCodecPoint *key) {
+  uint8_t idx;
+  if (xQueueReceive(s_free_q, &idx, 0) != pdTRUE) return false;
+  s_cur = idx;
+  sdlog_block_hdr_t *h = (sdlog_block_hdr_t *)block_ptr(s_cur);
+  memset(h, 0, sizeof(*h));
+  h->first_seq = seq;
+  h->op_time_s = SessionStatsNow();
+  h->count = 1;
+  h->key_t_ms = key->t_ms;
+  h->key_v = key->v;
+  h->key_i = key->i;
+  s_prev = *key;
+  uint8_t in_use = (uint8_t)(SD_LOG_BLOCKS - uxQueueMessagesWaiting(s_free_q));
+  portENTER_CRITICAL(&s_stats_mux);
+  if (in_use > s_stats.blocks_hwm) s_stats.blocks_hwm = in_use;
+  portEXIT_CRITICAL(&s_stats_mux);
+  return true;
+}
+
+/* False when the pool is exhausted (the card is behind): the sample is dropped */
+static bool block_append(const SensorSample *smp, uint32_t seq) {
+  SampleCodecPoint p = {smp->t_ms, SampleCodecQuantise(smp->voltage, SD_LOG_V_LSB_UV),
+                        SampleCodecQuantise(smp->current, SD_LOG_I_LSB_UA)};
+  if (s_cur >= 0) {
+    sdlog_block_hdr_t *h = (sdlog_block_hdr_t *)block_ptr(s_cur);
+    if (h->payload_len + SAMPLE_CODEC_MAX_RECORD <= SDLOG_PAYLOAD_BYTES) {
+      uint8_t *dst = block_ptr(s_cur) + sizeof(*h) + h->payload_len;
+      h->payload_len += (uint16_t)SampleCodecEncode(&s_prev, &p, dst);
+      h->count++;
+      s_prev = p;
+      return true;
+    }
+    block_seal();
+  }
+  return block_open(seq, &p);
+}
+
+static void collector_task(void *arg) {
+  (void)arg;
+  s_seq = SensorRingHead();
+  TickType_t wake = xTaskGetTickCount();
+  SensorSample chunk[32];
+  for (;;) {
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(SD_LOG_POLL_MS));
+    for (;;) {
+      uint32_t before = s_seq;
+      uint32_t got = SensorRingRead(&s_seq, chunk, 32);
+      uint32_t lost = (s_seq - before) - got;
+      if (lost) {
+        /* Overrun: records in a block must be consecutive from first_seq */
+        block_seal();
+        portENTER_CRITICAL(&s_stats_mux);
+        s_stats.samples_dropped += lost;
+        portEXIT_CRITICAL(&s_stats_mux);
+      }
+      if (got == 0) break;
+      uint32_t seq0 = s_seq - got;
+      uint32_t kept = 0;
+      uint32_t t0 = micros();
+      for (uint32_t k = 0; k < got; k++) kept += block_append(&chunk[k], seq0 + k) ? 1 : 0;
+      s_enc_us += micros() - t0;
+      s_enc_samples += got;
+      portENTER_CRITICAL(&s_stats_mux);
+      s_stats.samples_logged += kept;
+      s_stats.samples_dropped += got - kept;
+      s_stats.encode_ns = (uint32_t)(s_enc_us * 1000 / s_enc_samples);
+      portEXIT_CRITICAL(&s_stats_mux);
+    }
+  }
+}
+
+/* ─── Writer: RAM blocks -> card (holds the SPI bus only while writing) ─── */
+/* Lowest and highest file index in /log; returns the number of log files */
+static uint32_t dir_scan(uint32_t *lo, uint32_t *hi) {
+  uint32_t n = 0;
+  *lo = UINT32_MAX;
+  *hi = 0;
+  DIR *d = opendir(SDLOG_DIR);
+  if (!d) return 0;
+  struct dirent *e;
+  while ((e = readdir(d)) != NULL) {
+    char *end = NULL;
+    unsigned long idx = strtoul(e->d_name, &end, 10);
+    if (end == e->d_name || strcasecmp(end, ".BIN") != 0) continue;
+    if (idx < *lo) *lo = (uint32_t)idx;
+    if (idx > *hi) *hi = (uint32_t)idx;
+    n++;
+  }
+  closedir(d);
+  return n;
+}
+
+static void file_path(uint32_t idx, char *buf, size_t len) {
+  snprintf(buf, len, SDLOG_DIR "/%08lu.BIN", (unsigned long)idx);
+}
+
+/* Delete the oldest files (always keeping the newest) until SD_LOG_MIN_FREE_MB is free */
+static void make_room(void) {
+  for (;;) {
+    uint64_t free_b = SD.totalBytes() - SD.usedBytes();
+    if (free_b >= (uint64_t)SD_LOG_MIN_FREE_MB * 1024 * 1024) return;
+    uint32_t lo, hi;
+    if (dir_scan(&lo, &hi) < 2) return;
+    char path[40];
+    file_path(lo, path, sizeof(path));
+    if (unlink(path) != 0) return;
+    Serial.printf("SD log: deleted %s (card full)\n", path);
+  }
+}
+
+static void file_close(void) {
+  if (s_fd < 0) return;
+  ftruncate(s_fd, s_file_bytes);  /* drop the pre-allocated tail */
+  close(s_fd);
+  s_fd = -1;
+}
+
+static bool file_open_next(void) {
+  file_close();
+  make_room();
+  char path[40];
+  file_path(++s_file_index, path, sizeof(path));
+  s_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  s_block_no = 0;
+  s_file_bytes = 0;
+  s_file_alloc = 0;
+  s_file_start_s = SessionStatsNow();
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.file_index = s_file_index;
+  portEXIT_CRITICAL(&s_stats_mux);
+  return s_fd >= 0;
+}
+
+/* FatFs extends the cluster chain when seeking past the end in write mode: allocate a whole step
+ * at once and sync the directory entry, so block writes only ever land in allocated clusters */
+static bool file_reserve(void) {
+  if (s_file_bytes + SD_LOG_BLOCK_BYTES <= s_file_alloc) return true;
+  uint32_t want = s_file_alloc + SD_LOG_PREALLOC_BYTES;
+  if (lseek(s_fd, (off_t)want - 1, SEEK_SET) < 0 || write(s_fd, "", 1) != 1) return false;
+  fsync(s_fd);
+  if (lseek(s_fd, (off_t)s_file_bytes, SEEK_SET) < 0) return false;
+  s_file_alloc = want;
+  return true;
+}
+
+static bool block_write(uint8_t *blk) {
+  if (s_fd < 0 || SessionStatsNow() - s_file_start_s >= SD_LOG_ROTATE_S) {
+    if (!file_open_next()) return false;
+  }
+  if (!file_reserve()) return false;
+  sdlog_block_hdr_t *h = (sdlog_block_hdr_t *)blk;
+  h->magic = SDLOG_MAGIC;
+  h->version = SDLOG_VERSION;
+  h->file_index = s_file_index;
+  h->block_no = s_block_no;
+  h->v_lsb_uv = SD_LOG_V_LSB_UV;
+  h->i_lsb_ua = SD_LOG_I_LSB_UA;
+  h->reserved = 0xFFFF;
+  uint32_t crc = Crc32(h, offsetof(sdlog_block_hdr_t, crc));
+  h->crc = Crc32Update(crc, blk + sizeof(*h), h->payload_len);
+  if (write(s_fd, blk, SD_LOG_BLOCK_BYTES) != SD_LOG_BLOCK_BYTES) return false;
+  s_block_no++;
+  s_file_bytes += SD_LOG_BLOCK_BYTES;
+  return true;
+}
+
+static void report(uint32_t now) {
+  uint32_t span = now - s_window_start_ms;
+  if (span < SDLOG_WINDOW_MS) return;
+  SdLogStats st;
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.rate_Bps = span ? (uint32_t)((uint64_t)s_window_bytes * 1000 / span) : 0;
+  st = s_stats;
+  portEXIT_CRITICAL(&s_stats_mux);
+  s_window_bytes = 0;
+  s_window_start_ms = now;
+#if SD_LOG_REPORT_MS > 0
+  Serial.printf("SD log: file %lu, %lu B/s, write max %lu us (last %lu), buffer peak %u/%u blocks, "
+                "%lu logged, %lu dropped, %lu errors, encode %lu ns/sample, ratio %u.%02ux\n",
+                (unsigned long)st.file_index, (unsigned long)st.rate_Bps, (unsigned long)st.write_us_max,
+                (unsigned long)st.write_us_last, st.blocks_hwm, st.blocks_total,
+                (unsigned long)st.samples_logged, (unsigned long)st.samples_dropped,
+                (unsigned long)st.write_errors, (unsigned long)st.encode_ns, st.ratio_x100 / 100,
+                st.ratio_x100 % 100);
+#else
+  (void)st;
+#endif
+}
+
+static void writer_task(void *arg) {
+  (void)arg;
+  s_window_start_ms = millis();
+  for (;;) {
+    uint8_t idx;
+    if (xQueueReceive(s_full_q, &idx, pdMS_TO_TICKS(1000)) == pdTRUE) {
+      SpiBusAcquire(SPI_BUS_SD, UINT32_MAX);
+      uint32_t t0 = micros();
+      bool ok = block_write(block_ptr(idx));
+      uint32_t dt = micros() - t0;
+      if (!ok) file_close();  /* card pulled or full: retry with a fresh file next time */
+      SpiBusRelease();
+      xQueueSend(s_free_q, &idx, 0);
+
+      portENTER_CRITICAL(&s_stats_mux);
+      s_stats.write_us_last = dt;
+      if (dt > s_stats.write_us_max) s_stats.write_us_max = dt;
+      if (ok) s_stats.bytes_written += SD_LOG_BLOCK_BYTES;
+      else s_stats.write_errors++;
+      portEXIT_CRITICAL(&s_stats_mux);
+      if (ok) s_window_bytes += SD_LOG_BLOCK_BYTES;
+    }
+    report(millis());
+  }
+}
+
+bool SdLogInit(void *spi_instance) {
+  SPIClass *spi = (SPIClass *)spi_instance;
+  if (!spi || s_pool) return false;
+  SpiBusSetPins(SPI_BUS_SD, SD_SCK_PIN, SD_MISO_PIN, SD_MOSI_PIN);
+  if (!SpiBusAcquire(SPI_BUS_SD, 1000)) return false;
+  bool ok = SD.begin(SD_CS_PIN, *spi, SD_SPI_HZ, SDLOG_MOUNT, 2);
+  if (ok && SD.cardType() == CARD_NONE) {
+    SD.end();
+    ok = false;
+  }
+  if (ok) {
+    mkdir(SDLOG_DIR, 0755);
+    uint32_t lo, hi;
+    if (dir_scan(&lo, &hi)) s_file_index = hi;  /* next file continues the numbering */
+  }
+  SpiBusRelease();
+  if (!ok) return false;
+
+  s_pool = (uint8_t *)malloc((size_t)SD_LOG_BLOCKS * SD_LOG_BLOCK_BYTES);
+  s_free_q = xQueueCreate(SD_LOG_BLOCKS, sizeof(uint8_t));
+  s_full_q = xQueueCreate(SD_LOG_BLOCKS, sizeof(uint8_t));
+  if (!s_pool || !s_free_q || !s_full_q) {
+    Serial.println("SD log: out of memory");
+    return false;
+  }
+  for (uint8_t k = 0; k < SD_LOG_BLOCKS; k++) xQueueSend(s_free_q, &k, 0);
+  s_stats.mounted = true;
+  s_stats.blocks_total = SD_LOG_BLOCKS;
+  s_stats.file_index = s_file_index;
+
+  /* Writer below the collector: a stalled write must never hold up draining the ring */
+  xTaskCreatePinnedToCore(collector_task, "sdcol", 3072, NULL, 2, NULL, 1);
+  xTaskCreatePinnedToCore(writer_task, "sdwr", 4096, NULL, 1, NULL, 1);
+  Serial.printf("SD log: card %llu MB, next file %lu, %u x %u B buffer\n",
+                (unsigned long long)(SD.cardSize() / (1024 * 1024)), (unsigned long)(s_file_index + 1),
+                (unsigned)SD_LOG_BLOCKS, (unsigned)SD_LOG_BLOCK_BYTES);
+  return true;
+}
+
+bool SdLogIsReady(void) {
+  return s_stats.mounted;
+}
+
+void SdLogGetStats(SdLogStats *out) {
+  if (!out) return;
+  portENTER_CRITICAL(&s_stats_mux);
+  *out = s_stats;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+void SdLogGetInfo(char *buf, size_t len) {
+  if (!buf || !len) return;
+  SdLogStats st;
+  SdLogGetStats(&st);
+  if (!st.mounted) {
+    snprintf(buf, len, "no card");
+    return;
+  }
+  snprintf(buf, len, "file %lu, %lu B/s, %u.%ux, max %lu ms, buf %u/%u%s", (unsigned long)st.file_index,
+           (unsigned long)st.rate_Bps, st.ratio_x100 / 100, (st.ratio_x100 % 100) / 10,
+           (unsigned long)(st.write_us_max / 1000), st.blocks_hwm, st.blocks_total,
+           st.samples_dropped ? ", drops" : "");
+}
@@ -4,7 +4,13 @@
  */
 #include "sensor.h"
 #include "sensor_backend.h"
+#include "session_stats.h"
 #include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <math.h>
+#include <string.h>
 
 /* INA device ID registers (TI standard) */
 #define INA228_REG_MFG_ID  0x3E
@@ -29,6 +35,111 @@ typedef enum {
 
 static sensor_backend_id_t s_backend = SENSOR_NONE;
 
+/* I2C transactions are issued from the LVGL task (UI sampling) and the loop task (telemetry).
+ * A recursive mutex keeps each register access sequence atomic on the bus. */
+static SemaphoreHandle_t s_bus_lock = NULL;
+
+struct SensorBusGuard {
+  SensorBusGuard()  { if (s_bus_lock) xSemaphoreTakeRecursive(s_bus_lock, portMAX_DELAY); }
+  ~SensorBusGuard() { if (s_bus_lock) xSemaphoreGiveRecursive(s_bus_lock); }
+};
+
+/* ─── Per-consumer windows, fed by the sampler task ─── */
+#define SENSOR_CONNECT_CHECK_MS 1000  /* isConnected() is an extra bus transaction; not per sample */
+
+typedef struct {
+  double sum;
+  double sumsq;
+  float  min;
+  float  max;
+} sensor_acc_t;
+
+typedef struct {
+  uint32_t     n;
+  uint32_t     first_ms;
+  uint32_t     last_ms;
+  sensor_acc_t v, i, p;
+} sensor_window_acc_t;
+
+static sensor_window_acc_t s_windows[SENSOR_CONSUMER_COUNT];
+static portMUX_TYPE        s_win_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t        s_sampler = NULL;
+static uint32_t            s_rate = 0;
+
+static SensorSample        s_ring[SENSOR_RING_SIZE];
+static uint32_t            s_ring_head = 0;  /* published with release order after the slot is written */
+
+static void acc_add(sensor_acc_t *a, float x, bool first) {
+  if (first) {
+    a->sum = a->sumsq = 0.0;
+    a->min = a->max = x;
+  }
+  a->sum += x;
+  a->sumsq += (double)x * x;
+  if (x < a->min) a->min = x;
+  if (x > a->max) a->max = x;
+}
+
+static void acc_result(const sensor_acc_t *a, uint32_t n, SensorAggregate *out) {
+  out->mean = (float)(a->sum / n);
+  out->min = a->min;
+  out->max = a->max;
+  out->rms = (float)sqrt(a->sumsq / n);
+}
+
+static void sampler_task(void *arg) {
+  (void)arg;
+  TickType_t wake = xTaskGetTickCount();
+  uint32_t next_check_ms = millis();
+  uint32_t rate_start_ms = next_check_ms;
+  uint32_t rate_count = 0;
+  bool connected = false;
+  for (;;) {
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(SENSOR_SAMPLE_PERIOD_MS));
+    uint32_t now = millis();
+    if ((int32_t)(now - next_check_ms) >= 0) {
+      connected = SensorIsConnected();
+      next_check_ms = now + SENSOR_CONNECT_CHECK_MS;
+    }
+    if (now - rate_start_ms >= 1000) {
+      s_rate = rate_count;
+      rate_count = 0;
+      rate_start_ms = now;
+    }
+    if (!connected) continue;
+
+    float v, i;
+    {
+      SensorBusGuard guard;  /* keep the V/I pair back to back on the bus */
+      v = SensorGetBusVoltage();
+      i = SensorGetCurrent();
+    }
+    float p = v * i;
+    rate_count++;
+
+    uint32_t head = s_ring_head;
+    SensorSample *slot = &s_ring[head & (SENSOR_RING_SIZE - 1)];
+    slot->t_ms = now;
+    slot->voltage = v;
+    slot->current = i;
+    __atomic_store_n(&s_ring_head, head + 1, __ATOMIC_RELEASE);
+
+    portENTER_CRITICAL(&s_win_mux);
+    for (int c = 0; c < SENSOR_CONSUMER_COUNT; c++) {
+      sensor_window_acc_t *w = &s_windows[c];
+      bool first = w->n == 0;
+      if (first) w->first_ms = now;
+      w->last_ms = now;
+      acc_add(&w->v, v, first);
+      acc_add(&w->i, i, first);
+      acc_add(&w->p, p, first);
+      w->n++;
+    }
+    portEXIT_CRITICAL(&s_win_mux);
+    SessionStatsPush(v, i, p);  /* O(1); every sample, so one-sample extremes reach the statistics */
+  }
+}
+
 static uint16_t readRegister(uint8_t addr, uint8_t reg) {
   Wire.beginTransmission(addr);
   Wire.write(reg);
@@ -96,6 +207,8 @@ static bool looksLikeINA219(uint8_t addr) {
 }
 
 bool SensorBegin(void) {
+  if (!s_bus_lock) s_bus_lock = xSemaphoreCreateRecursiveMutex();
+  SensorBusGuard guard;
   s_backend = SENSOR_NONE;
   for (uint8_t addr = INA_ADDR_MIN; addr <= INA_ADDR_MAX; addr++) {
     if (probeINA228(addr)) {
@@ -121,6 +234,7 @@ bool SensorBegin(void) {
 }
 
 float SensorGetCurrent(void) {
+  SensorBusGuard guard;
   switch (s_backend) {
     case SENSOR_INA228: return INA228_GetCurrent();
     case SENSOR_INA226: return INA226_GetCurrent();
@@ -130,6 +244,7 @@ float SensorGetCurrent(void) {
 }
 
 float SensorGetBusVoltage(void) {
+  SensorBusGuard guard;
   switch (s_backend) {
     case SENSOR_INA228: return INA228_GetBusVoltage();
     case SENSOR_INA226: return INA226_GetBusVoltage();
@@ -139,6 +254,7 @@ float SensorGetBusVoltage(void) {
 }
 
 float SensorGetPower(void) {
+  SensorBusGuard guard;
   switch (s_backend) {
     case SENSOR_INA228: return INA228_GetPower();
     case SENSOR_INA226: return INA226_GetPower();
@@ -148,6 +264,7 @@ float SensorGetPower(void) {
 }
 
 double SensorGetWattHour(void) {
+  SensorBusGuard guard;
   switch (s_backend) {
     case SENSOR_INA228: return INA228_GetWattHour();
     case SENSOR_INA226: return INA226_GetWattHour();
@@ -157,6 +274,7 @@ double SensorGetWattHour(void) {
 }
 
 float SensorGetTemperature(void) {
+  SensorBusGuard guard;
   switch (s_backend) {
     case SENSOR_INA228: return INA228_GetTemperature();
     case SENSOR_INA226: return INA226_GetTemperature();
@@ -166,6 +284,7 @@ float SensorGetTemperature(void) {
 }
 
 bool SensorIsConnected(void) {
+  SensorBusGuard guard;
   switch (s_backend) {
     case SENSOR_INA228: return INA228_IsConnected();
     case SENSOR_INA226: return INA226_IsConnected();
@@ -175,6 +294,7 @@ bool SensorIsConnected(void) {
 }
 
 int SensorSetShunt(float maxCurrent_A, float shuntResistance_Ohm) {
+  SensorBusGuard guard;
   switch (s_backend) {
     case SENSOR_INA228: return INA228_SetShunt(maxCurrent_A, shuntResistance_Ohm);
     case SENSOR_INA226: return INA226_SetShunt(maxCurrent_A, shuntResistance_Ohm);
@@ -184,6 +304,7 @@ int SensorSetShunt(float maxCurrent_A, float shuntResistance_Ohm) {
 }
 
 void SensorResetEnergy(void) {
+  SensorBusGuard guard;
   switch (s_backend) {
     case SENSOR_INA228: INA228_ResetEnergy(); break;
     case SENSOR_INA226: INA226_ResetEnergy(); break;
@@ -193,6 +314,7 @@ void SensorResetEnergy(void) {
 }
 
 void SensorCycleAveraging(void) {
+  SensorBusGuard guard;
   switch (s_backend) {
     case SENSOR_INA228: INA228_CycleAveraging(); break;
     case SENSOR_INA226: INA226_CycleAveraging(); break;
@@ -201,7 +323,18 @@ void SensorCycleAveraging(void) {
   }
 }
 
+bool SensorSetAveraging(uint16_t samples) {
+  SensorBusGuard guard;
+  switch (s_backend) {
+    case SENSOR_INA228: return INA228_SetAveraging(samples);
+    case SENSOR_INA226: return INA226_SetAveraging(samples);
+    case SENSOR_INA219: return INA219_SetAveraging(samples);
+    default: return false;
+  }
+}
+
 const char *SensorGetAveragingString(void) {
+  SensorBusGuard guard;
   switch (s_backend) {
     case SENSOR_INA228: return INA228_GetAveragingString();
     case SENSOR_INA226: return INA226_GetAveragingString();
@@ -211,6 +344,7 @@ const char *SensorGetAveragingString(void) {
 }
 
 const char *SensorGetDriverName(void) {
+  SensorBusGuard guard;
   switch (s_backend) {
     case SENSOR_INA228: return INA228_GetDriverName();
     case SENSOR_INA226: return INA226_GetDriverName();
@@ -218,3 +352,55 @@ const char *SensorGetDriverName(void) {
     default: return "INA?";
   }
 }
+
+void SensorSamplerStart(void) {
+  if (s_sampler || s_backend == SENSOR_NONE) return;
+  xTaskCreatePinnedToCore(sampler_task, "sensor", 3072, NULL, SENSOR_SAMPLER_PRIO, &s_sampler,
+                          SENSOR_SAMPLER_CORE);
+}
+
+bool SensorReadWindow(SensorConsumer consumer, SensorWindow *out) {
+  if (!out || consumer >= SENSOR_CONSUMER_COUNT) return false;
+  sensor_window_acc_t w;
+  portENTER_CRITICAL(&s_win_mux);
+  w = s_windows[consumer];
+  s_windows[consumer].n = 0;
+  portEXIT_CRITICAL(&s_win_mux);
+  if (w.n == 0) return false;
+  out->n = w.n;
+  out->span_ms = w.last_ms - w.first_ms;
+  acc_result(&w.v, w.n, &out->voltage);
+  acc_result(&w.i, w.n, &out->current);
+  acc_result(&w.p, w.n, &out->power);
+  return true;
+}
+
+uint32_t SensorSampleRate(void) {
+  return s_sampler ? s_rate : 0;
+}
+
+uint32_t SensorRingHead(void) {
+  return __atomic_load_n(&s_ring_head, __ATOMIC_ACQUIRE);
+}
+
+uint32_t SensorRingRead(uint32_t *seq, SensorSample *out, uint32_t max) {
+  if (!seq || !out) return 0;
+  uint32_t head = __atomic_load_n(&s_ring_head, __ATOMIC_ACQUIRE);
+  /* Keep one slot of slack: the producer may be writing head & mask while we copy */
+  if (head - *seq > SENSOR_RING_SIZE - 1) *seq = head - (SENSOR_RING_SIZE - 1);
+  uint32_t n = head - *seq;
+  if (n > max) n = max;
+  for (uint32_t k = 0; k < n; k++) out[k] = s_ring[(*seq + k) & (SENSOR_RING_SIZE - 1)];
+  /* Anything the producer lapped during the copy is stale: drop it from the front */
+  uint32_t after = __atomic_load_n(&s_ring_head, __ATOMIC_ACQUIRE);
+  uint32_t oldest_ok = after - (SENSOR_RING_SIZE - 1);
+  uint32_t skip = 0;
+  if ((int32_t)(oldest_ok - *seq) > 0) skip = oldest_ok - *seq;
+  if (skip >= n) {
+    *seq = oldest_ok;
+    return 0;
+  }
+  if (skip) memmove(out, out + skip, (n - skip) * sizeof(SensorSample));
+  *seq += n;
+  return n - skip;
+}
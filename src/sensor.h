@@ -4,12 +4,24 @@
  * Auto-detection: INA228, INA226, INA219 are probed on I2C 0x40–0x4F via device ID
  * (INA228/INA226) or begin() (INA219). First match wins. Backends: sensor_ina228.cpp,
  * sensor_ina226.cpp, sensor_ina219.cpp; dispatcher: sensor.cpp.
+ *
+ * Point readings (SensorGet*) sample the chip once per call. For V/I/P, consumers that poll slowly
+ * should use SensorReadWindow() instead: a sampler task reads the sensor at a fixed rate and folds
+ * every sample into one window per consumer, so spikes between reads are not lost.
  */
 #ifndef SENSOR_H
 #define SENSOR_H
 
 #include <Arduino.h>
 
+/* Sensor I2C bus (CYD CN1 connector) */
+#ifndef I2C_SDA
+#define I2C_SDA 22
+#endif
+#ifndef I2C_SCL
+#define I2C_SCL 27
+#endif
+
 /** Call once after Wire.begin(). Returns false if sensor not found. */
 bool SensorBegin(void);
 
@@ -29,9 +41,83 @@ void SensorResetEnergy(void);
 
 /** Averaging: cycle to next profile; string for UI. */
 void        SensorCycleAveraging(void);
+/** Averaging by sample count: INA228/INA226 1, 4, 16, 64..1024; INA219 1..16 at 12 bit. False if not offered. */
+bool        SensorSetAveraging(uint16_t samples);
 const char *SensorGetAveragingString(void);
 
 /** Short name for status line, e.g. "INA228". */
 const char *SensorGetDriverName(void);
 
+/* ─── Full-rate sampling, aggregated per consumer ─── */
+
+/** Sampler period. Reads faster than the chip's averaging time repeat a conversion, which only
+ *  weights the mean, so this is a ceiling, not the effective bandwidth. */
+#ifndef SENSOR_SAMPLE_PERIOD_MS
+#define SENSOR_SAMPLE_PERIOD_MS 10
+#endif
+#ifndef SENSOR_SAMPLER_CORE
+#define SENSOR_SAMPLER_CORE 1
+#endif
+#ifndef SENSOR_SAMPLER_PRIO
+#define SENSOR_SAMPLER_PRIO 3
+#endif
+
+/** One window per reader; each read returns everything since that reader's previous read. */
+typedef enum {
+  SENSOR_CONSUMER_UI = 0,
+  SENSOR_CONSUMER_TELEMETRY,
+  SENSOR_CONSUMER_MQTT,
+  SENSOR_CONSUMER_INFLUX,
+  SENSOR_CONSUMER_COUNT
+} SensorConsumer;
+
+typedef struct {
+  float mean;
+  float min;
+  float max;
+  float rms;
+} SensorAggregate;
+
+typedef struct {
+  uint32_t        n;        /* samples in the window */
+  uint32_t        span_ms;  /* first to last sample */
+  SensorAggregate voltage;
+  SensorAggregate current;
+  SensorAggregate power;    /* per-sample V*I (signed like current): mean is true average power */
+} SensorWindow;
+
+/** Start the sampler task. Call once after SensorBegin() succeeded. */
+void SensorSamplerStart(void);
+
+/** Take and clear this consumer's window. Returns false (out untouched) if it holds no samples,
+ *  e.g. no sampler or sensor disconnected: fall back to point readings then. */
+bool SensorReadWindow(SensorConsumer consumer, SensorWindow *out);
+
+/** Samples taken per second over the last second (0 if the sampler is not running). */
+uint32_t SensorSampleRate(void);
+
+/* ─── Raw sample ring: single producer (the sampler); lock-free readers each keep their own
+ *     sequence number (scope, SD logger) ─── */
+
+/** Power of two. At the default rate this is about 10 s of history. */
+#ifndef SENSOR_RING_SIZE
+#define SENSOR_RING_SIZE 1024
+#endif
+
+typedef struct {
+  uint32_t t_ms;  /* millis() when taken */
+  float    voltage;
+  float    current;
+} SensorSample;
+
+/** Sequence number the next sample will get (total samples written since boot). */
+uint32_t SensorRingHead(void);
+
+/**
+ * Copy up to max samples starting at *seq and advance *seq past them. If the reader fell more
+ * than SENSOR_RING_SIZE behind, the overwritten samples are skipped (*seq jumps forward).
+ * Returns the number of samples copied. Samples are SENSOR_SAMPLE_PERIOD_MS apart.
+ */
+uint32_t SensorRingRead(uint32_t *seq, SensorSample *out, uint32_t max);
+
 #endif /* SENSOR_H */
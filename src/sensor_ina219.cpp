@@ -54,6 +54,20 @@ void INA219_CycleAveraging(void) {
   s_ina219->setBusADC(adc[s_averaging]);
 }
 
+bool INA219_SetAveraging(uint16_t samples) {
+  /* Profiles 3..7 of the cycle: 12 bit with 1, 2, 4, 8, 16 samples (9..11 bit only via the cycle) */
+  static const uint16_t counts[] = { 1, 2, 4, 8, 16 };
+  if (!s_ina219) return false;
+  for (uint8_t k = 0; k < sizeof(counts) / sizeof(counts[0]); k++) {
+    if (counts[k] != samples) continue;
+    s_averaging = (uint8_t)(3 + k);
+    s_ina219->setShuntADC(s_averaging);
+    s_ina219->setBusADC(s_averaging);
+    return true;
+  }
+  return false;
+}
+
 const char *INA219_GetAveragingString(void) {
   static const char *str[] = { "9b 1s", "10b 1s", "11b 1s", "12b 1s", "12b 2s", "12b 4s", "12b 8s", "12b 16s" };
   return str[s_averaging % 8];
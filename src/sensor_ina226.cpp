@@ -64,6 +64,20 @@ void INA226_CycleAveraging(void) {
   s_ina226->setAverage(s_averaging);
 }
 
+bool INA226_SetAveraging(uint16_t samples) {
+  static const uint16_t counts[] = { 1, 4, 16, 64, 128, 256, 512, 1024 };
+  static const uint8_t modes[] = { INA226_1_SAMPLE, INA226_4_SAMPLES, INA226_16_SAMPLES, INA226_64_SAMPLES,
+                                   INA226_128_SAMPLES, INA226_256_SAMPLES, INA226_512_SAMPLES, INA226_1024_SAMPLES };
+  if (!s_ina226) return false;
+  for (size_t k = 0; k < sizeof(counts) / sizeof(counts[0]); k++) {
+    if (counts[k] != samples) continue;
+    s_averaging = modes[k];
+    s_ina226->setAverage(s_averaging);
+    return true;
+  }
+  return false;
+}
+
 const char *INA226_GetAveragingString(void) {
   switch (s_averaging) {
     case INA226_1_SAMPLE:     return "1 Sample";
@@ -68,6 +68,20 @@ void INA228_CycleAveraging(void) {
   s_ina228->setAverage(s_averaging);
 }
 
+bool INA228_SetAveraging(uint16_t samples) {
+  static const uint16_t counts[] = { 1, 4, 16, 64, 128, 256, 512, 1024 };
+  static const uint8_t modes[] = { INA228_1_SAMPLE, INA228_4_SAMPLES, INA228_16_SAMPLES, INA228_64_SAMPLES,
+                                   INA228_128_SAMPLES, INA228_256_SAMPLES, INA228_512_SAMPLES, INA228_1024_SAMPLES };
+  if (!s_ina228) return false;
+  for (size_t k = 0; k < sizeof(counts) / sizeof(counts[0]); k++) {
+    if (counts[k] != samples) continue;
+    s_averaging = modes[k];
+    s_ina228->setAverage(s_averaging);
+    return true;
+  }
+  return false;
+}
+
 const char *INA228_GetAveragingString(void) {
   switch (s_averaging) {
     case INA228_1_SAMPLE:     return "1 Sample";
@@ -0,0 +1,146 @@
+/**
+ * @file session_stats.cpp
+ * Session/lifetime running statistics (see session_stats.h).
+ */
+#include "session_stats.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <math.h>
+#include <string.h>
+
+#define STATS_NVS_NAMESPACE "cyd_stats"
+#define STATS_NVS_KEY       "life_v1"   /* bump when SessionStats changes layout */
+#define STATS_MAX_GAP_MS    2000        /* longer gaps (stalls, first sample) are not integrated */
+
+typedef struct {
+  SessionStats life;
+  uint64_t     runtime_ms;
+} stats_blob_t;
+
+static SessionStats s_stats[STATS_SCOPE_COUNT];
+static uint64_t     s_runtime_ms = 0;   /* operating time, lifetime */
+static uint32_t     s_last_ms = 0;
+static bool         s_have_last = false;
+static uint32_t     s_next_save_s = STATS_SAVE_PERIOD_S;
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void scope_clear(SessionStats *st, uint32_t now_s) {
+  memset(st, 0, sizeof(*st));
+  st->start_t_s = now_s;
+}
+
+static void channel_push(StatsChannel *ch, float x, uint32_t now_s) {
+  ch->n++;
+  double d = (double)x - ch->mean;
+  ch->mean += d / ch->n;
+  ch->m2 += d * ((double)x - ch->mean);
+  if (ch->n == 1 || x < ch->min) { ch->min = x; ch->min_t_s = now_s; }
+  if (ch->n == 1 || x > ch->max) { ch->max = x; ch->max_t_s = now_s; }
+}
+
+static void scope_push(SessionStats *st, float v, float i, float p, uint32_t dt_ms, uint32_t now_s) {
+  channel_push(&st->voltage, v, now_s);
+  channel_push(&st->current, i, now_s);
+  channel_push(&st->power, p, now_s);
+  if (fabsf(p) > st->peak_power_W) {
+    st->peak_power_W = fabsf(p);
+    st->peak_power_t_s = now_s;
+  }
+  double ah = (double)i * dt_ms / 3600000.0;
+  if (i > STATS_IDLE_A) {
+    st->ah_in += ah;
+    st->charge_ms += dt_ms;
+  } else if (i < -STATS_IDLE_A) {
+    st->ah_out -= ah;
+    st->discharge_ms += dt_ms;
+  } else {
+    st->idle_ms += dt_ms;
+  }
+}
+
+void SessionStatsInit(void) {
+  Preferences prefs;
+  stats_blob_t blob;
+  bool loaded = false;
+  if (prefs.begin(STATS_NVS_NAMESPACE, true)) {
+    loaded = prefs.getBytesLength(STATS_NVS_KEY) == sizeof(blob) &&
+             prefs.getBytes(STATS_NVS_KEY, &blob, sizeof(blob)) == sizeof(blob);
+    prefs.end();
+  }
+  portENTER_CRITICAL(&s_mux);
+  if (loaded) {
+    s_stats[STATS_LIFETIME] = blob.life;
+    s_runtime_ms = blob.runtime_ms;
+  } else {
+    scope_clear(&s_stats[STATS_LIFETIME], 0);
+  }
+  uint32_t now_s = (uint32_t)(s_runtime_ms / 1000);
+  scope_clear(&s_stats[STATS_SESSION], now_s);
+  s_next_save_s = now_s + STATS_SAVE_PERIOD_S;
+  portEXIT_CRITICAL(&s_mux);
+  Serial.printf("Stats: lifetime %s, %lu h operating\n", loaded ? "loaded" : "new",
+                (unsigned long)(now_s / 3600));
+}
+
+void SessionStatsPush(float voltage_V, float current_A, float power_W) {
+  if (isnan(voltage_V) || isnan(current_A) || isnan(power_W)) return;
+  uint32_t now_ms = millis();
+  uint32_t dt_ms = s_have_last ? now_ms - s_last_ms : 0;
+  if (dt_ms > STATS_MAX_GAP_MS) dt_ms = 0;
+  s_last_ms = now_ms;
+  s_have_last = true;
+
+  portENTER_CRITICAL(&s_mux);
+  s_runtime_ms += dt_ms;
+  uint32_t now_s = (uint32_t)(s_runtime_ms / 1000);
+  for (int k = 0; k < STATS_SCOPE_COUNT; k++) scope_push(&s_stats[k], voltage_V, current_A, power_W, dt_ms, now_s);
+  portEXIT_CRITICAL(&s_mux);
+}
+
+void SessionStatsPoll(void) {
+  portENTER_CRITICAL(&s_mux);
+  bool save = s_runtime_ms / 1000 >= s_next_save_s;
+  portEXIT_CRITICAL(&s_mux);
+  if (save) SessionStatsSave();
+}
+
+void SessionStatsGet(StatsScope scope, SessionStats *out) {
+  if (!out || scope >= STATS_SCOPE_COUNT) return;
+  portENTER_CRITICAL(&s_mux);
+  *out = s_stats[scope];
+  portEXIT_CRITICAL(&s_mux);
+}
+
+void SessionStatsReset(StatsScope scope) {
+  if (scope >= STATS_SCOPE_COUNT) return;
+  portENTER_CRITICAL(&s_mux);
+  scope_clear(&s_stats[scope], (uint32_t)(s_runtime_ms / 1000));
+  portEXIT_CRITICAL(&s_mux);
+  if (scope == STATS_LIFETIME) SessionStatsSave();
+}
+
+uint32_t SessionStatsNow(void) {
+  portENTER_CRITICAL(&s_mux);
+  uint32_t now_s = (uint32_t)(s_runtime_ms / 1000);
+  portEXIT_CRITICAL(&s_mux);
+  return now_s;
+}
+
+float SessionStatsStdDev(const StatsChannel *ch) {
+  if (!ch || ch->n < 2) return 0.f;
+  return (float)sqrt(ch->m2 / (ch->n - 1));
+}
+
+void SessionStatsSave(void) {
+  stats_blob_t blob;
+  portENTER_CRITICAL(&s_mux);
+  blob.life = s_stats[STATS_LIFETIME];
+  blob.runtime_ms = s_runtime_ms;
+  s_next_save_s = (uint32_t)(s_runtime_ms / 1000) + STATS_SAVE_PERIOD_S;
+  portEXIT_CRITICAL(&s_mux);
+
+  Preferences prefs;
+  if (!prefs.begin(STATS_NVS_NAMESPACE, false)) return;
+  prefs.putBytes(STATS_NVS_KEY, &blob, sizeof(blob));
+  prefs.end();
+}
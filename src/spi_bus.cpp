@@ -0,0 +1,57 @@
+/**
+ * @file spi_bus.cpp
+ * Shared VSPI host with per-user pin routing (see spi_bus.h).
+ */
+#include "spi_bus.h"
+#include <Arduino.h>
+#include <SPI.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+typedef struct {
+  int8_t sck, miso, mosi;
+  bool   set;
+} spi_bus_pins_t;
+
+static SPIClass         *s_spi = NULL;
+static SemaphoreHandle_t s_lock = NULL;
+static SpiBusUser        s_routed = SPI_BUS_TOUCH;
+static spi_bus_pins_t    s_pins[SPI_BUS_USER_COUNT];
+static uint32_t          s_switches = 0;
+
+void SpiBusSetPins(SpiBusUser user, int8_t sck, int8_t miso, int8_t mosi) {
+  if (user >= SPI_BUS_USER_COUNT) return;
+  s_pins[user].sck = sck;
+  s_pins[user].miso = miso;
+  s_pins[user].mosi = mosi;
+  s_pins[user].set = true;
+}
+
+void SpiBusInit(void *spi_instance, SpiBusUser owner) {
+  s_spi = (SPIClass *)spi_instance;
+  s_routed = owner;
+  if (!s_lock) s_lock = xSemaphoreCreateMutex();
+}
+
+bool SpiBusAcquire(SpiBusUser user, uint32_t timeout_ms) {
+  if (!s_spi || !s_lock) return true;  /* no arbiter set up: single user */
+  if (user >= SPI_BUS_USER_COUNT) return false;
+  if (xSemaphoreTake(s_lock, timeout_ms ? pdMS_TO_TICKS(timeout_ms) : 0) != pdTRUE) return false;
+  if (user != s_routed && s_pins[user].set) {
+    /* SPIClass::begin() ignores new pins while the bus is up: end() releases the old ones first */
+    const spi_bus_pins_t *p = &s_pins[user];
+    s_spi->end();
+    s_spi->begin(p->sck, p->miso, p->mosi, -1);
+    s_routed = user;
+    s_switches++;
+  }
+  return true;
+}
+
+void SpiBusRelease(void) {
+  if (s_spi && s_lock) xSemaphoreGive(s_lock);
+}
+
+uint32_t SpiBusSwitches(void) {
+  return s_switches;
+}
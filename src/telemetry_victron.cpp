@@ -10,11 +10,6 @@
  */
 static HardwareSerial &VE_UART = Serial1;
 
-// ESP32 Serial1 pins (single source of truth for Integration settings display).
-// CYD / many ESP32 boards: UART1 = RX 16, TX 17. Use -1 for core default.
-static constexpr int VE_UART_RX_PIN = 16;
-static constexpr int VE_UART_TX_PIN = 17;
-
 // This is a SmartShunt 500A (Victron-style product id)
 static const uint16_t PID      = 0xA389;
 // Firmware/App ID as seen by Victron apps (same as reference)
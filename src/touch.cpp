@@ -1,18 +1,42 @@
 /**
  * @file touch.cpp
- * XPT2046 touch mapping using NVS calibration.
- * Main owns SPI/ts; call TouchInit(&ts) after ts.begin() and ts.setRotation(1).
+ * XPT2046 touch: affine calibration mapping and fitting, plus the filtered LVGL read path.
+ * Main owns SPI/ts; call TouchInit(&ts, &spi) after ts.begin() and ts.setRotation(1).
+ *
+ * The LVGL read does no SPI while the pen is up: it checks the PENIRQ line and the edge latched by
+ * the interrupt. With the pen down, each read is one burst: pressure, TOUCH_BURST X/Y pairs, and
+ * pressure again. The burst is median filtered, checked for spread and smoothed with a one-pole IIR.
+ * LVGL always gets the cached point, so a release reports the last good position.
  */
 #include "touch.h"
+#include "spi_bus.h"
 #include <XPT2046_Touchscreen.h>
+#include <SPI.h>
 #include <Arduino.h>
+#include <math.h>
 
 static XPT2046_Touchscreen *s_ts = NULL;
-static TouchCalibration_t s_cal = {0, 0, 0, 0, false};
+static SPIClass *s_spi = NULL;
+static TouchCalibration_t s_cal = {0, 0, 0, 0, 0, 0, false};
 static bool s_diagnostic = false;
 
-void TouchInit(void *ts_instance) {
+/* Filtered state handed to LVGL (LVGL task only) */
+static bool    s_pressed = false;
+static float   s_fx = 0.f, s_fy = 0.f;     /* IIR output, raw units */
+static int16_t s_sx = 0, s_sy = 0;         /* last reported screen point */
+static int16_t s_jx = -1, s_jy = -1;       /* previous single-sample point, for the jitter stat */
+static volatile bool s_irq_latched = false;
+static TouchStats_t s_stats;
+
+static void IRAM_ATTR touch_irq_isr(void) {
+  s_irq_latched = true;
+}
+
+void TouchInit(void *ts_instance, void *spi_instance) {
   s_ts = (XPT2046_Touchscreen *)ts_instance;
+  s_spi = (SPIClass *)spi_instance;
+  pinMode(TOUCH_IRQ_PIN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(TOUCH_IRQ_PIN), touch_irq_isr, FALLING);
 }
 
 void TouchSetCalibration(const TouchCalibration_t *cal) {
@@ -27,68 +51,262 @@ static inline float clampf(float v, float a, float b) {
   return v;
 }
 
+bool TouchGetCalibration(TouchCalibration_t *out) {
+  if (out) *out = s_cal;
+  return s_cal.isValid;
+}
+
+void TouchCalibrationFromBox(int16_t x_min, int16_t x_max, int16_t y_min, int16_t y_max, TouchCalibration_t *out) {
+  if (!out) return;
+  out->isValid = (x_max > x_min) && (y_max > y_min);
+  if (!out->isValid) return;
+  out->a = (float)(TOUCH_DISPLAY_WIDTH - 1) / (float)(x_max - x_min);
+  out->b = 0.f;
+  out->c = -out->a * (float)x_min;
+  out->d = 0.f;
+  out->e = (float)(TOUCH_DISPLAY_HEIGHT - 1) / (float)(y_max - y_min);
+  out->f = -out->e * (float)y_min;
+}
+
+/* Solve the 3x3 system m * x = v by Cramer's rule; false when singular */
+static bool solve3(const double m[3][3], const double v[3], double x[3]) {
+  double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+             - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+             + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+  if (fabs(det) < 1e-9) return false;
+  for (int c = 0; c < 3; c++) {
+    double t[3][3];
+    for (int r = 0; r < 3; r++)
+      for (int k = 0; k < 3; k++) t[r][k] = (k == c) ? v[r] : m[r][k];
+    x[c] = (t[0][0] * (t[1][1] * t[2][2] - t[1][2] * t[2][1])
+          - t[0][1] * (t[1][0] * t[2][2] - t[1][2] * t[2][0])
+          + t[0][2] * (t[1][0] * t[2][1] - t[1][1] * t[2][0])) / det;
+  }
+  return true;
+}
+
+bool TouchCalibrationSolve(const int16_t *raw_x, const int16_t *raw_y, const int16_t *scr_x, const int16_t *scr_y,
+                           int n, TouchCalibration_t *out, float *rms_px) {
+  if (!raw_x || !raw_y || !scr_x || !scr_y || !out || n < 3 || n > TOUCH_CAL_POINTS_MAX) return false;
+
+  /* Normal equations over [rx ry 1], raw centred on its mean so the matrix stays well conditioned */
+  double mx = 0, my = 0;
+  for (int k = 0; k < n; k++) { mx += raw_x[k]; my += raw_y[k]; }
+  mx /= n;
+  my /= n;
+  double m[3][3] = {{0}}, vx[3] = {0}, vy[3] = {0};
+  for (int k = 0; k < n; k++) {
+    double p[3] = {raw_x[k] - mx, raw_y[k] - my, 1.0};
+    for (int r = 0; r < 3; r++) {
+      for (int c = 0; c < 3; c++) m[r][c] += p[r] * p[c];
+      vx[r] += p[r] * scr_x[k];
+      vy[r] += p[r] * scr_y[k];
+    }
+  }
+  double cx[3], cy[3];
+  if (!solve3(m, vx, cx) || !solve3(m, vy, cy)) return false;
+
+  out->a = (float)cx[0];
+  out->b = (float)cx[1];
+  out->c = (float)(cx[2] - cx[0] * mx - cx[1] * my);
+  out->d = (float)cy[0];
+  out->e = (float)cy[1];
+  out->f = (float)(cy[2] - cy[0] * mx - cy[1] * my);
+  out->isValid = true;
+
+  if (rms_px) {
+    double err = 0;
+    for (int k = 0; k < n; k++) {
+      double ex = out->a * raw_x[k] + out->b * raw_y[k] + out->c - scr_x[k];
+      double ey = out->d * raw_x[k] + out->e * raw_y[k] + out->f - scr_y[k];
+      err += ex * ex + ey * ey;
+    }
+    *rms_px = (float)sqrt(err / n);
+  }
+  return true;
+}
+
 void TouchRawToScreen(int16_t raw_x, int16_t raw_y, int16_t *screen_x, int16_t *screen_y) {
   if (!screen_x || !screen_y) return;
 
-  float nx = 0.5f, ny = 0.5f;
-  if (s_cal.isValid && (s_cal.xMax > s_cal.xMin) && (s_cal.yMax > s_cal.yMin)) {
-    nx = (float)(raw_x - s_cal.xMin) / (float)(s_cal.xMax - s_cal.xMin);
-    ny = (float)(raw_y - s_cal.yMin) / (float)(s_cal.yMax - s_cal.yMin);
-    nx = clampf(nx, 0.f, 1.f);
-    ny = clampf(ny, 0.f, 1.f);
+  float sx = (TOUCH_DISPLAY_WIDTH - 1) * 0.5f, sy = (TOUCH_DISPLAY_HEIGHT - 1) * 0.5f;
+  if (s_cal.isValid) {
+    sx = s_cal.a * raw_x + s_cal.b * raw_y + s_cal.c;
+    sy = s_cal.d * raw_x + s_cal.e * raw_y + s_cal.f;
   }
+  sx = clampf(sx + 0.5f, 0.f, (float)(TOUCH_DISPLAY_WIDTH - 1));
+  sy = clampf(sy + 0.5f, 0.f, (float)(TOUCH_DISPLAY_HEIGHT - 1));
+  *screen_x = (int16_t)sx;
+  *screen_y = (int16_t)sy;
+}
 
-  /* Mapping variant: adjust swap/invert here if touch is mirrored or wrong-handed.
-   * Default: x = nx * W, y = ny * H.
-   * Swap:   use ny for x, nx for y.
-   * Invert X: use (1 - nx) for x.
-   * Invert Y: use (1 - ny) for y.
-   */
-  float sx = nx;
-  float sy = ny;
-  /* Example: if X is reversed, use: sx = 1.f - nx; */
-  /* Example: if Y is reversed, use: sy = 1.f - ny; */
-  /* Example: if axes are swapped, use: sx=ny; sy=nx; */
-
-  *screen_x = (int16_t)(sx * (TOUCH_DISPLAY_WIDTH - 1) + 0.5f);
-  *screen_y = (int16_t)(sy * (TOUCH_DISPLAY_HEIGHT - 1) + 0.5f);
-  if (*screen_x < 0) *screen_x = 0;
-  if (*screen_x >= TOUCH_DISPLAY_WIDTH)  *screen_x = TOUCH_DISPLAY_WIDTH - 1;
-  if (*screen_y < 0) *screen_y = 0;
-  if (*screen_y >= TOUCH_DISPLAY_HEIGHT) *screen_y = TOUCH_DISPLAY_HEIGHT - 1;
+bool TouchIrqPending(void) {
+  /* Line low = pen down now; latch = a tap since the last read. No SPI either way */
+  return s_irq_latched || digitalRead(TOUCH_IRQ_PIN) == LOW;
 }
 
 void TouchSetDiagnostic(bool on) {
   s_diagnostic = on;
 }
 
+/* ─── Burst sampling ─── */
+#define XPT_CMD_X   0x91  /* X, ADC kept on between conversions */
+#define XPT_CMD_Y   0xD1
+#define XPT_CMD_Z1  0xB1
+#define XPT_CMD_Z2  0xC1
+#define XPT_CMD_PD  0xD0  /* last conversion: power down with PENIRQ re-enabled */
+
+static inline int16_t xpt_read(uint8_t cmd) {
+  s_spi->transfer(cmd);
+  return (int16_t)(s_spi->transfer16(0) >> 3);
+}
+
+static int16_t xpt_pressure(void) {
+  int16_t z = (int16_t)(xpt_read(XPT_CMD_Z1) + 4095 - xpt_read(XPT_CMD_Z2));
+  return z < 0 ? 0 : z;
+}
+
+static void sort_small(int16_t *v, int n) {
+  for (int i = 1; i < n; i++) {
+    int16_t t = v[i];
+    int j = i - 1;
+    while (j >= 0 && v[j] > t) { v[j + 1] = v[j]; j--; }
+    v[j + 1] = t;
+  }
+}
+
+bool TouchConfirmPress(void) {
+  if (!s_ts || !s_spi) return false;
+  if (!SpiBusAcquire(SPI_BUS_TOUCH, 0)) {  /* latch kept: the caller polls again */
+    s_stats.bus_busy++;
+    return false;
+  }
+  s_irq_latched = false;
+  s_spi->beginTransaction(SPISettings(TOUCH_SPI_HZ, MSBFIRST, SPI_MODE0));
+  digitalWrite(TOUCH_CS_PIN, LOW);
+  int16_t z = xpt_pressure();
+  xpt_read(XPT_CMD_PD);
+  digitalWrite(TOUCH_CS_PIN, HIGH);
+  s_spi->endTransaction();
+  SpiBusRelease();
+  s_stats.wake_checks++;
+  if (z >= TOUCH_Z_PRESS) return true;
+  s_stats.wake_rejected++;
+  return false;
+}
+
+/* One burst. Returns false when the pen is up, lifted mid-burst, or the samples disagree.
+ * x/y are medians in the library's rotation-1 raw space (same as the stored calibration). */
+static bool touch_burst(int16_t *x, int16_t *y, int16_t *x0, int16_t *y0) {
+  int16_t xs[TOUCH_BURST], ys[TOUCH_BURST];
+  int16_t threshold = s_pressed ? TOUCH_Z_RELEASE : TOUCH_Z_PRESS;
+
+  s_spi->beginTransaction(SPISettings(TOUCH_SPI_HZ, MSBFIRST, SPI_MODE0));
+  digitalWrite(TOUCH_CS_PIN, LOW);
+  bool ok = xpt_pressure() >= threshold;
+  if (ok) {
+    xpt_read(XPT_CMD_X);  /* first X after the Z conversions is always noisy */
+    for (int k = 0; k < TOUCH_BURST; k++) {
+      xs[k] = xpt_read(XPT_CMD_X);
+      ys[k] = xpt_read(XPT_CMD_Y);
+    }
+    ok = xpt_pressure() >= threshold;  /* pen lifting during the burst gives skewed points */
+  }
+  xpt_read(XPT_CMD_PD);
+  digitalWrite(TOUCH_CS_PIN, HIGH);
+  s_spi->endTransaction();
+  s_stats.spi_reads++;
+  if (!ok) return false;
+
+  *x0 = xs[0];
+  *y0 = ys[0];
+  sort_small(xs, TOUCH_BURST);
+  sort_small(ys, TOUCH_BURST);
+  /* Spread of the middle samples: wide means a bouncing contact, not a press */
+  if (xs[TOUCH_BURST - 2] - xs[1] > TOUCH_MAX_SPREAD || ys[TOUCH_BURST - 2] - ys[1] > TOUCH_MAX_SPREAD) {
+    s_stats.rejected++;
+    return false;
+  }
+  *x = xs[TOUCH_BURST / 2];
+  *y = ys[TOUCH_BURST / 2];
+  return true;
+}
+
 void TouchGetScreenPoint(int16_t *x, int16_t *y, bool *pressed) {
   if (!x || !y || !pressed) return;
+  *x = s_sx;
+  *y = s_sy;
   *pressed = false;
-  *x = 0;
-  *y = 0;
-  if (!s_ts) return;
+  if (!s_ts || !s_spi) return;
 
-  if (!s_ts->tirqTouched() || !s_ts->touched()) {
+  uint32_t t0 = micros();
+  s_stats.reads++;
+  if (!s_pressed && !s_irq_latched && digitalRead(TOUCH_IRQ_PIN) != LOW) {
+    s_stats.idle_us += micros() - t0;
     return;
   }
+  if (!SpiBusAcquire(SPI_BUS_TOUCH, 0)) {  /* SD card write in progress: keep the last state */
+    s_stats.bus_busy++;
+    *pressed = s_pressed;
+    return;
+  }
+  s_irq_latched = false;
+
+  int16_t mx = 0, my = 0, rx = 0, ry = 0;
+  bool down = touch_burst(&mx, &my, &rx, &ry);
+  SpiBusRelease();
+  if (down) {
+    if (!s_pressed) {
+      s_fx = mx;  /* seed on touch-down: no drag from the previous press */
+      s_fy = my;
+      s_jx = -1;
+      s_stats.presses++;
+    } else {
+      s_fx += TOUCH_IIR_ALPHA * ((float)mx - s_fx);
+      s_fy += TOUCH_IIR_ALPHA * ((float)my - s_fy);
+    }
+    int16_t sx = 0, sy = 0, jx = 0, jy = 0;
+    TouchRawToScreen((int16_t)(s_fx + 0.5f), (int16_t)(s_fy + 0.5f), &sx, &sy);
+    TouchRawToScreen(rx, ry, &jx, &jy);
+    if (s_pressed && s_jx >= 0) {
+      s_stats.held_reads++;
+      s_stats.jitter_raw_px += (uint32_t)(abs(jx - s_jx) + abs(jy - s_jy));
+      s_stats.jitter_filt_px += (uint32_t)(abs(sx - s_sx) + abs(sy - s_sy));
+    }
+    s_jx = jx;
+    s_jy = jy;
+    s_sx = sx;
+    s_sy = sy;
+  } else {
+    s_irq_latched = false;  /* edges caused by our own conversions */
+  }
+  s_pressed = down;
+  *x = s_sx;
+  *y = s_sy;
+  *pressed = down;
 
-  TS_Point p = s_ts->getPoint();
-  int16_t sx = 0, sy = 0;
-  TouchRawToScreen(p.x, p.y, &sx, &sy);
-  *x = sx;
-  *y = sy;
-  *pressed = true;
+  uint32_t dt = micros() - t0;
+  s_stats.busy_us += dt;
+  if (dt > s_stats.busy_max_us) s_stats.busy_max_us = dt;
 
-  if (s_diagnostic) {
+  if (s_diagnostic && down) {
     Serial.print(F("[touch] raw=("));
-    Serial.print(p.x);
+    Serial.print(mx);
     Serial.print(F(","));
-    Serial.print(p.y);
+    Serial.print(my);
     Serial.print(F(") mapped=("));
-    Serial.print(sx);
+    Serial.print(s_sx);
     Serial.print(F(","));
-    Serial.println(sy);
+    Serial.println(s_sy);
     Serial.flush();
   }
 }
+
+void TouchGetRawPoint(int16_t *raw_x, int16_t *raw_y) {
+  if (raw_x) *raw_x = (int16_t)(s_fx + 0.5f);
+  if (raw_y) *raw_y = (int16_t)(s_fy + 0.5f);
+}
+
+void TouchGetStats(TouchStats_t *out) {
+  if (out) *out = s_stats;
+}
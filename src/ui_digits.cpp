@@ -0,0 +1,151 @@
+/**
+ * @file ui_digits.cpp
+ * Glyph cache and digits widget for the large dashboard values (see ui_digits.h).
+ */
+#include "ui_digits.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DIGITS_TEXT_MAX 24
+
+static const char k_glyph_set[] = "0123456789.- AV";
+#define DIGITS_GLYPHS ((int)sizeof(k_glyph_set) - 1)
+
+static lv_draw_buf_t   s_glyph_buf[DIGITS_GLYPHS];
+static lv_image_dsc_t  s_glyph_img[DIGITS_GLYPHS];
+static bool            s_ready = false;
+static const lv_font_t *s_font = NULL;
+static lv_color_t      s_fg;
+static int32_t         s_line_h = 0;
+
+/* One-character strings for the fallback path: draw tasks keep the text pointer until they run */
+static char s_ascii[128][2];
+
+typedef struct {
+  char text[DIGITS_TEXT_MAX];
+} digits_t;
+
+static int glyph_index(char c) {
+  const char *p = strchr(k_glyph_set, c);
+  return (p && c) ? (int)(p - k_glyph_set) : -1;
+}
+
+bool ui_digits_init(const lv_font_t *font, lv_color_t fg, lv_color_t bg) {
+  if (s_ready || !font) return s_ready;
+  s_font = font;
+  s_fg = fg;
+  s_line_h = lv_font_get_line_height(font);
+  for (int k = 0; k < 128; k++) {
+    s_ascii[k][0] = (char)k;
+    s_ascii[k][1] = '\0';
+  }
+
+  /* Render each glyph through a hidden canvas, so the cached pixels are exactly what a label draws */
+  lv_obj_t *canvas = lv_canvas_create(lv_layer_top());
+  lv_obj_add_flag(canvas, LV_OBJ_FLAG_HIDDEN);
+  bool ok = true;
+  for (int g = 0; g < DIGITS_GLYPHS && ok; g++) {
+    uint32_t letter = (uint8_t)k_glyph_set[g];
+    uint32_t w = lv_font_get_glyph_width(font, letter, 0);
+    if (w == 0) w = 1;
+    uint32_t stride = w * 2;
+    uint32_t size = stride * (uint32_t)s_line_h;
+    void *data = malloc(size);  /* system heap: keeps the LVGL pool for widgets */
+    if (!data) { ok = false; break; }
+    lv_draw_buf_init(&s_glyph_buf[g], w, (uint32_t)s_line_h, LV_COLOR_FORMAT_RGB565, stride, data, size);
+
+    lv_canvas_set_draw_buf(canvas, &s_glyph_buf[g]);
+    lv_canvas_fill_bg(canvas, bg, LV_OPA_COVER);
+    lv_layer_t layer;
+    lv_canvas_init_layer(canvas, &layer);
+    lv_draw_label_dsc_t dsc;
+    lv_draw_label_dsc_init(&dsc);
+    dsc.font = font;
+    dsc.color = fg;
+    dsc.text = s_ascii[letter];
+    lv_area_t a = {0, 0, (int32_t)w - 1, s_line_h - 1};
+    lv_draw_label(&layer, &dsc, &a);
+    lv_canvas_finish_layer(canvas, &layer);
+
+    s_glyph_img[g].header = s_glyph_buf[g].header;
+    s_glyph_img[g].data = (const uint8_t *)s_glyph_buf[g].data;
+    s_glyph_img[g].data_size = s_glyph_buf[g].data_size;
+  }
+  lv_obj_delete(canvas);
+  if (!ok) {
+    for (int g = 0; g < DIGITS_GLYPHS; g++) {
+      free(s_glyph_buf[g].data);
+      s_glyph_buf[g].data = NULL;
+    }
+  }
+  s_ready = ok;
+  return ok;
+}
+
+static void digits_draw_cb(lv_event_t *e) {
+  lv_obj_t *obj = (lv_obj_t *)lv_event_get_target(e);
+  lv_layer_t *layer = lv_event_get_layer(e);
+  const digits_t *d = (const digits_t *)lv_obj_get_user_data(obj);
+  if (!d || !s_font) return;
+
+  lv_area_t coords;
+  lv_obj_get_content_coords(obj, &coords);
+  int32_t x = coords.x1;
+  for (const char *p = d->text; *p && x <= coords.x2; p++) {
+    int g = s_ready ? glyph_index(*p) : -1;
+    if (g >= 0) {
+      lv_draw_image_dsc_t img;
+      lv_draw_image_dsc_init(&img);
+      img.src = &s_glyph_img[g];
+      int32_t w = (int32_t)s_glyph_img[g].header.w;
+      lv_area_t a = {x, coords.y1, x + w - 1, coords.y1 + s_line_h - 1};
+      lv_draw_image(layer, &img, &a);
+      x += w;
+    } else {
+      uint32_t letter = (uint8_t)*p < 128 ? (uint8_t)*p : '?';
+      int32_t w = (int32_t)lv_font_get_glyph_width(s_font, letter, 0);
+      lv_draw_label_dsc_t dsc;
+      lv_draw_label_dsc_init(&dsc);
+      dsc.font = s_font;
+      dsc.color = s_fg;
+      dsc.text = s_ascii[letter];
+      lv_area_t a = {x, coords.y1, x + w - 1, coords.y1 + s_line_h - 1};
+      lv_draw_label(layer, &dsc, &a);
+      x += w;
+    }
+  }
+}
+
+static void digits_delete_cb(lv_event_t *e) {
+  lv_obj_t *obj = (lv_obj_t *)lv_event_get_target(e);
+  free(lv_obj_get_user_data(obj));
+  lv_obj_set_user_data(obj, NULL);
+}
+
+lv_obj_t *ui_digits_create(lv_obj_t *parent) {
+  digits_t *d = (digits_t *)calloc(1, sizeof(digits_t));
+  if (!d) return NULL;
+  lv_obj_t *obj = lv_obj_create(parent);
+  lv_obj_remove_style_all(obj);
+  lv_obj_remove_flag(obj, LV_OBJ_FLAG_CLICKABLE);
+  lv_obj_remove_flag(obj, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_set_size(obj, lv_pct(100), s_line_h > 0 ? s_line_h : 24);
+  lv_obj_set_user_data(obj, d);
+  lv_obj_add_event_cb(obj, digits_draw_cb, LV_EVENT_DRAW_MAIN, NULL);
+  lv_obj_add_event_cb(obj, digits_delete_cb, LV_EVENT_DELETE, NULL);
+  return obj;
+}
+
+void ui_digits_set_text(lv_obj_t *obj, const char *text) {
+  digits_t *d = obj ? (digits_t *)lv_obj_get_user_data(obj) : NULL;
+  if (!d || !text) return;
+  if (strncmp(d->text, text, DIGITS_TEXT_MAX - 1) == 0) return;
+  strncpy(d->text, text, DIGITS_TEXT_MAX - 1);
+  d->text[DIGITS_TEXT_MAX - 1] = '\0';
+  lv_obj_invalidate(obj);
+}
+
+const char *ui_digits_get_text(lv_obj_t *obj) {
+  const digits_t *d = obj ? (const digits_t *)lv_obj_get_user_data(obj) : NULL;
+  return d ? d->text : "";
+}
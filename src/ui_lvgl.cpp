@@ -8,9 +8,20 @@
 #include "touch.h"
 #include "sensor.h"
 #include "telemetry_victron.h"
+#include "history_log.h"
+#include "backlight.h"
+#include "ui_theme.h"
+#include "ui_perf.h"
+#include "ui_digits.h"
+#include "ui_sparkline.h"
+#include "ui_scope.h"
+#include "sd_log.h"
+#include "session_stats.h"
+#include "ble_telemetry.h"
 #include <lvgl.h>
 #include <TFT_eSPI.h>
 #include <Arduino.h>
+#include <esp_timer.h>
 #include <math.h>
 #include <cstring>
 
@@ -19,7 +30,7 @@ extern TFT_eSPI tft;
 extern void resetEnergyAccumulation(void);
 extern void cycleAveraging(void);
 extern String getAveragingString(void);
-extern void performTouchCalibration(void);
+extern void saveTouchCalibration(const TouchCalibration_t *cal);
 extern void saveShuntCalibration(void);
 extern float getDefaultMaxCurrent(void);
 extern float getDefaultShuntResistance(void);
@@ -28,32 +39,7 @@ extern float shuntResistance;
 extern bool get_vedirect_enabled(void);
 extern void set_vedirect_enabled(bool on);
 
-/* ─── UX constants (CYD: 320×240, 8px grid, resistive touch) ─── */
-#define DISP_W    320
-#define DISP_H    240
-#define GRID      8
-#define MARGIN    4
-#define MARGIN_L  16
-#define GAP       4
-#define PAD       4
-#define HEADER_H  32
-#define MIN_TAP_W 44
-#define MIN_TAP_H 28
-#define BTN_W     56
-#define BTN_H     32
-#define CARD_R    6
-#define ROW_H     36
-#define LIST_ITEM_H 44
-
-/* Colors: black BG, dark grey cards, cyan accent, red/green. Muted brighter for contrast. */
-#define COL_BG      0x000000
-#define COL_CARD    0x252525
-#define COL_HEADER  0x1a1a1a
-#define COL_ACCENT  0x00D4FF
-#define COL_ERROR   0xE63946
-#define COL_OK      0x00AA00
-#define COL_TEXT    0xFFFFFF
-#define COL_MUTED   0xB0B0B0
+/* Layout and colour tokens (DISP_W, GRID, COL_*, ...) and shared styles live in ui_theme.h */
 
 #define BUF_STRIDE  320
 #define BUF_LINES   40
@@ -77,10 +63,15 @@ static lv_obj_t *scr_shunt_standard = NULL;
 static lv_obj_t *scr_known_load = NULL;
 static lv_obj_t *scr_calc_mv = NULL;
 static lv_obj_t *scr_about = NULL;
+static lv_obj_t *scr_perf = NULL;
+static lv_obj_t *scr_touch_cal = NULL;
+static lv_obj_t *scr_scope = NULL;
 
 static lv_obj_t *label_current = NULL;
 static lv_obj_t *label_voltage = NULL;
 static lv_obj_t *label_power = NULL;
+static lv_obj_t *label_peak_i = NULL;
+static lv_obj_t *label_peak_p = NULL;
 static lv_obj_t *label_energy = NULL;
 static lv_obj_t *label_status = NULL;
 static lv_obj_t *label_avg_val = NULL;
@@ -97,12 +88,21 @@ static lv_obj_t *label_calc_mv_result = NULL;
 static uint8_t *draw_buf1 = NULL;
 static uint8_t *draw_buf2 = NULL;
 
+/* Set when a touch wakes the blanked display: that press is not delivered to LVGL */
+static bool s_touch_swallow = false;
+
+/* Redraw benchmark: flush (byte swap + SPI) time accumulated while it runs, to split render from transfer */
+static bool     s_bench_active = false;
+static uint32_t s_bench_flush_us = 0;
+
 /* ─── History buffer for histogram (since start or last reset) ─── */
 #define HISTORY_LEN 256
-static float s_history_v[HISTORY_LEN];
-static float s_history_i[HISTORY_LEN];
-static float s_history_p[HISTORY_LEN];
 static float s_history_e[HISTORY_LEN];
+/* V/I/P as the extremes of the full-rate samples behind each slot (not window means), so the popup
+ * envelope keeps spikes shorter than a slot */
+static float s_history_v_min[HISTORY_LEN], s_history_v_max[HISTORY_LEN];
+static float s_history_i_min[HISTORY_LEN], s_history_i_max[HISTORY_LEN];
+static float s_history_p_min[HISTORY_LEN], s_history_p_max[HISTORY_LEN];
 static uint16_t s_history_write_idx = 0;
 static uint16_t s_history_count = 0;  /* samples written so far */
 
@@ -112,6 +112,7 @@ static void my_flush_cb(lv_display_t *d, const lv_area_t *area, uint8_t *px_map)
   int32_t w = lv_area_get_width(area);
   int32_t h = lv_area_get_height(area);
   if (w <= 0 || h <= 0) { lv_display_flush_ready(d); return; }
+  uint32_t t0 = micros();
   uint32_t n = (uint32_t)w * (uint32_t)h;
   uint16_t *p = (uint16_t *)px_map;
 #if LVGL_FLUSH_SWAP_BYTES
@@ -125,6 +126,9 @@ static void my_flush_cb(lv_display_t *d, const lv_area_t *area, uint8_t *px_map)
   tft.setAddrWindow((int32_t)area->x1, (int32_t)area->y1, (int32_t)w, (int32_t)h);
   tft.pushPixels(p, n);
   tft.endWrite();
+  uint32_t dt = micros() - t0;
+  if (s_bench_active) s_bench_flush_us += dt;
+  ui_perf_on_flush(n, dt);
   lv_display_flush_ready(d);
 }
 
@@ -133,6 +137,10 @@ static void my_touchpad_read_cb(lv_indev_t *indev, lv_indev_data_t *data) {
   int16_t x = 0, y = 0;
   bool pressed = false;
   TouchGetScreenPoint(&x, &y, &pressed);
+  if (s_touch_swallow) {
+    if (pressed) pressed = false;
+    else s_touch_swallow = false;
+  }
   data->point.x = (int32_t)x;
   data->point.y = (int32_t)y;
   data->state   = pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
@@ -154,60 +162,192 @@ static int decimals_for_magnitude(double value, int sig_figs, int max_decimals)
   return dec > max_decimals ? max_decimals : dec;
 }
 
+/* ─── Screen registry: built on first navigation, least recently used ones freed ─── */
+/* Non-pinned screens kept alive besides the active one; 0 frees each screen as soon as it is left. */
+#ifndef UI_SCREEN_CACHE
+#define UI_SCREEN_CACHE 3
+#endif
+
+typedef enum {
+  SCR_MONITOR = 0,
+  SCR_SETTINGS_HOME,
+  SCR_MEASUREMENT,
+  SCR_CALIBRATION,
+  SCR_SHUNT_CALIBRATION,
+  SCR_SHUNT_STANDARD,
+  SCR_KNOWN_LOAD,
+  SCR_CALC_MV,
+  SCR_DATA,
+  SCR_SYSTEM,
+  SCR_INTEGRATION,
+  SCR_ABOUT,
+  SCR_PERF,
+  SCR_TOUCH_CAL,
+  SCR_SCOPE,
+  SCR_COUNT
+} screen_id_t;
+
+static void build_monitor(void);
+static void build_settings_home(void);
+static void build_measurement(void);
+static void build_calibration(void);
+static void build_shunt_calibration(void);
+static void build_shunt_standard(void);
+static void build_known_load(void);
+static void build_calc_mv(void);
+static void build_data(void);
+static void build_system(void);
+static void build_integration(void);
+static void build_about(void);
+static void build_perf(void);
+static void build_touch_cal(void);
+static void build_scope(void);
+static void screen_forget_labels(screen_id_t id);
+
+typedef struct {
+  lv_obj_t **scr;
+  void (*build)(void);
+  bool pinned;        /* never freed (Monitor: update timer and history popup live there) */
+  uint32_t last_used; /* navigation counter, for LRU eviction */
+  bool transient;     /* freed as soon as it is left, regardless of UI_SCREEN_CACHE (large buffers) */
+} screen_slot_t;
+
+static screen_slot_t s_screens[SCR_COUNT] = {
+  {&scr_monitor,           build_monitor,           true,  0},
+  {&scr_settings_home,     build_settings_home,     false, 0},
+  {&scr_measurement,       build_measurement,       false, 0},
+  {&scr_calibration,       build_calibration,       false, 0},
+  {&scr_shunt_calibration, build_shunt_calibration, false, 0},
+  {&scr_shunt_standard,    build_shunt_standard,    false, 0},
+  {&scr_known_load,        build_known_load,        false, 0},
+  {&scr_calc_mv,           build_calc_mv,           false, 0},
+  {&scr_data,              build_data,              false, 0},
+  {&scr_system,            build_system,            false, 0},
+  {&scr_integration,       build_integration,       false, 0},
+  {&scr_about,             build_about,             false, 0},
+  {&scr_perf,              build_perf,              false, 0},
+  {&scr_touch_cal,         build_touch_cal,         false, 0},
+  {&scr_scope,             build_scope,             false, 0, true},
+};
+static uint32_t s_screen_clock = 0;
+static uint8_t  s_screens_built = 0;  /* screens alive now */
+static uint8_t  s_screens_built_max = 0;
+
+static lv_obj_t *screen_get(screen_id_t id) {
+  screen_slot_t *slot = &s_screens[id];
+  if (!*slot->scr) {
+    lv_mem_monitor_t before, after;
+    lv_mem_monitor(&before);
+    slot->build();
+    lv_mem_monitor(&after);
+    Serial.printf("UI: built screen %d, LVGL heap +%ld B (%lu B free)\n", (int)id,
+                  (long)before.free_size - (long)after.free_size, (unsigned long)after.free_size);
+    if (*slot->scr) {
+      s_screens_built++;
+      if (s_screens_built > s_screens_built_max) s_screens_built_max = s_screens_built;
+    }
+  }
+  return *slot->scr;
+}
+
+/* Free least recently used screens beyond UI_SCREEN_CACHE. Deletion is deferred (lv_obj_delete_async)
+ * because navigation usually runs from an event of an object on the screen being left. */
+static void screen_evict(void) {
+  lv_obj_t *active = lv_screen_active();
+  for (;;) {
+    int cached = 0;
+    int lru = -1;
+    for (int k = 0; k < SCR_COUNT; k++) {
+      const screen_slot_t *slot = &s_screens[k];
+      if (slot->pinned || !*slot->scr || *slot->scr == active) continue;
+      if (slot->transient) {
+        lru = k;
+        cached = UI_SCREEN_CACHE + 1;
+        break;
+      }
+      cached++;
+      if (lru < 0 || slot->last_used < s_screens[lru].last_used) lru = k;
+    }
+    if (cached <= UI_SCREEN_CACHE || lru < 0) return;
+    lv_obj_delete_async(*s_screens[lru].scr);
+    *s_screens[lru].scr = NULL;
+    screen_forget_labels((screen_id_t)lru);
+    s_screens_built--;
+  }
+}
+
+static void screen_show(screen_id_t id) {
+  lv_obj_t *scr = screen_get(id);
+  if (!scr) return;
+  s_screens[id].last_used = ++s_screen_clock;
+  lv_screen_load(scr);
+  screen_evict();
+}
+
 /* ─── Navigation ─── */
 static void to_monitor(lv_event_t *e) {
   (void)e;
-  if (scr_monitor) lv_screen_load(scr_monitor);
+  screen_show(SCR_MONITOR);
 }
 
 static void to_settings_home(lv_event_t *e) {
   (void)e;
-  if (scr_settings_home) lv_screen_load(scr_settings_home);
+  screen_show(SCR_SETTINGS_HOME);
 }
 
 static void open_settings(lv_event_t *e) {
   (void)e;
-  if (scr_settings_home) lv_screen_load(scr_settings_home);
+  screen_show(SCR_SETTINGS_HOME);
 }
 
 static void to_measurement(lv_event_t *e) {
   (void)e;
-  if (scr_measurement) lv_screen_load(scr_measurement);
+  screen_show(SCR_MEASUREMENT);
 }
 
 static void to_calibration(lv_event_t *e) {
   (void)e;
-  if (scr_calibration) lv_screen_load(scr_calibration);
+  screen_show(SCR_CALIBRATION);
 }
 
 static void to_data(lv_event_t *e) {
   (void)e;
-  if (scr_data) lv_screen_load(scr_data);
+  screen_show(SCR_DATA);
 }
 
 static void to_system(lv_event_t *e) {
   (void)e;
-  if (scr_system) lv_screen_load(scr_system);
+  screen_show(SCR_SYSTEM);
 }
 
 static void to_integration(lv_event_t *e) {
   (void)e;
-  if (scr_integration) lv_screen_load(scr_integration);
+  screen_show(SCR_INTEGRATION);
 }
 
 static void to_about(lv_event_t *e) {
   (void)e;
-  if (scr_about) lv_screen_load(scr_about);
+  screen_show(SCR_ABOUT);
 }
 
 static void to_shunt_calibration(lv_event_t *e) {
   (void)e;
-  if (scr_shunt_calibration) lv_screen_load(scr_shunt_calibration);
+  screen_show(SCR_SHUNT_CALIBRATION);
 }
 
 static void to_shunt_standard(lv_event_t *e) {
   (void)e;
-  if (scr_shunt_standard) lv_screen_load(scr_shunt_standard);
+  screen_show(SCR_SHUNT_STANDARD);
+}
+
+static void to_perf(lv_event_t *e) {
+  (void)e;
+  screen_show(SCR_PERF);
+}
+
+static void to_scope(lv_event_t *e) {
+  (void)e;
+  screen_show(SCR_SCOPE);
 }
 
 /* ─── Persistent header: title left, one action right (Back or Settings) ─── */
@@ -215,15 +355,13 @@ static lv_obj_t *add_header(lv_obj_t *parent, const char *title, bool show_back)
   lv_obj_t *bar = lv_obj_create(parent);
   lv_obj_set_size(bar, DISP_W, HEADER_H);
   lv_obj_set_pos(bar, 0, 0);
-  lv_obj_set_style_bg_color(bar, lv_color_hex(COL_HEADER), 0);
-  lv_obj_set_style_radius(bar, 0, 0);
-  lv_obj_set_style_pad_all(bar, 0, 0);
+  lv_obj_add_style(bar, &ui_style_header, 0);
   lv_obj_remove_flag(bar, LV_OBJ_FLAG_SCROLLABLE);
 
   if (title) {
     lv_obj_t *tit = lv_label_create(bar);
     lv_label_set_text(tit, title);
-    lv_obj_set_style_text_color(tit, lv_color_hex(COL_TEXT), 0);
+    lv_obj_add_style(tit, &ui_style_text, 0);
     lv_obj_align(tit, LV_ALIGN_LEFT_MID, MARGIN, 0);
   }
 
@@ -247,14 +385,12 @@ static lv_obj_t *add_header_back_to_monitor(lv_obj_t *parent, const char *title)
   lv_obj_t *bar = lv_obj_create(parent);
   lv_obj_set_size(bar, DISP_W, HEADER_H);
   lv_obj_set_pos(bar, 0, 0);
-  lv_obj_set_style_bg_color(bar, lv_color_hex(COL_HEADER), 0);
-  lv_obj_set_style_radius(bar, 0, 0);
-  lv_obj_set_style_pad_all(bar, 0, 0);
+  lv_obj_add_style(bar, &ui_style_header, 0);
   lv_obj_remove_flag(bar, LV_OBJ_FLAG_SCROLLABLE);
 
   lv_obj_t *tit = lv_label_create(bar);
   lv_label_set_text(tit, title);
-  lv_obj_set_style_text_color(tit, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(tit, &ui_style_text, 0);
   lv_obj_align(tit, LV_ALIGN_LEFT_MID, MARGIN, 0);
 
   lv_obj_t *btn = lv_btn_create(bar);
@@ -273,14 +409,12 @@ static lv_obj_t *add_header_back_to_settings(lv_obj_t *parent, const char *title
   lv_obj_t *bar = lv_obj_create(parent);
   lv_obj_set_size(bar, DISP_W, HEADER_H);
   lv_obj_set_pos(bar, 0, 0);
-  lv_obj_set_style_bg_color(bar, lv_color_hex(COL_HEADER), 0);
-  lv_obj_set_style_radius(bar, 0, 0);
-  lv_obj_set_style_pad_all(bar, 0, 0);
+  lv_obj_add_style(bar, &ui_style_header, 0);
   lv_obj_remove_flag(bar, LV_OBJ_FLAG_SCROLLABLE);
 
   lv_obj_t *tit = lv_label_create(bar);
   lv_label_set_text(tit, title);
-  lv_obj_set_style_text_color(tit, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(tit, &ui_style_text, 0);
   lv_obj_align(tit, LV_ALIGN_LEFT_MID, MARGIN, 0);
 
   lv_obj_t *btn = lv_btn_create(bar);
@@ -299,14 +433,12 @@ static lv_obj_t *add_header_back_to_calibration(lv_obj_t *parent, const char *ti
   lv_obj_t *bar = lv_obj_create(parent);
   lv_obj_set_size(bar, DISP_W, HEADER_H);
   lv_obj_set_pos(bar, 0, 0);
-  lv_obj_set_style_bg_color(bar, lv_color_hex(COL_HEADER), 0);
-  lv_obj_set_style_radius(bar, 0, 0);
-  lv_obj_set_style_pad_all(bar, 0, 0);
+  lv_obj_add_style(bar, &ui_style_header, 0);
   lv_obj_remove_flag(bar, LV_OBJ_FLAG_SCROLLABLE);
 
   lv_obj_t *tit = lv_label_create(bar);
   lv_label_set_text(tit, title);
-  lv_obj_set_style_text_color(tit, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(tit, &ui_style_text, 0);
   lv_obj_align(tit, LV_ALIGN_LEFT_MID, MARGIN, 0);
 
   lv_obj_t *btn = lv_btn_create(bar);
@@ -320,19 +452,40 @@ static lv_obj_t *add_header_back_to_calibration(lv_obj_t *parent, const char *ti
   return bar;
 }
 
+static lv_obj_t *add_header_back_to_system(lv_obj_t *parent, const char *title) {
+  lv_obj_t *bar = lv_obj_create(parent);
+  lv_obj_set_size(bar, DISP_W, HEADER_H);
+  lv_obj_set_pos(bar, 0, 0);
+  lv_obj_add_style(bar, &ui_style_header, 0);
+  lv_obj_remove_flag(bar, LV_OBJ_FLAG_SCROLLABLE);
+
+  lv_obj_t *tit = lv_label_create(bar);
+  lv_label_set_text(tit, title);
+  lv_obj_add_style(tit, &ui_style_text, 0);
+  lv_obj_align(tit, LV_ALIGN_LEFT_MID, MARGIN, 0);
+
+  lv_obj_t *btn = lv_btn_create(bar);
+  lv_obj_set_size(btn, BTN_W, BTN_H);
+  lv_obj_align(btn, LV_ALIGN_RIGHT_MID, -MARGIN, 0);
+  lv_obj_set_style_radius(btn, CARD_R, 0);
+  lv_obj_t *lbl = lv_label_create(btn);
+  lv_label_set_text(lbl, "Back");
+  lv_obj_center(lbl);
+  lv_obj_add_event_cb(btn, to_system, LV_EVENT_CLICKED, NULL);
+  return bar;
+}
+
 /* Header for standard shunt list: Back returns to Shunt calibration */
 static lv_obj_t *add_header_back_to_shunt(lv_obj_t *parent, const char *title) {
   lv_obj_t *bar = lv_obj_create(parent);
   lv_obj_set_size(bar, DISP_W, HEADER_H);
   lv_obj_set_pos(bar, 0, 0);
-  lv_obj_set_style_bg_color(bar, lv_color_hex(COL_HEADER), 0);
-  lv_obj_set_style_radius(bar, 0, 0);
-  lv_obj_set_style_pad_all(bar, 0, 0);
+  lv_obj_add_style(bar, &ui_style_header, 0);
   lv_obj_remove_flag(bar, LV_OBJ_FLAG_SCROLLABLE);
 
   lv_obj_t *tit = lv_label_create(bar);
   lv_label_set_text(tit, title);
-  lv_obj_set_style_text_color(tit, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(tit, &ui_style_text, 0);
   lv_obj_align(tit, LV_ALIGN_LEFT_MID, MARGIN, 0);
 
   lv_obj_t *btn = lv_btn_create(bar);
@@ -352,7 +505,7 @@ static void confirm_reset_energy_cb(lv_event_t *e) {
   if (msgbox) lv_msgbox_close(msgbox);
   resetEnergyAccumulation();
   ui_history_clear();
-  if (scr_data) lv_screen_load(scr_data);
+  screen_show(SCR_DATA);
 }
 
 /* Reset from dashboard: stay on monitor after reset */
@@ -400,18 +553,27 @@ typedef enum { HIST_V = 0, HIST_I = 1, HIST_P = 2, HIST_E = 3 } hist_metric_t;
 #define HIST_TITLE_H    28
 #define HIST_SCALE_H    18
 #define HIST_BTN_ROW_H  36
+#define HIST_ENV_MAX_COLS DISP_W  /* envelope resolution cap: one column per pixel */
+#define HIST_LOG_VIEW_SPAN 1024   /* flash log records in the widest archive window (~17 min at 1 s) */
+#define HIST_LOG_CHUNK  32        /* archive records paged in per flash read */
 
 typedef struct {
   lv_obj_t *modal;
   lv_obj_t *graph_container;  /* chart + scale label + button row */
-  lv_obj_t *chart;
-  lv_chart_series_t *series;
+  lv_obj_t *chart;             /* grid only; envelope drawn in LV_EVENT_DRAW_MAIN_END */
   lv_obj_t *label_scale;       /* Y range e.g. "11.8 - 12.5 V" */
+  lv_obj_t *title;
+  lv_obj_t *label_source;      /* "Log" / "Live" toggle text; NULL without a history partition */
   const char *unit;            /* "V", "A", "W", "Wh" */
-  int32_t chart_data[HISTORY_LEN];
+  float env_min[HIST_ENV_MAX_COLS];  /* per-column min of the visible window (NAN = no data) */
+  float env_max[HIST_ENV_MAX_COLS];  /* per-column max of the visible window */
+  uint16_t env_cols;
+  float env_lo, env_hi;        /* Y range incl. margin */
   hist_metric_t metric;
   uint8_t zoom;      /* 1, 2, 4 */
-  uint16_t scroll;   /* start index */
+  uint32_t scroll;   /* start index */
+  uint32_t last_count;  /* source sample count at the last refresh */
+  bool archive;      /* true: flash history log, false: RAM ring */
   int32_t last_x;
   bool user_has_panned_or_zoomed;
   unsigned long last_user_action_time;
@@ -426,70 +588,91 @@ static uint16_t hist_phys_idx(uint16_t logical) {
   return (s_history_write_idx + logical) % HISTORY_LEN;
 }
 
-/* Clamp to int32 range to avoid overflow and LVGL issues */
-static int32_t clamp_chart_val(int32_t v) {
-  if (v > 2000000000) return 2000000000;
-  if (v < -2000000000) return -2000000000;
-  return v;
+/* Samples covered by the visible window: zoom 1 = whole source, 2 = half, 4 = quarter */
+static uint16_t hist_window_span(const hist_popup_t *hp) {
+  uint16_t span = (hp->archive ? HIST_LOG_VIEW_SPAN : HISTORY_LEN) / hp->zoom;
+  return span < 4 ? 4 : span;
 }
 
-static int32_t safe_scale(float v, float scale) {
-  if (isnan(v) || isinf(v)) return 0;
-  double d = (double)v * (double)scale;
-  if (d > 2000000000.0) return 2000000000;
-  if (d < -2000000000.0) return -2000000000;
-  return (int32_t)d;
+static uint32_t hist_source_count(const hist_popup_t *hp) {
+  return hp->archive ? HistoryLogCount() : s_history_count;
+}
+
+/* Archive reads go through a small chunk so the window is paged in from flash, never held whole */
+static HistoryLogRecord s_log_chunk[HIST_LOG_CHUNK];
+static uint32_t s_log_chunk_first = 0;
+static size_t s_log_chunk_n = 0;
+
+static float hist_sample(const hist_popup_t *hp, const float *ring, uint32_t k) {
+  if (!hp->archive) return ring[hist_phys_idx((uint16_t)k)];
+  if (k < s_log_chunk_first || k >= s_log_chunk_first + s_log_chunk_n) {
+    s_log_chunk_first = k;
+    s_log_chunk_n = HistoryLogRead(k, s_log_chunk, HIST_LOG_CHUNK);
+    if (s_log_chunk_n == 0) return NAN;
+  }
+  const HistoryLogRecord *r = &s_log_chunk[k - s_log_chunk_first];
+  switch (hp->metric) {
+    case HIST_V: return r->voltage_V;
+    case HIST_I: return r->current_A;
+    case HIST_P: return r->power_W;
+    case HIST_E: return r->energy_Wh;
+  }
+  return NAN;
 }
 
-#define HIST_CHART_MAX_POINTS 128  /* some LVGL builds cap chart points */
+/* Decimate the visible window into per-pixel-column min/max so short spikes survive any zoom.
+ * Single pass over the window; every ring sample lands in exactly one column. The RAM ring brings
+ * the sampler's extremes per slot; the flash log only has means (energy has no extremes either). */
 static void hist_refresh_chart(hist_popup_t *hp) {
-  if (!hp || !hp->chart || !hp->series) return;
-  uint16_t pts = HISTORY_LEN / hp->zoom;
-  if (pts < 4) pts = 4;
-  if (pts > HIST_CHART_MAX_POINTS) pts = HIST_CHART_MAX_POINTS;
-  uint16_t max_scroll = (s_history_count > pts) ? (s_history_count - pts) : 0;
+  if (!hp || !hp->chart) return;
+  uint16_t span = hist_window_span(hp);
+  uint32_t count = hist_source_count(hp);
+  uint32_t max_scroll = (count > span) ? (count - span) : 0;
   if (hp->scroll > max_scroll) hp->scroll = max_scroll;
+  hp->last_count = count;
+  s_log_chunk_n = 0;  /* log indices shift when the oldest flash page is recycled */
 
-  float *src = NULL;
-  float scale = 1.0f;
+  float *src_lo = NULL, *src_hi = NULL;
   switch (hp->metric) {
-    case HIST_V: src = s_history_v; scale = 1000.0f; break;  /* mV */
-    case HIST_I: src = s_history_i; scale = 1000.0f; break;  /* mA */
-    case HIST_P: src = s_history_p; scale = 1.0f; break;
-    case HIST_E: src = s_history_e; scale = 1.0f; break;    /* Wh (avoid int32 overflow with scale 10) */
+    case HIST_V: src_lo = s_history_v_min; src_hi = s_history_v_max; break;
+    case HIST_I: src_lo = s_history_i_min; src_hi = s_history_i_max; break;
+    case HIST_P: src_lo = s_history_p_min; src_hi = s_history_p_max; break;
+    case HIST_E: src_lo = src_hi = s_history_e; break;
   }
-  if (!src) return;
+  if (!src_lo) return;
+
+  uint16_t cols = span;
+  int32_t w = lv_obj_get_content_width(hp->chart);
+  if (w > 0 && cols > (uint16_t)w) cols = (uint16_t)w;
+  if (cols > HIST_ENV_MAX_COLS) cols = HIST_ENV_MAX_COLS;
 
   float vmin = 1e9f, vmax = -1e9f;
-  for (uint16_t i = 0; i < pts; i++) {
-    if (hp->scroll + i >= s_history_count) continue;
-    uint16_t idx = hist_phys_idx(hp->scroll + i);
-    float v = src[idx];
-    if (isnan(v) || isinf(v)) continue;
-    if (v < vmin) vmin = v;
-    if (v > vmax) vmax = v;
+  for (uint16_t c = 0; c < cols; c++) {
+    uint32_t first = hp->scroll + (uint32_t)c * span / cols;
+    uint32_t last  = hp->scroll + (uint32_t)(c + 1) * span / cols;
+    float cmin = NAN, cmax = NAN;
+    for (uint32_t k = first; k < last && k < count; k++) {
+      float lo = hist_sample(hp, src_lo, k);
+      float hi = hp->archive ? lo : hist_sample(hp, src_hi, k);
+      if (isnan(lo) || isinf(lo) || isnan(hi) || isinf(hi)) continue;
+      if (isnan(cmin) || lo < cmin) cmin = lo;
+      if (isnan(cmax) || hi > cmax) cmax = hi;
+    }
+    hp->env_min[c] = cmin;
+    hp->env_max[c] = cmax;
+    if (!isnan(cmin)) {
+      if (cmin < vmin) vmin = cmin;
+      if (cmax > vmax) vmax = cmax;
+    }
   }
+  hp->env_cols = cols;
+
   if (vmin > vmax) { vmin = 0; vmax = 100; }
   float margin = (vmax - vmin) * 0.05f;
   if (margin < 0.001f) margin = 0.001f;
-  int32_t ymin = safe_scale(vmin - margin, scale);
-  int32_t ymax = safe_scale(vmax + margin, scale);
-  if (ymin >= ymax) ymax = ymin + 1;
-
-  lv_chart_set_range(hp->chart, LV_CHART_AXIS_PRIMARY_Y, clamp_chart_val(ymin), clamp_chart_val(ymax));
-  lv_chart_set_point_count(hp->chart, pts);
-  lv_chart_set_x_start_point(hp->chart, hp->series, 0);
-
-  /* Fill chart: left = oldest in window (scroll), right = newest (scroll+pts-1); new data appears from the right */
-  for (uint16_t i = 0; i < pts; i++) {
-    int32_t val = ymin;
-    if (hp->scroll + i < s_history_count) {
-      uint16_t idx = hist_phys_idx(hp->scroll + i);
-      val = safe_scale(src[idx], scale);
-    }
-    lv_chart_set_value_by_id(hp->chart, hp->series, i, clamp_chart_val(val));
-  }
-  lv_chart_refresh(hp->chart);
+  hp->env_lo = vmin - margin;
+  hp->env_hi = vmax + margin;
+  lv_obj_invalidate(hp->chart);
 
   /* Update Y-scale label (min - max unit). Adaptive decimals; current/voltage capped at 3 (mA/mV). */
   if (hp->label_scale && hp->unit) {
@@ -504,6 +687,47 @@ static void hist_refresh_chart(hist_popup_t *hp) {
   }
 }
 
+/* Envelope: one filled vertical span per column from min to max, stretched to meet the previous
+ * column so the trace stays continuous. Vertical fills are cheaper than anti-aliased line segments. */
+static void hist_chart_draw_cb(lv_event_t *e) {
+  hist_popup_t *hp = (hist_popup_t *)lv_event_get_user_data(e);
+  if (!hp || hp->env_cols == 0) return;
+  lv_layer_t *layer = lv_event_get_layer(e);
+  lv_area_t ca;
+  lv_obj_get_content_coords(hp->chart, &ca);
+  int32_t w = lv_area_get_width(&ca);
+  int32_t h = lv_area_get_height(&ca);
+  float range = hp->env_hi - hp->env_lo;
+  if (w <= 0 || h <= 1 || range <= 0.0f) return;
+  float ky = (float)(h - 1) / range;
+
+  lv_draw_rect_dsc_t dsc;
+  lv_draw_rect_dsc_init(&dsc);
+  dsc.bg_color = lv_color_hex(COL_ACCENT);
+  dsc.bg_opa = LV_OPA_COVER;
+  dsc.radius = 0;
+
+  bool have_prev = false;
+  int32_t prev_top = 0, prev_bot = 0;
+  for (uint16_t c = 0; c < hp->env_cols; c++) {
+    if (isnan(hp->env_min[c])) { have_prev = false; continue; }
+    int32_t top = ca.y2 - (int32_t)((hp->env_max[c] - hp->env_lo) * ky + 0.5f);
+    int32_t bot = ca.y2 - (int32_t)((hp->env_min[c] - hp->env_lo) * ky + 0.5f);
+    lv_area_t a;
+    a.x1 = ca.x1 + (int32_t)c * w / hp->env_cols;
+    a.x2 = ca.x1 + (int32_t)(c + 1) * w / hp->env_cols - 1;
+    if (a.x2 < a.x1) a.x2 = a.x1;
+    a.y1 = (have_prev && prev_bot < top) ? prev_bot : top;
+    a.y2 = (have_prev && prev_top > bot) ? prev_top : bot;
+    if (a.y1 < ca.y1) a.y1 = ca.y1;
+    if (a.y2 > ca.y2) a.y2 = ca.y2;
+    lv_draw_rect(layer, &dsc, &a);
+    prev_top = top;
+    prev_bot = bot;
+    have_prev = true;
+  }
+}
+
 static void hist_mark_user_action(hist_popup_t *hp) {
   if (hp) {
     hp->user_has_panned_or_zoomed = true;
@@ -513,13 +737,15 @@ static void hist_mark_user_action(hist_popup_t *hp) {
 
 /** Apply scroll policy when new data arrives: auto-scroll by default; if user panned/zoomed, hold for 30s unless already at newest (then keep following). */
 static void hist_apply_scroll_policy_and_refresh(hist_popup_t *hp) {
-  if (!hp || !hp->chart || !hp->series) return;
-  uint16_t pts = HISTORY_LEN / hp->zoom;
-  if (pts < 4) pts = 4;
-  if (pts > HIST_CHART_MAX_POINTS) pts = HIST_CHART_MAX_POINTS;
-  uint16_t max_scroll = (s_history_count > pts) ? (s_history_count - pts) : 0;
+  if (!hp || !hp->chart) return;
+  uint16_t pts = hist_window_span(hp);
+  uint32_t count = hist_source_count(hp);
+  /* Archive grows a block at a time; skip the flash reads while nothing new has landed */
+  if (hp->archive && count == hp->last_count) return;
+  uint32_t max_scroll = (count > pts) ? (count - pts) : 0;
   /* previous max (before this sample): if user was at this, they were "at newest" and we keep following */
-  uint16_t max_scroll_prev = (s_history_count > pts && s_history_count > 0) ? (s_history_count - 1 - pts) : 0;
+  uint32_t prev = hp->archive ? hp->last_count : (count > 0 ? count - 1 : 0);
+  uint32_t max_scroll_prev = (prev > pts) ? (prev - pts) : 0;
   unsigned long now = (unsigned long)millis();
 
   if (!hp->user_has_panned_or_zoomed) {
@@ -554,16 +780,18 @@ static void hist_zoom_minus_cb(lv_event_t *e) {
 static void hist_scroll_left_cb(lv_event_t *e) {
   hist_popup_t *hp = (hist_popup_t *)lv_event_get_user_data(e);
   hist_mark_user_action(hp);
-  uint16_t pts = HISTORY_LEN / hp->zoom;
-  if (hp->scroll + pts < s_history_count) hp->scroll += pts / 4;
-  if (hp->scroll + pts > s_history_count) hp->scroll = (s_history_count > pts) ? (s_history_count - pts) : 0;
+  uint16_t pts = hist_window_span(hp);
+  uint32_t count = hist_source_count(hp);
+  if (hp->scroll + pts < count) hp->scroll += pts / 4;
+  if (hp->scroll + pts > count) hp->scroll = (count > pts) ? (count - pts) : 0;
   hist_refresh_chart(hp);
 }
 
 static void hist_scroll_right_cb(lv_event_t *e) {
   hist_popup_t *hp = (hist_popup_t *)lv_event_get_user_data(e);
   hist_mark_user_action(hp);
-  if (hp->scroll >= 16) hp->scroll -= 16; else hp->scroll = 0;
+  uint32_t step = hp->archive ? hist_window_span(hp) / 4 : 16;
+  if (hp->scroll >= step) hp->scroll -= step; else hp->scroll = 0;
   hist_refresh_chart(hp);
 }
 
@@ -589,13 +817,15 @@ static void hist_chart_gesture_cb(lv_event_t *e) {
     lv_indev_get_point(indev, &p);
     int32_t dx = p.x - hp->last_x;
     hp->last_x = p.x;
-    uint16_t pts = HISTORY_LEN / hp->zoom;
+    uint16_t pts = hist_window_span(hp);
+    uint32_t count = hist_source_count(hp);
+    uint32_t step = hp->archive ? pts / 64 : 4;
     if (dx > 8) { /* swipe right = scroll to older */
-      if (hp->scroll + pts < s_history_count) hp->scroll += 4;
-      if (hp->scroll + pts > s_history_count) hp->scroll = (s_history_count > pts) ? (s_history_count - pts) : 0;
+      if (hp->scroll + pts < count) hp->scroll += step;
+      if (hp->scroll + pts > count) hp->scroll = (count > pts) ? (count - pts) : 0;
       hist_refresh_chart(hp);
     } else if (dx < -8) { /* swipe left = scroll to newer */
-      if (hp->scroll >= 4) hp->scroll -= 4; else hp->scroll = 0;
+      if (hp->scroll >= step) hp->scroll -= step; else hp->scroll = 0;
       hist_refresh_chart(hp);
     }
   } else if (code == LV_EVENT_PRESSED) {
@@ -604,30 +834,51 @@ static void hist_chart_gesture_cb(lv_event_t *e) {
   }
 }
 
+static const char *const k_hist_titles[] = { "Voltage", "Current", "Power", "Energy" };
+static const char *const k_hist_units[]  = { "V", "A", "W", "Wh" };
+
+static void hist_update_title(hist_popup_t *hp) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%s %s (%s)", k_hist_titles[hp->metric],
+           hp->archive ? "log" : "history", k_hist_units[hp->metric]);
+  lv_label_set_text(hp->title, buf);
+}
+
+/* Log/Live: switch between the RAM ring and the flash history log, jumping to the newest data */
+static void hist_source_cb(lv_event_t *e) {
+  hist_popup_t *hp = (hist_popup_t *)lv_event_get_user_data(e);
+  hp->archive = !hp->archive;
+  hp->user_has_panned_or_zoomed = false;
+  uint16_t pts = hist_window_span(hp);
+  uint32_t count = hist_source_count(hp);
+  hp->scroll = (count > pts) ? (count - pts) : 0;
+  if (hp->label_source) lv_label_set_text(hp->label_source, hp->archive ? "Live" : "Log");
+  hist_update_title(hp);
+  hist_refresh_chart(hp);
+}
+
 static void show_history_popup(hist_metric_t metric) {
   static hist_popup_t hp;
   hp.metric = metric;
   hp.zoom = 1;
+  hp.archive = false;
   /* Start at newest (same as max_scroll so graph scrolls with new data by default) */
   {
-    uint16_t pts = HISTORY_LEN / hp.zoom;
-    if (pts > HIST_CHART_MAX_POINTS) pts = HIST_CHART_MAX_POINTS;
+    uint16_t pts = hist_window_span(&hp);
     hp.scroll = (s_history_count > pts) ? (s_history_count - pts) : 0;
   }
+  hp.last_count = s_history_count;
+  hp.env_cols = 0;
   hp.last_x = 0;
   hp.user_has_panned_or_zoomed = false;  /* start in auto-scroll mode */
   hp.last_user_action_time = 0;
   s_active_hist_popup = &hp;
 
-  const char *titles[] = { "Voltage", "Current", "Power", "Energy" };
-  static const char *units[] = { "V", "A", "W", "Wh" };
-
   /* History popup: modal (flex col) -> title, then graph area (scale, chart, buttons). Spacing uses GAP/GRID. */
   hp.modal = lv_obj_create(lv_screen_active());
   lv_obj_set_size(hp.modal, DISP_W - 2 * MARGIN, DISP_H - 2 * MARGIN);
   lv_obj_align(hp.modal, LV_ALIGN_CENTER, 0, 0);
-  lv_obj_set_style_bg_color(hp.modal, lv_color_hex(COL_CARD), 0);
-  lv_obj_set_style_radius(hp.modal, CARD_R, 0);
+  lv_obj_add_style(hp.modal, &ui_style_card, 0);
   lv_obj_set_style_pad_all(hp.modal, PAD, 0);
   lv_obj_set_flex_flow(hp.modal, LV_FLEX_FLOW_COLUMN);
   lv_obj_set_flex_align(hp.modal, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_START);
@@ -636,22 +887,20 @@ static void show_history_popup(hist_metric_t metric) {
   lv_obj_add_flag(hp.modal, LV_OBJ_FLAG_CLICKABLE);
   lv_obj_add_event_cb(hp.modal, hist_modal_deleted_cb, LV_EVENT_DELETE, NULL);
 
-  lv_obj_t *tit = lv_label_create(hp.modal);
-  char buf[32];
-  snprintf(buf, sizeof(buf), "%s history (%s)", titles[metric], units[metric]);
-  lv_label_set_text(tit, buf);
-  lv_obj_set_style_text_color(tit, lv_color_hex(COL_ACCENT), 0);
-  lv_obj_set_height(tit, HIST_TITLE_H);
-  lv_obj_set_flex_grow(tit, 0);
+  hp.title = lv_label_create(hp.modal);
+  hist_update_title(&hp);
+  lv_obj_add_style(hp.title, &ui_style_text_accent, 0);
+  lv_obj_set_height(hp.title, HIST_TITLE_H);
+  lv_obj_set_flex_grow(hp.title, 0);
 
-  hp.unit = units[metric];
+  hp.unit = k_hist_units[metric];
   hp.graph_container = lv_obj_create(hp.modal);
   lv_obj_set_width(hp.graph_container, lv_pct(100));
   lv_obj_set_flex_grow(hp.graph_container, 1);
   lv_obj_set_style_min_height(hp.graph_container, 120, 0);
   lv_obj_set_flex_flow(hp.graph_container, LV_FLEX_FLOW_COLUMN);
   lv_obj_set_flex_align(hp.graph_container, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_START);
-  lv_obj_set_style_bg_color(hp.graph_container, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(hp.graph_container, &ui_style_bg, 0);
   lv_obj_set_style_radius(hp.graph_container, CARD_R, 0);
   lv_obj_set_style_pad_all(hp.graph_container, GAP, 0);
   lv_obj_set_style_pad_row(hp.graph_container, GAP, 0);
@@ -659,7 +908,7 @@ static void show_history_popup(hist_metric_t metric) {
 
   hp.label_scale = lv_label_create(hp.graph_container);
   lv_label_set_text(hp.label_scale, "-");  /* placeholder; ASCII only for LVGL display */
-  lv_obj_set_style_text_color(hp.label_scale, lv_color_hex(COL_MUTED), 0);
+  lv_obj_add_style(hp.label_scale, &ui_style_text_muted, 0);
   lv_obj_set_style_text_font(hp.label_scale, &lv_font_montserrat_14, 0);
   lv_obj_set_height(hp.label_scale, HIST_SCALE_H);
   lv_obj_set_flex_grow(hp.label_scale, 0);
@@ -668,10 +917,10 @@ static void show_history_popup(hist_metric_t metric) {
   lv_obj_set_width(hp.chart, lv_pct(100));
   lv_obj_set_flex_grow(hp.chart, 1);
   lv_obj_set_style_min_height(hp.chart, 80, 0);
-  lv_obj_set_style_bg_color(hp.chart, lv_color_hex(COL_BG), 0);
-  lv_chart_set_type(hp.chart, LV_CHART_TYPE_LINE);
+  lv_obj_add_style(hp.chart, &ui_style_bg, 0);
+  lv_chart_set_type(hp.chart, LV_CHART_TYPE_NONE);  /* no series: envelope is drawn by hist_chart_draw_cb */
   lv_chart_set_div_line_count(hp.chart, 4, 5);
-  hp.series = lv_chart_add_series(hp.chart, lv_color_hex(COL_ACCENT), LV_CHART_AXIS_PRIMARY_Y);
+  lv_obj_add_event_cb(hp.chart, hist_chart_draw_cb, LV_EVENT_DRAW_MAIN_END, &hp);
   lv_obj_add_flag(hp.chart, LV_OBJ_FLAG_SCROLLABLE);
   lv_obj_set_scroll_dir(hp.chart, LV_DIR_NONE);
   lv_obj_add_event_cb(hp.chart, hist_chart_gesture_cb, LV_EVENT_PRESSING, &hp);
@@ -715,6 +964,16 @@ static void show_history_popup(hist_metric_t metric) {
   lv_obj_center(lbl);
   lv_obj_add_event_cb(btn_right, hist_scroll_left_cb, LV_EVENT_CLICKED, &hp);  /* > = newer = increase scroll */
 
+  hp.label_source = NULL;
+  if (HistoryLogIsReady()) {
+    lv_obj_t *btn_src = lv_btn_create(btn_row);
+    lv_obj_set_size(btn_src, 48, 28);
+    hp.label_source = lv_label_create(btn_src);
+    lv_label_set_text(hp.label_source, "Log");
+    lv_obj_center(hp.label_source);
+    lv_obj_add_event_cb(btn_src, hist_source_cb, LV_EVENT_CLICKED, &hp);
+  }
+
   lv_obj_t *btn_close = lv_btn_create(btn_row);
   lv_obj_set_size(btn_close, 56, 28);
   lbl = lv_label_create(btn_close);
@@ -722,6 +981,7 @@ static void show_history_popup(hist_metric_t metric) {
   lv_obj_center(lbl);
   lv_obj_add_event_cb(btn_close, hist_close_cb, LV_EVENT_CLICKED, &hp);
 
+  lv_obj_update_layout(hp.modal);  /* chart width sets the envelope column count */
   hist_refresh_chart(&hp);
 }
 
@@ -730,7 +990,210 @@ static void hist_card_click_cb(lv_event_t *e) {
   show_history_popup(m);
 }
 
-/* ─── Calibration: confirm then run legacy full-screen flow (TFT take-over is intentional) ─── */
+/* ─── Touch calibration screen: crosses driven by the indev, affine fit, verify then save ─── */
+#define TCAL_POINTS     5
+#define TCAL_MIN_READS  5     /* indev reads per point (~165 ms hold at the 33 ms read period) */
+#define TCAL_MAX_RMS_PX 6.0f  /* reject a fit worse than this */
+#define TCAL_TIMEOUT_S  30    /* no progress: restore the previous calibration and leave */
+#define TCAL_INSET      24
+
+static const int16_t k_tcal_x[TCAL_POINTS] = {TCAL_INSET, DISP_W - 1 - TCAL_INSET, DISP_W - 1 - TCAL_INSET,
+                                              TCAL_INSET, DISP_W / 2};
+static const int16_t k_tcal_y[TCAL_POINTS] = {TCAL_INSET, TCAL_INSET, DISP_H - 1 - TCAL_INSET,
+                                              DISP_H - 1 - TCAL_INSET, DISP_H / 2};
+
+typedef struct {
+  lv_obj_t *target;
+  lv_obj_t *dot;            /* centre of the cross: red waiting, green while held */
+  lv_obj_t *label;
+  lv_obj_t *btn_row;
+  lv_timer_t *timer;
+  screen_id_t return_to;
+  TouchCalibration_t prev;  /* restored on Retry/timeout */
+  TouchCalibration_t fit;
+  int idx;                  /* point being collected; TCAL_POINTS = verifying the fit */
+  int32_t sum_x, sum_y;
+  uint16_t reads;
+  uint16_t idle_s;
+  int16_t raw_x[TCAL_POINTS], raw_y[TCAL_POINTS];
+} tcal_state_t;
+
+static tcal_state_t s_tcal = {};
+
+static void tcal_show_point(void) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "Touch and hold the cross\n%d of %d", s_tcal.idx + 1, TCAL_POINTS);
+  lv_label_set_text(s_tcal.label, buf);
+  lv_obj_set_pos(s_tcal.target, k_tcal_x[s_tcal.idx] - 10, k_tcal_y[s_tcal.idx] - 10);
+  lv_obj_remove_flag(s_tcal.target, LV_OBJ_FLAG_HIDDEN);
+  lv_obj_add_flag(s_tcal.btn_row, LV_OBJ_FLAG_HIDDEN);
+}
+
+static void tcal_restart(void) {
+  TouchSetCalibration(&s_tcal.prev);
+  s_tcal.idx = 0;
+  s_tcal.reads = 0;
+  s_tcal.idle_s = 0;
+  tcal_show_point();
+}
+
+static void tcal_leave(void) {
+  screen_show(s_tcal.return_to);
+}
+
+static void tcal_finish(void) {
+  float rms = 0.f;
+  int16_t sx[TCAL_POINTS], sy[TCAL_POINTS];
+  memcpy(sx, k_tcal_x, sizeof(sx));
+  memcpy(sy, k_tcal_y, sizeof(sy));
+  bool ok = TouchCalibrationSolve(s_tcal.raw_x, s_tcal.raw_y, sx, sy, TCAL_POINTS, &s_tcal.fit, &rms);
+  Serial.printf("Touch calibration: fit %s, rms %.2f px\n", ok ? "ok" : "singular", (double)rms);
+  char buf[96];
+  if (!ok || rms > TCAL_MAX_RMS_PX) {
+    tcal_restart();
+    snprintf(buf, sizeof(buf), "Points did not agree (%.1f px)\nTouch and hold the cross\n1 of %d",
+             (double)rms, TCAL_POINTS);
+    lv_label_set_text(s_tcal.label, buf);
+    return;
+  }
+  /* Apply live so the buttons below already use the new mapping: hitting Save is the check */
+  TouchSetCalibration(&s_tcal.fit);
+  s_tcal.idx = TCAL_POINTS;
+  s_tcal.idle_s = 0;
+  snprintf(buf, sizeof(buf), "Error %.1f px\nTap Save to keep it", (double)rms);
+  lv_label_set_text(s_tcal.label, buf);
+  lv_obj_add_flag(s_tcal.target, LV_OBJ_FLAG_HIDDEN);
+  lv_obj_remove_flag(s_tcal.btn_row, LV_OBJ_FLAG_HIDDEN);
+}
+
+/* Screen-wide press events: collect the filtered raw point while the cross is held */
+static void tcal_press_cb(lv_event_t *e) {
+  if (s_tcal.idx >= TCAL_POINTS) return;
+  lv_event_code_t code = lv_event_get_code(e);
+  if (code == LV_EVENT_PRESSED) {
+    s_tcal.sum_x = s_tcal.sum_y = 0;
+    s_tcal.reads = 0;
+    lv_obj_set_style_bg_color(s_tcal.dot, lv_color_hex(COL_OK), 0);
+  } else if (code == LV_EVENT_PRESSING) {
+    int16_t rx = 0, ry = 0;
+    TouchGetRawPoint(&rx, &ry);
+    s_tcal.sum_x += rx;
+    s_tcal.sum_y += ry;
+    s_tcal.reads++;
+  } else if (code == LV_EVENT_RELEASED || code == LV_EVENT_PRESS_LOST) {
+    lv_obj_set_style_bg_color(s_tcal.dot, lv_color_hex(COL_ERROR), 0);
+    if (s_tcal.reads < TCAL_MIN_READS) {
+      lv_label_set_text(s_tcal.label, "Hold a little longer");
+      return;
+    }
+    s_tcal.raw_x[s_tcal.idx] = (int16_t)(s_tcal.sum_x / s_tcal.reads);
+    s_tcal.raw_y[s_tcal.idx] = (int16_t)(s_tcal.sum_y / s_tcal.reads);
+    Serial.printf("Touch calibration: point %d raw (%d, %d)\n", s_tcal.idx + 1, s_tcal.raw_x[s_tcal.idx],
+                  s_tcal.raw_y[s_tcal.idx]);
+    s_tcal.idle_s = 0;
+    if (++s_tcal.idx < TCAL_POINTS) tcal_show_point();
+    else tcal_finish();
+  }
+}
+
+static void tcal_timer_cb(lv_timer_t *t) {
+  (void)t;
+  if (++s_tcal.idle_s < TCAL_TIMEOUT_S) return;
+  Serial.println(s_tcal.prev.isValid ? "Touch calibration: timeout, previous calibration kept"
+                                     : "Touch calibration: timeout, starting over");
+  tcal_restart();  /* restores the previous calibration */
+  if (s_tcal.prev.isValid) tcal_leave();  /* without one there is nothing usable to go back to */
+}
+
+static void tcal_save_cb(lv_event_t *e) {
+  (void)e;
+  saveTouchCalibration(&s_tcal.fit);
+  tcal_leave();
+}
+
+static void tcal_retry_cb(lv_event_t *e) {
+  (void)e;
+  tcal_restart();
+}
+
+static void tcal_screen_cb(lv_event_t *e) {
+  if (lv_event_get_code(e) == LV_EVENT_SCREEN_LOADED) {
+    TouchGetCalibration(&s_tcal.prev);
+    tcal_restart();
+    if (!s_tcal.timer) s_tcal.timer = lv_timer_create(tcal_timer_cb, 1000, NULL);
+  } else if (s_tcal.timer) {
+    lv_timer_delete(s_tcal.timer);
+    s_tcal.timer = NULL;
+  }
+}
+
+static void build_touch_cal(void) {
+  scr_touch_cal = lv_obj_create(NULL);
+  lv_obj_add_style(scr_touch_cal, &ui_style_bg, 0);
+  lv_obj_remove_flag(scr_touch_cal, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_add_flag(scr_touch_cal, LV_OBJ_FLAG_CLICKABLE);
+  lv_obj_add_event_cb(scr_touch_cal, tcal_press_cb, LV_EVENT_ALL, NULL);
+  lv_obj_add_event_cb(scr_touch_cal, tcal_screen_cb, LV_EVENT_SCREEN_LOADED, NULL);
+  lv_obj_add_event_cb(scr_touch_cal, tcal_screen_cb, LV_EVENT_SCREEN_UNLOADED, NULL);
+
+  lv_obj_t *title = lv_label_create(scr_touch_cal);
+  lv_label_set_text(title, "Touch calibration");
+  lv_obj_add_style(title, &ui_style_text_accent, 0);
+  lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 2 * GRID + GAP);
+
+  s_tcal.label = lv_label_create(scr_touch_cal);
+  lv_obj_add_style(s_tcal.label, &ui_style_text, 0);
+  lv_obj_set_style_text_align(s_tcal.label, LV_TEXT_ALIGN_CENTER, 0);
+  lv_obj_align(s_tcal.label, LV_ALIGN_CENTER, 0, -6 * GRID);
+
+  /* Cross: 21x21 transparent box with a 3 px bar each way; not clickable so presses reach the screen */
+  s_tcal.target = lv_obj_create(scr_touch_cal);
+  lv_obj_remove_style_all(s_tcal.target);
+  lv_obj_set_size(s_tcal.target, 21, 21);
+  lv_obj_remove_flag(s_tcal.target, LV_OBJ_FLAG_CLICKABLE);
+  for (int k = 0; k < 2; k++) {
+    lv_obj_t *bar = lv_obj_create(s_tcal.target);
+    lv_obj_remove_style_all(bar);
+    lv_obj_set_size(bar, k ? 3 : 21, k ? 21 : 3);
+    lv_obj_center(bar);
+    lv_obj_remove_flag(bar, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_set_style_bg_opa(bar, LV_OPA_COVER, 0);
+    lv_obj_set_style_bg_color(bar, lv_color_hex(COL_TEXT), 0);
+  }
+  s_tcal.dot = lv_obj_create(s_tcal.target);
+  lv_obj_remove_style_all(s_tcal.dot);
+  lv_obj_set_size(s_tcal.dot, 7, 7);
+  lv_obj_center(s_tcal.dot);
+  lv_obj_remove_flag(s_tcal.dot, LV_OBJ_FLAG_CLICKABLE);
+  lv_obj_set_style_radius(s_tcal.dot, LV_RADIUS_CIRCLE, 0);
+  lv_obj_set_style_bg_opa(s_tcal.dot, LV_OPA_COVER, 0);
+  lv_obj_set_style_bg_color(s_tcal.dot, lv_color_hex(COL_ERROR), 0);
+
+  s_tcal.btn_row = lv_obj_create(scr_touch_cal);
+  lv_obj_remove_style_all(s_tcal.btn_row);
+  lv_obj_set_size(s_tcal.btn_row, DISP_W - 2 * MARGIN, BTN_H + 2 * GAP);
+  lv_obj_align(s_tcal.btn_row, LV_ALIGN_BOTTOM_MID, 0, -MARGIN);
+  lv_obj_remove_flag(s_tcal.btn_row, LV_OBJ_FLAG_SCROLLABLE);
+  static const char *const names[2] = {"Retry", "Save"};
+  for (int k = 0; k < 2; k++) {
+    lv_obj_t *btn = lv_btn_create(s_tcal.btn_row);
+    lv_obj_set_size(btn, 2 * BTN_W, BTN_H + GAP);
+    lv_obj_align(btn, k ? LV_ALIGN_RIGHT_MID : LV_ALIGN_LEFT_MID, 0, 0);
+    lv_obj_set_style_radius(btn, CARD_R, 0);
+    if (k) lv_obj_set_style_bg_color(btn, lv_color_hex(COL_ACCENT), 0);
+    lv_obj_t *lbl = lv_label_create(btn);
+    lv_label_set_text(lbl, names[k]);
+    lv_obj_center(lbl);
+    lv_obj_add_event_cb(btn, k ? tcal_save_cb : tcal_retry_cb, LV_EVENT_CLICKED, NULL);
+  }
+}
+
+static void show_touch_cal(screen_id_t return_to) {
+  s_tcal.return_to = return_to;
+  screen_show(SCR_TOUCH_CAL);
+}
+
+/* ─── Calibration: confirm, then open the calibration screen ─── */
 typedef enum { CAL_TOUCH = 0 } cal_type_t;
 
 static void cal_confirm_continue_cb(lv_event_t *e) {
@@ -739,13 +1202,7 @@ static void cal_confirm_continue_cb(lv_event_t *e) {
   cal_type_t which = (cal_type_t)(intptr_t)lv_obj_get_user_data(btn);
   if (msgbox) lv_msgbox_close(msgbox);
   switch (which) {
-    case CAL_TOUCH:  performTouchCalibration();  break;
-  }
-  if (scr_calibration) {
-    lv_screen_load(scr_calibration);
-    /* TFT was drawn by performTouchCalibration(); force full redraw so menu isn’t left half‑green */
-    lv_obj_invalidate(scr_calibration);
-    lv_refr_now(disp);
+    case CAL_TOUCH:  show_touch_cal(SCR_CALIBRATION);  break;
   }
 }
 
@@ -769,7 +1226,7 @@ static void show_cal_confirm(cal_type_t which, const char *title, const char *bo
 static void act_touch_cal(lv_event_t *e) {
   (void)e;
   show_cal_confirm(CAL_TOUCH, "Touch calibration",
-    "Full-screen prompts will appear. Touch the crosshairs. You will return here when done.");
+    "Touch and hold each of the 5 crosses, then check the result with Save. Measurement keeps running.");
 }
 
 
@@ -1045,18 +1502,17 @@ static void open_keypad_modal(void) {
   keypad_modal = lv_obj_create(lv_screen_active());
   lv_obj_set_size(keypad_modal, DISP_W - 2 * MARGIN, 200);
   lv_obj_center(keypad_modal);
-  lv_obj_set_style_bg_color(keypad_modal, lv_color_hex(COL_CARD), 0);
-  lv_obj_set_style_radius(keypad_modal, CARD_R, 0);
+  lv_obj_add_style(keypad_modal, &ui_style_card, 0);
   lv_obj_set_style_pad_all(keypad_modal, PAD, 0);
   lv_obj_remove_flag(keypad_modal, LV_OBJ_FLAG_SCROLLABLE);
 
   lv_obj_t *lbl = lv_label_create(keypad_modal);
   lv_label_set_text(lbl, "Enter value");
-  lv_obj_set_style_text_color(lbl, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(lbl, &ui_style_text, 0);
   lv_obj_align(lbl, LV_ALIGN_TOP_LEFT, 0, 0);
 
   keypad_display = lv_label_create(keypad_modal);
-  lv_obj_set_style_text_color(keypad_display, lv_color_hex(COL_ACCENT), 0);
+  lv_obj_add_style(keypad_display, &ui_style_text_accent, 0);
   lv_obj_set_style_text_font(keypad_display, LV_FONT_DEFAULT, 0);
   lv_obj_set_width(keypad_display, DISP_W - 2 * MARGIN - 2 * PAD);
   lv_label_set_long_mode(keypad_display, LV_LABEL_LONG_CLIP);
@@ -1153,8 +1609,7 @@ static void open_edit_modal(edit_field_t field) {
   edit_modal = lv_obj_create(lv_screen_active());
   lv_obj_set_size(edit_modal, DISP_W - 2 * MARGIN, 200);
   lv_obj_center(edit_modal);
-  lv_obj_set_style_bg_color(edit_modal, lv_color_hex(COL_CARD), 0);
-  lv_obj_set_style_radius(edit_modal, CARD_R, 0);
+  lv_obj_add_style(edit_modal, &ui_style_card, 0);
   lv_obj_set_style_pad_all(edit_modal, PAD, 0);
   lv_obj_remove_flag(edit_modal, LV_OBJ_FLAG_SCROLLABLE);
 
@@ -1210,14 +1665,14 @@ static void open_edit_modal(edit_field_t field) {
 
   lv_obj_t *lbl = lv_label_create(edit_modal);
   lv_label_set_text(lbl, edit_title);
-  lv_obj_set_style_text_color(lbl, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(lbl, &ui_style_text, 0);
   lv_obj_align(lbl, LV_ALIGN_TOP_LEFT, 0, 0);
 
   /* Value row: [ < ]  before digit after  [ > ] — selected digit highlighted + underlined */
   lv_obj_t *value_row = lv_obj_create(edit_modal);
   lv_obj_set_size(value_row, (DISP_W - 2 * MARGIN) - 2 * PAD, 56);
   lv_obj_align(value_row, LV_ALIGN_TOP_LEFT, 0, 28);
-  lv_obj_set_style_bg_color(value_row, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(value_row, &ui_style_bg, 0);
   lv_obj_set_style_radius(value_row, 4, 0);
   lv_obj_set_style_border_color(value_row, lv_color_hex(COL_ACCENT), 0);
   lv_obj_set_style_border_width(value_row, 2, 0);
@@ -1232,7 +1687,7 @@ static void open_edit_modal(edit_field_t field) {
   lv_obj_set_style_bg_color(btn_left, lv_color_hex(COL_CARD), 0);
   lv_obj_t *lbl_left = lv_label_create(btn_left);
   lv_label_set_text(lbl_left, "<");
-  lv_obj_set_style_text_color(lbl_left, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(lbl_left, &ui_style_text, 0);
   lv_obj_center(lbl_left);
   lv_obj_add_event_cb(btn_left, edit_cursor_left_cb, LV_EVENT_CLICKED, NULL);
 
@@ -1267,12 +1722,12 @@ static void open_edit_modal(edit_field_t field) {
   lv_obj_set_style_bg_color(btn_right, lv_color_hex(COL_CARD), 0);
   lv_obj_t *lbl_right = lv_label_create(btn_right);
   lv_label_set_text(lbl_right, ">");
-  lv_obj_set_style_text_color(lbl_right, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(lbl_right, &ui_style_text, 0);
   lv_obj_center(lbl_right);
   lv_obj_add_event_cb(btn_right, edit_cursor_right_cb, LV_EVENT_CLICKED, NULL);
 
   edit_step_label = lv_label_create(edit_modal);
-  lv_obj_set_style_text_color(edit_step_label, lv_color_hex(COL_MUTED), 0);
+  lv_obj_add_style(edit_step_label, &ui_style_text_muted, 0);
   lv_obj_align(edit_step_label, LV_ALIGN_TOP_LEFT, 0, 88);
 
   edit_refresh_value_label();
@@ -1286,7 +1741,7 @@ static void open_edit_modal(edit_field_t field) {
   lv_obj_set_style_border_width(btn_minus, 2, 0);
   lv_obj_t *lbl_minus = lv_label_create(btn_minus);
   lv_label_set_text(lbl_minus, "-");
-  lv_obj_set_style_text_color(lbl_minus, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(lbl_minus, &ui_style_text, 0);
   lv_obj_center(lbl_minus);
   lv_obj_add_event_cb(btn_minus, edit_minus_cb, LV_EVENT_CLICKED, NULL);
   lv_obj_add_event_cb(btn_minus, edit_minus_cb, LV_EVENT_LONG_PRESSED_REPEAT, NULL);
@@ -1308,7 +1763,7 @@ static void open_edit_modal(edit_field_t field) {
   lv_obj_set_style_bg_color(btn_keypad, lv_color_hex(COL_CARD), 0);
   lv_obj_t *lbl_kp = lv_label_create(btn_keypad);
   lv_label_set_text(lbl_kp, "123");
-  lv_obj_set_style_text_color(lbl_kp, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(lbl_kp, &ui_style_text, 0);
   lv_obj_center(lbl_kp);
   lv_obj_add_event_cb(btn_keypad, (lv_event_cb_t)open_keypad_modal, LV_EVENT_CLICKED, NULL);
 
@@ -1318,7 +1773,7 @@ static void open_edit_modal(edit_field_t field) {
   lv_obj_set_style_bg_color(btn_cancel, lv_color_hex(COL_CARD), 0);
   lv_obj_t *lbl_cancel = lv_label_create(btn_cancel);
   lv_label_set_text(lbl_cancel, "Cancel");
-  lv_obj_set_style_text_color(lbl_cancel, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(lbl_cancel, &ui_style_text, 0);
   lv_obj_center(lbl_cancel);
   lv_obj_add_event_cb(btn_cancel, edit_cancel_cb, LV_EVENT_CLICKED, NULL);
 
@@ -1413,7 +1868,7 @@ static void apply_known_load_cb(lv_event_t *e) {
   maxCurrent = correctedMaxCurrent;
   shuntResistance = correctedShunt;
   update_shunt_labels();
-  if (scr_shunt_calibration) lv_screen_load(scr_shunt_calibration);
+  screen_show(SCR_SHUNT_CALIBRATION);
   lv_obj_t *msgbox = lv_msgbox_create(lv_screen_active());
   lv_msgbox_add_title(msgbox, "Corrections applied");
   lv_msgbox_add_text(msgbox, "Shunt values updated from known load.");
@@ -1427,7 +1882,7 @@ static void apply_calc_mv_cb(lv_event_t *e) {
   maxCurrent = calc_mv_current_a;
   shuntResistance = (calc_mv_voltage_mv / 1000.0f) / calc_mv_current_a;
   update_shunt_labels();
-  if (scr_shunt_calibration) lv_screen_load(scr_shunt_calibration);
+  screen_show(SCR_SHUNT_CALIBRATION);
   lv_obj_t *msgbox = lv_msgbox_create(lv_screen_active());
   lv_msgbox_add_title(msgbox, "Values applied");
   lv_msgbox_add_text(msgbox, "Shunt values set from mV/A.");
@@ -1442,7 +1897,7 @@ static void shunt_calibration_warning_ok_cb(lv_event_t *e) {
 
 static void open_known_load_cb(lv_event_t *e) {
   (void)e;
-  if (scr_known_load) lv_screen_load(scr_known_load);
+  screen_show(SCR_KNOWN_LOAD);
   lv_obj_t *msgbox = lv_msgbox_create(lv_screen_active());
   lv_msgbox_add_title(msgbox, "Shunt calibration");
   lv_msgbox_add_text(msgbox, "For a reliable calibration: use a stable known load and an accurate reference meter.");
@@ -1452,7 +1907,7 @@ static void open_known_load_cb(lv_event_t *e) {
 
 static void open_calc_mv_cb(lv_event_t *e) {
   (void)e;
-  if (scr_calc_mv) lv_screen_load(scr_calc_mv);
+  screen_show(SCR_CALC_MV);
 }
 
 typedef struct {
@@ -1483,7 +1938,7 @@ static void standard_confirm_use_cb(lv_event_t *e) {
     pending_standard_for_confirm = NULL;
   }
   if (msgbox) lv_msgbox_close(msgbox);
-  if (scr_shunt_calibration) lv_screen_load(scr_shunt_calibration);
+  screen_show(SCR_SHUNT_CALIBRATION);
 }
 
 static void standard_confirm_cancel_cb(lv_event_t *e) {
@@ -1521,18 +1976,17 @@ static lv_obj_t *add_setting_row(lv_obj_t *parent, const char *name, const char
   lv_obj_t *row = lv_btn_create(parent);
   lv_obj_set_size(row, DISP_W - 2 * MARGIN, ROW_H);
   lv_obj_set_pos(row, MARGIN, y);
-  lv_obj_set_style_radius(row, CARD_R, 0);
-  lv_obj_set_style_bg_color(row, lv_color_hex(COL_CARD), 0);
+  lv_obj_add_style(row, &ui_style_card, 0);
   lv_obj_clear_flag(row, LV_OBJ_FLAG_SCROLLABLE);
 
   lv_obj_t *lbl = lv_label_create(row);
   lv_label_set_text(lbl, name);
-  lv_obj_set_style_text_color(lbl, lv_color_hex(COL_MUTED), 0);
+  lv_obj_add_style(lbl, &ui_style_text_muted, 0);
   lv_obj_align(lbl, LV_ALIGN_LEFT_MID, PAD, 0);
 
   lv_obj_t *val = lv_label_create(row);
   lv_label_set_text(val, value);
-  lv_obj_set_style_text_color(val, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(val, &ui_style_text, 0);
   lv_obj_align(val, LV_ALIGN_RIGHT_MID, -PAD, 0);
 
   if (tap_cb) lv_obj_add_event_cb(row, tap_cb, LV_EVENT_CLICKED, NULL);
@@ -1544,17 +1998,16 @@ static lv_obj_t *add_category_row(lv_obj_t *parent, const char *name, lv_coord_t
   lv_obj_t *row = lv_btn_create(parent);
   lv_obj_set_size(row, DISP_W - 2 * MARGIN, LIST_ITEM_H);
   lv_obj_set_pos(row, MARGIN, y);
-  lv_obj_set_style_radius(row, CARD_R, 0);
-  lv_obj_set_style_bg_color(row, lv_color_hex(COL_CARD), 0);
+  lv_obj_add_style(row, &ui_style_card, 0);
 
   lv_obj_t *lbl = lv_label_create(row);
   lv_label_set_text(lbl, name);
-  lv_obj_set_style_text_color(lbl, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(lbl, &ui_style_text, 0);
   lv_obj_set_pos(lbl, PAD, (LIST_ITEM_H - 14) / 2);
 
   lv_obj_t *chev = lv_label_create(row);
   lv_label_set_text(chev, ">");
-  lv_obj_set_style_text_color(chev, lv_color_hex(COL_ACCENT), 0);
+  lv_obj_add_style(chev, &ui_style_text_accent, 0);
   lv_obj_align(chev, LV_ALIGN_RIGHT_MID, -PAD, 0);
 
   if (cb) lv_obj_add_event_cb(row, cb, LV_EVENT_CLICKED, NULL);
@@ -1565,18 +2018,17 @@ static lv_obj_t *add_setting_row_flex(lv_obj_t *parent, const char *name, const
     lv_event_cb_t tap_cb) {
   lv_obj_t *row = lv_btn_create(parent);
   lv_obj_set_size(row, DISP_W - 2 * MARGIN, ROW_H);
-  lv_obj_set_style_radius(row, CARD_R, 0);
-  lv_obj_set_style_bg_color(row, lv_color_hex(COL_CARD), 0);
+  lv_obj_add_style(row, &ui_style_card, 0);
   lv_obj_clear_flag(row, LV_OBJ_FLAG_SCROLLABLE);
 
   lv_obj_t *lbl = lv_label_create(row);
   lv_label_set_text(lbl, name);
-  lv_obj_set_style_text_color(lbl, lv_color_hex(COL_MUTED), 0);
+  lv_obj_add_style(lbl, &ui_style_text_muted, 0);
   lv_obj_set_pos(lbl, PAD, (ROW_H - 14) / 2);
 
   lv_obj_t *val = lv_label_create(row);
   lv_label_set_text(val, value);
-  lv_obj_set_style_text_color(val, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(val, &ui_style_text, 0);
   lv_obj_align(val, LV_ALIGN_RIGHT_MID, -PAD, 0);
 
   if (tap_cb) lv_obj_add_event_cb(row, tap_cb, LV_EVENT_CLICKED, NULL);
@@ -1586,34 +2038,201 @@ static lv_obj_t *add_setting_row_flex(lv_obj_t *parent, const char *name, const
 static lv_obj_t *add_category_row_flex(lv_obj_t *parent, const char *name, lv_event_cb_t cb) {
   lv_obj_t *row = lv_btn_create(parent);
   lv_obj_set_size(row, DISP_W - 2 * MARGIN, LIST_ITEM_H);
-  lv_obj_set_style_radius(row, CARD_R, 0);
-  lv_obj_set_style_bg_color(row, lv_color_hex(COL_CARD), 0);
+  lv_obj_add_style(row, &ui_style_card, 0);
   lv_obj_clear_flag(row, LV_OBJ_FLAG_SCROLLABLE);
 
   lv_obj_t *lbl = lv_label_create(row);
   lv_label_set_text(lbl, name);
-  lv_obj_set_style_text_color(lbl, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(lbl, &ui_style_text, 0);
   lv_obj_set_pos(lbl, PAD, (LIST_ITEM_H - 14) / 2);
 
   lv_obj_t *chev = lv_label_create(row);
   lv_label_set_text(chev, ">");
-  lv_obj_set_style_text_color(chev, lv_color_hex(COL_ACCENT), 0);
+  lv_obj_add_style(chev, &ui_style_text_accent, 0);
   lv_obj_align(chev, LV_ALIGN_RIGHT_MID, -PAD, 0);
 
   if (cb) lv_obj_add_event_cb(row, cb, LV_EVENT_CLICKED, NULL);
   return row;
 }
 
+/* ─── Large value tiles (Current, Voltage) ─── */
+#ifndef UI_DIGIT_CACHE
+#define UI_DIGIT_CACHE 1  /* 0: plain labels, the path the glyph cache is benchmarked against */
+#endif
+#define VALUE_USE_CACHE (UI_DIGIT_CACHE && LV_FONT_MONTSERRAT_20)
+
+static lv_obj_t *value_label_create(lv_obj_t *card, const char *text) {
+  lv_obj_t *lbl = lv_label_create(card);
+  lv_label_set_text(lbl, text);
+  lv_obj_add_style(lbl, &ui_style_text_accent, 0);
+  lv_obj_set_pos(lbl, PAD, 22);
+#if LV_FONT_MONTSERRAT_20
+  lv_obj_add_style(lbl, &ui_style_text_large, 0);
+#endif
+  return lbl;
+}
+
+static lv_obj_t *value_create(lv_obj_t *card, const char *text, int32_t w) {
+#if VALUE_USE_CACHE
+  lv_obj_t *obj = ui_digits_create(card);
+  if (obj) {
+    lv_obj_set_width(obj, w);
+    lv_obj_set_pos(obj, PAD, 22);
+    ui_digits_set_text(obj, text);
+    return obj;
+  }
+#endif
+  (void)w;
+  return value_label_create(card, text);
+}
+
+static void value_set_text(lv_obj_t *obj, const char *text) {
+#if VALUE_USE_CACHE
+  if (lv_obj_get_class(obj) != &lv_label_class) {
+    ui_digits_set_text(obj, text);
+    return;
+  }
+#endif
+  lv_label_set_text(obj, text);
+}
+
+/* ─── Tile sparklines (Current, Voltage, Power): one column per sample, shifted in place ─── */
+#ifndef UI_SPARK_H
+#define UI_SPARK_H          20
+#endif
+#ifndef UI_SPARK_BUDGET_US
+#define UI_SPARK_BUDGET_US  1500  /* push + render of all three, per 200 ms tick */
+#endif
+
+static lv_obj_t *spark_i = NULL;
+static lv_obj_t *spark_v = NULL;
+static lv_obj_t *spark_p = NULL;
+static uint32_t  s_spark_push_us_sum = 0;
+static uint32_t  s_spark_push_us_max = 0;
+static uint32_t  s_spark_pushes = 0;
+
+/* Sparkline along the bottom of a tile's content area, inset like the value text */
+static lv_obj_t *spark_create(lv_obj_t *card, float min_span, uint32_t color) {
+  lv_obj_update_layout(card);
+  int32_t w = lv_obj_get_content_width(card) - 2 * PAD;
+  lv_obj_t *sp = ui_sparkline_create(card, w, UI_SPARK_H, min_span, lv_color_hex(color), lv_color_hex(COL_CARD));
+  if (sp) lv_obj_align(sp, LV_ALIGN_BOTTOM_LEFT, PAD, 0);
+  return sp;
+}
+
+/* visible = false while blanked: pixel buffers only, no LVGL calls; spark_refresh_all() on wake */
+static void spark_push_all(bool connected, float voltage, float current, float power, bool visible) {
+  void (*push)(lv_obj_t *, float) = visible ? ui_sparkline_push : ui_sparkline_append;
+  uint32_t t0 = micros();
+  push(spark_i, connected ? current : NAN);
+  push(spark_v, connected ? voltage : NAN);
+  push(spark_p, connected ? power : NAN);
+  uint32_t dt = micros() - t0;
+  s_spark_push_us_sum += dt;
+  s_spark_pushes++;
+  if (dt > s_spark_push_us_max) {
+    s_spark_push_us_max = dt;
+    if (dt > UI_SPARK_BUDGET_US / 2) Serial.printf("UI: sparkline push %lu us (budget %u us incl. render)\n",
+                                                   (unsigned long)dt, UI_SPARK_BUDGET_US);
+  }
+}
+
+static void spark_refresh_all(void) {
+  ui_sparkline_refresh(spark_i);
+  ui_sparkline_refresh(spark_v);
+  ui_sparkline_refresh(spark_p);
+}
+
+/* ─── Tile values: sampler window means, with a peak-hold marker for current and power ─── */
+#ifndef UI_PEAK_HOLD_MS
+#define UI_PEAK_HOLD_MS 3000
+#endif
+
+typedef struct {
+  float voltage;
+  float current;
+  float power;
+  float current_peak;  /* largest |I| in the window, signed */
+  float power_peak;
+  float v_min, v_max;  /* window extremes, for the history envelope */
+  float i_min, i_max;
+  float p_min, p_max;
+} ui_sample_t;
+
+typedef struct {
+  float    value;
+  uint32_t until_ms;
+} peak_hold_t;
+
+static peak_hold_t s_peak_i, s_peak_p;
+
+static float window_peak(const SensorAggregate *a) {
+  return fabsf(a->max) >= fabsf(a->min) ? a->max : a->min;
+}
+
+/* Everything since the previous UI tick from the full-rate sampler; point reads if it has nothing */
+static void ui_sample(ui_sample_t *out) {
+  SensorWindow w;
+  if (SensorReadWindow(SENSOR_CONSUMER_UI, &w)) {
+    out->voltage = w.voltage.mean;
+    out->current = w.current.mean;
+    out->power = w.power.mean;
+    out->current_peak = window_peak(&w.current);
+    out->power_peak = window_peak(&w.power);
+    out->v_min = w.voltage.min;
+    out->v_max = w.voltage.max;
+    out->i_min = w.current.min;
+    out->i_max = w.current.max;
+    out->p_min = w.power.min;
+    out->p_max = w.power.max;
+  } else {
+    out->voltage = SensorGetBusVoltage();
+    out->current = SensorGetCurrent();
+    out->power = SensorGetPower();
+    out->current_peak = out->current;
+    out->power_peak = out->power;
+    out->v_min = out->v_max = out->voltage;
+    out->i_min = out->i_max = out->current;
+    out->p_min = out->p_max = out->power;
+  }
+}
+
+/* Keep the largest magnitude for UI_PEAK_HOLD_MS, then follow the signal again */
+static float peak_hold(peak_hold_t *h, float peak) {
+  uint32_t now = lv_tick_get();
+  if (fabsf(peak) >= fabsf(h->value) || (int32_t)(now - h->until_ms) >= 0) {
+    h->value = peak;
+    h->until_ms = now + UI_PEAK_HOLD_MS;
+  }
+  return h->value;
+}
+
+/* Small marker in the tile's title row, right-aligned */
+static lv_obj_t *peak_label_create(lv_obj_t *card) {
+  lv_obj_t *lbl = lv_label_create(card);
+  lv_label_set_text(lbl, "");
+  lv_obj_add_style(lbl, &ui_style_text_muted, 0);
+  lv_obj_align(lbl, LV_ALIGN_TOP_RIGHT, -PAD, 2);
+  return lbl;
+}
+
+static void peak_label_set(lv_obj_t *lbl, float peak, int sig, const char *unit) {
+  char buf[24];
+  int d = decimals_for_magnitude((double)peak, sig, 3);
+  snprintf(buf, sizeof(buf), LV_SYMBOL_UP " %.*f %s", d, (double)peak, unit);
+  lv_label_set_text(lbl, buf);
+}
+
 /* ─── Screen 1: Monitor ─── */
 static void build_monitor(void) {
   scr_monitor = lv_obj_create(NULL);
-  lv_obj_set_style_bg_color(scr_monitor, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(scr_monitor, &ui_style_bg, 0);
   lv_obj_remove_flag(scr_monitor, LV_OBJ_FLAG_SCROLLABLE);
 
   lv_obj_t *hdr = add_header(scr_monitor, NULL, false);  /* No static title; status shows "SmartShunt INA228 27.8C" */
   label_status = lv_label_create(hdr);
   lv_label_set_text(label_status, "CYD SmartShunt INA? N/A");
-  lv_obj_set_style_text_color(label_status, lv_color_hex(COL_MUTED), 0);
+  lv_obj_add_style(label_status, &ui_style_text_muted, 0);
   lv_obj_set_width(label_status, DISP_W - 2 * MARGIN - BTN_W - GAP);
   lv_label_set_long_mode(label_status, LV_LABEL_LONG_CLIP);
   lv_obj_align(label_status, LV_ALIGN_LEFT_MID, MARGIN, 0);
@@ -1628,42 +2247,31 @@ static void build_monitor(void) {
   lv_obj_t *card_i = lv_obj_create(scr_monitor);
   lv_obj_set_size(card_i, card_w, card_h);
   lv_obj_set_pos(card_i, MARGIN, top);
-  lv_obj_set_style_bg_color(card_i, lv_color_hex(COL_CARD), 0);
-  lv_obj_set_style_radius(card_i, CARD_R, 0);
+  lv_obj_add_style(card_i, &ui_style_card, 0);
   lv_obj_remove_flag(card_i, LV_OBJ_FLAG_SCROLLABLE);
   lv_obj_add_flag(card_i, LV_OBJ_FLAG_CLICKABLE);
   lv_obj_add_event_cb(card_i, hist_card_click_cb, LV_EVENT_CLICKED, (void *)(intptr_t)HIST_I);
   lv_obj_t *lbl_i = lv_label_create(card_i);
   lv_label_set_text(lbl_i, "Current");
-  lv_obj_set_style_text_color(lbl_i, lv_color_hex(COL_MUTED), 0);
+  lv_obj_add_style(lbl_i, &ui_style_text_muted, 0);
   lv_obj_set_pos(lbl_i, PAD, 2);
-  label_current = lv_label_create(card_i);
-  lv_label_set_text(label_current, "0.000 A");
-  lv_obj_set_style_text_color(label_current, lv_color_hex(COL_ACCENT), 0);
-  lv_obj_set_pos(label_current, PAD, 22);
-#if LV_FONT_MONTSERRAT_20
-  lv_obj_set_style_text_font(label_current, &lv_font_montserrat_20, 0);
-#endif
+  label_current = value_create(card_i, "0.000 A", card_w - 2 * PAD);
+  label_peak_i = peak_label_create(card_i);
+  spark_i = spark_create(card_i, 0.05f, COL_ACCENT);
 
   lv_obj_t *card_v = lv_obj_create(scr_monitor);
   lv_obj_set_size(card_v, card_w, card_h);
   lv_obj_set_pos(card_v, MARGIN + card_w + GAP, top);
-  lv_obj_set_style_bg_color(card_v, lv_color_hex(COL_CARD), 0);
-  lv_obj_set_style_radius(card_v, CARD_R, 0);
+  lv_obj_add_style(card_v, &ui_style_card, 0);
   lv_obj_remove_flag(card_v, LV_OBJ_FLAG_SCROLLABLE);
   lv_obj_add_flag(card_v, LV_OBJ_FLAG_CLICKABLE);
   lv_obj_add_event_cb(card_v, hist_card_click_cb, LV_EVENT_CLICKED, (void *)(intptr_t)HIST_V);
   lv_obj_t *lbl_v = lv_label_create(card_v);
   lv_label_set_text(lbl_v, "Voltage");
-  lv_obj_set_style_text_color(lbl_v, lv_color_hex(COL_MUTED), 0);
+  lv_obj_add_style(lbl_v, &ui_style_text_muted, 0);
   lv_obj_set_pos(lbl_v, PAD, 2);
-  label_voltage = lv_label_create(card_v);
-  lv_label_set_text(label_voltage, "0.00 V");
-  lv_obj_set_style_text_color(label_voltage, lv_color_hex(COL_ACCENT), 0);
-  lv_obj_set_pos(label_voltage, PAD, 22);
-#if LV_FONT_MONTSERRAT_20
-  lv_obj_set_style_text_font(label_voltage, &lv_font_montserrat_20, 0);
-#endif
+  label_voltage = value_create(card_v, "0.00 V", card_w - 2 * PAD);
+  spark_v = spark_create(card_v, 0.05f, COL_ACCENT);
 
   top += card_h + GAP;
   /* Secondary: Power + Energy – same card layout as Current/Voltage (label top, value below), white value text */
@@ -1671,43 +2279,43 @@ static void build_monitor(void) {
     lv_obj_t *card_p = lv_btn_create(scr_monitor);
     lv_obj_set_size(card_p, card_w, card_h);
     lv_obj_set_pos(card_p, MARGIN, top);
-    lv_obj_set_style_radius(card_p, CARD_R, 0);
-    lv_obj_set_style_bg_color(card_p, lv_color_hex(COL_CARD), 0);
+    lv_obj_add_style(card_p, &ui_style_card, 0);
     lv_obj_clear_flag(card_p, LV_OBJ_FLAG_SCROLLABLE);
     lv_obj_add_flag(card_p, LV_OBJ_FLAG_CLICKABLE);
     lv_obj_add_event_cb(card_p, hist_card_click_cb, LV_EVENT_CLICKED, (void *)(intptr_t)HIST_P);
     lv_obj_t *lbl = lv_label_create(card_p);
     lv_label_set_text(lbl, "Power");
-    lv_obj_set_style_text_color(lbl, lv_color_hex(COL_MUTED), 0);
+    lv_obj_add_style(lbl, &ui_style_text_muted, 0);
     lv_obj_set_pos(lbl, PAD, 2);
     label_power = lv_label_create(card_p);
     lv_label_set_text(label_power, "0.0 W");
-    lv_obj_set_style_text_color(label_power, lv_color_hex(COL_TEXT), 0);
+    lv_obj_add_style(label_power, &ui_style_text, 0);
     lv_obj_set_pos(label_power, PAD, 22);
 #if LV_FONT_MONTSERRAT_20
-    lv_obj_set_style_text_font(label_power, &lv_font_montserrat_20, 0);
+    lv_obj_add_style(label_power, &ui_style_text_large, 0);
 #endif
+    spark_p = spark_create(card_p, 0.5f, COL_TEXT);
+    label_peak_p = peak_label_create(card_p);
   }
   {
     lv_obj_t *card_e = lv_btn_create(scr_monitor);
     lv_obj_set_size(card_e, card_w, card_h);
     lv_obj_set_pos(card_e, MARGIN + card_w + GAP, top);
-    lv_obj_set_style_radius(card_e, CARD_R, 0);
-    lv_obj_set_style_bg_color(card_e, lv_color_hex(COL_CARD), 0);
+    lv_obj_add_style(card_e, &ui_style_card, 0);
     lv_obj_clear_flag(card_e, LV_OBJ_FLAG_SCROLLABLE);
     lv_obj_add_flag(card_e, LV_OBJ_FLAG_CLICKABLE);
     lv_obj_add_event_cb(card_e, hist_card_click_cb, LV_EVENT_CLICKED, (void *)(intptr_t)HIST_E);
     lv_obj_add_event_cb(card_e, show_reset_energy_confirm_from_dashboard, LV_EVENT_LONG_PRESSED, NULL);
     lv_obj_t *lbl = lv_label_create(card_e);
     lv_label_set_text(lbl, "Energy");
-    lv_obj_set_style_text_color(lbl, lv_color_hex(COL_MUTED), 0);
+    lv_obj_add_style(lbl, &ui_style_text_muted, 0);
     lv_obj_set_pos(lbl, PAD, 2);
     label_energy = lv_label_create(card_e);
     lv_label_set_text(label_energy, "0.0 Wh");
-    lv_obj_set_style_text_color(label_energy, lv_color_hex(COL_TEXT), 0);
+    lv_obj_add_style(label_energy, &ui_style_text, 0);
     lv_obj_set_pos(label_energy, PAD, 22);
 #if LV_FONT_MONTSERRAT_20
-    lv_obj_set_style_text_font(label_energy, &lv_font_montserrat_20, 0);
+    lv_obj_add_style(label_energy, &ui_style_text_large, 0);
 #endif
   }
 }
@@ -1715,7 +2323,7 @@ static void build_monitor(void) {
 /* ─── Screen 2: Settings home (category list) ─── */
 static void build_settings_home(void) {
   scr_settings_home = lv_obj_create(NULL);
-  lv_obj_set_style_bg_color(scr_settings_home, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(scr_settings_home, &ui_style_bg, 0);
   lv_obj_remove_flag(scr_settings_home, LV_OBJ_FLAG_SCROLLABLE);
 
   add_header_back_to_monitor(scr_settings_home, "Settings");
@@ -1724,9 +2332,7 @@ static void build_settings_home(void) {
   lv_obj_t *list = lv_obj_create(scr_settings_home);
   lv_obj_set_size(list, DISP_W, DISP_H - HEADER_H);
   lv_obj_set_pos(list, 0, HEADER_H);
-  lv_obj_set_style_bg_color(list, lv_color_hex(COL_BG), 0);
-  lv_obj_set_style_pad_all(list, MARGIN, 0);
-  lv_obj_set_style_pad_row(list, GAP, 0);
+  lv_obj_add_style(list, &ui_style_list, 0);
   lv_obj_set_flex_flow(list, LV_FLEX_FLOW_COLUMN);
   lv_obj_set_scrollbar_mode(list, LV_SCROLLBAR_MODE_AUTO);
   lv_obj_set_scroll_dir(list, LV_DIR_VER);
@@ -1734,6 +2340,7 @@ static void build_settings_home(void) {
   add_category_row_flex(list, "Measurement  >", to_measurement);
   add_category_row_flex(list, "Calibration  >", to_calibration);
   add_category_row_flex(list, "Data  >", to_data);
+  add_category_row_flex(list, "Scope  >", to_scope);
   add_category_row_flex(list, "Integration  >", to_integration);
   add_category_row_flex(list, "System  >", to_system);
   add_category_row_flex(list, "About  >", to_about);
@@ -1742,7 +2349,7 @@ static void build_settings_home(void) {
 /* ─── Screen 3: Measurement ─── */
 static void build_measurement(void) {
   scr_measurement = lv_obj_create(NULL);
-  lv_obj_set_style_bg_color(scr_measurement, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(scr_measurement, &ui_style_bg, 0);
   lv_obj_remove_flag(scr_measurement, LV_OBJ_FLAG_SCROLLABLE);
 
   add_header_back_to_settings(scr_measurement, "Measurement");
@@ -1754,7 +2361,7 @@ static void build_measurement(void) {
 /* ─── Screen 4: Calibration ─── */
 static void build_calibration(void) {
   scr_calibration = lv_obj_create(NULL);
-  lv_obj_set_style_bg_color(scr_calibration, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(scr_calibration, &ui_style_bg, 0);
   lv_obj_remove_flag(scr_calibration, LV_OBJ_FLAG_SCROLLABLE);
 
   add_header_back_to_settings(scr_calibration, "Calibration");
@@ -1766,7 +2373,7 @@ static void build_calibration(void) {
 
 static void build_shunt_calibration(void) {
   scr_shunt_calibration = lv_obj_create(NULL);
-  lv_obj_set_style_bg_color(scr_shunt_calibration, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(scr_shunt_calibration, &ui_style_bg, 0);
   lv_obj_remove_flag(scr_shunt_calibration, LV_OBJ_FLAG_SCROLLABLE);
 
   add_header_back_to_calibration(scr_shunt_calibration, "Shunt calibration");
@@ -1774,9 +2381,7 @@ static void build_shunt_calibration(void) {
   lv_obj_t *list = lv_obj_create(scr_shunt_calibration);
   lv_obj_set_size(list, DISP_W, DISP_H - HEADER_H);
   lv_obj_set_pos(list, 0, HEADER_H);
-  lv_obj_set_style_bg_color(list, lv_color_hex(COL_BG), 0);
-  lv_obj_set_style_pad_all(list, MARGIN, 0);
-  lv_obj_set_style_pad_row(list, GAP, 0);
+  lv_obj_add_style(list, &ui_style_list, 0);
   lv_obj_set_flex_flow(list, LV_FLEX_FLOW_COLUMN);
 
   label_shunt_max = add_setting_row_flex(list, "Max current", "--", edit_max_current_cb);
@@ -1791,7 +2396,7 @@ static void build_shunt_calibration(void) {
 
 static void build_shunt_standard(void) {
   scr_shunt_standard = lv_obj_create(NULL);
-  lv_obj_set_style_bg_color(scr_shunt_standard, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(scr_shunt_standard, &ui_style_bg, 0);
   lv_obj_remove_flag(scr_shunt_standard, LV_OBJ_FLAG_SCROLLABLE);
 
   add_header_back_to_shunt(scr_shunt_standard, "Choose shunt");
@@ -1799,7 +2404,7 @@ static void build_shunt_standard(void) {
   lv_obj_t *list = lv_list_create(scr_shunt_standard);
   lv_obj_set_size(list, DISP_W, DISP_H - HEADER_H);
   lv_obj_set_pos(list, 0, HEADER_H);
-  lv_obj_set_style_bg_color(list, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(list, &ui_style_bg, 0);
 
   for (size_t i = 0; i < sizeof(k_shunt_standards) / sizeof(k_shunt_standards[0]); i++) {
     const shunt_standard_t *standard = &k_shunt_standards[i];
@@ -1813,23 +2418,21 @@ static void build_shunt_standard(void) {
 
 static void build_known_load(void) {
   scr_known_load = lv_obj_create(NULL);
-  lv_obj_set_style_bg_color(scr_known_load, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(scr_known_load, &ui_style_bg, 0);
   lv_obj_remove_flag(scr_known_load, LV_OBJ_FLAG_SCROLLABLE);
 
   add_header_back_to_shunt(scr_known_load, "Shunt calibration");
 
   lv_obj_t *hint = lv_label_create(scr_known_load);
   lv_label_set_text(hint, "Apply known load, enter reference values.");
-  lv_obj_set_style_text_color(hint, lv_color_hex(COL_MUTED), 0);
+  lv_obj_add_style(hint, &ui_style_text_muted, 0);
   lv_obj_set_width(hint, DISP_W - 2 * MARGIN);
   lv_obj_set_pos(hint, MARGIN, HEADER_H + GAP);
 
   lv_obj_t *list = lv_obj_create(scr_known_load);
   lv_obj_set_size(list, DISP_W, DISP_H - HEADER_H - ROW_H - GAP);
   lv_obj_set_pos(list, 0, HEADER_H + ROW_H + GAP);
-  lv_obj_set_style_bg_color(list, lv_color_hex(COL_BG), 0);
-  lv_obj_set_style_pad_all(list, MARGIN, 0);
-  lv_obj_set_style_pad_row(list, GAP, 0);
+  lv_obj_add_style(list, &ui_style_list, 0);
   lv_obj_set_flex_flow(list, LV_FLEX_FLOW_COLUMN);
 
   char buf[24];
@@ -1844,7 +2447,7 @@ static void build_known_load(void) {
 
 static void build_calc_mv(void) {
   scr_calc_mv = lv_obj_create(NULL);
-  lv_obj_set_style_bg_color(scr_calc_mv, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(scr_calc_mv, &ui_style_bg, 0);
   lv_obj_remove_flag(scr_calc_mv, LV_OBJ_FLAG_SCROLLABLE);
 
   add_header_back_to_shunt(scr_calc_mv, "Calc from mV/A");
@@ -1852,9 +2455,7 @@ static void build_calc_mv(void) {
   lv_obj_t *list = lv_obj_create(scr_calc_mv);
   lv_obj_set_size(list, DISP_W, DISP_H - HEADER_H);
   lv_obj_set_pos(list, 0, HEADER_H);
-  lv_obj_set_style_bg_color(list, lv_color_hex(COL_BG), 0);
-  lv_obj_set_style_pad_all(list, MARGIN, 0);
-  lv_obj_set_style_pad_row(list, GAP, 0);
+  lv_obj_add_style(list, &ui_style_list, 0);
   lv_obj_set_flex_flow(list, LV_FLEX_FLOW_COLUMN);
 
   char buf[24];
@@ -1873,54 +2474,629 @@ static void build_calc_mv(void) {
 }
 
 /* ─── Screen 5: Data ─── */
+/* Session statistics (session_stats): scope toggle, summary, reset of the shown scope */
+static lv_obj_t  *label_stats = NULL;
+static lv_obj_t  *btn_stats_scope[STATS_SCOPE_COUNT] = {NULL, NULL};
+static lv_obj_t  *label_stats_reset = NULL;
+static StatsScope s_stats_scope = STATS_SESSION;
+
+/* Compact duration: "45s", "12m", "3h05m", "2d04h" */
+static void fmt_duration(char *buf, size_t len, uint64_t s) {
+  if (s < 60) snprintf(buf, len, "%lus", (unsigned long)s);
+  else if (s < 3600) snprintf(buf, len, "%lum", (unsigned long)(s / 60));
+  else if (s < 86400) snprintf(buf, len, "%luh%02lum", (unsigned long)(s / 3600), (unsigned long)(s / 60 % 60));
+  else snprintf(buf, len, "%lud%02luh", (unsigned long)(s / 86400), (unsigned long)(s / 3600 % 24));
+}
+
+static void stats_refresh(void) {
+  if (!label_stats) return;
+  SessionStats st;
+  SessionStatsGet(s_stats_scope, &st);
+  if (st.voltage.n == 0) {
+    lv_label_set_text(label_stats, "No samples yet");
+    return;
+  }
+  uint32_t now = SessionStatsNow();
+  char span[12], chg[12], dis[12], idle[12], vmin[12], vmax[12], imin[12], imax[12], ppk[12];
+  fmt_duration(span, sizeof(span), now - st.start_t_s);
+  fmt_duration(chg, sizeof(chg), st.charge_ms / 1000);
+  fmt_duration(dis, sizeof(dis), st.discharge_ms / 1000);
+  fmt_duration(idle, sizeof(idle), st.idle_ms / 1000);
+  fmt_duration(vmin, sizeof(vmin), now - st.voltage.min_t_s);
+  fmt_duration(vmax, sizeof(vmax), now - st.voltage.max_t_s);
+  fmt_duration(imin, sizeof(imin), now - st.current.min_t_s);
+  fmt_duration(imax, sizeof(imax), now - st.current.max_t_s);
+  fmt_duration(ppk, sizeof(ppk), now - st.peak_power_t_s);
+
+  char buf[360];
+  snprintf(buf, sizeof(buf),
+           "Over %s: chg %s, dis %s, idle %s\n"
+           "V avg %.3f sd %.3f\n"
+           "   min %.3f (%s ago), max %.3f (%s ago)\n"
+           "I avg %.3f sd %.3f\n"
+           "   min %.3f (%s ago), max %.3f (%s ago)\n"
+           "P avg %.2f W, peak %.2f W (%s ago)\n"
+           "Ah in %.3f, out %.3f, net %+.3f",
+           span, chg, dis, idle,
+           st.voltage.mean, (double)SessionStatsStdDev(&st.voltage),
+           (double)st.voltage.min, vmin, (double)st.voltage.max, vmax,
+           st.current.mean, (double)SessionStatsStdDev(&st.current),
+           (double)st.current.min, imin, (double)st.current.max, imax,
+           st.power.mean, (double)st.peak_power_W, ppk,
+           st.ah_in, st.ah_out, st.ah_in - st.ah_out);
+  lv_label_set_text(label_stats, buf);
+}
+
+static void stats_scope_show(StatsScope scope) {
+  s_stats_scope = scope;
+  for (int k = 0; k < STATS_SCOPE_COUNT; k++) {
+    if (!btn_stats_scope[k]) continue;
+    lv_obj_set_style_bg_color(btn_stats_scope[k], lv_color_hex(k == (int)scope ? COL_ACCENT : COL_CARD), 0);
+  }
+  if (label_stats_reset)
+    lv_label_set_text(label_stats_reset, scope == STATS_SESSION ? "Reset session stats" : "Reset lifetime stats");
+  stats_refresh();
+}
+
+static void stats_scope_cb(lv_event_t *e) {
+  stats_scope_show((StatsScope)(intptr_t)lv_event_get_user_data(e));
+}
+
+static void confirm_reset_stats_cb(lv_event_t *e) {
+  lv_obj_t *msgbox = (lv_obj_t *)lv_event_get_user_data(e);
+  if (msgbox) lv_msgbox_close(msgbox);
+  SessionStatsReset(s_stats_scope);
+  stats_refresh();
+}
+
+static void show_reset_stats_confirm(lv_event_t *e) {
+  (void)e;
+  lv_obj_t *msgbox = lv_msgbox_create(lv_screen_active());
+  lv_msgbox_add_title(msgbox, s_stats_scope == STATS_SESSION ? "Reset session stats?" : "Reset lifetime stats?");
+  lv_msgbox_add_text(msgbox, "Clears min/max, averages, Ah in/out and charge times for this scope.");
+  lv_obj_t *btn_cancel = lv_msgbox_add_footer_button(msgbox, "Cancel");
+  lv_obj_t *btn_reset  = lv_msgbox_add_footer_button(msgbox, "Reset");
+  lv_obj_set_style_bg_color(btn_reset, lv_color_hex(COL_ERROR), 0);
+  lv_obj_add_event_cb(btn_cancel, confirm_reset_cancel_cb, LV_EVENT_CLICKED, msgbox);
+  lv_obj_add_event_cb(btn_reset,  confirm_reset_stats_cb, LV_EVENT_CLICKED, msgbox);
+}
+
+static lv_obj_t *add_data_action_row(lv_obj_t *list, const char *text, lv_event_cb_t cb) {
+  lv_obj_t *row = lv_btn_create(list);
+  lv_obj_set_size(row, DISP_W - 2 * MARGIN, LIST_ITEM_H);
+  lv_obj_add_style(row, &ui_style_card, 0);
+  lv_obj_t *lbl = lv_label_create(row);
+  lv_label_set_text(lbl, text);
+  lv_obj_add_style(lbl, &ui_style_text, 0);
+  lv_obj_set_pos(lbl, PAD, (LIST_ITEM_H - 14) / 2);
+  lv_obj_add_event_cb(row, cb, LV_EVENT_CLICKED, NULL);
+  return lbl;
+}
+
 static void build_data(void) {
   scr_data = lv_obj_create(NULL);
-  lv_obj_set_style_bg_color(scr_data, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(scr_data, &ui_style_bg, 0);
   lv_obj_remove_flag(scr_data, LV_OBJ_FLAG_SCROLLABLE);
 
   add_header_back_to_settings(scr_data, "Data");
 
-  lv_coord_t y = HEADER_H + GAP;
-  lv_obj_t *row = lv_btn_create(scr_data);
-  lv_obj_set_size(row, DISP_W - 2 * MARGIN, LIST_ITEM_H);
-  lv_obj_set_pos(row, MARGIN, y);
-  lv_obj_set_style_radius(row, CARD_R, 0);
-  lv_obj_set_style_bg_color(row, lv_color_hex(COL_CARD), 0);
-  lv_obj_t *lbl = lv_label_create(row);
-  lv_label_set_text(lbl, "Reset energy / charge");
-  lv_obj_set_style_text_color(lbl, lv_color_hex(COL_TEXT), 0);
-  lv_obj_set_pos(lbl, PAD, (LIST_ITEM_H - 14) / 2);
-  lv_obj_add_event_cb(row, show_reset_energy_confirm, LV_EVENT_CLICKED, NULL);
+  lv_obj_t *list = lv_obj_create(scr_data);
+  lv_obj_set_size(list, DISP_W, DISP_H - HEADER_H);
+  lv_obj_set_pos(list, 0, HEADER_H);
+  lv_obj_add_style(list, &ui_style_list, 0);
+  lv_obj_set_flex_flow(list, LV_FLEX_FLOW_COLUMN);
+  lv_obj_set_scrollbar_mode(list, LV_SCROLLBAR_MODE_AUTO);
+  lv_obj_set_scroll_dir(list, LV_DIR_VER);
+
+  /* Scope toggle: Session | Lifetime */
+  lv_obj_t *seg = lv_obj_create(list);
+  lv_obj_remove_style_all(seg);
+  lv_obj_set_size(seg, DISP_W - 2 * MARGIN, BTN_H);
+  lv_obj_remove_flag(seg, LV_OBJ_FLAG_SCROLLABLE);
+  static const char *const scope_names[STATS_SCOPE_COUNT] = {"Session", "Lifetime"};
+  for (int k = 0; k < STATS_SCOPE_COUNT; k++) {
+    lv_obj_t *btn = lv_btn_create(seg);
+    lv_obj_set_size(btn, (DISP_W - 2 * MARGIN - GAP) / 2, BTN_H);
+    lv_obj_align(btn, k ? LV_ALIGN_RIGHT_MID : LV_ALIGN_LEFT_MID, 0, 0);
+    lv_obj_set_style_radius(btn, CARD_R, 0);
+    lv_obj_t *lbl = lv_label_create(btn);
+    lv_label_set_text(lbl, scope_names[k]);
+    lv_obj_center(lbl);
+    lv_obj_add_event_cb(btn, stats_scope_cb, LV_EVENT_CLICKED, (void *)(intptr_t)k);
+    btn_stats_scope[k] = btn;
+  }
+
+  lv_obj_t *card = lv_obj_create(list);
+  lv_obj_set_size(card, DISP_W - 2 * MARGIN, LV_SIZE_CONTENT);
+  lv_obj_add_style(card, &ui_style_card, 0);
+  lv_obj_remove_flag(card, LV_OBJ_FLAG_SCROLLABLE);
+  label_stats = lv_label_create(card);
+  lv_obj_add_style(label_stats, &ui_style_text, 0);
+  lv_obj_set_width(label_stats, lv_pct(100));  /* wrap long min/max lines inside the card */
+
+  label_stats_reset = add_data_action_row(list, "", show_reset_stats_confirm);
+  add_data_action_row(list, "Reset energy / charge", show_reset_energy_confirm);
+  stats_scope_show(s_stats_scope);
+}
+
+/* ─── Idle display power: dim, then blank with LVGL paused; sampling keeps running ─── */
+#ifndef UI_IDLE_DIM_S
+#define UI_IDLE_DIM_S        60   /* no touch for this long: dim (0 = never) */
+#endif
+#ifndef UI_IDLE_BLANK_S
+#define UI_IDLE_BLANK_S      300  /* no touch for this long: backlight off, panel asleep, LVGL paused (0 = never) */
+#endif
+#ifndef UI_IDLE_DIM_PCT
+#define UI_IDLE_DIM_PCT      20
+#endif
+#define UI_IDLE_WAKE_POLL_MS 20   /* PENIRQ flag poll while blanked */
+
+typedef enum { IDLE_ACTIVE = 0, IDLE_DIM, IDLE_BLANK, IDLE_STATE_COUNT } idle_state_t;
+
+typedef struct {
+  uint64_t time_us;      /* wall time spent in the state */
+  uint64_t busy_us;      /* LVGL task time spent working (rendering, sampling) */
+  double   current_sum;  /* measured current, for the mean draw in the state */
+  uint32_t current_n;
+} idle_stats_t;
+
+static const char *const k_idle_names[IDLE_STATE_COUNT] = {"Active", "Dim", "Blank"};
+static idle_state_t s_idle = IDLE_ACTIVE;
+static idle_stats_t s_idle_stats[IDLE_STATE_COUNT];
+static int64_t      s_blank_next_sample_us = 0;
+
+static void idle_note_current(float current) {
+  s_idle_stats[s_idle].current_sum += current;
+  s_idle_stats[s_idle].current_n++;
+}
+
+static float idle_mean_current(const idle_stats_t *st) {
+  return st->current_n ? (float)(st->current_sum / st->current_n) : 0.0f;
+}
+
+static unsigned idle_cpu_pct(const idle_stats_t *st) {
+  return st->time_us ? (unsigned)(st->busy_us * 100 / st->time_us) : 0;
+}
+
+static void idle_enter(idle_state_t next) {
+  if (next == s_idle) return;
+  const idle_stats_t *st = &s_idle_stats[s_idle];
+  Serial.printf("Display: %s -> %s (%s so far: %lu s, mean %.3f A, UI CPU %u%%)\n", k_idle_names[s_idle],
+                k_idle_names[next], k_idle_names[s_idle], (unsigned long)(st->time_us / 1000000),
+                (double)idle_mean_current(st), idle_cpu_pct(st));
+  if (next == IDLE_BLANK) {
+    BacklightSetPercent(0);
+    tft.writecommand(TFT_SLPIN);
+    s_blank_next_sample_us = esp_timer_get_time();
+  } else {
+    BacklightSetPercent(next == IDLE_DIM ? UI_IDLE_DIM_PCT : 100);
+  }
+  s_idle = next;
+}
+
+/* LVGL timer: pick the state from the time since the last touch */
+static void idle_timer_cb(lv_timer_t *t) {
+  (void)t;
+  uint32_t inactive_s = lv_display_get_inactive_time(disp) / 1000;
+  if (UI_IDLE_BLANK_S > 0 && inactive_s >= UI_IDLE_BLANK_S) idle_enter(IDLE_BLANK);
+  else if (UI_IDLE_DIM_S > 0 && inactive_s >= UI_IDLE_DIM_S) idle_enter(IDLE_DIM);
+  else idle_enter(IDLE_ACTIVE);
+}
+
+/* Called from the LVGL task (outside lv_timer_handler) when a press was confirmed while blanked */
+static void idle_wake(void) {
+  tft.writecommand(TFT_SLPOUT);
+  delay(120);  /* ILI9341 needs 120 ms after sleep-out before it takes more commands */
+  ui_lvgl_lock();
+  s_touch_swallow = true;  /* the waking tap must not press whatever is under it */
+  lv_display_trigger_activity(disp);
+  idle_enter(IDLE_ACTIVE);
+  spark_refresh_all();  /* pixels appended while blank; drop their cached images once */
+  lv_obj_invalidate(lv_screen_active());
+  ui_lvgl_unlock();
+}
+
+static void idle_format(char *buf, size_t len) {
+  size_t n = 0;
+  for (int k = 0; k < IDLE_STATE_COUNT && n < len; k++) {
+    const idle_stats_t *st = &s_idle_stats[k];
+    n += (size_t)snprintf(buf + n, len - n, "%s%s %.3fA %u%%", k ? (k == 2 ? "\n" : "  ") : "",
+                          k_idle_names[k], (double)idle_mean_current(st), idle_cpu_pct(st));
+  }
+  if (n < len) snprintf(buf + n, len - n, "  (mean I, UI CPU)");
+}
+
+/* ─── Redraw benchmark: full-screen refresh of Monitor, Settings and History popup ─── */
+#define BENCH_ROUNDS 8
+
+static lv_obj_t *label_bench = NULL;
+static lv_obj_t *label_sys_heap = NULL;
+static uint32_t  s_first_frame_ms = 0;  /* boot to first LVGL frame on the panel */
+
+typedef struct {
+  uint32_t total_us;  /* lv_refr_now() wall time */
+  uint32_t flush_us;  /* part of it spent in my_flush_cb */
+  uint32_t style_us;  /* one style-resolution pass over the widget tree */
+  uint32_t objs;      /* widgets in the tree */
+} bench_result_t;
+
+static volatile uint32_t s_bench_sink;
+
+/* Resolve the properties every widget's draw path looks up (cascade over shared + local styles) */
+static uint32_t bench_style_walk(lv_obj_t *obj) {
+  uint32_t n = 1;
+  s_bench_sink += lv_obj_get_style_bg_color(obj, LV_PART_MAIN).red;
+  s_bench_sink += lv_obj_get_style_text_color(obj, LV_PART_MAIN).green;
+  s_bench_sink += (uint32_t)lv_obj_get_style_radius(obj, LV_PART_MAIN);
+  s_bench_sink += (uint32_t)lv_obj_get_style_pad_left(obj, LV_PART_MAIN);
+  uint32_t cnt = lv_obj_get_child_count(obj);
+  for (uint32_t k = 0; k < cnt; k++) n += bench_style_walk(lv_obj_get_child(obj, (int32_t)k));
+  return n;
+}
+
+static bench_result_t bench_screen(lv_obj_t *scr) {
+  bench_result_t r = {0, 0, 0, 0};
+  uint32_t t0 = micros();
+  for (int k = 0; k < BENCH_ROUNDS; k++) r.objs = bench_style_walk(scr);
+  r.style_us = (micros() - t0) / BENCH_ROUNDS;
+  for (int k = 0; k < BENCH_ROUNDS; k++) {
+    lv_obj_invalidate(scr);
+    s_bench_flush_us = 0;
+    uint32_t t0 = micros();
+    lv_refr_now(disp);
+    r.total_us += micros() - t0;
+    r.flush_us += s_bench_flush_us;
+  }
+  r.total_us /= BENCH_ROUNDS;
+  r.flush_us /= BENCH_ROUNDS;
+  return r;
+}
+
+/* One value-tile update: what a text change dirties, rendered without the flush */
+static uint32_t bench_tile(lv_obj_t *value) {
+  uint32_t render = 0;
+  for (int k = 0; k < BENCH_ROUNDS; k++) {
+    lv_obj_invalidate(value);
+    s_bench_flush_us = 0;
+    uint32_t t0 = micros();
+    lv_refr_now(disp);
+    render += (micros() - t0) - s_bench_flush_us;
+  }
+  return render / BENCH_ROUNDS;
+}
+
+static void bench_run_cb(lv_event_t *e) {
+  (void)e;
+  static const char *const names[3] = {"Monitor", "Settings", "History"};
+  bench_result_t r[3];
+  uint32_t tile_us = 0, tile_label_us = 0;
+
+  s_bench_active = true;
+  screen_show(SCR_MONITOR);
+  r[0] = bench_screen(scr_monitor);
+  if (label_current) {
+    tile_us = bench_tile(label_current);
+#if VALUE_USE_CACHE
+    /* Same text through the label path, in the same spot, for a direct comparison */
+    lv_obj_t *alt = value_label_create(lv_obj_get_parent(label_current), ui_digits_get_text(label_current));
+    lv_obj_add_flag(label_current, LV_OBJ_FLAG_HIDDEN);
+    tile_label_us = bench_tile(alt);
+    lv_obj_delete(alt);
+    lv_obj_remove_flag(label_current, LV_OBJ_FLAG_HIDDEN);
+#else
+    tile_label_us = tile_us;
+#endif
+  }
+  /* Sparklines: what one sample tick adds, the in-place push plus rendering the three canvases */
+  uint32_t spark_render_us = 0;
+  if (spark_i && spark_v && spark_p) {
+    for (int k = 0; k < BENCH_ROUNDS; k++) {
+      lv_obj_invalidate(spark_i);
+      lv_obj_invalidate(spark_v);
+      lv_obj_invalidate(spark_p);
+      s_bench_flush_us = 0;
+      uint32_t t0 = micros();
+      lv_refr_now(disp);
+      spark_render_us += (micros() - t0) - s_bench_flush_us;
+    }
+    spark_render_us /= BENCH_ROUNDS;
+  }
+  screen_show(SCR_SETTINGS_HOME);
+  r[1] = bench_screen(scr_settings_home);
+  screen_show(SCR_MONITOR);
+  show_history_popup(HIST_P);
+  r[2] = bench_screen(scr_monitor);
+  if (s_active_hist_popup) {
+    lv_obj_t *modal = s_active_hist_popup->modal;
+    s_active_hist_popup = NULL;
+    lv_obj_delete(modal);
+  }
+  s_bench_active = false;
+  screen_show(SCR_SYSTEM);
+
+  for (int k = 0; k < 3; k++) {
+    Serial.printf("Redraw %-8s: %6lu us total, %6lu us render, %6lu us flush (%d draw unit%s); "
+                  "style lookup %lu us / %lu objs\n", names[k],
+                  (unsigned long)r[k].total_us, (unsigned long)(r[k].total_us - r[k].flush_us),
+                  (unsigned long)r[k].flush_us, LV_DRAW_SW_DRAW_UNIT_CNT, LV_DRAW_SW_DRAW_UNIT_CNT > 1 ? "s" : "",
+                  (unsigned long)r[k].style_us, (unsigned long)r[k].objs);
+  }
+  Serial.printf("Redraw value tile: %lu us render (%s), %lu us with label drawing\n",
+                (unsigned long)tile_us, VALUE_USE_CACHE ? "glyph cache" : "label",
+                (unsigned long)tile_label_us);
+  uint32_t spark_push_avg = s_spark_pushes ? s_spark_push_us_sum / s_spark_pushes : 0;
+  uint32_t spark_tick = spark_push_avg + spark_render_us;
+  Serial.printf("Sparklines per tick: push avg %lu us (max %lu), render %lu us, total %lu us of %u us budget%s; "
+                "rescales %lu/%lu/%lu\n", (unsigned long)spark_push_avg, (unsigned long)s_spark_push_us_max,
+                (unsigned long)spark_render_us, (unsigned long)spark_tick, UI_SPARK_BUDGET_US,
+                spark_tick > UI_SPARK_BUDGET_US ? " - OVER" : "",
+                (unsigned long)ui_sparkline_rescales(spark_i), (unsigned long)ui_sparkline_rescales(spark_v),
+                (unsigned long)ui_sparkline_rescales(spark_p));
+  if (label_bench) {
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%dU render %lu/%lu/%lu ms", LV_DRAW_SW_DRAW_UNIT_CNT,
+             (unsigned long)((r[0].total_us - r[0].flush_us) / 1000),
+             (unsigned long)((r[1].total_us - r[1].flush_us) / 1000),
+             (unsigned long)((r[2].total_us - r[2].flush_us) / 1000));
+    lv_label_set_text(label_bench, buf);
+  }
+}
+
+static void system_stats_refresh(void) {
+  if (!label_sys_heap) return;
+  lv_mem_monitor_t mon;
+  lv_mem_monitor(&mon);
+  char sd_info[64];
+  SdLogGetInfo(sd_info, sizeof(sd_info));
+  lv_label_set_text_fmt(label_sys_heap, "LVGL heap %lu/%lu KB, peak %lu KB\nScreens %u (max %u), 1st frame %lu ms\n"
+                        "SD log: %s",
+                        (unsigned long)((mon.total_size - mon.free_size) / 1024),
+                        (unsigned long)(mon.total_size / 1024), (unsigned long)(mon.max_used / 1024),
+                        (unsigned)s_screens_built, (unsigned)s_screens_built_max, (unsigned long)s_first_frame_ms,
+                        sd_info);
 }
 
 /* ─── Screen 6: System ─── */
 static void build_system(void) {
   scr_system = lv_obj_create(NULL);
-  lv_obj_set_style_bg_color(scr_system, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(scr_system, &ui_style_bg, 0);
   lv_obj_remove_flag(scr_system, LV_OBJ_FLAG_SCROLLABLE);
 
   add_header_back_to_settings(scr_system, "System");
 
   lv_obj_t *info = lv_label_create(scr_system);
   {
-    char buf[64];
-    snprintf(buf, sizeof(buf), "%s Smart Shunt\nSensor info on next update", SensorGetDriverName());
+    char log_info[40];
+    HistoryLogGetInfo(log_info, sizeof(log_info));
+    char buf[112];
+    snprintf(buf, sizeof(buf), "%s Smart Shunt\nSensor info on next update\nHistory log: %s",
+             SensorGetDriverName(), log_info);
     lv_label_set_text(info, buf);
   }
-  lv_obj_set_style_text_color(info, lv_color_hex(COL_MUTED), 0);
+  lv_obj_add_style(info, &ui_style_text_muted, 0);
   lv_obj_set_pos(info, MARGIN, HEADER_H + GAP);
+
+  label_sys_heap = lv_label_create(scr_system);
+  lv_obj_add_style(label_sys_heap, &ui_style_text_muted, 0);
+  lv_obj_set_pos(label_sys_heap, MARGIN, HEADER_H + GAP + 7 * GRID);
+  system_stats_refresh();
+
+  add_category_row(scr_system, "Performance", DISP_H - MARGIN - ROW_H - GAP - LIST_ITEM_H, to_perf);
+  label_bench = add_setting_row(scr_system, "Redraw bench", "Tap to run",
+                                DISP_H - MARGIN - ROW_H, bench_run_cb);
+}
+
+/* ─── System > Performance: frame/flush/dirty histograms and LVGL heap (ui_perf) ─── */
+static lv_obj_t *label_perf = NULL;
+
+static void perf_refresh(void) {
+  if (!label_perf) return;
+  char buf[448];
+  ui_perf_format(buf, sizeof(buf));
+  size_t n = strlen(buf);
+  if (n + 1 < sizeof(buf)) {
+    buf[n++] = '\n';
+    idle_format(buf + n, sizeof(buf) - n);
+  }
+  lv_label_set_text(label_perf, buf);
+}
+
+static void perf_overlay_switch_cb(lv_event_t *e) {
+  lv_obj_t *sw = (lv_obj_t *)lv_event_get_target(e);
+  ui_perf_set_overlay(lv_obj_has_state(sw, LV_STATE_CHECKED));
+}
+
+static void build_perf(void) {
+  scr_perf = lv_obj_create(NULL);
+  lv_obj_add_style(scr_perf, &ui_style_bg, 0);
+  lv_obj_remove_flag(scr_perf, LV_OBJ_FLAG_SCROLLABLE);
+
+  add_header_back_to_system(scr_perf, "Performance");
+
+  label_perf = lv_label_create(scr_perf);
+  lv_obj_add_style(label_perf, &ui_style_text_muted, 0);
+  lv_obj_set_pos(label_perf, MARGIN, HEADER_H + GAP);
+  perf_refresh();
+
+  lv_obj_t *row = lv_btn_create(scr_perf);
+  lv_obj_set_size(row, DISP_W - 2 * MARGIN, ROW_H);
+  lv_obj_set_pos(row, MARGIN, DISP_H - MARGIN - ROW_H);
+  lv_obj_add_style(row, &ui_style_card, 0);
+  lv_obj_t *lbl = lv_label_create(row);
+  lv_label_set_text(lbl, "Overlay (serial: p = dump)");
+  lv_obj_add_style(lbl, &ui_style_text, 0);
+  lv_obj_align(lbl, LV_ALIGN_LEFT_MID, PAD, 0);
+  lv_obj_t *sw = lv_switch_create(row);
+  lv_obj_align(sw, LV_ALIGN_RIGHT_MID, -PAD, 0);
+  if (ui_perf_overlay_enabled()) lv_obj_add_state(sw, LV_STATE_CHECKED);
+  lv_obj_add_event_cb(sw, perf_overlay_switch_cb, LV_EVENT_VALUE_CHANGED, NULL);
+}
+
+/* ─── Screen: Scope (live V/I traces from the sensor sample ring) ─── */
+#ifndef UI_SCOPE_PLOT_H
+#define UI_SCOPE_PLOT_H 112  /* RGB565 canvas: (DISP_W - 2*MARGIN) x this x 2 B on the system heap */
+#endif
+
+static lv_obj_t *scope_obj = NULL;
+static lv_obj_t *label_scope_info = NULL;
+static lv_obj_t *label_scope_scale = NULL;
+static lv_obj_t *label_scope_run = NULL;
+
+static void scope_refresh(void) {
+  if (!scope_obj || !label_scope_info || !label_scope_scale) return;
+  ui_scope_stats_t st;
+  ui_scope_get_stats(scope_obj, &st);
+  lv_label_set_text_fmt(label_scope_info, "%lu.%lu fps  %lu/%lu S/frame", (unsigned long)(st.fps_x10 / 10),
+                        (unsigned long)(st.fps_x10 % 10), (unsigned long)st.samples_new,
+                        (unsigned long)st.samples_shown);
+  char buf[96];
+  snprintf(buf, sizeof(buf), "%lu ms/div   I %.3g A/div   V %.3g V/div\nTrig %s %.3g %s%s",
+           (unsigned long)st.timebase_ms, (double)st.per_div[SCOPE_CH_CURRENT],
+           (double)st.per_div[SCOPE_CH_VOLTAGE], st.trigger_ch == SCOPE_CH_CURRENT ? "I" : "V",
+           (double)st.trigger_level, st.trigger_ch == SCOPE_CH_CURRENT ? "A" : "V",
+           st.triggered ? "" : "  (auto)");
+  lv_label_set_text(label_scope_scale, buf);
+}
+
+static void scope_btn_cb(lv_event_t *e) {
+  if (!scope_obj) return;
+  switch ((intptr_t)lv_event_get_user_data(e)) {
+    case 0:
+      ui_scope_set_running(scope_obj, !ui_scope_is_running(scope_obj));
+      if (label_scope_run) lv_label_set_text(label_scope_run, ui_scope_is_running(scope_obj) ? "Stop" : "Run");
+      break;
+    case 1: ui_scope_timebase_step(scope_obj, -1); break;
+    case 2: ui_scope_timebase_step(scope_obj, +1); break;
+    case 3: ui_scope_trigger_toggle_channel(scope_obj); break;
+    case 4: ui_scope_trigger_step(scope_obj, -1); break;
+    case 5: ui_scope_trigger_step(scope_obj, +1); break;
+    default: break;
+  }
+  scope_refresh();
 }
 
-/* ─── Screen: Integration (VE.Direct, UART info) ─── */
+/* Leaving: one summary line, so a run can be compared without the screen */
+static void scope_screen_cb(lv_event_t *e) {
+  (void)e;
+  if (!scope_obj) return;
+  ui_scope_stats_t st;
+  ui_scope_get_stats(scope_obj, &st);
+  Serial.printf("Scope: %lu.%lu fps, %lu new / %lu shown samples per frame, raster %lu us (max %lu)\n",
+                (unsigned long)(st.fps_x10 / 10), (unsigned long)(st.fps_x10 % 10),
+                (unsigned long)st.samples_new, (unsigned long)st.samples_shown,
+                (unsigned long)st.render_us, (unsigned long)st.render_max_us);
+}
+
+static void build_scope(void) {
+  scr_scope = lv_obj_create(NULL);
+  lv_obj_add_style(scr_scope, &ui_style_bg, 0);
+  lv_obj_remove_flag(scr_scope, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_add_event_cb(scr_scope, scope_screen_cb, LV_EVENT_SCREEN_UNLOADED, NULL);
+
+  lv_obj_t *hdr = add_header_back_to_settings(scr_scope, "Scope");
+  label_scope_info = lv_label_create(hdr);
+  lv_label_set_text(label_scope_info, "");
+  lv_obj_add_style(label_scope_info, &ui_style_text_muted, 0);
+  lv_obj_align(label_scope_info, LV_ALIGN_RIGHT_MID, -(MARGIN + BTN_W + GAP), 0);
+
+  lv_coord_t top = HEADER_H + GAP;
+  scope_obj = ui_scope_create(scr_scope, DISP_W - 2 * MARGIN, UI_SCOPE_PLOT_H);
+  if (!scope_obj) {
+    lv_obj_t *err = lv_label_create(scr_scope);
+    lv_label_set_text(err, "Not enough memory for the scope");
+    lv_obj_add_style(err, &ui_style_text_muted, 0);
+    lv_obj_set_pos(err, MARGIN, top);
+    return;
+  }
+  lv_obj_set_pos(scope_obj, MARGIN, top);
+
+  label_scope_scale = lv_label_create(scr_scope);
+  lv_obj_add_style(label_scope_scale, &ui_style_text_muted, 0);
+  lv_obj_set_pos(label_scope_scale, MARGIN, top + UI_SCOPE_PLOT_H + GAP);
+
+  static const char *const names[6] = {"Stop", "T-", "T+", "I/V", LV_SYMBOL_DOWN, LV_SYMBOL_UP};
+  lv_coord_t bw = (DISP_W - 2 * MARGIN - 5 * GAP) / 6;
+  for (int k = 0; k < 6; k++) {
+    lv_obj_t *btn = lv_btn_create(scr_scope);
+    lv_obj_set_size(btn, bw, BTN_H);
+    lv_obj_set_pos(btn, MARGIN + k * (bw + GAP), DISP_H - MARGIN - BTN_H);
+    lv_obj_set_style_radius(btn, CARD_R, 0);
+    lv_obj_t *lbl = lv_label_create(btn);
+    lv_label_set_text(lbl, names[k]);
+    lv_obj_center(lbl);
+    lv_obj_add_event_cb(btn, scope_btn_cb, LV_EVENT_CLICKED, (void *)(intptr_t)k);
+    if (k == 0) label_scope_run = lbl;
+  }
+  scope_refresh();
+}
+
+/* ─── Screen: Integration (VE.Direct, UART info, BLE) ─── */
+static lv_obj_t *label_ble_name = NULL;
+static lv_obj_t *ble_name_modal = NULL;
+
 static void vedirect_switch_cb(lv_event_t *e) {
   lv_obj_t *sw = (lv_obj_t *)lv_event_get_target(e);
   bool on = lv_obj_has_state(sw, LV_STATE_CHECKED);
   set_vedirect_enabled(on);
 }
 
+static void ble_switch_cb(lv_event_t *e) {
+  lv_obj_t *sw = (lv_obj_t *)lv_event_get_target(e);
+  BleTelemetrySetEnabled(lv_obj_has_state(sw, LV_STATE_CHECKED));  /* returns at once; the BLE task does the work */
+}
+
+static void ble_name_close(void) {
+  if (ble_name_modal) {
+    lv_obj_delete_async(ble_name_modal);  /* called from the keyboard's own event */
+    ble_name_modal = NULL;
+  }
+}
+
+static void ble_name_kb_cb(lv_event_t *e) {
+  lv_event_code_t code = lv_event_get_code(e);
+  lv_obj_t *kb = (lv_obj_t *)lv_event_get_target(e);
+  if (code == LV_EVENT_READY) {
+    /* Empty text = back to the default "CYD Shunt <id>" */
+    BleTelemetrySetName(lv_textarea_get_text(lv_keyboard_get_textarea(kb)));
+    if (label_ble_name) {
+      char name[BLE_NAME_MAX + 1];
+      BleTelemetryGetName(name, sizeof(name));
+      lv_label_set_text(label_ble_name, name);
+    }
+  }
+  if (code == LV_EVENT_READY || code == LV_EVENT_CANCEL) ble_name_close();
+}
+
+static void open_ble_name_modal(lv_event_t *e) {
+  (void)e;
+  if (ble_name_modal) return;
+  ble_name_modal = lv_obj_create(lv_screen_active());
+  lv_obj_set_size(ble_name_modal, DISP_W, DISP_H);
+  lv_obj_set_pos(ble_name_modal, 0, 0);
+  lv_obj_add_style(ble_name_modal, &ui_style_bg, 0);
+  lv_obj_set_style_pad_all(ble_name_modal, 0, 0);
+  lv_obj_remove_flag(ble_name_modal, LV_OBJ_FLAG_SCROLLABLE);
+
+  lv_obj_t *ta = lv_textarea_create(ble_name_modal);
+  lv_textarea_set_one_line(ta, true);
+  lv_textarea_set_max_length(ta, BLE_NAME_MAX);
+  lv_textarea_set_placeholder_text(ta, "Empty = default name");
+  char name[BLE_NAME_MAX + 1];
+  BleTelemetryGetName(name, sizeof(name));
+  lv_textarea_set_text(ta, name);
+  lv_obj_set_width(ta, DISP_W - 2 * MARGIN);
+  lv_obj_align(ta, LV_ALIGN_TOP_MID, 0, MARGIN);
+
+  lv_obj_t *kb = lv_keyboard_create(ble_name_modal);
+  lv_obj_set_size(kb, DISP_W, DISP_H / 2 + HEADER_H);
+  lv_obj_align(kb, LV_ALIGN_BOTTOM_MID, 0, 0);
+  lv_keyboard_set_textarea(kb, ta);
+  lv_obj_add_event_cb(kb, ble_name_kb_cb, LV_EVENT_ALL, NULL);
+}
+
 static void build_integration(void) {
   scr_integration = lv_obj_create(NULL);
-  lv_obj_set_style_bg_color(scr_integration, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(scr_integration, &ui_style_bg, 0);
   lv_obj_remove_flag(scr_integration, LV_OBJ_FLAG_SCROLLABLE);
 
   add_header_back_to_settings(scr_integration, "Integration");
@@ -1931,11 +3107,10 @@ static void build_integration(void) {
   lv_obj_t *row_ve = lv_btn_create(scr_integration);
   lv_obj_set_size(row_ve, DISP_W - 2 * MARGIN, LIST_ITEM_H);
   lv_obj_set_pos(row_ve, MARGIN, y);
-  lv_obj_set_style_radius(row_ve, CARD_R, 0);
-  lv_obj_set_style_bg_color(row_ve, lv_color_hex(COL_CARD), 0);
+  lv_obj_add_style(row_ve, &ui_style_card, 0);
   lv_obj_t *lbl_ve = lv_label_create(row_ve);
   lv_label_set_text(lbl_ve, "VE.Direct");
-  lv_obj_set_style_text_color(lbl_ve, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(lbl_ve, &ui_style_text, 0);
   lv_obj_set_pos(lbl_ve, PAD, (LIST_ITEM_H - 14) / 2);
   lv_obj_t *sw = lv_switch_create(row_ve);
   lv_obj_align(sw, LV_ALIGN_RIGHT_MID, -PAD, 0);
@@ -1948,6 +3123,28 @@ static void build_integration(void) {
   char uart_buf[64];
   TelemetryVictronGetUartInfo(uart_buf, sizeof(uart_buf));
   add_setting_row(scr_integration, "UART", uart_buf, y, NULL);
+  y += ROW_H + GAP;
+
+  /* Bluetooth row: label + switch (generic GATT telemetry, docs/BLE_GATT.md) */
+  lv_obj_t *row_ble = lv_btn_create(scr_integration);
+  lv_obj_set_size(row_ble, DISP_W - 2 * MARGIN, LIST_ITEM_H);
+  lv_obj_set_pos(row_ble, MARGIN, y);
+  lv_obj_add_style(row_ble, &ui_style_card, 0);
+  lv_obj_t *lbl_ble = lv_label_create(row_ble);
+  lv_label_set_text(lbl_ble, "Bluetooth");
+  lv_obj_add_style(lbl_ble, &ui_style_text, 0);
+  lv_obj_set_pos(lbl_ble, PAD, (LIST_ITEM_H - 14) / 2);
+  lv_obj_t *sw_ble = lv_switch_create(row_ble);
+  lv_obj_align(sw_ble, LV_ALIGN_RIGHT_MID, -PAD, 0);
+  if (BleTelemetryGetEnabled())
+    lv_obj_add_state(sw_ble, LV_STATE_CHECKED);
+  lv_obj_add_event_cb(sw_ble, ble_switch_cb, LV_EVENT_VALUE_CHANGED, NULL);
+  y += LIST_ITEM_H + GAP;
+
+  /* BLE name: tap to edit with the on-screen keyboard */
+  char ble_name[BLE_NAME_MAX + 1];
+  BleTelemetryGetName(ble_name, sizeof(ble_name));
+  label_ble_name = add_setting_row(scr_integration, "BLE name", ble_name, y, open_ble_name_modal);
 }
 
 /* ─── About (version, author, thanks to libraries) ─── */
@@ -1956,16 +3153,14 @@ static void build_integration(void) {
 
 static void build_about(void) {
   scr_about = lv_obj_create(NULL);
-  lv_obj_set_style_bg_color(scr_about, lv_color_hex(COL_BG), 0);
+  lv_obj_add_style(scr_about, &ui_style_bg, 0);
 
   add_header_back_to_settings(scr_about, "About");
 
   lv_obj_t *scroll = lv_obj_create(scr_about);
   lv_obj_set_size(scroll, DISP_W, DISP_H - HEADER_H);
   lv_obj_set_pos(scroll, 0, HEADER_H);
-  lv_obj_set_style_bg_color(scroll, lv_color_hex(COL_BG), 0);
-  lv_obj_set_style_pad_all(scroll, MARGIN, 0);
-  lv_obj_set_style_pad_row(scroll, GAP, 0);
+  lv_obj_add_style(scroll, &ui_style_list, 0);
   lv_obj_set_flex_flow(scroll, LV_FLEX_FLOW_COLUMN);
   lv_obj_set_scrollbar_mode(scroll, LV_SCROLLBAR_MODE_AUTO);
   lv_obj_set_scroll_dir(scroll, LV_DIR_VER);
@@ -1973,22 +3168,22 @@ static void build_about(void) {
   /* App title and version */
   lv_obj_t *tit = lv_label_create(scroll);
   lv_label_set_text(tit, "CYD Smart Shunt");
-  lv_obj_set_style_text_color(tit, lv_color_hex(COL_ACCENT), 0);
-  lv_obj_set_style_text_font(tit, &lv_font_montserrat_20, 0);
+  lv_obj_add_style(tit, &ui_style_text_accent, 0);
+  lv_obj_add_style(tit, &ui_style_text_large, 0);
 
   lv_obj_t *ver = lv_label_create(scroll);
   lv_label_set_text_fmt(ver, "Version %s", CYD_SMARTSHUNT_VERSION);
-  lv_obj_set_style_text_color(ver, lv_color_hex(COL_TEXT), 0);
+  lv_obj_add_style(ver, &ui_style_text, 0);
 
   lv_obj_t *auth = lv_label_create(scroll);
   lv_label_set_text_fmt(auth, "Author: %s", CYD_SMARTSHUNT_AUTHOR);
-  lv_obj_set_style_text_color(auth, lv_color_hex(COL_MUTED), 0);
+  lv_obj_add_style(auth, &ui_style_text_muted, 0);
 
   lv_obj_t *sep = lv_label_create(scroll);
   lv_label_set_text(sep, " ");
   lv_obj_t *thanks_tit = lv_label_create(scroll);
   lv_label_set_text(thanks_tit, "Thanks to libraries");
-  lv_obj_set_style_text_color(thanks_tit, lv_color_hex(COL_MUTED), 0);
+  lv_obj_add_style(thanks_tit, &ui_style_text_muted, 0);
 
   /* Library rows: name, version, author (ASCII only for display) */
   struct { const char *name; const char *version; const char *author; } libs[] = {
@@ -2002,32 +3197,83 @@ static void build_about(void) {
   for (size_t i = 0; i < sizeof(libs) / sizeof(libs[0]); i++) {
     lv_obj_t *row = lv_label_create(scroll);
     lv_label_set_text_fmt(row, "%s %s - %s", libs[i].name, libs[i].version, libs[i].author);
-    lv_obj_set_style_text_color(row, lv_color_hex(COL_TEXT), 0);
+    lv_obj_add_style(row, &ui_style_text, 0);
   }
 }
 
-/* ─── History push (called from update_timer) ─── */
-static void history_push(float v, float i, float p, double e) {
-  s_history_v[s_history_write_idx] = v;
-  s_history_i[s_history_write_idx] = i;
-  s_history_p[s_history_write_idx] = (float)p;
-  s_history_e[s_history_write_idx] = (float)e;
+/* ─── History push (called from update_timer); also feeds the persistent flash log ─── */
+static void history_push(const ui_sample_t *s, double e) {
+  HistoryLogPush(s->voltage, s->current, s->power, e);
+  uint16_t k = s_history_write_idx;
+  s_history_e[k] = (float)e;
+  s_history_v_min[k] = s->v_min;
+  s_history_v_max[k] = s->v_max;
+  s_history_i_min[k] = s->i_min;
+  s_history_i_max[k] = s->i_max;
+  s_history_p_min[k] = s->p_min;
+  s_history_p_max[k] = s->p_max;
   s_history_write_idx = (s_history_write_idx + 1) % HISTORY_LEN;
   if (s_history_count < HISTORY_LEN) s_history_count++;
 }
 
+/* Clear the label pointers owned by a screen that screen_evict() is freeing */
+static void screen_forget_labels(screen_id_t id) {
+  switch (id) {
+    case SCR_MEASUREMENT:
+      label_avg_val = NULL;
+      break;
+    case SCR_SHUNT_CALIBRATION:
+      label_shunt_max = label_shunt_res = NULL;
+      break;
+    case SCR_KNOWN_LOAD:
+      label_known_current = label_known_voltage = NULL;
+      label_known_measured = label_known_corrected = NULL;
+      break;
+    case SCR_CALC_MV:
+      label_calc_mv_voltage = label_calc_mv_current = label_calc_mv_result = NULL;
+      break;
+    case SCR_SYSTEM:
+      label_bench = label_sys_heap = NULL;
+      break;
+    case SCR_DATA:
+      label_stats = label_stats_reset = NULL;
+      btn_stats_scope[STATS_SESSION] = btn_stats_scope[STATS_LIFETIME] = NULL;
+      break;
+    case SCR_INTEGRATION:
+      label_ble_name = ble_name_modal = NULL;
+      break;
+    case SCR_PERF:
+      label_perf = NULL;
+      break;
+    case SCR_TOUCH_CAL:
+      s_tcal.target = s_tcal.dot = s_tcal.label = s_tcal.btn_row = NULL;
+      break;
+    case SCR_SCOPE:
+      scope_obj = label_scope_info = label_scope_scale = label_scope_run = NULL;
+      break;
+    default:
+      break;
+  }
+}
+
 /* ─── Sensor update timer: only update value labels, no redraw ─── */
 static void update_timer_cb(lv_timer_t *timer) {
   (void)timer;
-  float current     = SensorGetCurrent();
-  float voltage     = SensorGetBusVoltage();
-  float power       = SensorGetPower();
+  ui_sample_t smp;
+  ui_sample(&smp);
+  float current     = smp.current;
+  float voltage     = smp.voltage;
+  float power       = smp.power;
   double energy     = SensorGetWattHour();
   float temperature = SensorGetTemperature();
   bool  connected   = SensorIsConnected();
   bool  ina228      = sensor_is_ina228();
+  float peak_i      = peak_hold(&s_peak_i, smp.current_peak);
+  float peak_p      = peak_hold(&s_peak_p, smp.power_peak);
 
-  history_push(voltage, current, power, energy);
+  history_push(&smp, energy);
+  spark_push_all(connected, voltage, current, power, true);
+  idle_note_current(current);
 
   if (s_active_hist_popup)
     hist_apply_scroll_policy_and_refresh(s_active_hist_popup);
@@ -2038,13 +3284,15 @@ static void update_timer_cb(lv_timer_t *timer) {
       int sig = ina228 ? 4 : 3;  /* INA228: one extra significant figure */
       int dc = decimals_for_magnitude((double)current, sig, 3);  /* milliamps max */
       snprintf(buf, sizeof(buf), "%.*f A", dc, (double)current);
-      lv_label_set_text(label_current, buf);
+      value_set_text(label_current, buf);
       int dv = decimals_for_magnitude((double)voltage, sig, 3);  /* millivolts max */
       snprintf(buf, sizeof(buf), "%.*f V", dv, (double)voltage);
-      lv_label_set_text(label_voltage, buf);
+      value_set_text(label_voltage, buf);
       int dp = decimals_for_magnitude((double)power, sig, 3);
       snprintf(buf, sizeof(buf), "%.*f W", dp, (double)power);
       lv_label_set_text(label_power, buf);
+      if (label_peak_i) peak_label_set(label_peak_i, peak_i, sig, "A");
+      if (label_peak_p) peak_label_set(label_peak_p, peak_p, sig, "W");
       if (energy >= 1000.0) {
         snprintf(buf, sizeof(buf), "%.2f kWh", (double)(energy / 1000.0));
       } else {
@@ -2056,9 +3304,11 @@ static void update_timer_cb(lv_timer_t *timer) {
       lv_label_set_text(label_status, buf);
       lv_obj_set_style_text_color(label_status, lv_color_hex(COL_MUTED), 0);
     } else {
-      lv_label_set_text(label_current, "--");
-      lv_label_set_text(label_voltage, "--");
+      value_set_text(label_current, "--");
+      value_set_text(label_voltage, "--");
       lv_label_set_text(label_power, "--");
+      if (label_peak_i) lv_label_set_text(label_peak_i, "");
+      if (label_peak_p) lv_label_set_text(label_peak_p, "");
       lv_label_set_text(label_energy, "--");
       snprintf(buf, sizeof(buf), "CYD SmartShunt INA? N/A");
       lv_label_set_text(label_status, buf);
@@ -2083,6 +3333,35 @@ static void update_timer_cb(lv_timer_t *timer) {
     }
   }
 
+  if (lv_screen_active() == scr_system) {
+    static uint8_t sys_div = 0;
+    if (++sys_div >= 5) {  /* 1 s: lv_mem_monitor() walks the whole pool */
+      sys_div = 0;
+      system_stats_refresh();
+    }
+  }
+  if (lv_screen_active() == scr_data) {
+    static uint8_t stats_div = 0;
+    if (++stats_div >= 5) {
+      stats_div = 0;
+      stats_refresh();
+    }
+  }
+  if (lv_screen_active() == scr_scope) {
+    static uint8_t scope_div = 0;
+    if (++scope_div >= 5) {
+      scope_div = 0;
+      scope_refresh();
+    }
+  }
+  if (lv_screen_active() == scr_perf) {
+    static uint8_t perf_div = 0;
+    if (++perf_div >= 5) {
+      perf_div = 0;
+      perf_refresh();
+    }
+  }
+
   if (lv_screen_active() == scr_calc_mv && label_calc_mv_result && calc_mv_current_a > 0.0f) {
     float mOhm = calc_mv_voltage_mv / calc_mv_current_a;
     char buf[24];
@@ -2091,7 +3370,84 @@ static void update_timer_cb(lv_timer_t *timer) {
   }
 }
 
+/* ─── LVGL task and tick ─── */
+/* Tick source: the esp_timer microsecond clock, read on demand (no periodic tick interrupt) */
+static uint32_t ui_tick_ms(void) {
+  return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+/* Sampling while blanked: the update timer is paused with the rest of LVGL, so feed history here.
+ * Runs outside lv_timer_handler(), so it takes the LVGL lock like any other task touching UI state. */
+static void blank_sample(void) {
+  ui_lvgl_lock();
+  ui_sample_t smp;
+  ui_sample(&smp);
+  float current = smp.current;
+  float voltage = smp.voltage;
+  float power = smp.power;
+  history_push(&smp, SensorGetWattHour());
+  bool connected = SensorIsConnected();
+  spark_push_all(connected, voltage, current, power, false);  /* buffers only: nothing renders while blank */
+  idle_note_current(current);
+  ui_lvgl_unlock();
+}
+
+/* One scheduler step: LVGL when the display is on, sampling + PENIRQ poll when blanked.
+ * Returns how long to sleep. Also accounts wall and busy time to the current idle state. */
+static uint32_t ui_run_once(void) {
+  static int64_t last_us = 0;
+  idle_state_t state = s_idle;
+  int64_t t0 = esp_timer_get_time();
+  uint32_t wait_ms;
+  if (state == IDLE_BLANK) {
+    if (TouchIrqPending() && TouchConfirmPress()) {  /* a PENIRQ glitch alone must not light the panel */
+      idle_wake();
+      wait_ms = 1;
+    } else {
+      if (t0 >= s_blank_next_sample_us) {
+        blank_sample();
+        s_blank_next_sample_us += UI_SAMPLE_PERIOD_MS * 1000LL;
+        if (s_blank_next_sample_us < t0) s_blank_next_sample_us = t0 + UI_SAMPLE_PERIOD_MS * 1000LL;
+      }
+      wait_ms = UI_IDLE_WAKE_POLL_MS;
+    }
+  } else {
+    wait_ms = lv_timer_handler();
+    if (wait_ms == LV_NO_TIMER_READY || wait_ms > LV_DEF_REFR_PERIOD) wait_ms = LV_DEF_REFR_PERIOD;
+  }
+  int64_t t1 = esp_timer_get_time();
+  if (last_us) s_idle_stats[state].time_us += (uint64_t)(t1 - last_us);
+  s_idle_stats[state].busy_us += (uint64_t)(t1 - t0);
+  last_us = t1;
+  return wait_ms;
+}
+
+#if LV_USE_OS == LV_OS_FREERTOS
+/* Core 0 by default: loop() (telemetry) stays on the Arduino core and is never stalled by rendering */
+#ifndef UI_LVGL_TASK_CORE
+#define UI_LVGL_TASK_CORE  0
+#endif
+#ifndef UI_LVGL_TASK_PRIO
+#define UI_LVGL_TASK_PRIO  2
+#endif
+#ifndef UI_LVGL_TASK_STACK
+#define UI_LVGL_TASK_STACK 8192
+#endif
+
+static TaskHandle_t s_ui_task = NULL;
+
+static void ui_lvgl_task(void *arg) {
+  (void)arg;
+  for (;;) {
+    /* lv_timer_handler() takes the LVGL lock itself; other tasks wait on it via ui_lvgl_lock() */
+    uint32_t wait_ms = ui_run_once();
+    vTaskDelay(pdMS_TO_TICKS(wait_ms > 0 ? wait_ms : 1));
+  }
+}
+#endif
+
 void ui_lvgl_init(void) {
+  int64_t t_init = esp_timer_get_time();
   draw_buf1 = (uint8_t *)malloc(BUF_BYTES);
   draw_buf2 = (uint8_t *)malloc(BUF_BYTES);
   if (!draw_buf1 || !draw_buf2) {
@@ -2101,9 +3457,16 @@ void ui_lvgl_init(void) {
   }
 
   lv_init();
+  lv_tick_set_cb(ui_tick_ms);
+  ui_theme_init();
   disp = lv_display_create(DISP_W, DISP_H);
   lv_display_set_flush_cb(disp, my_flush_cb);
   lv_display_set_buffers(disp, draw_buf1, draw_buf2, BUF_BYTES, LV_DISPLAY_RENDER_MODE_PARTIAL);
+  ui_perf_init(disp);
+#if VALUE_USE_CACHE
+  if (!ui_digits_init(&lv_font_montserrat_20, lv_color_hex(COL_ACCENT), lv_color_hex(COL_CARD)))
+    Serial.println("UI: digit glyph cache alloc failed, using label drawing");
+#endif
 
   lv_indev_t *indev = lv_indev_create();
   lv_indev_set_type(indev, LV_INDEV_TYPE_POINTER);
@@ -2111,23 +3474,30 @@ void ui_lvgl_init(void) {
   /* Low scroll limit: small vertical drag starts scrolling so list scroll wins over row click */
   lv_indev_set_scroll_limit(indev, 4);
 
-  build_monitor();
-  build_settings_home();
-  build_measurement();
-  build_calibration();
-  build_shunt_calibration();
-  build_shunt_standard();
-  build_known_load();
-  build_calc_mv();
-  build_data();
-  build_system();
-  build_integration();
-  build_about();
-
-  lv_screen_load(scr_monitor);
-
-  lv_timer_t *t = lv_timer_create(update_timer_cb, 200, NULL);
+  /* Only the dashboard is built up front; other screens are built on first navigation */
+  screen_show(SCR_MONITOR);
+  lv_refr_now(disp);  /* first frame now, so time-to-first-frame is measured, not the first task slice */
+  {
+    int64_t t_now = esp_timer_get_time();
+    s_first_frame_ms = (uint32_t)(t_now / 1000);
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    Serial.printf("UI: first frame %lu ms after boot (ui init %lu ms), LVGL heap peak %lu of %lu B\n",
+                  (unsigned long)s_first_frame_ms, (unsigned long)((t_now - t_init) / 1000),
+                  (unsigned long)mon.max_used, (unsigned long)mon.total_size);
+  }
+  /* First boot (or cleared NVS): calibrate before anything else, with sampling already running */
+  if (!TouchGetCalibration(NULL)) show_touch_cal(SCR_MONITOR);
+
+  lv_timer_t *t = lv_timer_create(update_timer_cb, UI_SAMPLE_PERIOD_MS, NULL);
   lv_timer_set_repeat_count(t, -1);
+  lv_timer_create(idle_timer_cb, 500, NULL);
+
+#if LV_USE_OS == LV_OS_FREERTOS
+  /* From here on only the LVGL task (or ui_lvgl_lock holders) may touch LVGL objects */
+  xTaskCreatePinnedToCore(ui_lvgl_task, "lvgl", UI_LVGL_TASK_STACK, NULL, UI_LVGL_TASK_PRIO,
+                          &s_ui_task, UI_LVGL_TASK_CORE);
+#endif
 }
 
 void ui_lvgl_on_touch_calibration_done(void) {
@@ -2135,15 +3505,26 @@ void ui_lvgl_on_touch_calibration_done(void) {
 }
 
 void ui_lvgl_poll(void) {
+#if LV_USE_OS == LV_OS_NONE
   if (!disp) return;  /* init failed (e.g. buffer alloc), avoid calling LVGL */
-  static uint32_t last = 0;
-  uint32_t now = millis();
-  lv_tick_inc(now - last);
-  last = now;
-  lv_timer_handler();
+  ui_run_once();
+#endif
+}
+
+void ui_lvgl_lock(void) {
+#if LV_USE_OS != LV_OS_NONE
+  if (disp) lv_lock();
+#endif
+}
+
+void ui_lvgl_unlock(void) {
+#if LV_USE_OS != LV_OS_NONE
+  if (disp) lv_unlock();
+#endif
 }
 
 void ui_history_clear(void) {
+  HistoryLogFlush();  /* the records before the clear reach flash now, not a block later */
   s_history_write_idx = 0;
   s_history_count = 0;
 }
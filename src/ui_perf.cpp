@@ -0,0 +1,295 @@
+/**
+ * @file ui_perf.cpp
+ * LVGL render/flush instrumentation (see ui_perf.h).
+ */
+#include "ui_perf.h"
+#include "ui_lvgl.h"
+#include "ui_theme.h"
+#include "touch.h"
+#include "console.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <string.h>
+
+#define PERF_BUCKETS 8
+/* Upper bucket bounds in ms; the last bucket is open-ended. 33 ms = LV_DEF_REFR_PERIOD. */
+static const uint16_t k_bucket_ms[PERF_BUCKETS - 1] = {2, 5, 10, 20, 33, 50, 100};
+
+typedef struct {
+  uint32_t render_us;  /* frame time minus flush time */
+  uint32_t flush_us;
+  uint32_t dirty_px;
+} perf_frame_t;
+
+typedef struct {
+  uint32_t used;
+  uint32_t free;
+  uint32_t free_biggest;
+  uint8_t  frag_pct;
+} perf_heap_t;
+
+typedef struct {
+  perf_frame_t frames[UI_PERF_FRAMES];
+  uint16_t     frame_idx;
+  uint16_t     frame_count;
+  uint32_t     frames_total;
+  uint32_t     frames_last_s;  /* frames completed in the last 1 s sampling period */
+  perf_heap_t  heap[UI_PERF_HEAP_SAMPLES];
+  uint16_t     heap_idx;
+  uint16_t     heap_count;
+  uint32_t     heap_total;
+} perf_state_t;
+
+static perf_state_t s_perf;
+
+/* Current frame accumulators (LVGL task only) */
+static int64_t  s_frame_start_us = 0;
+static uint32_t s_frame_flush_us = 0;
+static uint32_t s_frame_px = 0;
+static uint32_t s_frames_at_last_sample = 0;
+
+static lv_obj_t *s_overlay = NULL;
+static bool      s_overlay_on = false;
+
+/* ─── Recording (hot path) ─── */
+static void refr_start_cb(lv_event_t *e) {
+  (void)e;
+  s_frame_start_us = esp_timer_get_time();
+  s_frame_flush_us = 0;
+  s_frame_px = 0;
+}
+
+static void refr_ready_cb(lv_event_t *e) {
+  (void)e;
+  if (s_frame_px == 0) return;  /* timer ran but nothing was dirty */
+  uint32_t total = (uint32_t)(esp_timer_get_time() - s_frame_start_us);
+  perf_frame_t *f = &s_perf.frames[s_perf.frame_idx];
+  f->flush_us  = s_frame_flush_us;
+  f->render_us = total > s_frame_flush_us ? total - s_frame_flush_us : 0;
+  f->dirty_px  = s_frame_px;
+  s_perf.frame_idx = (uint16_t)((s_perf.frame_idx + 1) % UI_PERF_FRAMES);
+  if (s_perf.frame_count < UI_PERF_FRAMES) s_perf.frame_count++;
+  s_perf.frames_total++;
+}
+
+void ui_perf_on_flush(uint32_t px, uint32_t us) {
+  s_frame_px += px;
+  s_frame_flush_us += us;
+}
+
+/* ─── Summaries (on demand) ─── */
+typedef struct {
+  uint32_t hist_frame[PERF_BUCKETS];
+  uint32_t hist_render[PERF_BUCKETS];
+  uint32_t hist_flush[PERF_BUCKETS];
+  uint32_t render_avg_us, render_max_us;
+  uint32_t flush_avg_us, flush_max_us;
+  uint32_t dirty_avg_pct, dirty_max_pct;
+  uint32_t n;
+} perf_summary_t;
+
+static int bucket_of(uint32_t us) {
+  uint32_t ms = us / 1000;
+  for (int b = 0; b < PERF_BUCKETS - 1; b++)
+    if (ms < k_bucket_ms[b]) return b;
+  return PERF_BUCKETS - 1;
+}
+
+static void summarise(const perf_state_t *st, perf_summary_t *sum) {
+  memset(sum, 0, sizeof(*sum));
+  const uint32_t screen_px = (uint32_t)DISP_W * DISP_H;
+  uint64_t r = 0, f = 0, d = 0;
+  for (uint16_t k = 0; k < st->frame_count; k++) {
+    const perf_frame_t *fr = &st->frames[k];
+    sum->hist_frame[bucket_of(fr->render_us + fr->flush_us)]++;
+    sum->hist_render[bucket_of(fr->render_us)]++;
+    sum->hist_flush[bucket_of(fr->flush_us)]++;
+    r += fr->render_us;
+    f += fr->flush_us;
+    d += fr->dirty_px;
+    if (fr->render_us > sum->render_max_us) sum->render_max_us = fr->render_us;
+    if (fr->flush_us > sum->flush_max_us) sum->flush_max_us = fr->flush_us;
+    uint32_t pct = fr->dirty_px * 100 / screen_px;
+    if (pct > sum->dirty_max_pct) sum->dirty_max_pct = pct;
+  }
+  sum->n = st->frame_count;
+  if (sum->n) {
+    sum->render_avg_us = (uint32_t)(r / sum->n);
+    sum->flush_avg_us = (uint32_t)(f / sum->n);
+    sum->dirty_avg_pct = (uint32_t)(d * 100 / ((uint64_t)screen_px * sum->n));
+  }
+}
+
+static const perf_heap_t *heap_latest(const perf_state_t *st) {
+  if (st->heap_count == 0) return NULL;
+  return &st->heap[(st->heap_idx + UI_PERF_HEAP_SAMPLES - 1) % UI_PERF_HEAP_SAMPLES];
+}
+
+static void heap_extremes(const perf_state_t *st, uint32_t *min_free, uint8_t *max_frag) {
+  *min_free = UINT32_MAX;
+  *max_frag = 0;
+  for (uint16_t k = 0; k < st->heap_count; k++) {
+    if (st->heap[k].free < *min_free) *min_free = st->heap[k].free;
+    if (st->heap[k].frag_pct > *max_frag) *max_frag = st->heap[k].frag_pct;
+  }
+  if (st->heap_count == 0) *min_free = 0;
+}
+
+static void format_overlay(char *buf, size_t len) {
+  perf_summary_t sum;
+  summarise(&s_perf, &sum);
+  const perf_heap_t *h = heap_latest(&s_perf);
+  snprintf(buf, len, "%lu fps r%lu f%lu ms %lu%% | %luK %u%%",
+           (unsigned long)s_perf.frames_last_s, (unsigned long)(sum.render_avg_us / 1000),
+           (unsigned long)(sum.flush_avg_us / 1000), (unsigned long)sum.dirty_avg_pct,
+           (unsigned long)(h ? h->free / 1024 : 0), h ? h->frag_pct : 0);
+}
+
+/* ─── 1 Hz sampler: heap, fps, overlay text ─── */
+static void sample_timer_cb(lv_timer_t *t) {
+  (void)t;
+  lv_mem_monitor_t mon;
+  lv_mem_monitor(&mon);
+  perf_heap_t *h = &s_perf.heap[s_perf.heap_idx];
+  h->used = (uint32_t)(mon.total_size - mon.free_size);
+  h->free = (uint32_t)mon.free_size;
+  h->free_biggest = (uint32_t)mon.free_biggest_size;
+  h->frag_pct = mon.frag_pct;
+  s_perf.heap_idx = (uint16_t)((s_perf.heap_idx + 1) % UI_PERF_HEAP_SAMPLES);
+  if (s_perf.heap_count < UI_PERF_HEAP_SAMPLES) s_perf.heap_count++;
+  s_perf.heap_total++;
+
+  s_perf.frames_last_s = s_perf.frames_total - s_frames_at_last_sample;
+  s_frames_at_last_sample = s_perf.frames_total;
+
+  if (s_overlay_on && s_overlay) {
+    char buf[48];
+    format_overlay(buf, sizeof(buf));
+    lv_label_set_text(s_overlay, buf);
+  }
+}
+
+void ui_perf_init(lv_display_t *disp) {
+  if (!disp) return;
+  memset(&s_perf, 0, sizeof(s_perf));
+  lv_display_add_event_cb(disp, refr_start_cb, LV_EVENT_REFR_START, NULL);
+  lv_display_add_event_cb(disp, refr_ready_cb, LV_EVENT_REFR_READY, NULL);
+  lv_timer_create(sample_timer_cb, 1000, NULL);
+}
+
+/* ─── Overlay ─── */
+void ui_perf_set_overlay(bool on) {
+  s_overlay_on = on;
+  if (on && !s_overlay) {
+    s_overlay = lv_label_create(lv_layer_top());
+    lv_obj_add_style(s_overlay, &ui_style_text_accent, 0);
+    lv_obj_set_style_bg_color(s_overlay, lv_color_hex(COL_BG), 0);
+    lv_obj_set_style_bg_opa(s_overlay, LV_OPA_70, 0);
+    lv_obj_set_style_pad_hor(s_overlay, PAD, 0);
+    lv_obj_align(s_overlay, LV_ALIGN_BOTTOM_RIGHT, 0, 0);
+    lv_obj_remove_flag(s_overlay, LV_OBJ_FLAG_CLICKABLE);
+    lv_label_set_text(s_overlay, "perf: sampling...");
+  } else if (!on && s_overlay) {
+    lv_obj_delete(s_overlay);
+    s_overlay = NULL;
+  }
+}
+
+bool ui_perf_overlay_enabled(void) {
+  return s_overlay_on;
+}
+
+/* ─── System > Performance page ─── */
+void ui_perf_format(char *buf, size_t len) {
+  if (!buf || len == 0) return;
+  perf_summary_t sum;
+  summarise(&s_perf, &sum);
+  const perf_heap_t *h = heap_latest(&s_perf);
+  uint32_t min_free;
+  uint8_t max_frag;
+  heap_extremes(&s_perf, &min_free, &max_frag);
+
+  size_t n = (size_t)snprintf(buf, len,
+      "Last %lu frames, %lu fps now\n"
+      "Render ms avg %lu.%lu max %lu.%lu\n"
+      "Flush  ms avg %lu.%lu max %lu.%lu\n"
+      "Dirty avg %lu%% max %lu%% of screen\n"
+      "Frame ms",
+      (unsigned long)sum.n, (unsigned long)s_perf.frames_last_s,
+      (unsigned long)(sum.render_avg_us / 1000), (unsigned long)(sum.render_avg_us / 100 % 10),
+      (unsigned long)(sum.render_max_us / 1000), (unsigned long)(sum.render_max_us / 100 % 10),
+      (unsigned long)(sum.flush_avg_us / 1000), (unsigned long)(sum.flush_avg_us / 100 % 10),
+      (unsigned long)(sum.flush_max_us / 1000), (unsigned long)(sum.flush_max_us / 100 % 10),
+      (unsigned long)sum.dirty_avg_pct, (unsigned long)sum.dirty_max_pct);
+  for (int b = 0; b < PERF_BUCKETS && n < len; b++) {
+    if (b == 4) n += (size_t)snprintf(buf + n, len - n, "\n        ");
+    if (n >= len) break;
+    if (b < PERF_BUCKETS - 1)
+      n += (size_t)snprintf(buf + n, len - n, " <%u:%lu", k_bucket_ms[b], (unsigned long)sum.hist_frame[b]);
+    else
+      n += (size_t)snprintf(buf + n, len - n, " >:%lu", (unsigned long)sum.hist_frame[b]);
+  }
+  if (n < len) {
+    snprintf(buf + n, len - n,
+             "\nHeap used %luK free %luK frag %u%%\nMin free %luK, max frag %u%% (%u s)",
+             (unsigned long)(h ? h->used / 1024 : 0), (unsigned long)(h ? h->free / 1024 : 0),
+             h ? h->frag_pct : 0, (unsigned long)(min_free / 1024), max_frag, s_perf.heap_count);
+  }
+}
+
+/* ─── Serial dump ─── */
+static void print_hist(const char *name, const uint32_t *hist) {
+  ConsolePrintf("  %-7s", name);
+  for (int b = 0; b < PERF_BUCKETS; b++) ConsolePrintf(" %5lu", (unsigned long)hist[b]);
+  ConsoleWrite("\n", 1);
+}
+
+void ui_perf_dump(void) {
+  /* Snapshot under the UI lock (a memcpy), then do all formatting and printing outside it */
+  static perf_state_t snap;
+  TouchStats_t ts;
+  ui_lvgl_lock();
+  memcpy(&snap, &s_perf, sizeof(snap));
+  TouchGetStats(&ts);
+  ui_lvgl_unlock();
+
+  perf_summary_t sum;
+  summarise(&snap, &sum);
+  ConsolePrintf("UI perf: %lu frames total, last %lu in window\n", (unsigned long)snap.frames_total,
+                (unsigned long)sum.n);
+  ConsolePrintf("  render avg %lu us max %lu us | flush avg %lu us max %lu us | dirty avg %lu%% max %lu%%\n",
+                (unsigned long)sum.render_avg_us, (unsigned long)sum.render_max_us,
+                (unsigned long)sum.flush_avg_us, (unsigned long)sum.flush_max_us,
+                (unsigned long)sum.dirty_avg_pct, (unsigned long)sum.dirty_max_pct);
+  ConsolePrintf("  ms     ");
+  for (int b = 0; b < PERF_BUCKETS - 1; b++) ConsolePrintf("  <%3u", k_bucket_ms[b]);
+  ConsolePrintf("  >=100\n");
+  print_hist("frame", sum.hist_frame);
+  print_hist("render", sum.hist_render);
+  print_hist("flush", sum.hist_flush);
+
+  ConsolePrintf("  LVGL heap, %u samples at 1 Hz (oldest first): used/free/biggest free B, frag %%\n",
+                snap.heap_count);
+  uint16_t first = (snap.heap_count < UI_PERF_HEAP_SAMPLES) ? 0 : snap.heap_idx;
+  for (uint16_t k = 0; k < snap.heap_count; k++) {
+    const perf_heap_t *h = &snap.heap[(first + k) % UI_PERF_HEAP_SAMPLES];
+    ConsolePrintf("    %lu/%lu/%lu %u%%\n", (unsigned long)h->used, (unsigned long)h->free,
+                  (unsigned long)h->free_biggest, h->frag_pct);
+  }
+
+  uint32_t idle_reads = ts.reads - ts.spi_reads;
+  ConsolePrintf("  touch: %lu reads, %lu with SPI, %lu presses, %lu rejected, %lu bus busy | read avg %lu us "
+                "(idle %lu us) max %lu us\n", (unsigned long)ts.reads, (unsigned long)ts.spi_reads,
+                (unsigned long)ts.presses, (unsigned long)ts.rejected, (unsigned long)ts.bus_busy,
+                (unsigned long)(ts.spi_reads ? ts.busy_us / ts.spi_reads : 0),
+                (unsigned long)(idle_reads ? ts.idle_us / idle_reads : 0), (unsigned long)ts.busy_max_us);
+  if (ts.wake_checks) {
+    ConsolePrintf("  touch wake checks while blank: %lu, %lu without pressure\n", (unsigned long)ts.wake_checks,
+                  (unsigned long)ts.wake_rejected);
+  }
+  if (ts.held_reads) {
+    ConsolePrintf("  touch jitter while held: raw %.2f px/read, filtered %.2f px/read (%lu reads)\n",
+                  (double)ts.jitter_raw_px / ts.held_reads, (double)ts.jitter_filt_px / ts.held_reads,
+                  (unsigned long)ts.held_reads);
+  }
+}
@@ -0,0 +1,361 @@
+/**
+ * @file ui_scope.cpp
+ * Live scope widget (see ui_scope.h).
+ */
+#include "ui_scope.h"
+#include "ui_theme.h"
+#include "sensor.h"
+#include <Arduino.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCOPE_HIST       512       /* local sample history; bounds the widest timebase */
+#define SCOPE_TRIG_DIVS  1         /* trigger point this many divisions from the left edge */
+#define SCOPE_MARGIN     0.1f      /* headroom above/below the traces on rescale */
+#define SCOPE_COL_GRID   0x404040
+#define SCOPE_COL_V      0xFFC940  /* current uses COL_ACCENT, as on the dashboard */
+
+static const uint16_t k_timebase_ms[] = {20, 50, 100, 200, 500};
+#define SCOPE_TIMEBASES  (sizeof(k_timebase_ms) / sizeof(k_timebase_ms[0]))
+#define SCOPE_TB_DEFAULT 2
+
+typedef struct {
+  float lo;
+  float hi;
+  float min_span;
+} scope_scale_t;
+
+typedef struct {
+  lv_draw_buf_t buf;
+  uint16_t     *row_blank;   /* background row templates, memcpy'd per frame */
+  uint16_t     *row_vdots;   /* ... with dots on the vertical division lines */
+  uint16_t     *row_hline;   /* ... a dotted horizontal division line */
+  int32_t       w, h;
+  SensorSample  hist[SCOPE_HIST];
+  uint32_t      hist_head;   /* next write index */
+  uint32_t      hist_count;
+  uint32_t      seq;         /* next sensor ring sequence number to read */
+  bool          running;
+  bool          dirty;       /* settings changed while stopped: redraw once */
+  bool          pending;     /* frame invalidated, waiting for the refresh */
+  bool          drawn;       /* the canvas was rendered since */
+  uint8_t       tb_idx;
+  ui_scope_channel_t trig_ch;
+  float         trig_level;
+  scope_scale_t scale[SCOPE_CH_COUNT];
+  uint16_t      col[SCOPE_CH_COUNT];
+  uint16_t      col_bg, col_grid;
+  lv_timer_t   *timer;
+  uint32_t      win_start_ms;
+  uint32_t      win_frames;
+  uint32_t      win_ticks;
+  uint32_t      win_new;
+  ui_scope_stats_t stats;
+} scope_t;
+
+static inline uint16_t *scope_row(scope_t *s, int32_t y) {
+  return (uint16_t *)(s->buf.data + (size_t)y * s->buf.header.stride);
+}
+
+static inline const SensorSample *hist_at(const scope_t *s, uint32_t k) {
+  return &s->hist[(s->hist_head + SCOPE_HIST - s->hist_count + k) % SCOPE_HIST];
+}
+
+static inline float sample_ch(const SensorSample *smp, ui_scope_channel_t ch) {
+  return ch == SCOPE_CH_CURRENT ? smp->current : smp->voltage;
+}
+
+static uint32_t samples_per_screen(const scope_t *s) {
+  uint32_t n = (uint32_t)k_timebase_ms[s->tb_idx] * SCOPE_DIVS_X / SENSOR_SAMPLE_PERIOD_MS;
+  if (n < 2) n = 2;
+  if (n > SCOPE_HIST) n = SCOPE_HIST;
+  return n;
+}
+
+static int32_t scope_y(const scope_t *s, ui_scope_channel_t ch, float v) {
+  const scope_scale_t *sc = &s->scale[ch];
+  float t = (v - sc->lo) / (sc->hi - sc->lo);
+  int32_t y = (s->h - 1) - (int32_t)lroundf(t * (s->h - 1));
+  if (y < 0) y = 0;
+  if (y > s->h - 1) y = s->h - 1;
+  return y;
+}
+
+/* Bresenham; endpoints are already clamped to the plot */
+static void scope_line(scope_t *s, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint16_t c) {
+  int32_t dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+  int32_t dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+  int32_t err = dx + dy;
+  for (;;) {
+    scope_row(s, y0)[x0] = c;
+    if (x0 == x1 && y0 == y1) break;
+    int32_t e2 = 2 * err;
+    if (e2 >= dy) { err += dy; x0 += sx; }
+    if (e2 <= dx) { err += dx; y0 += sy; }
+  }
+}
+
+/* Same autoscale rule as the sparklines: grow at once, shrink when the data fills under half */
+static void scope_rescale(scope_t *s, ui_scope_channel_t ch, uint32_t start, uint32_t n) {
+  float mn = INFINITY, mx = -INFINITY;
+  for (uint32_t k = 0; k < n; k++) {
+    float v = sample_ch(hist_at(s, start + k), ch);
+    if (v < mn) mn = v;
+    if (v > mx) mx = v;
+  }
+  if (mn > mx) return;
+  scope_scale_t *sc = &s->scale[ch];
+  bool outside = mn < sc->lo || mx > sc->hi;
+  float d = mx - mn;
+  if (d < sc->min_span) {
+    float mid = 0.5f * (mn + mx);
+    mn = mid - 0.5f * sc->min_span;
+    mx = mid + 0.5f * sc->min_span;
+    d = sc->min_span;
+  }
+  bool loose = (sc->hi - sc->lo) > 2.f * (1.f + 2.f * SCOPE_MARGIN) * d;
+  if (!outside && !loose) return;
+  sc->lo = mn - SCOPE_MARGIN * d;
+  sc->hi = mx + SCOPE_MARGIN * d;
+}
+
+/* Latest rising edge through the level that still has a full screen after it */
+static bool scope_find_trigger(const scope_t *s, uint32_t n, uint32_t *start) {
+  uint32_t pre = n * SCOPE_TRIG_DIVS / SCOPE_DIVS_X;
+  uint32_t post = n - pre;
+  if (s->hist_count < n) return false;
+  for (uint32_t t = s->hist_count - post; t > pre; t--) {
+    float a = sample_ch(hist_at(s, t - 1), s->trig_ch);
+    float b = sample_ch(hist_at(s, t), s->trig_ch);
+    if (a < s->trig_level && b >= s->trig_level) {
+      *start = t - pre;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void scope_pull(scope_t *s) {
+  SensorSample chunk[32];
+  uint32_t got;
+  while ((got = SensorRingRead(&s->seq, chunk, 32)) > 0) {
+    for (uint32_t k = 0; k < got; k++) {
+      s->hist[s->hist_head] = chunk[k];
+      s->hist_head = (s->hist_head + 1) % SCOPE_HIST;
+      if (s->hist_count < SCOPE_HIST) s->hist_count++;
+    }
+    s->win_new += got;
+  }
+}
+
+static void scope_render(scope_t *s) {
+  uint32_t t0 = micros();
+  uint32_t n = samples_per_screen(s);
+
+  /* Pick the window: trigger-aligned when an edge is found, else the newest samples */
+  uint32_t start = 0;
+  bool triggered = scope_find_trigger(s, n, &start);
+  uint32_t shown = n;
+  if (!triggered) {
+    if (s->hist_count < n) shown = s->hist_count;
+    start = s->hist_count - shown;
+  }
+  for (int ch = 0; ch < SCOPE_CH_COUNT; ch++) scope_rescale(s, (ui_scope_channel_t)ch, start, shown);
+
+  /* Graticule */
+  size_t row_bytes = (size_t)s->w * 2;
+  for (int32_t y = 0; y < s->h; y++)
+    memcpy(scope_row(s, y), (y & 3) == 0 ? s->row_vdots : s->row_blank, row_bytes);
+  for (int k = 0; k <= SCOPE_DIVS_Y; k++)
+    memcpy(scope_row(s, (int32_t)k * (s->h - 1) / SCOPE_DIVS_Y), s->row_hline, row_bytes);
+
+  /* Trigger level (dashed, in the trigger channel's colour) and trigger point */
+  uint16_t tc = s->col[s->trig_ch];
+  int32_t ty = scope_y(s, s->trig_ch, s->trig_level);
+  uint16_t *trow = scope_row(s, ty);
+  for (int32_t x = 0; x < s->w; x++)
+    if ((x & 7) < 3) trow[x] = tc;
+  if (triggered) {
+    int32_t tx = (int32_t)(SCOPE_TRIG_DIVS * (s->w - 1) / SCOPE_DIVS_X);
+    for (int32_t y = 0; y < 5; y++) scope_row(s, y)[tx] = tc;
+  }
+
+  /* Traces: sample k of the nominal n sits at k*(w-1)/(n-1), so a short history fills from the left */
+  for (int ch = SCOPE_CH_COUNT - 1; ch >= 0; ch--) {
+    int32_t px = 0, py = 0;
+    for (uint32_t k = 0; k < shown; k++) {
+      int32_t x = (int32_t)(k * (uint32_t)(s->w - 1) / (n - 1));
+      int32_t y = scope_y(s, (ui_scope_channel_t)ch, sample_ch(hist_at(s, start + k), (ui_scope_channel_t)ch));
+      if (k == 0) scope_row(s, y)[x] = s->col[ch];
+      else scope_line(s, px, py, x, y, s->col[ch]);
+      px = x;
+      py = y;
+    }
+  }
+
+  uint32_t dt = micros() - t0;
+  s->stats.render_us = dt;
+  if (dt > s->stats.render_max_us) s->stats.render_max_us = dt;
+  s->stats.samples_shown = shown;
+  s->stats.triggered = triggered;
+}
+
+static void scope_timer_cb(lv_timer_t *t) {
+  lv_obj_t *obj = (lv_obj_t *)lv_timer_get_user_data(t);
+  scope_t *s = (scope_t *)lv_obj_get_user_data(obj);
+  if (!s) return;
+
+  if (s->pending && s->drawn) s->win_frames++;
+  s->pending = false;
+  s->win_ticks++;
+  uint32_t now = lv_tick_get();
+  if (now - s->win_start_ms >= 1000) {
+    uint32_t span = now - s->win_start_ms;
+    s->stats.fps_x10 = s->win_frames * 10000 / span;
+    s->stats.samples_new = s->win_ticks ? s->win_new / s->win_ticks : 0;
+    s->win_frames = s->win_ticks = s->win_new = 0;
+    s->win_start_ms = now;
+  }
+
+  if (s->running) scope_pull(s);
+  else if (!s->dirty) return;
+  s->dirty = false;
+
+  scope_render(s);
+  lv_image_cache_drop(&s->buf);
+  lv_obj_invalidate(obj);
+  s->pending = true;
+  s->drawn = false;
+}
+
+static void scope_draw_cb(lv_event_t *e) {
+  scope_t *s = (scope_t *)lv_obj_get_user_data((lv_obj_t *)lv_event_get_target(e));
+  if (s) s->drawn = true;
+}
+
+static void scope_delete_cb(lv_event_t *e) {
+  lv_obj_t *obj = (lv_obj_t *)lv_event_get_target(e);
+  scope_t *s = (scope_t *)lv_obj_get_user_data(obj);
+  if (!s) return;
+  if (s->timer) lv_timer_delete(s->timer);
+  free(s->buf.data);
+  free(s->row_blank);
+  free(s);
+  lv_obj_set_user_data(obj, NULL);
+}
+
+lv_obj_t *ui_scope_create(lv_obj_t *parent, int32_t w, int32_t h) {
+  if (w < SCOPE_DIVS_X * 2 || h < SCOPE_DIVS_Y * 2) return NULL;
+  scope_t *s = (scope_t *)calloc(1, sizeof(scope_t));
+  uint32_t stride = (uint32_t)w * 2;
+  uint32_t size = stride * (uint32_t)h;
+  void *data = malloc(size);
+  uint16_t *rows = (uint16_t *)malloc((size_t)w * 2 * 3);
+  if (!s || !data || !rows) {
+    free(s);
+    free(data);
+    free(rows);
+    return NULL;
+  }
+  lv_draw_buf_init(&s->buf, (uint32_t)w, (uint32_t)h, LV_COLOR_FORMAT_RGB565, stride, data, size);
+  s->w = w;
+  s->h = h;
+  s->col_bg = lv_color_to_u16(lv_color_hex(COL_BG));
+  s->col_grid = lv_color_to_u16(lv_color_hex(SCOPE_COL_GRID));
+  s->col[SCOPE_CH_CURRENT] = lv_color_to_u16(lv_color_hex(COL_ACCENT));
+  s->col[SCOPE_CH_VOLTAGE] = lv_color_to_u16(lv_color_hex(SCOPE_COL_V));
+  s->scale[SCOPE_CH_CURRENT].min_span = 0.05f;
+  s->scale[SCOPE_CH_VOLTAGE].min_span = 0.1f;
+  for (int ch = 0; ch < SCOPE_CH_COUNT; ch++) {
+    s->scale[ch].lo = -0.5f * s->scale[ch].min_span;
+    s->scale[ch].hi = 0.5f * s->scale[ch].min_span;
+  }
+  s->row_blank = rows;
+  s->row_vdots = rows + w;
+  s->row_hline = rows + 2 * w;
+  for (int32_t x = 0; x < w; x++) {
+    bool vline = false;
+    for (int k = 0; k <= SCOPE_DIVS_X && !vline; k++) vline = x == k * (w - 1) / SCOPE_DIVS_X;
+    s->row_blank[x] = s->col_bg;
+    s->row_vdots[x] = vline ? s->col_grid : s->col_bg;
+    s->row_hline[x] = (vline || (x & 3) == 0) ? s->col_grid : s->col_bg;
+  }
+  s->running = true;
+  s->dirty = true;
+  s->tb_idx = SCOPE_TB_DEFAULT;
+  s->trig_ch = SCOPE_CH_CURRENT;
+  s->trig_level = 0.0f;  /* charge/discharge crossing */
+  /* Start with the history the ring already holds, so the first frame is not empty */
+  uint32_t head = SensorRingHead();
+  s->seq = head > SCOPE_HIST ? head - SCOPE_HIST : 0;
+  s->win_start_ms = lv_tick_get();
+  scope_render(s);
+
+  lv_obj_t *canvas = lv_canvas_create(parent);
+  lv_canvas_set_draw_buf(canvas, &s->buf);
+  lv_obj_remove_flag(canvas, LV_OBJ_FLAG_CLICKABLE);
+  lv_obj_set_user_data(canvas, s);
+  lv_obj_add_event_cb(canvas, scope_draw_cb, LV_EVENT_DRAW_POST_END, NULL);
+  lv_obj_add_event_cb(canvas, scope_delete_cb, LV_EVENT_DELETE, NULL);
+  s->timer = lv_timer_create(scope_timer_cb, SCOPE_FRAME_MS, canvas);
+  return canvas;
+}
+
+static scope_t *scope_get(lv_obj_t *scope) {
+  return scope ? (scope_t *)lv_obj_get_user_data(scope) : NULL;
+}
+
+void ui_scope_set_running(lv_obj_t *scope, bool run) {
+  scope_t *s = scope_get(scope);
+  if (!s) return;
+  /* Resuming continues from now; the gap while stopped is not stitched into the trace */
+  if (run && !s->running) {
+    s->hist_count = 0;
+    s->seq = SensorRingHead();
+  }
+  s->running = run;
+}
+
+bool ui_scope_is_running(lv_obj_t *scope) {
+  scope_t *s = scope_get(scope);
+  return s && s->running;
+}
+
+uint32_t ui_scope_timebase_step(lv_obj_t *scope, int dir) {
+  scope_t *s = scope_get(scope);
+  if (!s) return 0;
+  int idx = (int)s->tb_idx + dir;
+  if (idx < 0) idx = 0;
+  if (idx >= (int)SCOPE_TIMEBASES) idx = SCOPE_TIMEBASES - 1;
+  s->tb_idx = (uint8_t)idx;
+  s->dirty = true;
+  return k_timebase_ms[s->tb_idx];
+}
+
+void ui_scope_trigger_step(lv_obj_t *scope, int divs) {
+  scope_t *s = scope_get(scope);
+  if (!s) return;
+  const scope_scale_t *sc = &s->scale[s->trig_ch];
+  s->trig_level += divs * (sc->hi - sc->lo) / SCOPE_DIVS_Y;
+  s->dirty = true;
+}
+
+void ui_scope_trigger_toggle_channel(lv_obj_t *scope) {
+  scope_t *s = scope_get(scope);
+  if (!s) return;
+  s->trig_ch = s->trig_ch == SCOPE_CH_CURRENT ? SCOPE_CH_VOLTAGE : SCOPE_CH_CURRENT;
+  const scope_scale_t *sc = &s->scale[s->trig_ch];
+  s->trig_level = 0.5f * (sc->lo + sc->hi);
+  s->dirty = true;
+}
+
+void ui_scope_get_stats(lv_obj_t *scope, ui_scope_stats_t *out) {
+  scope_t *s = scope_get(scope);
+  if (!s || !out) return;
+  *out = s->stats;
+  out->trigger_level = s->trig_level;
+  out->trigger_ch = s->trig_ch;
+  for (int ch = 0; ch < SCOPE_CH_COUNT; ch++) out->per_div[ch] = (s->scale[ch].hi - s->scale[ch].lo) / SCOPE_DIVS_Y;
+  out->timebase_ms = k_timebase_ms[s->tb_idx];
+}
@@ -0,0 +1,181 @@
+/**
+ * @file ui_sparkline.cpp
+ * Incrementally drawn canvas sparkline (see ui_sparkline.h).
+ */
+#include "ui_sparkline.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPARK_ZERO_COLOR 0x505050  /* zero line when the range spans 0 (charge/discharge) */
+#define SPARK_MARGIN     0.1f      /* headroom added above/below the data on rescale */
+
+typedef struct {
+  lv_draw_buf_t buf;
+  float   *ring;      /* one value per column, oldest at head */
+  int32_t  w, h;
+  int32_t  head;
+  int32_t  count;
+  float    lo, hi;    /* current scale */
+  float    min_span;
+  int16_t  last_y;    /* row of the previous sample, -1 = gap */
+  uint16_t fg, bg, zero;
+  uint32_t rescales;
+} spark_t;
+
+static inline uint16_t *spark_row(spark_t *s, int32_t y) {
+  return (uint16_t *)(s->buf.data + (size_t)y * s->buf.header.stride);
+}
+
+static int16_t spark_y(const spark_t *s, float v) {
+  float t = (v - s->lo) / (s->hi - s->lo);
+  int32_t y = (s->h - 1) - (int32_t)lroundf(t * (s->h - 1));
+  if (y < 0) y = 0;
+  if (y > s->h - 1) y = s->h - 1;
+  return (int16_t)y;
+}
+
+/* Column x: background, zero line, then the segment joining the previous sample to this one */
+static void spark_column(spark_t *s, int32_t x, float v) {
+  for (int32_t y = 0; y < s->h; y++) spark_row(s, y)[x] = s->bg;
+  if (s->lo < 0.f && s->hi > 0.f) spark_row(s, spark_y(s, 0.f))[x] = s->zero;
+  if (isnan(v)) {
+    s->last_y = -1;
+    return;
+  }
+  int16_t y = spark_y(s, v);
+  int16_t y0 = s->last_y < 0 ? y : s->last_y;
+  int16_t a = y0 < y ? y0 : y, b = y0 < y ? y : y0;
+  for (int32_t r = a; r <= b; r++) spark_row(s, r)[x] = s->fg;
+  s->last_y = y;
+}
+
+static void spark_redraw(spark_t *s) {
+  int32_t blank = s->w - s->count;
+  for (int32_t x = 0; x < blank; x++)
+    for (int32_t y = 0; y < s->h; y++) spark_row(s, y)[x] = s->bg;
+  s->last_y = -1;
+  for (int32_t k = 0; k < s->count; k++) spark_column(s, blank + k, s->ring[(s->head + k) % s->w]);
+}
+
+/* Fit the scale to the window when data leaves it or fills under half of it */
+static bool spark_rescale(spark_t *s) {
+  float mn = INFINITY, mx = -INFINITY;
+  for (int32_t k = 0; k < s->count; k++) {
+    float v = s->ring[(s->head + k) % s->w];
+    if (isnan(v)) continue;
+    if (v < mn) mn = v;
+    if (v > mx) mx = v;
+  }
+  if (mn > mx) return false;
+  bool outside = mn < s->lo || mx > s->hi;
+  float d = mx - mn;
+  if (d < s->min_span) {
+    float mid = 0.5f * (mn + mx);
+    mn = mid - 0.5f * s->min_span;
+    mx = mid + 0.5f * s->min_span;
+    d = s->min_span;
+  }
+  bool loose = (s->hi - s->lo) > 2.f * (1.f + 2.f * SPARK_MARGIN) * d;
+  if (!outside && !loose) return false;
+  s->lo = mn - SPARK_MARGIN * d;
+  s->hi = mx + SPARK_MARGIN * d;
+  return true;
+}
+
+static void spark_delete_cb(lv_event_t *e) {
+  lv_obj_t *obj = (lv_obj_t *)lv_event_get_target(e);
+  spark_t *s = (spark_t *)lv_obj_get_user_data(obj);
+  if (!s) return;
+  free(s->buf.data);
+  free(s->ring);
+  free(s);
+  lv_obj_set_user_data(obj, NULL);
+}
+
+lv_obj_t *ui_sparkline_create(lv_obj_t *parent, int32_t w, int32_t h, float min_span,
+                              lv_color_t fg, lv_color_t bg) {
+  if (w < 2 || h < 2) return NULL;
+  spark_t *s = (spark_t *)calloc(1, sizeof(spark_t));
+  uint32_t stride = (uint32_t)w * 2;
+  uint32_t size = stride * (uint32_t)h;
+  void *data = malloc(size);
+  float *ring = (float *)malloc(sizeof(float) * (size_t)w);
+  if (!s || !data || !ring) {
+    free(s);
+    free(data);
+    free(ring);
+    return NULL;
+  }
+  lv_draw_buf_init(&s->buf, (uint32_t)w, (uint32_t)h, LV_COLOR_FORMAT_RGB565, stride, data, size);
+  s->ring = ring;
+  s->w = w;
+  s->h = h;
+  s->min_span = min_span > 0.f ? min_span : 1e-3f;
+  s->lo = -0.5f * s->min_span;
+  s->hi = 0.5f * s->min_span;
+  s->fg = lv_color_to_u16(fg);
+  s->bg = lv_color_to_u16(bg);
+  s->zero = lv_color_to_u16(lv_color_hex(SPARK_ZERO_COLOR));
+  s->last_y = -1;
+  spark_redraw(s);
+
+  lv_obj_t *canvas = lv_canvas_create(parent);
+  lv_canvas_set_draw_buf(canvas, &s->buf);
+  lv_obj_remove_flag(canvas, LV_OBJ_FLAG_CLICKABLE);
+  lv_obj_set_user_data(canvas, s);
+  lv_obj_add_event_cb(canvas, spark_delete_cb, LV_EVENT_DELETE, NULL);
+  return canvas;
+}
+
+void ui_sparkline_append(lv_obj_t *spark, float v) {
+  spark_t *s = spark ? (spark_t *)lv_obj_get_user_data(spark) : NULL;
+  if (!s) return;
+  if (s->count < s->w) {
+    s->ring[(s->head + s->count) % s->w] = v;
+    s->count++;
+  } else {
+    s->ring[s->head] = v;
+    s->head = (s->head + 1) % s->w;
+  }
+
+  if (spark_rescale(s)) {
+    s->rescales++;
+    spark_redraw(s);
+  } else {
+    for (int32_t y = 0; y < s->h; y++) {
+      uint16_t *row = spark_row(s, y);
+      memmove(row, row + 1, (size_t)(s->w - 1) * 2);
+    }
+    spark_column(s, s->w - 1, v);
+  }
+}
+
+void ui_sparkline_refresh(lv_obj_t *spark) {
+  spark_t *s = spark ? (spark_t *)lv_obj_get_user_data(spark) : NULL;
+  if (!s) return;
+  lv_image_cache_drop(&s->buf);  /* pixels changed in place */
+  lv_obj_invalidate(spark);
+}
+
+void ui_sparkline_push(lv_obj_t *spark, float v) {
+  ui_sparkline_append(spark, v);
+  ui_sparkline_refresh(spark);
+}
+
+void ui_sparkline_clear(lv_obj_t *spark) {
+  spark_t *s = spark ? (spark_t *)lv_obj_get_user_data(spark) : NULL;
+  if (!s) return;
+  s->count = 0;
+  s->head = 0;
+  s->lo = -0.5f * s->min_span;
+  s->hi = 0.5f * s->min_span;
+  spark_redraw(s);
+  lv_image_cache_drop(&s->buf);
+  lv_obj_invalidate(spark);
+}
+
+uint32_t ui_sparkline_rescales(lv_obj_t *spark) {
+  spark_t *s = spark ? (spark_t *)lv_obj_get_user_data(spark) : NULL;
+  return s ? s->rescales : 0;
+}
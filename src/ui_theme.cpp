@@ -0,0 +1,49 @@
+/**
+ * @file ui_theme.cpp
+ * Shared static styles for the LVGL UI (see ui_theme.h).
+ */
+#include "ui_theme.h"
+
+lv_style_t ui_style_bg;
+lv_style_t ui_style_list;
+lv_style_t ui_style_header;
+lv_style_t ui_style_card;
+lv_style_t ui_style_text;
+lv_style_t ui_style_text_muted;
+lv_style_t ui_style_text_accent;
+lv_style_t ui_style_text_large;
+
+static void text_style(lv_style_t *st, uint32_t color) {
+  lv_style_init(st);
+  lv_style_set_text_color(st, lv_color_hex(color));
+}
+
+void ui_theme_init(void) {
+  static bool inited = false;
+  if (inited) return;
+  inited = true;
+
+  lv_style_init(&ui_style_bg);
+  lv_style_set_bg_color(&ui_style_bg, lv_color_hex(COL_BG));
+
+  lv_style_init(&ui_style_list);
+  lv_style_set_bg_color(&ui_style_list, lv_color_hex(COL_BG));
+  lv_style_set_pad_all(&ui_style_list, MARGIN);
+  lv_style_set_pad_row(&ui_style_list, GAP);
+
+  lv_style_init(&ui_style_header);
+  lv_style_set_bg_color(&ui_style_header, lv_color_hex(COL_HEADER));
+  lv_style_set_radius(&ui_style_header, 0);
+  lv_style_set_pad_all(&ui_style_header, 0);
+
+  lv_style_init(&ui_style_card);
+  lv_style_set_bg_color(&ui_style_card, lv_color_hex(COL_CARD));
+  lv_style_set_radius(&ui_style_card, CARD_R);
+
+  text_style(&ui_style_text, COL_TEXT);
+  text_style(&ui_style_text_muted, COL_MUTED);
+  text_style(&ui_style_text_accent, COL_ACCENT);
+
+  lv_style_init(&ui_style_text_large);
+  lv_style_set_text_font(&ui_style_text_large, &lv_font_montserrat_20);
+}
@@ -0,0 +1,172 @@
+/**
+ * @file usb_stream.cpp
+ * USB sample stream (see usb_stream.h and docs/USB_STREAM.md).
+ */
+#include "usb_stream.h"
+#include "sensor.h"
+#include "sample_codec.h"
+#include "cobs.h"
+#include "crc32.h"
+#include <Arduino.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#define USB_STREAM_IDLE_BAUD 115200  /* Serial.begin() in main.cpp */
+
+static_assert(USB_STREAM_FRAME_SAMPLES >= 1 && USB_STREAM_FRAME_SAMPLES <= 1024, "frame sample count");
+
+#define STREAM_RAW_MAX  USB_STREAM_FRAME_MAX(USB_STREAM_FRAME_SAMPLES)
+
+static TaskHandle_t      s_task = NULL;
+static SemaphoreHandle_t s_tx_lock = NULL;  /* held by the task while a frame is built and sent */
+static volatile bool     s_run = false;
+static UsbStreamStats    s_stats;
+static portMUX_TYPE      s_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t          s_start_ms = 0;
+
+/* Stream task state */
+static uint32_t     s_seq = 0;
+static uint16_t     s_frame_no = 0;
+static SensorSample s_chunk[USB_STREAM_FRAME_SAMPLES];
+static uint8_t      s_raw[STREAM_RAW_MAX];
+static uint8_t      s_wire[COBS_MAX_ENCODED(STREAM_RAW_MAX) + 2];
+
+/* ─── Frame building ─── */
+static size_t frame_build(const SensorSample *smp, uint32_t n, uint32_t first_seq) {
+  UsbStreamFrameHeader h;
+  memset(&h, 0, sizeof(h));
+  h.type = USB_STREAM_FRAME_TYPE;
+  h.version = USB_STREAM_VERSION;
+  h.frame_no = s_frame_no++;
+  h.first_seq = first_seq;
+  h.count = (uint16_t)n;
+  h.v_lsb_uv = USB_STREAM_V_LSB_UV;
+  h.i_lsb_ua = USB_STREAM_I_LSB_UA;
+
+  SampleCodecPoint prev = {smp[0].t_ms, SampleCodecQuantise(smp[0].voltage, USB_STREAM_V_LSB_UV),
+                           SampleCodecQuantise(smp[0].current, USB_STREAM_I_LSB_UA)};
+  h.key_t_ms = prev.t_ms;
+  h.key_v = prev.v;
+  h.key_i = prev.i;
+  size_t len = sizeof(h);
+  for (uint32_t k = 1; k < n; k++) {
+    SampleCodecPoint p = {smp[k].t_ms, SampleCodecQuantise(smp[k].voltage, USB_STREAM_V_LSB_UV),
+                          SampleCodecQuantise(smp[k].current, USB_STREAM_I_LSB_UA)};
+    len += SampleCodecEncode(&prev, &p, s_raw + len);
+    prev = p;
+  }
+  memcpy(s_raw, &h, sizeof(h));
+  uint32_t crc = Crc32(s_raw, len);
+  memcpy(s_raw + len, &crc, sizeof(crc));
+  len += sizeof(crc);
+
+  /* Leading delimiter too: log text printed between frames then stays out of the next frame */
+  s_wire[0] = 0;
+  size_t w = 1 + CobsEncode(s_raw, len, s_wire + 1);
+  s_wire[w++] = 0;
+  return w;
+}
+
+static void stream_drain(void) {
+  for (;;) {
+    uint32_t before = s_seq;
+    uint32_t got = SensorRingRead(&s_seq, s_chunk, USB_STREAM_FRAME_SAMPLES);
+    uint32_t lost = (s_seq - before) - got;
+    if (got == 0) {
+      if (lost) {
+        portENTER_CRITICAL(&s_stats_mux);
+        s_stats.samples_dropped += lost;
+        portEXIT_CRITICAL(&s_stats_mux);
+      }
+      return;
+    }
+    size_t w = frame_build(s_chunk, got, s_seq - got);
+    uint32_t t0 = micros();
+    Serial.write(s_wire, w);  /* one call: other tasks' prints cannot land inside the frame */
+    uint32_t dt = micros() - t0;
+
+    portENTER_CRITICAL(&s_stats_mux);
+    s_stats.frames++;
+    s_stats.samples += got;
+    s_stats.bytes += w;
+    s_stats.samples_dropped += lost;
+    if (dt > s_stats.write_us_max) s_stats.write_us_max = dt;
+    portEXIT_CRITICAL(&s_stats_mux);
+  }
+}
+
+static void stream_task(void *arg) {
+  (void)arg;
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    if (!s_run) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      wake = xTaskGetTickCount();
+      continue;
+    }
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(USB_STREAM_POLL_MS));
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    if (s_run) stream_drain();
+    xSemaphoreGive(s_tx_lock);
+  }
+}
+
+/* ─── Public API ─── */
+void UsbStreamStart(void) {
+  if (s_run) return;
+  if (!s_task) {
+    s_tx_lock = xSemaphoreCreateMutex();
+    /* Below the sampler (3) on the same core: a blocking UART write never delays sampling */
+    if (!s_tx_lock || xTaskCreatePinnedToCore(stream_task, "usbst", 3072, NULL, 2, &s_task, 1) != pdPASS) {
+      Serial.println("USB stream: out of memory");
+      return;
+    }
+  }
+  Serial.printf("USB stream: switching to %lu baud\n", (unsigned long)USB_STREAM_BAUD);
+  Serial.flush();
+  Serial.updateBaudRate(USB_STREAM_BAUD);
+
+  s_seq = SensorRingHead();
+  portENTER_CRITICAL(&s_stats_mux);
+  memset(&s_stats, 0, sizeof(s_stats));
+  s_stats.active = true;
+  portEXIT_CRITICAL(&s_stats_mux);
+  s_start_ms = millis();
+  s_run = true;
+  xTaskNotifyGive(s_task);
+}
+
+void UsbStreamStop(void) {
+  if (!s_run) return;
+  s_run = false;
+  xSemaphoreTake(s_tx_lock, portMAX_DELAY);  /* wait out the frame in flight */
+  Serial.flush();
+  Serial.updateBaudRate(USB_STREAM_IDLE_BAUD);
+  xSemaphoreGive(s_tx_lock);
+
+  UsbStreamStats st;
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.active = false;
+  s_stats.duration_ms = millis() - s_start_ms;
+  st = s_stats;
+  portEXIT_CRITICAL(&s_stats_mux);
+  uint32_t secs = st.duration_ms / 1000 ? st.duration_ms / 1000 : 1;
+  Serial.printf("USB stream: stopped after %lu s, %lu samples in %lu frames, %lu B/s, %lu dropped, "
+                "write max %lu us\n", (unsigned long)(st.duration_ms / 1000), (unsigned long)st.samples,
+                (unsigned long)st.frames, (unsigned long)(st.bytes / secs), (unsigned long)st.samples_dropped,
+                (unsigned long)st.write_us_max);
+}
+
+bool UsbStreamIsActive(void) {
+  return s_run;
+}
+
+void UsbStreamGetStats(UsbStreamStats *out) {
+  if (!out) return;
+  portENTER_CRITICAL(&s_stats_mux);
+  *out = s_stats;
+  if (s_stats.active) out->duration_ms = millis() - s_start_ms;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
@@ -0,0 +1,88 @@
+/**
+ * @file wifi_link.cpp
+ * Wi-Fi station (see wifi_link.h).
+ */
+#include "wifi_link.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <stdio.h>
+#include <string.h>
+
+#define WIFI_NVS_NAMESPACE "cyd_wifi"
+#define WIFI_NVS_KEY_SSID  "ssid"
+#define WIFI_NVS_KEY_PASS  "pass"
+
+static char s_ssid[33] = "";
+static char s_id[7] = "";
+static bool s_started = false;
+
+static void start(void) {
+  if (!s_ssid[0]) {
+    if (s_started) WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+    s_started = false;
+    return;
+  }
+  char pass[65] = "";
+  Preferences prefs;
+  if (prefs.begin(WIFI_NVS_NAMESPACE, true)) {
+    prefs.getString(WIFI_NVS_KEY_PASS, pass, sizeof(pass));
+    prefs.end();
+  }
+  char host[24];
+  snprintf(host, sizeof(host), "cyd-shunt-%s", WifiLinkDeviceId());
+  WiFi.persistent(false);  /* credentials are ours, in NVS; keep the driver's flash copy out of it */
+  WiFi.mode(WIFI_STA);
+  WiFi.setHostname(host);
+  WiFi.setAutoReconnect(true);
+  WiFi.begin(s_ssid, pass[0] ? pass : NULL);
+  s_started = true;
+}
+
+bool WifiLinkInit(void) {
+  Preferences prefs;
+  if (prefs.begin(WIFI_NVS_NAMESPACE, true)) {
+    prefs.getString(WIFI_NVS_KEY_SSID, s_ssid, sizeof(s_ssid));
+    prefs.end();
+  }
+  if (!s_ssid[0]) return false;
+  start();
+  return true;
+}
+
+void WifiLinkSetCredentials(const char *ssid, const char *pass) {
+  Preferences prefs;
+  if (prefs.begin(WIFI_NVS_NAMESPACE, false)) {
+    prefs.putString(WIFI_NVS_KEY_SSID, ssid ? ssid : "");
+    prefs.putString(WIFI_NVS_KEY_PASS, pass ? pass : "");
+    prefs.end();
+  }
+  snprintf(s_ssid, sizeof(s_ssid), "%s", ssid ? ssid : "");
+  if (s_started) WiFi.disconnect();
+  start();
+}
+
+bool WifiLinkIsUp(void) {
+  return s_started && WiFi.status() == WL_CONNECTED;
+}
+
+const char *WifiLinkDeviceId(void) {
+  if (!s_id[0]) {
+    uint64_t mac = ESP.getEfuseMac();  /* factory MAC, valid before the radio starts */
+    snprintf(s_id, sizeof(s_id), "%02x%02x%02x", (unsigned)((mac >> 24) & 0xFF), (unsigned)((mac >> 32) & 0xFF),
+             (unsigned)((mac >> 40) & 0xFF));
+  }
+  return s_id;
+}
+
+void WifiLinkGetInfo(char *buf, size_t len) {
+  if (!buf || !len) return;
+  if (!s_started) {
+    snprintf(buf, len, "off");
+  } else if (WifiLinkIsUp()) {
+    snprintf(buf, len, "%s %s %d dBm", s_ssid, WiFi.localIP().toString().c_str(), (int)WiFi.RSSI());
+  } else {
+    snprintf(buf, len, "connecting to %s", s_ssid);
+  }
+}
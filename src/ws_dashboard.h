@@ -0,0 +1,55 @@
+/**
+ * @file ws_dashboard.h
+ * Live page served at /live by http_api.cpp, straight from flash. It renders the WebSocket sample
+ * stream (ws_stream_format.h) as scrolling V/I traces, picks the rate with "rate <hz>", and shows
+ * frames per second, the decimation in effect and any sequence gaps.
+ */
+#ifndef WS_DASHBOARD_H
+#define WS_DASHBOARD_H
+
+static const char k_ws_dashboard_html[] = R"HTML(<!DOCTYPE html>
+<html><head><meta charset="utf-8"><meta name="viewport" content="width=device-width,initial-scale=1">
+<title>CYD shunt live</title>
+<style>
+body{margin:0;font:15px system-ui,sans-serif;background:#111;color:#eee}
+header{padding:10px 14px;background:#222;display:flex;gap:14px;align-items:center;flex-wrap:wrap}
+header span:first-child{flex:1}#st{color:#888}select{background:#333;color:#eee;border:0;padding:3px}
+canvas{width:100%;height:calc(100vh - 90px);display:block}a{color:#6af}
+</style></head><body>
+<header><span><a href="/">CYD shunt</a> live</span><span id="vi">-</span>
+<label>rate <select id="rate"><option>1</option><option>5</option><option>10</option>
+<option selected>20</option><option>50</option><option>100</option></select> Hz</label>
+<span id="st">connecting</span></header>
+<canvas id="c"></canvas>
+<script>
+const WIN=10000,$=id=>document.getElementById(id);let ws,ts=[],vs=[],is=[],next=null,gaps=0,frames=0,pts=0,
+ decim=0,hello=null,dirty=false;
+function connect(){ws=new WebSocket('ws://'+location.host+'/ws');ws.binaryType='arraybuffer';
+ ws.onopen=()=>ws.send('rate '+$('rate').value);
+ ws.onclose=()=>{$('st').textContent='offline';next=null;setTimeout(connect,2000)};
+ ws.onmessage=e=>{if(typeof e.data=='string'){hello=JSON.parse(e.data);return}
+  const d=new DataView(e.data);if(d.getUint8(0)!=0x5A)return;
+  const first=d.getUint32(8,true),n=d.getUint16(16,true);decim=d.getUint16(18,true);
+  if((next!==null&&first!=next)||(d.getUint8(2)&1))gaps++;next=(first+d.getUint32(12,true))>>>0;
+  for(let k=0;k<n;k++){const o=24+12*k;ts.push(d.getUint32(o,true));vs.push(d.getFloat32(o+4,true));
+   is.push(d.getFloat32(o+8,true))}
+  frames++;pts+=n;const cut=ts[ts.length-1]-WIN;let j=0;while(j<ts.length&&ts[j]<cut)j++;
+  if(j){ts.splice(0,j);vs.splice(0,j);is.splice(0,j)}dirty=true}}
+$('rate').onchange=()=>{if(ws.readyState==1)ws.send('rate '+$('rate').value)};
+setInterval(()=>{if(ws.readyState!=1)return;const r=hello?hello.max_hz/decim:0;
+ $('st').textContent=frames+' fps, '+pts+' pts/s, '+(decim?r.toFixed(r<10?1:0)+' Hz (decim '+decim+')':'')+
+  (gaps?', '+gaps+' gaps':'');frames=pts=0},1000);
+function draw(){requestAnimationFrame(draw);if(!dirty)return;dirty=false;
+ const c=$('c'),g=c.getContext('2d'),w=c.width=c.clientWidth,h=c.height=c.clientHeight;g.clearRect(0,0,w,h);
+ if(ts.length<2)return;const t1=ts[ts.length-1],t0=t1-WIN,hh=h/2;
+ $('vi').textContent=vs[vs.length-1].toFixed(3)+' V  '+is[is.length-1].toFixed(3)+' A';
+ [[vs,'#4c8',0,'V'],[is,'#fa4',hh,'A']].forEach(([a,col,y0,u])=>{let lo=Math.min(...a),hi=Math.max(...a);
+  if(hi-lo<1e-3){hi+=5e-4;lo-=5e-4}g.strokeStyle=col;g.beginPath();
+  for(let k=0;k<a.length;k++){const x=(ts[k]-t0)*w/WIN,y=y0+hh-4-(a[k]-lo)*(hh-8)/(hi-lo);
+   k?g.lineTo(x,y):g.moveTo(x,y)}g.stroke();g.fillStyle=col;
+  g.fillText(lo.toFixed(3)+' .. '+hi.toFixed(3)+' '+u,6,y0+14)})}
+connect();draw();
+</script></body></html>
+)HTML";
+
+#endif /* WS_DASHBOARD_H */
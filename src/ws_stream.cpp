@@ -0,0 +1,323 @@
+/**
+ * @file ws_stream.cpp
+ * WebSocket sample stream (see ws_stream.h and docs/WS_STREAM.md).
+ */
+#include "ws_stream.h"
+#include "sensor.h"
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+static_assert(WS_STREAM_POINTS >= 8 && WS_STREAM_POINTS % 2 == 0, "point buffer must be even");
+
+#define WS_MAX_HZ      (1000 / SENSOR_SAMPLE_PERIOD_MS)
+#define WS_DECIM_MAX   16384  /* a client that lags past this loses its buffer (flagged as a gap) */
+#define WS_READ_CHUNK  64
+
+typedef struct {
+  uint32_t      id;          /* AsyncWebSocketClient id; 0 = free slot */
+  uint16_t      base_decim;  /* from the requested rate */
+  uint16_t      decim;       /* current: base_decim, or coarser while the client lags */
+  uint16_t      good;        /* consecutive sends into an empty queue */
+  uint8_t       flags;       /* WS_STREAM_FLAG_* for the pending frame */
+  uint32_t      frame_no;
+  /* Point being accumulated */
+  float         sum_v;
+  float         sum_i;
+  uint16_t      acc_n;
+  /* Completed points waiting for the client */
+  uint32_t      first_seq;   /* ring sequence number of pending[0]'s first raw sample */
+  uint32_t      samples;     /* raw samples in pending[] */
+  uint16_t      n;
+  WsStreamPoint pending[WS_STREAM_POINTS];
+} ws_slot_t;
+
+static AsyncWebSocket    s_ws(WS_STREAM_PATH);
+static TaskHandle_t      s_task = NULL;
+static SemaphoreHandle_t s_lock = NULL;  /* slots and s_seq; held by the task for a whole pass */
+static ws_slot_t         s_slots[WS_STREAM_MAX_CLIENTS];
+static uint8_t           s_active = 0;
+static uint32_t          s_seq = 0;
+static WsStreamStats     s_stats;
+static portMUX_TYPE      s_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* Sender task state */
+static SensorSample s_chunk[WS_READ_CHUNK];
+static uint8_t      s_frame[sizeof(WsStreamFrameHeader) + WS_STREAM_POINTS * sizeof(WsStreamPoint)];
+
+static uint16_t decim_for_rate(float hz) {
+  if (!(hz > 0)) hz = WS_STREAM_RATE_DEFAULT_HZ;
+  long d = lroundf((float)WS_MAX_HZ / hz);
+  if (d < 1) d = 1;
+  if (d > WS_MAX_HZ) d = WS_MAX_HZ;  /* 1 Hz floor */
+  return (uint16_t)d;
+}
+
+static ws_slot_t *slot_find(uint32_t id) {
+  for (int k = 0; k < WS_STREAM_MAX_CLIENTS; k++)
+    if (s_slots[k].id == id) return &s_slots[k];
+  return NULL;
+}
+
+/* ─── Per-client decimation ─── */
+
+/* Buffer full (the client is not taking frames): merge neighbouring points and halve the rate. */
+static void slot_coarsen(ws_slot_t *sl) {
+  if (sl->decim > WS_DECIM_MAX / 2) {  /* stalled for hours: start over, the client sees the jump */
+    sl->first_seq += sl->samples;
+    sl->samples = 0;
+    sl->n = 0;
+    sl->flags |= WS_STREAM_FLAG_GAP;
+    return;
+  }
+  for (uint16_t k = 0; k < sl->n / 2; k++) {
+    const WsStreamPoint *a = &sl->pending[2 * k];
+    const WsStreamPoint *b = &sl->pending[2 * k + 1];
+    WsStreamPoint m = {b->t_ms, (a->voltage + b->voltage) * 0.5f, (a->current + b->current) * 0.5f};
+    sl->pending[k] = m;
+  }
+  sl->n /= 2;
+  sl->decim *= 2;
+  sl->good = 0;
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.coarsened++;
+  if (sl->decim > s_stats.decim_max) s_stats.decim_max = sl->decim;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+static void slot_feed(ws_slot_t *sl, const SensorSample *s) {
+  sl->sum_v += s->voltage;
+  sl->sum_i += s->current;
+  if (++sl->acc_n < sl->decim) return;
+  if (sl->n == WS_STREAM_POINTS) slot_coarsen(sl);
+  WsStreamPoint p = {s->t_ms, sl->sum_v / sl->acc_n, sl->sum_i / sl->acc_n};
+  sl->pending[sl->n++] = p;
+  sl->samples += sl->acc_n;
+  sl->sum_v = sl->sum_i = 0;
+  sl->acc_n = 0;
+}
+
+/* Samples lost before the task read them: drop the partial point, keep the sequence numbers honest */
+static void slot_gap(ws_slot_t *sl, uint32_t lost) {
+  sl->samples += sl->acc_n + lost;
+  sl->sum_v = sl->sum_i = 0;
+  sl->acc_n = 0;
+  sl->flags |= WS_STREAM_FLAG_GAP;
+}
+
+static void slot_send(ws_slot_t *sl) {
+  AsyncWebSocketClient *c = s_ws.client(sl->id);
+  if (!c || c->status() != WS_CONNECTED) return;
+  size_t queued = c->queueLen();
+  if (queued >= WS_STREAM_QUEUE_HIGH || !c->canSend()) {
+    sl->good = 0;  /* points stay in the slot; slot_feed() coarsens them if this goes on */
+    portENTER_CRITICAL(&s_stats_mux);
+    s_stats.deferred++;
+    portEXIT_CRITICAL(&s_stats_mux);
+    return;
+  }
+
+  WsStreamFrameHeader h;
+  memset(&h, 0, sizeof(h));
+  h.type = WS_STREAM_FRAME_TYPE;
+  h.version = WS_STREAM_VERSION;
+  h.flags = sl->flags;
+  h.frame_no = sl->frame_no++;
+  h.first_seq = sl->first_seq;
+  h.samples = sl->samples;
+  h.count = sl->n;
+  h.decim = sl->decim;
+  h.sent_ms = millis();
+  size_t len = sizeof(h) + sl->n * sizeof(WsStreamPoint);
+  memcpy(s_frame, &h, sizeof(h));
+  memcpy(s_frame + sizeof(h), sl->pending, sl->n * sizeof(WsStreamPoint));
+  c->binary(s_frame, len);  /* copied into the client's queue */
+
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.frames++;
+  s_stats.points += sl->n;
+  s_stats.bytes += len;
+  portEXIT_CRITICAL(&s_stats_mux);
+
+  sl->first_seq += sl->samples;
+  sl->samples = 0;
+  sl->n = 0;
+  sl->flags = 0;
+  if (queued == 0 && sl->decim > sl->base_decim && ++sl->good >= WS_STREAM_RECOVER_SENDS) {
+    sl->decim = sl->decim / 2 > sl->base_decim ? sl->decim / 2 : sl->base_decim;
+    sl->good = 0;
+  }
+}
+
+/* ─── Sender task ─── */
+static void ws_pass(void) {
+  uint32_t t0 = micros();
+  for (;;) {
+    uint32_t before = s_seq;
+    uint32_t got = SensorRingRead(&s_seq, s_chunk, WS_READ_CHUNK);
+    uint32_t lost = (s_seq - before) - got;
+    if (lost) {
+      for (int k = 0; k < WS_STREAM_MAX_CLIENTS; k++)
+        if (s_slots[k].id) slot_gap(&s_slots[k], lost);
+      portENTER_CRITICAL(&s_stats_mux);
+      s_stats.samples_dropped += lost;
+      portEXIT_CRITICAL(&s_stats_mux);
+    }
+    if (!got) break;
+    for (int k = 0; k < WS_STREAM_MAX_CLIENTS; k++) {
+      ws_slot_t *sl = &s_slots[k];
+      if (!sl->id) continue;
+      for (uint32_t j = 0; j < got; j++) slot_feed(sl, &s_chunk[j]);
+    }
+  }
+  for (int k = 0; k < WS_STREAM_MAX_CLIENTS; k++)
+    if (s_slots[k].id && s_slots[k].n) slot_send(&s_slots[k]);
+  uint32_t dt = micros() - t0;
+  portENTER_CRITICAL(&s_stats_mux);
+  if (dt > s_stats.send_us_max) s_stats.send_us_max = dt;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+static void ws_task(void *arg) {
+  (void)arg;
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    if (!s_active) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      wake = xTaskGetTickCount();
+      continue;
+    }
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(WS_STREAM_POLL_MS));
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_active) ws_pass();
+    xSemaphoreGive(s_lock);
+  }
+}
+
+/* ─── WebSocket events (AsyncTCP task) ─── */
+static void send_hello(AsyncWebSocketClient *c, uint16_t decim) {
+  char msg[128];
+  snprintf(msg, sizeof(msg), "{\"type\":\"hello\",\"rate_hz\":%.2f,\"max_hz\":%u,\"decim\":%u,\"period_ms\":%u}",
+           (double)WS_MAX_HZ / decim, (unsigned)WS_MAX_HZ, (unsigned)decim, (unsigned)SENSOR_SAMPLE_PERIOD_MS);
+  c->text(msg);
+}
+
+static void on_connect(AsyncWebSocketClient *c) {
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  ws_slot_t *sl = slot_find(0);
+  if (sl) {
+    if (!s_active) s_seq = SensorRingHead();  /* the task was idle: start from now */
+    memset(sl, 0, sizeof(*sl));
+    sl->id = c->id();
+    sl->base_decim = sl->decim = decim_for_rate(WS_STREAM_RATE_DEFAULT_HZ);
+    sl->first_seq = s_seq;
+    s_active++;
+  }
+  uint16_t decim = sl ? sl->decim : 0;
+  xSemaphoreGive(s_lock);
+
+  portENTER_CRITICAL(&s_stats_mux);
+  if (sl) {
+    s_stats.connects++;
+    s_stats.clients = s_active;
+    if (s_active > s_stats.clients_peak) s_stats.clients_peak = s_active;
+  } else {
+    s_stats.rejected++;
+  }
+  portEXIT_CRITICAL(&s_stats_mux);
+
+  if (!sl) {
+    c->close(1013, "busy");
+    return;
+  }
+  send_hello(c, decim);
+  xTaskNotifyGive(s_task);
+}
+
+static void on_disconnect(uint32_t id) {
+  /* Holding the lock also keeps the library from freeing the client while the task sends to it */
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  ws_slot_t *sl = slot_find(id);
+  if (sl) {
+    sl->id = 0;
+    s_active--;
+  }
+  uint8_t active = s_active;
+  xSemaphoreGive(s_lock);
+  portENTER_CRITICAL(&s_stats_mux);
+  s_stats.clients = active;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+/* Text commands from the client; only "rate <hz>" so far */
+static void on_text(AsyncWebSocketClient *c, const uint8_t *data, size_t len) {
+  char cmd[32];
+  if (len >= sizeof(cmd)) return;
+  memcpy(cmd, data, len);
+  cmd[len] = '\0';
+  if (strncmp(cmd, "rate ", 5) != 0) return;
+  uint16_t decim = decim_for_rate(strtof(cmd + 5, NULL));
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  ws_slot_t *sl = slot_find(c->id());
+  if (sl) {
+    sl->base_decim = sl->decim = decim;  /* takes effect from the point being built */
+    sl->good = 0;
+  }
+  xSemaphoreGive(s_lock);
+  if (sl) send_hello(c, decim);
+}
+
+static void on_event(AsyncWebSocket *server, AsyncWebSocketClient *c, AwsEventType type, void *arg, uint8_t *data,
+                     size_t len) {
+  (void)server;
+  switch (type) {
+    case WS_EVT_CONNECT:
+      on_connect(c);
+      break;
+    case WS_EVT_DISCONNECT:
+      on_disconnect(c->id());
+      break;
+    case WS_EVT_DATA: {
+      const AwsFrameInfo *info = (const AwsFrameInfo *)arg;
+      if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) on_text(c, data, len);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+/* ─── Public API ─── */
+void WsStreamAttach(AsyncWebServer *server) {
+  if (s_task || !server) return;
+  s_lock = xSemaphoreCreateMutex();
+  /* Lowest priority on the sampler's core, like the MQTT publisher: a slow socket delays only this */
+  if (!s_lock || xTaskCreatePinnedToCore(ws_task, "wsst", 4096, NULL, 1, &s_task, 1) != pdPASS) {
+    Serial.println("WebSocket stream: out of memory");
+    return;
+  }
+  s_ws.onEvent(on_event);
+  server->addHandler(&s_ws);
+}
+
+void WsStreamGetStats(WsStreamStats *out) {
+  if (!out) return;
+  portENTER_CRITICAL(&s_stats_mux);
+  *out = s_stats;
+  portEXIT_CRITICAL(&s_stats_mux);
+}
+
+void WsStreamGetInfo(char *buf, size_t len) {
+  if (!buf || !len) return;
+  WsStreamStats st;
+  WsStreamGetStats(&st);
+  snprintf(buf, len, "%u clients (peak %u, %lu refused), %lu frames, %lu coarsened, max decim %u, %lu lost",
+           (unsigned)st.clients, (unsigned)st.clients_peak, (unsigned long)st.rejected, (unsigned long)st.frames,
+           (unsigned long)st.coarsened, (unsigned)st.decim_max, (unsigned long)st.samples_dropped);
+}
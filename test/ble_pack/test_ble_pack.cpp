@@ -0,0 +1,121 @@
+/**
+ * @file test_ble_pack.cpp
+ * Host tests for ble_telemetry_format.h: byte order, scaling and rounding, saturation, unknown
+ * sentinels, batch capacity per MTU, and batch round trips. Exit status 0 = all passed.
+ *
+ * Build and run: make -C test/ble_pack
+ */
+#include "ble_telemetry_format.h"
+#include <cstdio>
+#include <cstring>
+
+static int s_failed = 0;
+static int s_checks = 0;
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    s_checks++;                                                       \
+    if (!(cond)) {                                                    \
+      s_failed++;                                                     \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    }                                                                 \
+  } while (0)
+
+static bool bytes_eq(const uint8_t *a, const uint8_t *b, size_t n) {
+  return memcmp(a, b, n) == 0;
+}
+
+static void test_values(void) {
+  uint8_t b[4];
+  const uint8_t v[4] = {0x9E, 0x33, 0x00, 0x00};  /* 13214 mV */
+  CHECK(BleTlmPackVoltage(b, 13.214f) == 4 && bytes_eq(b, v, 4));
+  const uint8_t i[4] = {0xF9, 0xF6, 0xFF, 0xFF};  /* -2311 mA, two's complement */
+  CHECK(BleTlmPackCurrent(b, -2.3106f) == 4 && bytes_eq(b, i, 4));
+  BleTlmPackPower(b, -30.5245f);
+  CHECK((int32_t)BleTlmGetU32(b) == -30525 || (int32_t)BleTlmGetU32(b) == -30524);  /* float input */
+  BleTlmPackEnergy(b, 1234567.891);
+  CHECK((int32_t)BleTlmGetU32(b) == 1234567891);
+  BleTlmPackEnergy(b, 1e9);  /* 1 GWh: saturates instead of wrapping */
+  CHECK((int32_t)BleTlmGetU32(b) == INT32_MAX);
+  BleTlmPackEnergy(b, -1e9);
+  CHECK((int32_t)BleTlmGetU32(b) == INT32_MIN);
+  BleTlmPackVoltage(b, NAN);
+  CHECK(BleTlmGetU32(b) == 0);
+}
+
+static void test_soc_temperature(void) {
+  uint8_t b[2];
+  CHECK(BleTlmPackSoc(b, 87.25f) == 2 && BleTlmGetU16(b) == 8725);
+  BleTlmPackSoc(b, 104.0f);
+  CHECK(BleTlmGetU16(b) == 10000);
+  BleTlmPackSoc(b, -3.0f);
+  CHECK(BleTlmGetU16(b) == 0);
+  BleTlmPackSoc(b, NAN);
+  CHECK(BleTlmGetU16(b) == BLE_TLM_SOC_UNKNOWN);
+
+  CHECK(BleTlmPackTemperature(b, -12.345f) == 2 && (int16_t)BleTlmGetU16(b) == -1235);
+  BleTlmPackTemperature(b, NAN);
+  CHECK((int16_t)BleTlmGetU16(b) == BLE_TLM_TEMP_UNKNOWN);
+  BleTlmPackTemperature(b, -1000.0f);  /* saturates above the sentinel */
+  CHECK((int16_t)BleTlmGetU16(b) == INT16_MIN + 1);
+  BleTlmPackTemperature(b, 1000.0f);
+  CHECK((int16_t)BleTlmGetU16(b) == INT16_MAX);
+}
+
+static void test_capacity(void) {
+  CHECK(BleTlmBatchCapacity(22) == 0);
+  CHECK(BleTlmBatchCapacity(23) == 1);    /* BLE 4.0 default MTU */
+  CHECK(BleTlmBatchCapacity(185) == 21);  /* common iOS MTU */
+  CHECK(BleTlmBatchCapacity(247) == 29);  /* one LE data-length-extended packet */
+  CHECK(BleTlmBatchCapacity(517) == 62);
+  /* The whole batch always fits the notification payload */
+  for (unsigned mtu = 23; mtu <= 517; mtu++)
+    CHECK(BLE_TLM_BATCH_HEADER + BleTlmBatchCapacity((uint16_t)mtu) * BLE_TLM_BATCH_RECORD <=
+          mtu - BLE_TLM_ATT_OVERHEAD);
+}
+
+static void test_batch_round_trip(void) {
+  size_t cap = BleTlmBatchCapacity(247);
+  uint8_t buf[BLE_TLM_BATCH_HEADER + 29 * BLE_TLM_BATCH_RECORD];
+  BleTlmBatch b;
+  BleTlmBatchBegin(&b, buf, cap, 0xFFFFFFF0u, 123456789u, 50);
+  CHECK(BleTlmBatchLength(&b) == BLE_TLM_BATCH_HEADER);
+  for (size_t k = 0; k < cap; k++) CHECK(BleTlmBatchAdd(&b, 12.0f + 0.001f * (float)k, -1.5f + 0.01f * (float)k));
+  CHECK(BleTlmBatchFull(&b));
+  CHECK(!BleTlmBatchAdd(&b, 1.0f, 1.0f));
+  CHECK(BleTlmBatchLength(&b) == sizeof(buf));
+
+  BleTlmBatchInfo info;
+  CHECK(BleTlmBatchParse(buf, sizeof(buf), &info));
+  CHECK(info.count == cap && info.point_ms == 50 && info.first_seq == 0xFFFFFFF0u && info.t0_ms == 123456789u);
+  int32_t mv, ma;
+  BleTlmBatchPoint(buf, 0, &mv, &ma);
+  CHECK(mv == 12000 && ma == -1500);
+  BleTlmBatchPoint(buf, cap - 1, &mv, &ma);
+  CHECK(mv == 12028 && ma == -1220);
+
+  /* Truncated notification, wrong version */
+  CHECK(!BleTlmBatchParse(buf, sizeof(buf) - 1, &info));
+  buf[0] = 2;
+  CHECK(!BleTlmBatchParse(buf, sizeof(buf), &info));
+}
+
+static void test_batch_single_point_mtu(void) {
+  uint8_t buf[BLE_TLM_BATCH_HEADER + BLE_TLM_BATCH_RECORD];
+  BleTlmBatch b;
+  BleTlmBatchBegin(&b, buf, BleTlmBatchCapacity(23), 7, 1000, 10);
+  CHECK(BleTlmBatchAdd(&b, 3.3f, 0.0f));
+  CHECK(BleTlmBatchFull(&b));
+  BleTlmBatchInfo info;
+  CHECK(BleTlmBatchParse(buf, BleTlmBatchLength(&b), &info) && info.count == 1 && info.first_seq == 7);
+}
+
+int main(void) {
+  test_values();
+  test_soc_temperature();
+  test_capacity();
+  test_batch_round_trip();
+  test_batch_single_point_mtu();
+  printf("%d checks, %d failed\n", s_checks, s_failed);
+  return s_failed ? 1 : 0;
+}
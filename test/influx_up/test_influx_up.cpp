@@ -0,0 +1,673 @@
+/**
+ * @file test_influx_up.cpp
+ * Host tests for the InfluxDB uploader's shared code: line protocol and HTTP dates (influx_line.h),
+ * the RAM and directory spools (influx_spool.h: FIFO order, wrap-around, eviction, restart, torn and
+ * corrupt batches), and the store-and-forward policy (influx_forward.h) end to end against a local
+ * HTTP stand-in for InfluxDB on loopback.
+ *
+ * The end-to-end runs use a virtual clock (100 ms per poll, one point per second) so hours of
+ * operation take seconds, while every post is a real HTTP request to the stand-in. The stand-in
+ * goes away for a while (link down, then answering 503); the runs check that every point arrives,
+ * that the backlog drains within the budget, and that live batches keep arriving on time during the
+ * catch-up. Exit status 0 = all passed.
+ *
+ * Build and run: make -C test/influx_up
+ */
+#include "influx_line.h"
+#include "influx_spool.h"
+#include "influx_forward.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static int s_failed = 0;
+static int s_checks = 0;
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    s_checks++;                                                       \
+    if (!(cond)) {                                                    \
+      s_failed++;                                                     \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    }                                                                 \
+  } while (0)
+
+static const int64_t k_epoch_ms = 1760601600000LL;  /* 2025-10-16 08:00:00 UTC */
+
+/* ─── Line protocol ─── */
+static void test_line(void) {
+  char series[INFLUX_SERIES_MAX];
+  CHECK(InfluxSeries(series, sizeof(series), "shunt", "3a9f10", "site=north") == strlen("shunt,device=3a9f10,site=north"));
+  CHECK(!strcmp(series, "shunt,device=3a9f10,site=north"));
+  CHECK(InfluxSeries(series, sizeof(series), "shunt", "3a9f10", "") && !strcmp(series, "shunt,device=3a9f10"));
+  CHECK(InfluxSeries(series, 8, "shunt", "3a9f10", "") == 0);
+
+  InfluxPoint pt = {k_epoch_ms + 123, 13.214f, -2.311f, -30.53f, -112.402, 81.2f, 24.5f};
+  char line[INFLUX_LINE_MAX];
+  size_t n = InfluxFormatPoint(line, sizeof(line), "shunt,device=3a9f10", &pt);
+  const char *want = "shunt,device=3a9f10 v=13.2140,i=-2.3110,p=-30.530,wh=-112.402,soc=81.2,t=24.50 1760601600123\n";
+  CHECK(n == strlen(want) && !strcmp(line, want));
+
+  pt.soc = NAN;
+  pt.temp_C = NAN;
+  n = InfluxFormatPoint(line, sizeof(line), "shunt,device=3a9f10", &pt);
+  CHECK(n && !strcmp(line, "shunt,device=3a9f10 v=13.2140,i=-2.3110,p=-30.530,wh=-112.402 1760601600123\n"));
+  CHECK(InfluxFormatPoint(line, 40, "shunt,device=3a9f10", &pt) == 0);  /* does not fit */
+  pt.v = NAN;
+  CHECK(InfluxFormatPoint(line, sizeof(line), "shunt,device=3a9f10", &pt) == 0);
+
+  CHECK(InfluxTagsValid(""));
+  CHECK(InfluxTagsValid("site=north"));
+  CHECK(InfluxTagsValid("site=north,bank=a"));
+  CHECK(!InfluxTagsValid("site"));
+  CHECK(!InfluxTagsValid("site="));
+  CHECK(!InfluxTagsValid("=north"));
+  CHECK(!InfluxTagsValid("site=north,"));
+  CHECK(!InfluxTagsValid("site=no rth"));
+  CHECK(!InfluxTagsValid("site=a=b"));
+  CHECK(!InfluxTagsValid("site=\"x\""));
+  CHECK(!InfluxTagsValid(NULL));
+
+  int64_t t;
+  CHECK(InfluxParseHttpDate("Thu, 01 Jan 1970 00:00:00 GMT", &t) && t == 0);
+  CHECK(InfluxParseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT", &t) && t == 784111777);
+  CHECK(InfluxParseHttpDate("Tue, 29 Feb 2028 12:00:00 GMT", &t) && t == 1835438400);
+  CHECK(InfluxParseHttpDate("Thu, 16 Oct 2025 08:00:00 GMT", &t) && t * 1000 == k_epoch_ms);
+  CHECK(!InfluxParseHttpDate("Thu, 16 Okt 2025 08:00:00 GMT", &t));
+  CHECK(!InfluxParseHttpDate("Thu, 16 Oct 2025 08:00 GMT", &t));
+  CHECK(!InfluxParseHttpDate("", &t));
+  CHECK(!InfluxParseHttpDate(NULL, &t));
+}
+
+/* ─── Spools ─── */
+static std::string batch_body(int k, int lines) {
+  std::string s;
+  for (int j = 0; j < lines; j++) {
+    char l[64];
+    snprintf(l, sizeof(l), "shunt,device=t v=%d.%03d %d\n", k, j, k * 1000 + j);
+    s += l;
+  }
+  return s;
+}
+
+static bool peek_is(InfluxSpool *sp, int k, int lines) {
+  char buf[4096];
+  uint32_t len = 0, points = 0;
+  if (InfluxSpoolPeek(sp, buf, sizeof(buf), &len, &points) != 1) return false;
+  std::string want = batch_body(k, lines);
+  return points == (uint32_t)lines && len == want.size() && !memcmp(buf, want.data(), len);
+}
+
+static void test_ram_spool(void) {
+  static uint8_t mem[1000];
+  InfluxSpool sp;
+  InfluxSpoolInitRam(&sp, mem, sizeof(mem));
+  char buf[4096];
+  uint32_t len, points;
+  CHECK(InfluxSpoolPeek(&sp, buf, sizeof(buf), &len, &points) == 0);
+
+  /* FIFO across many wraps of the ring */
+  int next_put = 0, next_get = 0;
+  bool order_ok = true;
+  for (int round = 0; round < 200; round++) {
+    for (int k = 0; k < 2; k++, next_put++) {
+      std::string b = batch_body(next_put, 1 + next_put % 4);
+      CHECK(InfluxSpoolPut(&sp, b.data(), (uint32_t)b.size(), 1 + next_put % 4));
+    }
+    for (int k = 0; k < 2; k++, next_get++) {
+      if (!peek_is(&sp, next_get, 1 + next_get % 4)) order_ok = false;
+      InfluxSpoolPop(&sp);
+    }
+  }
+  CHECK(order_ok);
+  CHECK(sp.batches == 0 && sp.points == 0 && sp.bytes == 0 && sp.used == 0);
+  CHECK(sp.dropped_batches == 0);
+
+  /* Full: the oldest batches are evicted and counted */
+  std::string b = batch_body(0, 3);  /* 16 + ~75 bytes */
+  uint32_t size = (uint32_t)(sizeof(InfluxSpoolHdr) + b.size());
+  for (int k = 0; k < 30; k++) CHECK(InfluxSpoolPut(&sp, b.data(), (uint32_t)b.size(), 3));
+  uint32_t fit = (uint32_t)sizeof(mem) / size;
+  CHECK(sp.batches == fit);
+  CHECK(sp.dropped_batches == 30 - fit && sp.dropped_points == 3 * (30 - fit));
+  CHECK(sp.bytes == (uint64_t)fit * size);
+
+  /* Larger than the whole ring: refused */
+  std::string big(2000, 'x');
+  CHECK(!InfluxSpoolPut(&sp, big.data(), (uint32_t)big.size(), 1));
+  CHECK(sp.errors == 1);
+
+  /* Pop without a peek does nothing; an eviction cancels a pending pop */
+  uint32_t before = sp.batches;
+  InfluxSpoolPop(&sp);
+  CHECK(sp.batches == before);
+}
+
+static int s_locks = 0;
+static bool lock_fn(void) {
+  s_locks++;
+  return true;
+}
+static void unlock_fn(void) {
+  s_locks--;
+}
+
+static std::string make_tmp_dir(void) {
+  char tmpl[] = "/tmp/influx_spool_XXXXXX";
+  return mkdtemp(tmpl) ? std::string(tmpl) : std::string();
+}
+
+static int count_files(const std::string &dir) {
+  DIR *d = opendir(dir.c_str());
+  int n = 0;
+  if (!d) return -1;
+  while (struct dirent *e = readdir(d)) n += strstr(e->d_name, ".IFX") != NULL;
+  closedir(d);
+  return n;
+}
+
+static void remove_dir(const std::string &dir) {
+  DIR *d = opendir(dir.c_str());
+  if (!d) return;
+  while (struct dirent *e = readdir(d)) {
+    if (e->d_name[0] == '.') continue;
+    unlink((dir + "/" + e->d_name).c_str());
+  }
+  closedir(d);
+  rmdir(dir.c_str());
+}
+
+static void test_dir_spool(void) {
+  std::string dir = make_tmp_dir();
+  CHECK(!dir.empty());
+  InfluxSpool sp;
+  CHECK(InfluxSpoolInitDir(&sp, dir.c_str(), 1 << 20, 1024, lock_fn, unlock_fn));
+  CHECK(sp.batches == 0 && s_locks == 0);
+
+  /* ~110 bytes per batch, 1 KB files: rotation every 9 batches */
+  for (int k = 0; k < 40; k++) {
+    std::string b = batch_body(k, 3);
+    CHECK(InfluxSpoolPut(&sp, b.data(), (uint32_t)b.size(), 3));
+  }
+  CHECK(sp.batches == 40 && sp.points == 120);
+  CHECK(count_files(dir) >= 4);
+  bool order_ok = true;
+  for (int k = 0; k < 12; k++) {
+    if (!peek_is(&sp, k, 3)) order_ok = false;
+    InfluxSpoolPop(&sp);
+  }
+  CHECK(order_ok);
+  CHECK(sp.batches == 28);
+  CHECK(s_locks == 0);
+
+  /* Restart: counted again from the files; the oldest file is read from its start, so batches
+   * popped from it before the restart come round again */
+  uint32_t files_before = (uint32_t)count_files(dir);
+  InfluxSpool re;
+  CHECK(InfluxSpoolInitDir(&re, dir.c_str(), 1 << 20, 1024, lock_fn, unlock_fn));
+  CHECK(re.batches >= 28 && re.batches < 28 + 9);
+  CHECK((uint32_t)count_files(dir) == files_before);
+  uint32_t repeats = re.batches - 28;
+  order_ok = true;
+  for (uint32_t k = 0; k < repeats; k++) {
+    if (!peek_is(&re, 12 - (int)repeats + (int)k, 3)) order_ok = false;
+    InfluxSpoolPop(&re);
+  }
+  for (int k = 12; k < 40; k++) {
+    if (!peek_is(&re, k, 3)) order_ok = false;
+    InfluxSpoolPop(&re);
+  }
+  CHECK(order_ok);
+  CHECK(re.batches == 0 && re.bytes == 0);
+  CHECK(count_files(dir) == 0);  /* caught up: everything deleted */
+
+  /* Torn batch at the end of the newest file: cut off on open */
+  for (int k = 0; k < 3; k++) {
+    std::string b = batch_body(k, 2);
+    CHECK(InfluxSpoolPut(&re, b.data(), (uint32_t)b.size(), 2));
+  }
+  char path[96];
+  influx_dir_path(&re, re.wr_file, path, sizeof(path));
+  FILE *f = fopen(path, "ab");
+  InfluxSpoolHdr torn = {INFLUX_SPOOL_MAGIC, 500, 5, 0};
+  fwrite(&torn, sizeof(torn), 1, f);
+  fwrite("partial", 7, 1, f);
+  fclose(f);
+  InfluxSpool t;
+  CHECK(InfluxSpoolInitDir(&t, dir.c_str(), 1 << 20, 1024, NULL, NULL));
+  CHECK(t.batches == 3 && t.errors == 1);
+  std::string b3 = batch_body(3, 2);
+  CHECK(InfluxSpoolPut(&t, b3.data(), (uint32_t)b3.size(), 2));  /* lands where the torn one was */
+
+  /* Corrupt body: skipped and counted, the rest still comes out */
+  influx_dir_path(&t, t.rd_file, path, sizeof(path));
+  f = fopen(path, "r+b");
+  fseek(f, (long)sizeof(InfluxSpoolHdr) + 3, SEEK_SET);
+  fputc('#', f);
+  fclose(f);
+  order_ok = true;
+  for (int k = 1; k < 4; k++) {
+    if (!peek_is(&t, k, 2)) order_ok = false;
+    InfluxSpoolPop(&t);
+  }
+  CHECK(order_ok);
+  CHECK(t.errors == 2 && t.batches == 0);  /* the torn batch and the corrupt one */
+  char buf[4096];
+  uint32_t len, points;
+  CHECK(InfluxSpoolPeek(&t, buf, sizeof(buf), &len, &points) == 0);
+
+  /* Over max_bytes: the oldest whole file is evicted and its batches counted */
+  InfluxSpool ev;
+  CHECK(InfluxSpoolInitDir(&ev, dir.c_str(), 3000, 1024, NULL, NULL));
+  for (int k = 0; k < 60; k++) {
+    std::string b = batch_body(k, 3);
+    CHECK(InfluxSpoolPut(&ev, b.data(), (uint32_t)b.size(), 3));
+  }
+  CHECK(ev.bytes <= 3000 + 1024);
+  CHECK(ev.dropped_batches > 0 && ev.dropped_points == 3 * ev.dropped_batches);
+  CHECK(ev.batches + ev.dropped_batches == 60);
+  CHECK(peek_is(&ev, (int)ev.dropped_batches, 3));  /* oldest survivor comes first */
+  remove_dir(dir);
+}
+
+/* ─── HTTP stand-in for InfluxDB ─── */
+static std::atomic<int64_t> s_vclock{0};  /* virtual ms since the start of a run */
+
+static uint32_t vclock_ms(void) {
+  return (uint32_t)s_vclock.load();
+}
+
+typedef struct {
+  int      listen_fd;
+  uint16_t port;
+  std::atomic<int> mode;          /* 0 = up, 1 = answer 503, 2 = answer 400 */
+  std::atomic<bool> stop;
+  std::mutex mu;
+  std::map<int64_t, int64_t> first_seen;  /* point timestamp -> virtual receive time */
+  uint64_t points;
+  uint64_t duplicates;
+  uint64_t bytes;
+  uint64_t posts;
+  uint64_t bad_lines;
+  std::thread th;
+} StandIn;
+
+static bool read_request(int fd, std::string *head, std::string *body) {
+  static thread_local std::string buf;
+  char tmp[8192];
+  size_t end;
+  while ((end = buf.find("\r\n\r\n")) == std::string::npos) {
+    ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+    if (n <= 0) {
+      buf.clear();
+      return false;
+    }
+    buf.append(tmp, (size_t)n);
+  }
+  *head = buf.substr(0, end);
+  size_t clen = 0;
+  const char *cl = strcasestr(head->c_str(), "Content-Length:");
+  if (cl) clen = strtoul(cl + 15, NULL, 10);
+  while (buf.size() < end + 4 + clen) {
+    ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+    if (n <= 0) {
+      buf.clear();
+      return false;
+    }
+    buf.append(tmp, (size_t)n);
+  }
+  *body = buf.substr(end + 4, clen);
+  buf.erase(0, end + 4 + clen);
+  return true;
+}
+
+static void standin_serve(StandIn *s) {
+  while (!s->stop) {
+    int fd = accept(s->listen_fd, NULL, NULL);
+    if (fd < 0) continue;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    std::string head, body;
+    while (!s->stop && read_request(fd, &head, &body)) {
+      char date[64];
+      time_t now = (time_t)((k_epoch_ms + s_vclock.load()) / 1000);
+      strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", gmtime(&now));
+      int status = 204;
+      if (!head.compare(0, 5, "POST ")) {
+        int mode = s->mode;
+        if (mode == 1) {
+          status = 503;
+        } else if (mode == 2 || head.find("precision=ms") == std::string::npos) {
+          status = 400;
+        } else {
+          std::lock_guard<std::mutex> lock(s->mu);
+          s->posts++;
+          s->bytes += body.size();
+          size_t pos = 0;
+          while (pos < body.size()) {
+            size_t nl = body.find('\n', pos);
+            if (nl == std::string::npos) nl = body.size();
+            std::string line = body.substr(pos, nl - pos);
+            pos = nl + 1;
+            size_t sp = line.rfind(' ');
+            if (line.compare(0, 6, "shunt,") || sp == std::string::npos || line.find(" v=") == std::string::npos) {
+              s->bad_lines++;
+              continue;
+            }
+            int64_t ts = strtoll(line.c_str() + sp + 1, NULL, 10);
+            s->points++;
+            if (!s->first_seen.emplace(ts, s_vclock.load()).second) s->duplicates++;
+          }
+        }
+      } else if (head.compare(0, 10, "GET /ping ")) {
+        status = 404;
+      }
+      char resp[160];
+      int n = snprintf(resp, sizeof(resp), "HTTP/1.1 %d %s\r\nDate: %s\r\nContent-Length: 0\r\n\r\n", status,
+                       status == 204 ? "No Content" : "Error", date);
+      if (send(fd, resp, (size_t)n, MSG_NOSIGNAL) != n) break;
+    }
+    close(fd);
+  }
+}
+
+static bool standin_start(StandIn *s) {
+  s->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  a.sin_port = 0;
+  socklen_t alen = sizeof(a);
+  if (bind(s->listen_fd, (sockaddr *)&a, sizeof(a)) || listen(s->listen_fd, 4) ||
+      getsockname(s->listen_fd, (sockaddr *)&a, &alen))
+    return false;
+  s->port = ntohs(a.sin_port);
+  s->mode = 0;
+  s->stop = false;
+  s->points = s->duplicates = s->bytes = s->posts = s->bad_lines = 0;
+  s->th = std::thread(standin_serve, s);
+  return true;
+}
+
+static void standin_stop(StandIn *s) {
+  s->stop = true;
+  shutdown(s->listen_fd, SHUT_RDWR);
+  close(s->listen_fd);
+  s->th.join();
+}
+
+/* ─── HTTP client: one keep-alive connection, like HTTPClient with setReuse(true) ─── */
+typedef struct {
+  uint16_t port;
+  int      fd;
+  std::string last_date;
+  std::vector<double> post_us;
+} Client;
+
+static int client_request(Client *c, const char *method, const char *path, const char *body, size_t len) {
+  for (int attempt = 0; attempt < 2; attempt++) {
+    if (c->fd < 0) {
+      c->fd = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in a = {};
+      a.sin_family = AF_INET;
+      a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      a.sin_port = htons(c->port);
+      int one = 1;
+      setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      if (connect(c->fd, (sockaddr *)&a, sizeof(a))) {
+        close(c->fd);
+        c->fd = -1;
+        return -1;
+      }
+    }
+    char head[256];
+    int n = snprintf(head, sizeof(head),
+                     "%s %s HTTP/1.1\r\nHost: 127.0.0.1\r\nAuthorization: Token test\r\n"
+                     "Content-Type: text/plain; charset=utf-8\r\nContent-Length: %zu\r\n\r\n",
+                     method, path, len);
+    std::string req(head, (size_t)n);
+    req.append(body, len);
+    std::string resp;
+    if (send(c->fd, req.data(), req.size(), MSG_NOSIGNAL) == (ssize_t)req.size()) {
+      char tmp[512];
+      while (resp.find("\r\n\r\n") == std::string::npos) {
+        ssize_t r = recv(c->fd, tmp, sizeof(tmp), 0);
+        if (r <= 0) break;
+        resp.append(tmp, (size_t)r);
+      }
+    }
+    if (resp.compare(0, 9, "HTTP/1.1 ")) {  /* stale keep-alive connection: reconnect once */
+      close(c->fd);
+      c->fd = -1;
+      continue;
+    }
+    const char *d = strstr(resp.c_str(), "Date: ");
+    c->last_date = d ? std::string(d + 6, strcspn(d + 6, "\r")) : std::string();
+    return atoi(resp.c_str() + 9);
+  }
+  return -1;
+}
+
+static int client_post(void *ctx, const char *body, size_t len) {
+  Client *c = (Client *)ctx;
+  auto t0 = std::chrono::steady_clock::now();
+  int status = client_request(c, "POST", "/api/v2/write?org=test&bucket=shunt&precision=ms", body, len);
+  c->post_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+  return status;
+}
+
+/* ─── End to end ─── */
+typedef struct {
+  const char *name;
+  bool     on_disk;
+  bool     restart_mid_outage;   /* re-open the spool from its files halfway through the outage */
+  uint32_t run_s;
+  uint32_t link_down_s[2];       /* Wi-Fi gone */
+  uint32_t server_down_s[2];     /* link up, server answers 503 */
+  uint32_t drain_Bps;
+} Scenario;
+
+static void run_scenario(const Scenario *sc) {
+  StandIn srv;
+  CHECK(standin_start(&srv));
+  Client cl = {srv.port, -1, std::string(), {}};
+
+  /* The device's clock comes from the stand-in's Date header (no NTP on a closed site) */
+  s_vclock = 0;
+  int st = client_request(&cl, "GET", "/ping", "", 0);
+  int64_t unix_s = 0;
+  CHECK(st == 204 && InfluxParseHttpDate(cl.last_date.c_str(), &unix_s) && unix_s * 1000 == k_epoch_ms);
+
+  static uint8_t ram[512 * 1024];
+  std::string dir;
+  InfluxSpool sp;
+  if (sc->on_disk) {
+    dir = make_tmp_dir();
+    CHECK(InfluxSpoolInitDir(&sp, dir.c_str(), 64 << 20, 65536, NULL, NULL));
+  } else {
+    InfluxSpoolInitRam(&sp, ram, sizeof(ram));
+  }
+  static char live[6144], scratch[6144];
+  InfluxForwardConfig cfg = {60, 10000, sc->drain_Bps, 2000, 60000, 10000};
+  InfluxForward f;
+  InfluxForwardInit(&f, &cfg, &sp, live, sizeof(live), scratch, sizeof(scratch), client_post, &cl, vclock_ms);
+
+  char series[INFLUX_SERIES_MAX];
+  InfluxSeries(series, sizeof(series), "shunt", "3a9f10", "site=test");
+  uint32_t peak_batches = 0;
+  uint64_t peak_bytes = 0;
+  uint32_t catchup_start_s = 0, catchup_end_s = 0;
+  uint32_t recovered_s = 0;  /* first successful post after the outage */
+  uint32_t drain_Bps_peak = 0;
+  bool restarted = false;
+  auto t0 = std::chrono::steady_clock::now();
+  uint32_t points_made = 0;
+  uint32_t outage_end_s = sc->server_down_s[1] > sc->link_down_s[1] ? sc->server_down_s[1] : sc->link_down_s[1];
+
+  for (uint32_t tick = 0; tick < sc->run_s * 10; tick++) {
+    s_vclock = (int64_t)tick * 100;
+    uint32_t t_s = tick / 10;
+    bool link = !(t_s >= sc->link_down_s[0] && t_s < sc->link_down_s[1]);
+    srv.mode = (t_s >= sc->server_down_s[0] && t_s < sc->server_down_s[1]) ? 1 : 0;
+
+    if (sc->restart_mid_outage && !restarted && t_s == (sc->link_down_s[0] + sc->link_down_s[1]) / 2) {
+      /* Reboot: the live batch in RAM is lost with the device, the spool survives on the card */
+      restarted = true;
+      points_made -= f.live_points;
+      CHECK(InfluxSpoolInitDir(&sp, dir.c_str(), 64 << 20, 65536, NULL, NULL));
+      InfluxForwardStats keep = f.stats;
+      InfluxForwardInit(&f, &cfg, &sp, live, sizeof(live), scratch, sizeof(scratch), client_post, &cl, vclock_ms);
+      f.stats = keep;
+    }
+
+    if (tick % 10 == 0) {
+      InfluxPoint pt = {k_epoch_ms + s_vclock.load(), 13.2f, -2.3f, -30.4f, 100.0 + t_s, NAN, 25.0f};
+      char line[INFLUX_LINE_MAX];
+      size_t n = InfluxFormatPoint(line, sizeof(line), series, &pt);
+      InfluxForwardAdd(&f, line, n);
+      points_made++;
+    }
+    uint32_t posts_before = f.stats.posts;
+    InfluxForwardPoll(&f, link);
+    if (t_s >= outage_end_s && !recovered_s && f.stats.posts > posts_before) recovered_s = t_s;
+
+    if (sp.batches > peak_batches) peak_batches = sp.batches;
+    if (sp.bytes > peak_bytes) peak_bytes = sp.bytes;
+    if (t_s >= outage_end_s && sp.batches && !catchup_start_s) catchup_start_s = t_s;
+    if (catchup_start_s && !catchup_end_s && !sp.batches) catchup_end_s = t_s;
+    if (f.stats.drain_Bps > drain_Bps_peak) drain_Bps_peak = f.stats.drain_Bps;
+  }
+  /* Let the last batch out */
+  s_vclock = s_vclock.load() + cfg.batch_ms;
+  InfluxForwardPoll(&f, true);
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  std::lock_guard<std::mutex> lock(srv.mu);
+  /* Every point made it, once */
+  uint32_t missing = 0;
+  for (uint32_t k = 0; k < sc->run_s; k++)
+    if (!srv.first_seen.count(k_epoch_ms + (int64_t)k * 1000)) missing++;
+  CHECK(srv.bad_lines == 0);
+  CHECK(sp.batches == 0 && f.stats.points_dropped == 0 && sp.dropped_points == 0);
+  if (!sc->restart_mid_outage) {
+    CHECK(missing == 0);
+    CHECK(srv.duplicates == 0);
+    CHECK(f.stats.points_live + f.stats.points_drained == points_made);
+  } else {
+    CHECK(missing == sc->run_s - points_made);  /* only the live batch lost with the reboot */
+    CHECK(srv.first_seen.size() == points_made);
+  }
+  CHECK(f.stats.post_failures > 0 && f.stats.points_spooled > 0);
+
+  /* Live data during the catch-up: once the server answers again, new points arrive within one
+   * batch period, however large the backlog */
+  CHECK(recovered_s && recovered_s < catchup_end_s);
+  int64_t live_late_ms = 0;
+  for (auto &kv : srv.first_seen) {
+    int64_t made = kv.first - k_epoch_ms;
+    if (made < (int64_t)recovered_s * 1000 || made >= (int64_t)sc->run_s * 1000 - cfg.batch_ms) continue;  /* not the final flush */
+    live_late_ms = std::max(live_late_ms, kv.second - made);
+  }
+  CHECK(live_late_ms <= (int64_t)cfg.batch_ms + 200);
+
+  /* Catch-up stays within the budget: a 10 s window holds at most one second of burst plus the
+   * debt of one batch */
+  CHECK(catchup_start_s && catchup_end_s > catchup_start_s);
+  CHECK(drain_Bps_peak <= sc->drain_Bps + (sc->drain_Bps + sizeof(scratch)) / 10);
+  uint32_t catchup_s = catchup_end_s - catchup_start_s;
+  double expected_s = (double)peak_bytes / sc->drain_Bps;
+  CHECK(catchup_s + 2 >= (uint32_t)(expected_s * 0.8));
+
+  std::vector<double> us = cl.post_us;
+  std::sort(us.begin(), us.end());
+  double mean = 0;
+  for (double x : us) mean += x;
+  mean /= us.empty() ? 1 : (double)us.size();
+  printf("%-8s %u s simulated in %.2f s: %u points, %u live, %u drained, %llu duplicates, %u posts (%u failed)\n",
+         sc->name, sc->run_s, wall_s, points_made, f.stats.points_live, f.stats.points_drained,
+         (unsigned long long)srv.duplicates, f.stats.posts, f.stats.post_failures);
+  printf("         spool peak %u batches / %llu B, catch-up %u s at up to %u B/s (budget %u), "
+         "live points at most %lld ms late from %u s\n",
+         peak_batches, (unsigned long long)peak_bytes, catchup_s, drain_Bps_peak, sc->drain_Bps,
+         (long long)live_late_ms, recovered_s);
+  if (!us.empty())
+    printf("         loopback POST: mean %.0f us, p50 %.0f us, p99 %.0f us, max %.0f us\n", mean, us[us.size() / 2],
+           us[us.size() * 99 / 100], us.back());
+
+  if (cl.fd >= 0) close(cl.fd);
+  standin_stop(&srv);
+  if (!dir.empty()) {
+    CHECK(count_files(dir) <= 1);
+    remove_dir(dir);
+  }
+}
+
+/* A batch the server will never take is dropped, not retried forever */
+static void test_rejected(void) {
+  StandIn srv;
+  CHECK(standin_start(&srv));
+  Client cl = {srv.port, -1, std::string(), {}};
+  static uint8_t ram[16384];
+  InfluxSpool sp;
+  InfluxSpoolInitRam(&sp, ram, sizeof(ram));
+  static char live[2048], scratch[2048];
+  InfluxForwardConfig cfg = {5, 10000, 4096, 2000, 60000, 10000};
+  InfluxForward f;
+  s_vclock = 0;
+  InfluxForwardInit(&f, &cfg, &sp, live, sizeof(live), scratch, sizeof(scratch), client_post, &cl, vclock_ms);
+  const char *line = "shunt,device=x v=1.0,i=0.0,p=0.0,wh=0.0 1760601600000\n";
+  InfluxForwardPoll(&f, true);
+  srv.mode = 2;
+  for (int k = 0; k < 5; k++) InfluxForwardAdd(&f, line, strlen(line));
+  CHECK(f.stats.batches_rejected == 1 && f.stats.points_dropped == 5 && sp.batches == 0);
+  CHECK(f.stats.backoff_ms == 0 && f.retry_ms == 0);
+
+  /* 503: spooled and retried after the backoff */
+  srv.mode = 1;
+  InfluxForwardPoll(&f, true);
+  for (int k = 0; k < 5; k++) InfluxForwardAdd(&f, line, strlen(line));
+  CHECK(f.stats.post_failures == 1 && sp.batches == 1);
+  srv.mode = 0;
+  s_vclock = 1000;
+  InfluxForwardPoll(&f, true);
+  CHECK(sp.batches == 1);  /* still backing off */
+  s_vclock = 2100;
+  InfluxForwardPoll(&f, true);
+  CHECK(sp.batches == 0 && f.stats.points_drained == 5);
+  if (cl.fd >= 0) close(cl.fd);
+  standin_stop(&srv);
+}
+
+int main() {
+  test_line();
+  test_ram_spool();
+  test_dir_spool();
+  test_rejected();
+
+  /* Three hours at 1 point/s: 40 min without Wi-Fi, then 20 min of 503s */
+  const Scenario ram_run = {"RAM", false, false, 3 * 3600, {1200, 3600}, {3600, 4800}, 8192};
+  const Scenario card_run = {"card", true, false, 3 * 3600, {1200, 3600}, {3600, 4800}, 8192};
+  /* Slow drain, and a reboot in the middle of the outage */
+  const Scenario reboot_run = {"reboot", true, true, 4 * 3600, {600, 4200}, {4200, 4300}, 2048};
+  run_scenario(&ram_run);
+  run_scenario(&card_run);
+  run_scenario(&reboot_run);
+
+  printf("%d checks, %d failed\n", s_checks, s_failed);
+  return s_failed ? 1 : 0;
+}
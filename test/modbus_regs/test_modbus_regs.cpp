@@ -0,0 +1,367 @@
+/**
+ * @file test_modbus_regs.cpp
+ * Host tests for modbus_regs.h: CRC, image encoding (scaling, word order, saturation, unknown
+ * markers), request handling and exceptions, RTU addressing and TCP framing. Then measures request
+ * latency: the handler alone, and full round trips over a loopback TCP connection served the way
+ * the firmware serves them (receive buffer, MbTcpFrameLength, MbTcpHandle, send).
+ * Exit status 0 = all passed.
+ *
+ * Build and run: make -C test/modbus_regs
+ */
+#include "modbus_regs.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static int s_failed = 0;
+static int s_checks = 0;
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    s_checks++;                                                       \
+    if (!(cond)) {                                                    \
+      s_failed++;                                                     \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    }                                                                 \
+  } while (0)
+
+static uint16_t s_image[MB_REG_COUNT];
+
+static void sample_values(MbValues *v) {
+  memset(v, 0, sizeof(*v));
+  v->seq = 1834;
+  v->age_ms = 412;
+  v->op_s = 93311;
+  v->rate_hz = 100;
+  v->sensor_connected = true;
+  v->voltage_V = 13.2140f;
+  v->current_A = -2.3106f;
+  v->power_W = -30.5324f;
+  v->energy_Wh = -112.402;
+  v->temperature_C = 24.5f;
+  v->soc_percent = NAN;
+  v->session.ah_in = 0.0;
+  v->session.ah_out = 1.2034;
+  v->session.peak_power_W = 88.1f;
+  v->session.v_min = 12.9f;
+  v->session.v_max = 13.6f;
+  v->session.i_min = -7.5f;
+  v->session.samples = 42;
+  v->lifetime.ah_in = 5000000.0;  /* past UINT32_MAX mAh: saturates */
+  v->lifetime.ah_out = 430.12;
+}
+
+static void test_crc(void) {
+  const uint8_t req[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x0A};
+  CHECK(MbCrc16(req, sizeof(req)) == 0xCDC5);  /* sent as C5 CD */
+}
+
+static void test_image(void) {
+  MbValues v;
+  sample_values(&v);
+  MbBuildImage(&v, s_image);
+  CHECK(s_image[MB_REG_MAP_VERSION] == MB_MAP_VERSION);
+  CHECK(s_image[MB_REG_STATUS] == MB_STATUS_SENSOR);
+  CHECK(s_image[MB_REG_AGE_MS] == 412);
+  CHECK(s_image[MB_REG_RATE_HZ] == 100);
+  CHECK(MbGet32(s_image + MB_REG_SEQ) == 1834);
+  CHECK(MbGet32(s_image + MB_REG_OP_S) == 93311);
+  /* High word first */
+  CHECK(s_image[MB_REG_VOLTAGE] == 0 && s_image[MB_REG_VOLTAGE + 1] == 13214);
+  CHECK((int32_t)MbGet32(s_image + MB_REG_CURRENT) == -2311);
+  CHECK(s_image[MB_REG_CURRENT] == 0xFFFF);
+  CHECK((int32_t)MbGet32(s_image + MB_REG_POWER) == -30532);
+  CHECK((int32_t)MbGet32(s_image + MB_REG_ENERGY) == -112402);
+  CHECK(s_image[MB_REG_SOC] == 0xFFFF);
+  CHECK((int16_t)s_image[MB_REG_TEMPERATURE] == 2450);
+  CHECK(MbGetFloat(s_image + MB_REG_F_VOLTAGE) == 13.2140f);
+  CHECK(MbGetFloat(s_image + MB_REG_F_CURRENT) == -2.3106f);
+  CHECK(MbGetFloat(s_image + MB_REG_F_SOC) != MbGetFloat(s_image + MB_REG_F_SOC));  /* NaN */
+  CHECK(MbGet32(s_image + MB_REG_SESSION + MB_ST_AH_OUT) == 1203);
+  CHECK(MbGet32(s_image + MB_REG_SESSION + MB_ST_PEAK_POWER) == 88100);
+  CHECK((int32_t)MbGet32(s_image + MB_REG_SESSION + MB_ST_I_MIN) == -7500);
+  CHECK(MbGet32(s_image + MB_REG_SESSION + MB_ST_SAMPLES) == 42);
+  CHECK(MbGet32(s_image + MB_REG_LIFETIME + MB_ST_AH_IN) == 0xFFFFFFFFu);
+  CHECK(MbGet32(s_image + MB_REG_LIFETIME + MB_ST_AH_OUT) == 430120);
+  /* Gaps read 0 */
+  CHECK(s_image[8] == 0 && s_image[26] == 0 && s_image[127] == 0);
+
+  /* Markers, saturation and status bits */
+  v.seq = 0;
+  v.sensor_connected = false;
+  v.temperature_C = NAN;
+  v.soc_percent = 87.65f;
+  v.voltage_V = 1e9f;
+  v.current_A = -1e9f;
+  MbBuildImage(&v, s_image);
+  CHECK(s_image[MB_REG_STATUS] == (MB_STATUS_NO_DATA | MB_STATUS_SOC));
+  CHECK(s_image[MB_REG_TEMPERATURE] == 0x8000);
+  CHECK(s_image[MB_REG_SOC] == 8765);
+  CHECK((int32_t)MbGet32(s_image + MB_REG_VOLTAGE) == INT32_MAX);
+  CHECK((int32_t)MbGet32(s_image + MB_REG_CURRENT) == INT32_MIN);
+  v.seq = 5;
+  v.age_ms = 70000;
+  v.temperature_C = -400.0f;
+  v.soc_percent = 250.0f;
+  MbBuildImage(&v, s_image);
+  CHECK(s_image[MB_REG_STATUS] == (MB_STATUS_STALE | MB_STATUS_SOC));
+  CHECK(s_image[MB_REG_AGE_MS] == 0xFFFF);
+  CHECK((int16_t)s_image[MB_REG_TEMPERATURE] == -32767);  /* one above the marker */
+  CHECK(s_image[MB_REG_SOC] == 10000);
+}
+
+static size_t pdu(const uint8_t *req, size_t len, uint8_t *resp, uint16_t *cmd) {
+  return MbHandlePdu(s_image, req, len, resp, cmd);
+}
+
+static void test_requests(void) {
+  MbValues v;
+  sample_values(&v);
+  MbBuildImage(&v, s_image);
+  uint8_t r[MB_PDU_MAX];
+  uint16_t cmd = 0;
+
+  /* FC 04 and FC 03 read the same image */
+  const uint8_t rd4[] = {0x04, 0x00, MB_REG_VOLTAGE, 0x00, 0x04};
+  CHECK(pdu(rd4, 5, r, &cmd) == 10);
+  CHECK(r[0] == 0x04 && r[1] == 8 && r[2] == 0x00 && r[3] == 0x00 && r[4] == 0x33 && r[5] == 0x9E);
+  uint8_t r3[MB_PDU_MAX];
+  const uint8_t rd3[] = {0x03, 0x00, MB_REG_VOLTAGE, 0x00, 0x04};
+  CHECK(pdu(rd3, 5, r3, &cmd) == 10 && memcmp(r + 1, r3 + 1, 9) == 0);
+
+  /* Whole image in two reads; the limits */
+  const uint8_t rd_max[] = {0x04, 0x00, 0x00, 0x00, MB_READ_MAX};
+  CHECK(pdu(rd_max, 5, r, &cmd) == 2 + 2 * MB_READ_MAX);
+  const uint8_t rd_tail[] = {0x04, 0x00, MB_REG_COUNT - 3, 0x00, 0x03};
+  CHECK(pdu(rd_tail, 5, r, &cmd) == 8);
+  const uint8_t rd_past[] = {0x04, 0x00, MB_REG_COUNT - 3, 0x00, 0x04};
+  CHECK(pdu(rd_past, 5, r, &cmd) == 2 && r[0] == 0x84 && r[1] == MB_EX_ILLEGAL_ADDRESS);
+  const uint8_t rd_big[] = {0x04, 0x00, 0x00, 0x00, MB_READ_MAX + 1};
+  CHECK(pdu(rd_big, 5, r, &cmd) == 2 && r[0] == 0x84 && r[1] == MB_EX_ILLEGAL_VALUE);
+  const uint8_t rd_zero[] = {0x03, 0x00, 0x00, 0x00, 0x00};
+  CHECK(pdu(rd_zero, 5, r, &cmd) == 2 && r[0] == 0x83 && r[1] == MB_EX_ILLEGAL_VALUE);
+  CHECK(pdu(rd4, 4, r, &cmd) == 2 && r[1] == MB_EX_ILLEGAL_VALUE);
+  const uint8_t rd_cmd4[] = {0x04, 0x01, 0x00, 0x00, 0x01};
+  CHECK(pdu(rd_cmd4, 5, r, &cmd) == 2 && r[1] == MB_EX_ILLEGAL_ADDRESS);  /* command is holding only */
+  const uint8_t rd_cmd3[] = {0x03, 0x01, 0x00, 0x00, 0x01};
+  CHECK(pdu(rd_cmd3, 5, r, &cmd) == 4 && r[1] == 2 && r[2] == 0 && r[3] == 0);
+
+  /* Writes: only the command register, only known commands */
+  const uint8_t wr6[] = {0x06, 0x01, 0x00, 0x00, MB_CMD_RESET_SESSION};
+  CHECK(pdu(wr6, 5, r, &cmd) == 5 && memcmp(r, wr6, 5) == 0 && cmd == MB_CMD_RESET_SESSION);
+  cmd = 0;
+  const uint8_t wr6_bad[] = {0x06, 0x01, 0x00, 0x00, 0x07};
+  CHECK(pdu(wr6_bad, 5, r, &cmd) == 2 && r[0] == 0x86 && r[1] == MB_EX_ILLEGAL_VALUE && cmd == 0);
+  const uint8_t wr6_ro[] = {0x06, 0x00, MB_REG_VOLTAGE, 0x00, 0x01};
+  CHECK(pdu(wr6_ro, 5, r, &cmd) == 2 && r[1] == MB_EX_ILLEGAL_ADDRESS && cmd == 0);
+  const uint8_t wr16[] = {0x10, 0x01, 0x00, 0x00, 0x01, 0x02, 0x00, MB_CMD_RESET_SESSION};
+  CHECK(pdu(wr16, sizeof(wr16), r, &cmd) == 5 && memcmp(r, wr16, 5) == 0 && cmd == MB_CMD_RESET_SESSION);
+  cmd = 0;
+  const uint8_t wr16_two[] = {0x10, 0x01, 0x00, 0x00, 0x02, 0x04, 0x00, 0x01, 0x00, 0x01};
+  CHECK(pdu(wr16_two, sizeof(wr16_two), r, &cmd) == 2 && r[1] == MB_EX_ILLEGAL_ADDRESS && cmd == 0);
+  const uint8_t wr16_short[] = {0x10, 0x01, 0x00, 0x00, 0x01, 0x02, 0x00};
+  CHECK(pdu(wr16_short, sizeof(wr16_short), r, &cmd) == 2 && r[1] == MB_EX_ILLEGAL_VALUE && cmd == 0);
+
+  const uint8_t fc1[] = {0x01, 0x00, 0x00, 0x00, 0x01};
+  CHECK(pdu(fc1, 5, r, &cmd) == 2 && r[0] == 0x81 && r[1] == MB_EX_ILLEGAL_FUNCTION);
+  CHECK(pdu(fc1, 0, r, &cmd) == 0);
+}
+
+static size_t rtu_frame(uint8_t *f, uint8_t addr, const uint8_t *p, size_t n) {
+  f[0] = addr;
+  memcpy(f + 1, p, n);
+  uint16_t c = MbCrc16(f, n + 1);
+  f[n + 1] = (uint8_t)c;
+  f[n + 2] = (uint8_t)(c >> 8);
+  return n + 3;
+}
+
+static void test_rtu(void) {
+  uint8_t f[MB_RTU_ADU_MAX], out[MB_RTU_ADU_MAX];
+  uint16_t cmd = 0;
+  const uint8_t rd[] = {0x04, 0x00, MB_REG_VOLTAGE, 0x00, 0x02};
+  size_t n = rtu_frame(f, 7, rd, sizeof(rd));
+  int got = MbRtuHandle(7, s_image, f, n, out, &cmd);
+  CHECK(got == 1 + 2 + 4 + 2);
+  CHECK(out[0] == 7 && out[1] == 0x04 && out[2] == 4);
+  CHECK(got > 0 && MbCrc16(out, (size_t)got - 2) == (uint16_t)(out[got - 2] | (out[got - 1] << 8)));
+  CHECK(MbRtuHandle(8, s_image, f, n, out, &cmd) == MB_RTU_IGNORED);
+  f[3] ^= 1;
+  CHECK(MbRtuHandle(7, s_image, f, n, out, &cmd) == MB_RTU_BAD_FRAME);
+  CHECK(MbRtuHandle(7, s_image, f, 3, out, &cmd) == MB_RTU_BAD_FRAME);
+  /* Broadcast writes are executed but never answered */
+  const uint8_t wr[] = {0x06, 0x01, 0x00, 0x00, MB_CMD_RESET_SESSION};
+  n = rtu_frame(f, 0, wr, sizeof(wr));
+  CHECK(MbRtuHandle(7, s_image, f, n, out, &cmd) == MB_RTU_IGNORED && cmd == MB_CMD_RESET_SESSION);
+  /* Exceptions are answered */
+  const uint8_t bad[] = {0x2B, 0x0E, 0x01, 0x00};
+  n = rtu_frame(f, 7, bad, sizeof(bad));
+  CHECK(MbRtuHandle(7, s_image, f, n, out, &cmd) == 5 && out[1] == 0xAB && out[2] == MB_EX_ILLEGAL_FUNCTION);
+}
+
+static size_t tcp_adu(uint8_t *a, uint16_t tid, uint8_t unit, const uint8_t *p, size_t n) {
+  MbPutU16BE(a, tid);
+  MbPutU16BE(a + 2, 0);
+  MbPutU16BE(a + 4, (uint16_t)(n + 1));
+  a[6] = unit;
+  memcpy(a + MB_TCP_MBAP, p, n);
+  return MB_TCP_MBAP + n;
+}
+
+static void test_tcp(void) {
+  uint8_t a[MB_TCP_ADU_MAX], out[MB_TCP_ADU_MAX];
+  uint16_t cmd = 0;
+  const uint8_t rd[] = {0x03, 0x00, MB_REG_SEQ, 0x00, 0x02};
+  size_t n = tcp_adu(a, 0xBEEF, 0xFF, rd, sizeof(rd));
+  CHECK(MbTcpFrameLength(a, 6) == 0);
+  CHECK(MbTcpFrameLength(a, n - 1) == 0);
+  CHECK(MbTcpFrameLength(a, n) == (int)n);
+  CHECK(MbTcpFrameLength(a, n + 5) == (int)n);  /* next request already in the buffer */
+  size_t m = MbTcpHandle(s_image, a, n, out, &cmd);
+  CHECK(m == MB_TCP_MBAP + 2 + 4);
+  CHECK(out[0] == 0xBE && out[1] == 0xEF && out[2] == 0 && out[3] == 0);
+  CHECK(MbGetU16BE(out + 4) == m - 6 && out[6] == 0xFF);
+  CHECK(out[7] == 0x03 && out[8] == 4 && MbGetU16BE(out + 9) == 0 && MbGetU16BE(out + 11) == 1834);
+  a[2] = 1;  /* protocol id must be 0 */
+  CHECK(MbTcpFrameLength(a, n) == -1);
+  a[2] = 0;
+  MbPutU16BE(a + 4, 1);  /* unit id without a PDU */
+  CHECK(MbTcpFrameLength(a, n) == -1);
+  MbPutU16BE(a + 4, 300);
+  CHECK(MbTcpFrameLength(a, n) == -1);
+}
+
+/* ─── Latency ─── */
+static double percentile(std::vector<double> &v, double p) {
+  std::sort(v.begin(), v.end());
+  return v[(size_t)(p * (double)(v.size() - 1))];
+}
+
+static void bench_handler(void) {
+  uint8_t f[MB_RTU_ADU_MAX], out[MB_RTU_ADU_MAX];
+  uint16_t cmd = 0;
+  const uint8_t rd[] = {0x04, 0x00, 0x00, 0x00, 0x40};  /* 64 registers */
+  size_t n = rtu_frame(f, 1, rd, sizeof(rd));
+  const int N = 200000;
+  volatile int sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int k = 0; k < N; k++) sink = sink + MbRtuHandle(1, s_image, f, n, out, &cmd);
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+  CHECK(sink == N * (1 + 2 + 128 + 2));
+  printf("handler   RTU read of 64 registers, CRC both ways: %.0f ns/request (host)\n", ns);
+}
+
+/* Loopback stand-in for the TCP side of modbus_slave.cpp */
+static void serve(int lfd) {
+  int fd = accept(lfd, NULL, NULL);
+  if (fd < 0) return;
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  uint8_t buf[2 * MB_TCP_ADU_MAX], out[MB_TCP_ADU_MAX];
+  size_t have = 0;
+  for (;;) {
+    ssize_t r = recv(fd, buf + have, sizeof(buf) - have, 0);
+    if (r <= 0) break;
+    have += (size_t)r;
+    int len;
+    while ((len = MbTcpFrameLength(buf, have)) > 0) {
+      uint16_t cmd = 0;
+      size_t m = MbTcpHandle(s_image, buf, (size_t)len, out, &cmd);
+      if (send(fd, out, m, 0) != (ssize_t)m) break;
+      memmove(buf, buf + len, have - (size_t)len);
+      have -= (size_t)len;
+    }
+    if (len < 0) break;
+  }
+  close(fd);
+}
+
+static bool recv_all(int fd, uint8_t *p, size_t n) {
+  while (n) {
+    ssize_t r = recv(fd, p, n, 0);
+    if (r <= 0) return false;
+    p += r;
+    n -= (size_t)r;
+  }
+  return true;
+}
+
+static void bench_tcp_loopback(void) {
+  int lfd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t sl = sizeof(sa);
+  if (lfd < 0 || bind(lfd, (sockaddr *)&sa, sizeof(sa)) || listen(lfd, 1) || getsockname(lfd, (sockaddr *)&sa, &sl)) {
+    printf("loopback  skipped: no socket\n");
+    if (lfd >= 0) close(lfd);
+    return;
+  }
+  std::thread server(serve, lfd);
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  CHECK(connect(fd, (sockaddr *)&sa, sizeof(sa)) == 0);
+
+  uint8_t a[MB_TCP_ADU_MAX], r[MB_TCP_ADU_MAX];
+  const uint8_t rd[] = {0x04, 0x00, 0x00, 0x00, 0x40};
+  const size_t reply = MB_TCP_MBAP + 2 + 128;
+  const int N = 20000;
+  std::vector<double> us;
+  us.reserve(N);
+  int bad = 0;
+  for (int k = 0; k < N; k++) {
+    size_t n = tcp_adu(a, (uint16_t)k, 1, rd, sizeof(rd));
+    auto t0 = std::chrono::steady_clock::now();
+    if (send(fd, a, n, 0) != (ssize_t)n || !recv_all(fd, r, reply)) {
+      bad++;
+      break;
+    }
+    us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+    if (MbGetU16BE(r) != (uint16_t)k || r[7] != 0x04) bad++;
+  }
+  CHECK(bad == 0);
+
+  /* Two requests in one segment, then one split across two: each answered once, in order */
+  size_t n1 = tcp_adu(a, 1, 1, rd, sizeof(rd));
+  size_t n2 = tcp_adu(a + n1, 2, 1, rd, sizeof(rd));
+  CHECK(send(fd, a, n1 + n2, 0) == (ssize_t)(n1 + n2));
+  CHECK(recv_all(fd, r, reply) && MbGetU16BE(r) == 1);
+  CHECK(recv_all(fd, r, reply) && MbGetU16BE(r) == 2);
+  CHECK(send(fd, a, 5, 0) == 5);
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  CHECK(send(fd, a + 5, n1 - 5, 0) == (ssize_t)(n1 - 5));
+  CHECK(recv_all(fd, r, reply) && MbGetU16BE(r) == 1);
+
+  close(fd);
+  server.join();
+  close(lfd);
+  if (!us.empty()) {
+    double mean = 0;
+    for (double x : us) mean += x;
+    mean /= (double)us.size();
+    printf("loopback  %zu TCP requests of 64 registers: mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           us.size(), mean, percentile(us, 0.5), percentile(us, 0.99), percentile(us, 1.0));
+  }
+}
+
+int main(void) {
+  test_crc();
+  test_image();
+  test_requests();
+  test_rtu();
+  test_tcp();
+  bench_handler();
+  bench_tcp_loopback();
+  printf("%d checks, %d failed\n", s_checks, s_failed);
+  return s_failed ? 1 : 0;
+}
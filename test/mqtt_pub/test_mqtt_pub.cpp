@@ -0,0 +1,788 @@
+/**
+ * @file test_mqtt_pub.cpp
+ * Host tests for the MQTT publisher's shared code (mqtt_batch.h): the sample queue, the message
+ * formats (batch, state, Home Assistant discovery) and the publish policy (adaptive interval,
+ * reconnect backoff). Then runs the publisher loop the way mqtt_pub.cpp runs it, on a virtual clock,
+ * against a minimal MQTT 3.1.1 broker on loopback, and checks what the broker got: topics, retain
+ * flags, JSON payloads, discovery configs, the last will, and sample sequence numbers through broker
+ * outages, a slow link and a queue overflow. Exit status 0 = all passed.
+ *
+ * Build and run: make -C test/mqtt_pub
+ */
+#include "mqtt_batch.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static int s_failed = 0;
+static int s_checks = 0;
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    s_checks++;                                                       \
+    if (!(cond)) {                                                    \
+      s_failed++;                                                     \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    }                                                                 \
+  } while (0)
+
+static const MqttPolicyConfig k_cfg = {1000, 60, 30000, 250000, 1000, 60000, 60000};
+
+/* ─── Minimal JSON reader, enough to check the payloads ─── */
+struct Json {
+  enum Type { NUL, NUM, STR, ARR, OBJ } type = NUL;
+  double num = 0;
+  std::string str;
+  std::vector<Json> arr;
+  std::map<std::string, Json> obj;
+  bool has(const char *k) const { return type == OBJ && obj.count(k); }
+  const Json &at(const char *k) const {
+    static const Json none;
+    auto it = obj.find(k);
+    return it == obj.end() ? none : it->second;
+  }
+};
+
+static void json_ws(const char *&p) {
+  while (*p == ' ' || *p == '\n' || *p == '\t' || *p == '\r') p++;
+}
+
+static bool json_parse(const char *&p, Json *out) {
+  json_ws(p);
+  if (*p == '{') {
+    out->type = Json::OBJ;
+    p++;
+    json_ws(p);
+    if (*p == '}') return p++, true;
+    for (;;) {
+      Json key, val;
+      json_ws(p);
+      if (*p != '"' || !json_parse(p, &key)) return false;
+      json_ws(p);
+      if (*p++ != ':' || !json_parse(p, &val)) return false;
+      if (out->obj.count(key.str)) return false;  /* duplicate key */
+      out->obj[key.str] = val;
+      json_ws(p);
+      if (*p == '}') return p++, true;
+      if (*p++ != ',') return false;
+    }
+  }
+  if (*p == '[') {
+    out->type = Json::ARR;
+    p++;
+    json_ws(p);
+    if (*p == ']') return p++, true;
+    for (;;) {
+      Json val;
+      if (!json_parse(p, &val)) return false;
+      out->arr.push_back(val);
+      json_ws(p);
+      if (*p == ']') return p++, true;
+      if (*p++ != ',') return false;
+    }
+  }
+  if (*p == '"') {
+    out->type = Json::STR;
+    for (p++; *p != '"'; p++) {
+      if (!*p || *p == '\\' || (unsigned char)*p < 0x20) return false;  /* no escapes are ever needed */
+      out->str += *p;
+    }
+    p++;
+    return true;
+  }
+  if (!strncmp(p, "null", 4)) {
+    p += 4;
+    return true;
+  }
+  char *end;
+  out->num = strtod(p, &end);
+  if (end == p || !strncmp(p, "nan", 3) || !strncmp(p, "inf", 3) || !strncmp(p, "-nan", 4) || !strncmp(p, "-inf", 4))
+    return false;
+  out->type = Json::NUM;
+  p = end;
+  return true;
+}
+
+static bool json_read(const std::string &s, Json *out) {
+  const char *p = s.c_str();
+  if (!json_parse(p, out)) return false;
+  json_ws(p);
+  return *p == '\0';
+}
+
+/* ─── Queue, formats, policy ─── */
+static MqttSample sample_for(uint32_t k) {
+  MqttSample s;
+  s.t_ms = 1000 * k + 7;
+  s.v = 12.0f + (float)(k % 1000) * 0.001f;
+  s.i = -5.0f + (float)(k % 97) * 0.125f;
+  s.p = s.v * s.i;
+  return s;
+}
+
+static void test_queue(void) {
+  MqttSample buf[8];
+  MqttQueue q;
+  MqttQueueInit(&q, buf, 8);
+  for (uint32_t k = 0; k < 5; k++) {
+    MqttSample s = sample_for(k);
+    CHECK(MqttQueuePush(&q, &s));
+  }
+  CHECK(q.count == 5 && q.seq == 0 && q.peak == 5);
+  MqttQueuePop(&q, 3);
+  CHECK(q.count == 2 && q.seq == 3 && MqttQueueAt(&q, 0)->t_ms == sample_for(3).t_ms);
+  for (uint32_t k = 5; k < 15; k++) {
+    MqttSample s = sample_for(k);
+    MqttQueuePush(&q, &s);
+  }
+  /* 12 pushed into 8 slots: the 4 oldest were dropped, the sequence number follows */
+  CHECK(q.count == 8 && q.dropped == 4 && q.seq == 7 && q.peak == 8);
+  bool order = true;
+  for (uint16_t k = 0; k < q.count; k++) order &= MqttQueueAt(&q, k)->t_ms == sample_for(7 + k).t_ms;
+  CHECK(order);
+  MqttQueuePop(&q, 100);
+  CHECK(q.count == 0 && q.seq == 15);
+  MqttSample s = sample_for(15);
+  MqttQueuePush(&q, &s);
+  MqttQueueClear(&q);
+  CHECK(q.count == 0 && q.seq == 16);
+}
+
+static void test_formats(void) {
+  static MqttSample buf[100];
+  MqttQueue q;
+  MqttQueueInit(&q, buf, 100);
+  for (uint32_t k = 0; k < 60; k++) {
+    MqttSample s = sample_for(k);
+    MqttQueuePush(&q, &s);
+  }
+  MqttQueuePop(&q, 2);
+  char text[4096 - 64];
+  MqttMsg m;
+  MqttMsgInit(&m, text, sizeof(text));
+
+  /* A full batch fits the firmware's buffer */
+  CHECK(MqttFormatBatch(&m, &q, 58));
+  Json j;
+  CHECK(json_read(std::string(m.buf, m.len), &j));
+  CHECK(j.at("seq").num == 2 && j.at("n").num == 58);
+  bool cols = true;
+  for (const char *c : {"ms", "v", "i", "p"}) cols &= j.at(c).type == Json::ARR && j.at(c).arr.size() == 58;
+  CHECK(cols);
+  CHECK(j.at("ms").arr[0].num == sample_for(2).t_ms && fabs(j.at("v").arr[57].num - sample_for(59).v) < 0.0006);
+  CHECK(MqttFormatBatch(&m, &q, 1) && !strcmp(text, "{\"seq\":2,\"n\":1,\"ms\":[2007],\"v\":[12.002],\"i\":[-4.750],\"p\":[-57.01]}"));
+
+  /* Too small: fails, never a truncated message */
+  char small[300];
+  MqttMsg ms;
+  MqttMsgInit(&ms, small, sizeof(small));
+  CHECK(!MqttFormatBatch(&ms, &q, 20));
+  CHECK(ms.len < sizeof(small) && small[ms.len] == '\0');
+
+  CHECK(MqttFormatState(&m, 13.25f, -2.5f, -33.25f, 1234.5678, NAN));
+  CHECK(!strcmp(text, "{\"v\":13.250,\"i\":-2.500,\"p\":-33.25,\"wh\":1234.568,\"t\":null}"));
+  Json js;
+  CHECK(json_read(text, &js));
+
+  char topic[96];
+  CHECK(MqttFormatDiscovery(&m, topic, sizeof(topic), 0, "cyd-shunt/3a9f10", "3a9f10", "INA228"));
+  CHECK(!strcmp(topic, "homeassistant/sensor/cyd_shunt_3a9f10/v/config"));
+  CHECK(!MqttFormatDiscovery(&m, topic, 20, 0, "cyd-shunt/3a9f10", "3a9f10", "INA228"));
+}
+
+static void test_policy(void) {
+  MqttSample buf[600];
+  MqttQueue q;
+  MqttQueueInit(&q, buf, 600);
+  MqttPolicy p;
+  MqttPolicyInit(&p, &k_cfg, 5000);
+  CHECK(MqttPolicyConnectDue(&p, 5000));
+
+  /* Backoff: 1, 2, 4 ... 60 s, plus at most 25 % jitter */
+  uint32_t now = 5000, expect = 1000;
+  bool ok = true;
+  for (int k = 0; k < 10; k++) {
+    MqttPolicyConnectFailed(&p, now, 0xFFFFFFFFu);
+    uint32_t wait = p.next_attempt - now;
+    ok &= p.backoff == expect && wait >= expect && wait <= expect + expect / 4;
+    ok &= !MqttPolicyConnectDue(&p, now + expect - 1);
+    expect = expect * 2 > 60000 ? 60000 : expect * 2;
+    now = p.next_attempt;
+  }
+  CHECK(ok);
+  MqttPolicyConnected(&p, now);
+  CHECK(p.backoff == 0 && MqttPolicyStatsDue(&p, now) && !MqttPolicyStatsDue(&p, now + 59999));
+  MqttPolicyDisconnected(&p, now + 10);
+  CHECK(p.backoff == 1000 && p.next_attempt == now + 1010);
+  MqttPolicyDisconnected(&p, now + 500);  /* only once per lost connection */
+  CHECK(p.next_attempt == now + 1010);
+  MqttPolicyReset(&p, now + 600);
+  CHECK(MqttPolicyConnectDue(&p, now + 600));
+
+  /* Batches: a full one right away, otherwise once per interval */
+  MqttPolicyInit(&p, &k_cfg, 0);
+  MqttSample s = sample_for(0);
+  MqttQueuePush(&q, &s);
+  CHECK(MqttPolicyBatchDue(&p, &q, 999) == 0 && MqttPolicyBatchDue(&p, &q, 1000) == 1);
+  for (int k = 0; k < 70; k++) MqttQueuePush(&q, &s);
+  CHECK(MqttPolicyBatchDue(&p, &q, 1) == 60);
+
+  /* Adaptive interval: doubles when slow or failed, up to 30 s; halves when fast */
+  uint32_t iv[8];
+  for (int k = 0; k < 6; k++) {
+    MqttPolicyBatchDone(&p, 0, k != 2, 400000);
+    iv[k] = p.interval;
+  }
+  CHECK(iv[0] == 2000 && iv[1] == 4000 && iv[2] == 8000 && iv[3] == 16000 && iv[4] == 30000 && iv[5] == 30000);
+  MqttPolicyBatchDone(&p, 0, true, 1000);
+  CHECK(p.interval == 15000);
+  for (int k = 0; k < 5; k++) MqttPolicyBatchDone(&p, 0, true, 1000);
+  CHECK(p.interval == 1000);
+}
+
+/* ─── Loopback broker: MQTT 3.1.1, QoS 0, one client at a time ─── */
+struct Published {
+  std::string topic;
+  std::string payload;
+  bool        retain;
+  bool        will;
+};
+
+struct Broker {
+  int listen_fd = -1;
+  uint16_t port = 0;
+  std::atomic<bool> stop{false};
+  std::atomic<bool> refuse{false};       /* answer CONNECT with "server unavailable" */
+  std::atomic<int>  active_fd{-1};
+  std::atomic<uint64_t> rx_bytes{0};
+  std::thread th;
+  std::mutex mu;
+  std::vector<Published> log;
+  std::map<std::string, std::string> retained;
+  int connects = 0;
+  int refused = 0;
+  int wills = 0;
+  int clean_disconnects = 0;
+  std::string client_id;
+  int keepalive_s = 0;
+};
+
+static bool read_n(int fd, uint8_t *p, size_t n, Broker *b) {
+  while (n) {
+    ssize_t r = recv(fd, p, n, 0);
+    if (r <= 0) return false;
+    if (b) b->rx_bytes += (uint64_t)r;
+    p += r;
+    n -= (size_t)r;
+  }
+  return true;
+}
+
+/* One control packet: type byte and body */
+static bool read_packet(int fd, uint8_t *type, std::string *body, Broker *b) {
+  uint8_t c;
+  if (!read_n(fd, type, 1, b)) return false;
+  uint32_t len = 0, mul = 1;
+  for (int k = 0; k < 4; k++) {
+    if (!read_n(fd, &c, 1, b)) return false;
+    len += (c & 0x7Fu) * mul;
+    mul *= 128;
+    if (!(c & 0x80)) break;
+  }
+  body->resize(len);
+  return len == 0 || read_n(fd, (uint8_t *)&(*body)[0], len, b);
+}
+
+static std::string mqtt_str(const std::string &body, size_t *pos) {
+  if (*pos + 2 > body.size()) return std::string();
+  size_t n = ((uint8_t)body[*pos] << 8) | (uint8_t)body[*pos + 1];
+  std::string s = body.substr(*pos + 2, n);
+  *pos += 2 + n;
+  return s;
+}
+
+static void broker_record(Broker *b, const std::string &topic, const std::string &payload, bool retain, bool will) {
+  std::lock_guard<std::mutex> lock(b->mu);
+  b->log.push_back({topic, payload, retain, will});
+  if (retain) b->retained[topic] = payload;
+}
+
+static void broker_session(Broker *b, int fd) {
+  uint8_t type;
+  std::string body;
+  if (!read_packet(fd, &type, &body, b) || (type >> 4) != 1) return;
+  /* CONNECT: "MQTT", level 4, flags, keepalive, client id, [will topic, will message], [user], [pass] */
+  size_t pos = 0;
+  bool proto_ok = mqtt_str(body, &pos) == "MQTT" && pos + 4 <= body.size() && body[pos] == 4;
+  uint8_t flags = (uint8_t)body[pos + 1];
+  int keepalive = ((uint8_t)body[pos + 2] << 8) | (uint8_t)body[pos + 3];
+  pos += 4;
+  std::string id = mqtt_str(body, &pos), will_topic, will_msg;
+  if (flags & 0x04) {
+    will_topic = mqtt_str(body, &pos);
+    will_msg = mqtt_str(body, &pos);
+  }
+  bool will_retain = flags & 0x20;
+  uint8_t rc = !proto_ok ? 1 : b->refuse ? 3 : 0;
+  uint8_t connack[4] = {0x20, 2, 0, rc};
+  send(fd, connack, 4, MSG_NOSIGNAL);
+  {
+    std::lock_guard<std::mutex> lock(b->mu);
+    if (rc) {
+      b->refused++;
+      return;
+    }
+    b->connects++;
+    b->client_id = id;
+    b->keepalive_s = keepalive;
+  }
+  b->active_fd = fd;
+  bool clean = false;
+  while (read_packet(fd, &type, &body, b)) {
+    uint8_t kind = type >> 4;
+    if (kind == 3) {  /* PUBLISH, QoS 0 */
+      size_t p = 0;
+      std::string topic = mqtt_str(body, &p);
+      broker_record(b, topic, body.substr(p), type & 1, false);
+    } else if (kind == 12) {  /* PINGREQ */
+      uint8_t pong[2] = {0xD0, 0};
+      send(fd, pong, 2, MSG_NOSIGNAL);
+    } else if (kind == 14) {  /* DISCONNECT */
+      clean = true;
+      break;
+    }
+  }
+  b->active_fd = -1;
+  std::lock_guard<std::mutex> lock(b->mu);
+  if (clean) {
+    b->clean_disconnects++;
+  } else if (!will_topic.empty()) {  /* connection lost: the broker publishes the last will */
+    b->wills++;
+    b->log.push_back({will_topic, will_msg, will_retain, true});
+    if (will_retain) b->retained[will_topic] = will_msg;
+  }
+}
+
+static void broker_serve(Broker *b) {
+  while (!b->stop) {
+    int fd = accept(b->listen_fd, NULL, NULL);
+    if (fd < 0) continue;
+    broker_session(b, fd);
+    close(fd);
+  }
+}
+
+static bool broker_start(Broker *b) {
+  b->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t alen = sizeof(a);
+  if (bind(b->listen_fd, (sockaddr *)&a, sizeof(a)) || listen(b->listen_fd, 4) ||
+      getsockname(b->listen_fd, (sockaddr *)&a, &alen))
+    return false;
+  b->port = ntohs(a.sin_port);
+  b->th = std::thread(broker_serve, b);
+  return true;
+}
+
+/* Wait until the broker has read every byte the client sent and finished with closed sessions */
+static void broker_sync(Broker *b, uint64_t client_tx, bool idle) {
+  for (int k = 0; k < 2000 && (b->rx_bytes < client_tx || (idle && b->active_fd >= 0)); k++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+/* Broker restart: drop the client without a DISCONNECT, as a crashed or restarted broker does */
+static void broker_kick(Broker *b) {
+  int fd = b->active_fd;
+  if (fd >= 0) shutdown(fd, SHUT_RDWR);
+  broker_sync(b, 0, true);
+}
+
+static void broker_stop(Broker *b) {
+  b->stop = true;
+  shutdown(b->listen_fd, SHUT_RDWR);
+  close(b->listen_fd);
+  b->th.join();
+}
+
+/* ─── Client, standing in for PubSubClient ─── */
+struct Client {
+  uint16_t port;
+  int fd = -1;
+  uint64_t tx = 0;
+};
+
+static void put_str(std::string *out, const char *s) {
+  size_t n = strlen(s);
+  out->push_back((char)(n >> 8));
+  out->push_back((char)(n & 0xFF));
+  out->append(s, n);
+}
+
+static bool client_send(Client *c, uint8_t type, const std::string &body) {
+  std::string pkt(1, (char)type);
+  size_t n = body.size();
+  do {
+    uint8_t d = n % 128;
+    n /= 128;
+    pkt.push_back((char)(d | (n ? 0x80 : 0)));
+  } while (n);
+  pkt += body;
+  if (send(c->fd, pkt.data(), pkt.size(), MSG_NOSIGNAL) != (ssize_t)pkt.size()) return false;
+  c->tx += pkt.size();
+  return true;
+}
+
+static bool client_connected(Client *c) {
+  if (c->fd < 0) return false;
+  char b;
+  ssize_t r = recv(c->fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+    close(c->fd);
+    c->fd = -1;
+    return false;
+  }
+  return true;
+}
+
+static bool client_connect(Client *c, const char *id, const char *will_topic, const char *will_msg) {
+  c->fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  a.sin_port = htons(c->port);
+  int one = 1;
+  setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  timeval tv = {2, 0};
+  setsockopt(c->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  std::string body;
+  put_str(&body, "MQTT");
+  body += (char)4;
+  body += (char)(0x02 | 0x04 | 0x20);  /* clean session, will, will retained, QoS 0 */
+  body += (char)0;
+  body += (char)30;
+  put_str(&body, id);
+  put_str(&body, will_topic);
+  put_str(&body, will_msg);
+  uint8_t ack[4];
+  if (connect(c->fd, (sockaddr *)&a, sizeof(a)) || !client_send(c, 0x10, body) || !read_n(c->fd, ack, 4, NULL) ||
+      ack[0] != 0x20 || ack[3] != 0) {
+    close(c->fd);
+    c->fd = -1;
+    return false;
+  }
+  return true;
+}
+
+static bool client_publish(Client *c, const char *topic, const char *payload, size_t len, bool retain) {
+  if (c->fd < 0) return false;
+  std::string body;
+  put_str(&body, topic);
+  body.append(payload, len);
+  return client_send(c, (uint8_t)(0x30 | (retain ? 1 : 0)), body);
+}
+
+static void client_disconnect(Client *c) {
+  if (c->fd < 0) return;
+  client_send(c, 0xE0, std::string());
+  close(c->fd);
+  c->fd = -1;
+}
+
+/* ─── Publisher: the loop of mqtt_pub.cpp on a virtual clock ─── */
+static const char *k_id = "3a9f10";
+static const char *k_base = "cyd-shunt/3a9f10";
+
+struct Publisher {
+  Client       cl;
+  MqttSample   qbuf[600];
+  MqttQueue    q;
+  MqttPolicy   pol;
+  char         text[4096 - 64];
+  MqttMsg      m;
+  uint32_t     now = 0;
+  uint32_t     next_sample = 0;
+  uint32_t     made = 0;            /* samples taken */
+  uint32_t     publish_delay_us = 0;  /* simulated slow link */
+  std::vector<uint32_t> attempts;   /* connection attempt times */
+  std::vector<uint16_t> batches;    /* sizes, in order */
+  std::vector<uint32_t> batch_at;
+};
+
+static bool pub_publish(Publisher *p, const char *leaf_or_topic, bool retain, bool full_topic) {
+  char t[96];
+  if (full_topic) snprintf(t, sizeof(t), "%s", leaf_or_topic);
+  else snprintf(t, sizeof(t), "%s/%s", k_base, leaf_or_topic);
+  return client_publish(&p->cl, t, p->m.buf, p->m.len, retain);
+}
+
+static void pub_init(Publisher *p, uint16_t port, uint16_t queue_cap) {
+  p->cl.port = port;
+  MqttQueueInit(&p->q, p->qbuf, queue_cap);
+  MqttMsgInit(&p->m, p->text, sizeof(p->text));
+  MqttPolicyInit(&p->pol, &k_cfg, 0);
+}
+
+static void pub_tick(Publisher *p, bool wifi_up) {
+  if ((int32_t)(p->now - p->next_sample) >= 0) {
+    p->next_sample += k_cfg.sample_ms;
+    MqttSample s = sample_for(p->made++);
+    s.t_ms = p->now;
+    MqttQueuePush(&p->q, &s);
+  }
+  bool connected = client_connected(&p->cl);
+  if (!connected) {
+    MqttPolicyDisconnected(&p->pol, p->now);
+    if (wifi_up && MqttPolicyConnectDue(&p->pol, p->now)) {
+      p->attempts.push_back(p->now);
+      char will[64];
+      snprintf(will, sizeof(will), "%s/status", k_base);
+      if (client_connect(&p->cl, "cyd-shunt-3a9f10", will, "offline")) {
+        connected = true;
+        MqttPolicyConnected(&p->pol, p->now);
+        p->m.len = 0;
+        MqttMsgAppend(&p->m, "online");
+        pub_publish(p, "status", true, false);
+        char t[96];
+        for (size_t k = 0; k < MQTT_HA_SENSOR_COUNT; k++)
+          if (MqttFormatDiscovery(&p->m, t, sizeof(t), k, k_base, k_id, "INA228")) pub_publish(p, t, true, true);
+      } else {
+        MqttPolicyConnectFailed(&p->pol, p->now, (uint32_t)rand());
+      }
+    }
+  }
+  if (connected) {
+    uint16_t n = MqttPolicyBatchDue(&p->pol, &p->q, p->now);
+    if (n) {
+      bool ok = MqttFormatBatch(&p->m, &p->q, n) && pub_publish(p, "samples", false, false);
+      if (ok) {
+        MqttSample last = *MqttQueueAt(&p->q, (uint16_t)(n - 1));
+        MqttQueuePop(&p->q, n);
+        p->batches.push_back(n);
+        p->batch_at.push_back(p->now);
+        MqttFormatState(&p->m, last.v, last.i, last.p, 1000.0 + p->now / 3600.0, NAN);
+        pub_publish(p, "state", true, false);
+      }
+      MqttPolicyBatchDone(&p->pol, p->now, ok, p->publish_delay_us);
+    }
+    if (MqttPolicyStatsDue(&p->pol, p->now)) {
+      p->m.len = 0;
+      MqttMsgAppend(&p->m, "{\"op_s\":%lu,\"life\":{\"ah_in\":1.5,\"ah_out\":2.25},\"mqtt\":{\"queued\":%u}}",
+                    (unsigned long)(p->now / 1000), (unsigned)p->q.count);
+      pub_publish(p, "stats", true, false);
+    }
+  }
+  p->now += 100;
+}
+
+static void run_until(Publisher *p, Broker *b, uint32_t t_ms, bool wifi_up = true) {
+  while (p->now < t_ms) {
+    pub_tick(p, wifi_up);
+    broker_sync(b, p->cl.tx, false);
+  }
+}
+
+/* Sequence numbers seen in "samples" messages: each exactly once, values as sent */
+static void check_samples(Broker *b, uint32_t made, uint32_t dropped_expected, const char *what) {
+  std::vector<int> seen(made, 0);
+  bool valid = true, values = true, ordered = true;
+  uint32_t messages = 0;
+  double last_ms = -1;
+  std::lock_guard<std::mutex> lock(b->mu);
+  for (const Published &m : b->log) {
+    if (m.topic != std::string(k_base) + "/samples") continue;
+    messages++;
+    Json j;
+    if (!json_read(m.payload, &j) || m.retain) {
+      valid = false;
+      continue;
+    }
+    uint32_t seq = (uint32_t)j.at("seq").num, n = (uint32_t)j.at("n").num;
+    for (const char *c : {"ms", "v", "i", "p"}) valid &= j.at(c).arr.size() == n;
+    if (!valid) continue;
+    for (uint32_t k = 0; k < n; k++) {
+      if (seq + k >= made) {
+        valid = false;
+        break;
+      }
+      seen[seq + k]++;
+      MqttSample s = sample_for(seq + k);
+      values &= fabs(j.at("v").arr[k].num - s.v) < 0.0006 && fabs(j.at("i").arr[k].num - s.i) < 0.0006;
+      ordered &= j.at("ms").arr[k].num > last_ms;
+      last_ms = j.at("ms").arr[k].num;
+    }
+  }
+  uint32_t once = 0, twice = 0, missing = 0;
+  for (int c : seen) {
+    once += c == 1;
+    twice += c > 1;
+    missing += c == 0;
+  }
+  CHECK(valid && values && ordered);
+  CHECK(twice == 0);
+  CHECK(missing == dropped_expected);
+  printf("%-9s %u samples in %u messages, %u missing (%u dropped by the queue), %u repeated\n", what, made, messages,
+         missing, dropped_expected, twice);
+}
+
+/* Retained state after a run: status, Home Assistant discovery and the topics it points at */
+static void check_retained(Broker &b, const Publisher &p) {
+  std::lock_guard<std::mutex> lock(b.mu);
+  CHECK(b.clean_disconnects == 1 && b.wills == 2);
+  CHECK(b.retained[std::string(k_base) + "/status"] == "online");  /* a clean disconnect sends no will */
+
+  /* Home Assistant discovery: seven retained configs, valid and pointing at retained state topics */
+  int configs = 0;
+  bool disc_ok = true;
+  for (auto &kv : b.retained) {
+    if (kv.first.compare(0, 13, "homeassistant")) continue;
+    configs++;
+    Json j;
+    disc_ok &= json_read(kv.second, &j);
+    for (const char *k : {"name", "uniq_id", "stat_t", "val_tpl", "unit_of_meas", "stat_cla", "avty_t", "dev"})
+      disc_ok &= j.has(k);
+    std::string key = kv.first.substr(kv.first.rfind('/', kv.first.size() - 8) + 1);
+    key = key.substr(0, key.find('/'));
+    disc_ok &= kv.first == "homeassistant/sensor/cyd_shunt_3a9f10/" + key + "/config";
+    disc_ok &= j.at("uniq_id").str == "cyd_shunt_3a9f10_" + key;
+    disc_ok &= j.at("avty_t").str == std::string(k_base) + "/status";
+    disc_ok &= b.retained.count(j.at("stat_t").str) == 1;  /* its state topic exists */
+    disc_ok &= j.at("dev").at("ids").arr.size() == 1 && j.at("dev").at("ids").arr[0].str == "cyd_shunt_3a9f10";
+    disc_ok &= j.at("dev").at("mdl").str == "INA228";
+    disc_ok &= j.has("dev_cla") == (key != "ah_in" && key != "ah_out");
+    /* The template's field is in the retained state message */
+    std::string tpl = j.at("val_tpl").str, field = tpl.substr(14, tpl.size() - 17);
+    Json st;
+    disc_ok &= json_read(b.retained[j.at("stat_t").str], &st);
+    size_t dot = field.find('.');
+    disc_ok &= dot == std::string::npos ? st.has(field.c_str())
+                                        : st.at(field.substr(0, dot).c_str()).has(field.substr(dot + 1).c_str());
+  }
+  CHECK(configs == 7 && disc_ok);
+  Json st;
+  CHECK(json_read(b.retained[std::string(k_base) + "/state"], &st));
+  CHECK(st.at("t").type == Json::NUL && st.at("v").type == Json::NUM);
+  /* Discovery is sent again on every connect, before any samples */
+  int disc_msgs = 0;
+  for (const Published &m : b.log) disc_msgs += !m.topic.compare(0, 13, "homeassistant") && m.retain;
+  CHECK(disc_msgs == 7 * 3);
+  printf("          %d connects, %d refused, %d last wills, %zu connection attempts, %d discovery configs\n",
+         b.connects, b.refused, b.wills, p.attempts.size(), configs);
+}
+
+static void test_broker_run(void) {
+  Broker b;
+  CHECK(broker_start(&b));
+  static Publisher p;
+  pub_init(&p, b.port, 600);
+
+  /* Five minutes steady: one sample per message */
+  run_until(&p, &b, 300000);
+  CHECK(b.connects == 1 && b.client_id == "cyd-shunt-3a9f10" && b.keepalive_s == 30);
+  CHECK(p.batches.size() >= 295 && p.pol.interval == 1000);
+
+  /* Broker restart, down for two minutes: last will, then refused reconnects backing off */
+  b.refuse = true;
+  broker_kick(&b);
+  {
+    std::lock_guard<std::mutex> lock(b.mu);
+    CHECK(b.wills == 1 && b.retained[std::string(k_base) + "/status"] == "offline");
+  }
+  size_t attempts_before = p.attempts.size();
+  run_until(&p, &b, 420000);
+  CHECK(p.q.count >= 115);
+  bool backoff_ok = true;
+  for (size_t k = attempts_before + 1; k < p.attempts.size(); k++) {
+    uint32_t gap = p.attempts[k] - p.attempts[k - 1];
+    uint32_t want = 2000u << (k - attempts_before - 1);  /* the first retry already waited 1 s */
+    if (want > 60000) want = 60000;
+    backoff_ok &= gap >= want && gap <= want + want / 4 + 100;
+  }
+  CHECK(backoff_ok && p.attempts.size() - attempts_before >= 5);
+
+  /* Back: the backlog goes out in full batches, one per tick, then one sample per message again */
+  b.refuse = false;
+  size_t batches_before = p.batches.size();
+  run_until(&p, &b, 540000);
+  CHECK(b.connects == 2);
+  CHECK(p.batches.size() > batches_before + 2 && p.batches[batches_before] == 60 &&
+        p.batches[batches_before + 1] == 60);
+  CHECK(p.batch_at[batches_before + 1] - p.batch_at[batches_before] == 100);
+  CHECK(p.q.count <= 1);
+  {
+    std::lock_guard<std::mutex> lock(b.mu);
+    CHECK(b.retained[std::string(k_base) + "/status"] == "online");
+  }
+
+  /* Slow link: the interval widens to 30 s and messages carry up to 30 samples; then narrows again */
+  p.publish_delay_us = 400000;
+  batches_before = p.batches.size();
+  run_until(&p, &b, 720000);
+  uint16_t biggest = 0;
+  for (size_t k = batches_before; k < p.batches.size(); k++) biggest = std::max(biggest, p.batches[k]);
+  CHECK(p.pol.interval == 30000 && biggest >= 29 && biggest <= 31);
+  p.publish_delay_us = 2000;
+  run_until(&p, &b, 900000);
+  CHECK(p.pol.interval == 1000);
+
+  /* Wi-Fi down: no attempts at all, the queue carries the gap */
+  b.refuse = true;
+  broker_kick(&b);
+  b.refuse = false;
+  attempts_before = p.attempts.size();
+  run_until(&p, &b, 960000, false);
+  CHECK(p.attempts.size() == attempts_before);
+  run_until(&p, &b, 1020000);
+  CHECK(b.connects == 3 && p.q.count <= 1);
+
+  client_disconnect(&p.cl);
+  broker_sync(&b, p.cl.tx, true);
+  check_samples(&b, p.made - p.q.count, 0, "outages");
+  check_retained(b, p);
+  broker_stop(&b);
+}
+
+/* Outage longer than the queue: the oldest samples are dropped, and the gap shows in seq */
+static void test_overflow(void) {
+  Broker b;
+  CHECK(broker_start(&b));
+  static Publisher p;
+  pub_init(&p, b.port, 100);
+  run_until(&p, &b, 60000);
+  b.refuse = true;
+  broker_kick(&b);
+  run_until(&p, &b, 300000);
+  b.refuse = false;
+  run_until(&p, &b, 400000);
+  CHECK(p.q.dropped >= 130 && p.q.peak == 100);
+  client_disconnect(&p.cl);
+  broker_sync(&b, p.cl.tx, true);
+  check_samples(&b, p.made - p.q.count, p.q.dropped, "overflow");
+  broker_stop(&b);
+}
+
+int main() {
+  test_queue();
+  test_formats();
+  test_policy();
+  test_broker_run();
+  test_overflow();
+  printf("%d checks, %d failed\n", s_checks, s_failed);
+  return s_failed ? 1 : 0;
+}
@@ -0,0 +1,258 @@
+/**
+ * @file http_bench.cpp
+ * Load generator for the device HTTP API (docs/HTTP_API.md): N concurrent clients request one or
+ * more paths for a fixed time, then report requests per second, latency percentiles and status
+ * codes. Device heap and HTTP counters are read from /metrics before and after the run, so the
+ * heap cost of concurrent scrapes shows next to the throughput.
+ *
+ * Build: make -C tools/http_bench   (Linux, C++17, no dependencies)
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string host;
+  std::string port = "80";
+  std::vector<std::string> paths = {"/metrics"};
+  int clients = 4;
+  double seconds = 10;
+  double timeout_s = 5;
+  bool metrics = true;
+};
+
+struct Result {
+  int status = 0;     /* 0 = connect or read failure */
+  size_t bytes = 0;   /* body, after de-chunking */
+  double ms = 0;
+  std::string body;
+};
+
+/* ─── HTTP/1.1 client, one request per connection (the device closes after each response) ─── */
+static std::string dechunk(const std::string &b) {
+  std::string out;
+  size_t pos = 0;
+  for (;;) {
+    size_t eol = b.find("\r\n", pos);
+    if (eol == std::string::npos) break;
+    size_t n = strtoul(b.c_str() + pos, nullptr, 16);
+    if (n == 0) break;
+    out.append(b, eol + 2, n);
+    pos = eol + 2 + n + 2;
+    if (pos > b.size()) break;
+  }
+  return out;
+}
+
+static Result fetch(const Options &o, const addrinfo *ai, const std::string &path, bool keep_body) {
+  Result r;
+  auto t0 = Clock::now();
+  int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+  if (fd < 0) return r;
+  timeval tv;
+  tv.tv_sec = (time_t)o.timeout_s;
+  tv.tv_usec = (suseconds_t)((o.timeout_s - (double)tv.tv_sec) * 1e6);
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+    close(fd);
+    return r;
+  }
+  std::string req = "GET " + path + " HTTP/1.1\r\nHost: " + o.host + "\r\nConnection: close\r\n\r\n";
+  if (send(fd, req.data(), req.size(), MSG_NOSIGNAL) != (ssize_t)req.size()) {
+    close(fd);
+    return r;
+  }
+  std::string resp;
+  char buf[4096];
+  ssize_t n;
+  while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) resp.append(buf, (size_t)n);
+  close(fd);
+  r.ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+  if (n < 0 || resp.compare(0, 5, "HTTP/") != 0) return r;  /* timeout or garbage */
+
+  size_t sp = resp.find(' ');
+  r.status = sp == std::string::npos ? 0 : atoi(resp.c_str() + sp + 1);
+  size_t hdr_end = resp.find("\r\n\r\n");
+  if (hdr_end == std::string::npos) return r;
+  std::string headers = resp.substr(0, hdr_end);
+  std::string body = resp.substr(hdr_end + 4);
+  for (auto &ch : headers) ch = (char)tolower((unsigned char)ch);
+  if (headers.find("transfer-encoding: chunked") != std::string::npos) body = dechunk(body);
+  r.bytes = body.size();
+  if (keep_body) r.body.swap(body);
+  return r;
+}
+
+/* ─── /metrics scrape ─── */
+static std::map<std::string, double> scrape(const Options &o, const addrinfo *ai) {
+  std::map<std::string, double> m;
+  Result r = fetch(o, ai, "/metrics", true);
+  if (r.status != 200) return m;
+  size_t pos = 0;
+  while (pos < r.body.size()) {
+    size_t eol = r.body.find('\n', pos);
+    if (eol == std::string::npos) eol = r.body.size();
+    std::string line = r.body.substr(pos, eol - pos);
+    pos = eol + 1;
+    if (line.empty() || line[0] == '#') continue;
+    size_t sp = line.rfind(' ');
+    if (sp == std::string::npos) continue;
+    m[line.substr(0, sp)] = strtod(line.c_str() + sp + 1, nullptr);
+  }
+  return m;
+}
+
+static double metric(const std::map<std::string, double> &m, const char *key) {
+  auto it = m.find(key);
+  return it == m.end() ? -1 : it->second;
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: http_bench [options] host[:port]\n"
+          "  -c N       concurrent clients (default 4)\n"
+          "  -t S       run time in seconds (default 10)\n"
+          "  -p PATHS   comma-separated paths, taken round-robin (default /metrics)\n"
+          "  -w S       per-request timeout in seconds (default 5)\n"
+          "  --no-metrics  do not read /metrics before and after (for servers that are not the device)\n");
+}
+
+int main(int argc, char **argv) {
+  Options o;
+  for (int k = 1; k < argc; k++) {
+    std::string a = argv[k];
+    if (a == "-c" && k + 1 < argc) o.clients = atoi(argv[++k]);
+    else if (a == "-t" && k + 1 < argc) o.seconds = atof(argv[++k]);
+    else if (a == "-w" && k + 1 < argc) o.timeout_s = atof(argv[++k]);
+    else if (a == "-p" && k + 1 < argc) {
+      o.paths.clear();
+      std::string list = argv[++k];
+      size_t pos = 0;
+      while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) comma = list.size();
+        if (comma > pos) o.paths.push_back(list.substr(pos, comma - pos));
+        pos = comma + 1;
+      }
+    } else if (a == "--no-metrics") o.metrics = false;
+    else if (a[0] != '-' && o.host.empty()) {
+      size_t colon = a.find(':');
+      o.host = a.substr(0, colon);
+      if (colon != std::string::npos) o.port = a.substr(colon + 1);
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (o.host.empty() || o.clients < 1 || o.seconds <= 0 || o.paths.empty()) {
+    usage();
+    return 2;
+  }
+
+  addrinfo hints, *ai = nullptr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  int rc = getaddrinfo(o.host.c_str(), o.port.c_str(), &hints, &ai);
+  if (rc != 0) {
+    fprintf(stderr, "%s: %s\n", o.host.c_str(), gai_strerror(rc));
+    return 1;
+  }
+
+  std::map<std::string, double> before;
+  if (o.metrics) {
+    before = scrape(o, ai);
+    if (before.empty()) fprintf(stderr, "warning: no /metrics from %s (use --no-metrics for other servers)\n",
+                                o.host.c_str());
+  }
+
+  std::mutex lock;
+  std::vector<double> latencies;
+  std::map<int, uint64_t> statuses;
+  uint64_t bytes = 0;
+  std::atomic<uint64_t> next_path{0};
+  auto deadline = Clock::now() + std::chrono::duration<double>(o.seconds);
+  auto t_start = Clock::now();
+
+  std::vector<std::thread> threads;
+  for (int c = 0; c < o.clients; c++) {
+    threads.emplace_back([&]() {
+      std::vector<double> lat;
+      std::map<int, uint64_t> st;
+      uint64_t b = 0;
+      while (Clock::now() < deadline) {
+        const std::string &path = o.paths[next_path++ % o.paths.size()];
+        Result r = fetch(o, ai, path, false);
+        st[r.status]++;
+        if (r.status) {
+          lat.push_back(r.ms);
+          b += r.bytes;
+        } else {
+          std::this_thread::sleep_for(std::chrono::milliseconds(100));  /* no connect storm */
+        }
+      }
+      std::lock_guard<std::mutex> g(lock);
+      latencies.insert(latencies.end(), lat.begin(), lat.end());
+      for (auto &kv : st) statuses[kv.first] += kv.second;
+      bytes += b;
+    });
+  }
+  for (auto &t : threads) t.join();
+  double elapsed = std::chrono::duration<double>(Clock::now() - t_start).count();
+
+  uint64_t total = 0, ok = 0;
+  for (auto &kv : statuses) {
+    total += kv.second;
+    if (kv.first == 200) ok += kv.second;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  auto pct = [&](double p) {
+    if (latencies.empty()) return 0.0;
+    size_t i = (size_t)(p / 100.0 * (double)(latencies.size() - 1) + 0.5);
+    return latencies[i];
+  };
+
+  printf("%s:%s, %d clients, %.1f s, paths:", o.host.c_str(), o.port.c_str(), o.clients, elapsed);
+  for (auto &p : o.paths) printf(" %s", p.c_str());
+  printf("\nrequests  %llu (%.1f/s), 200 OK %.1f/s, %.1f KB/s body\n", (unsigned long long)total,
+         (double)total / elapsed, (double)ok / elapsed, (double)bytes / 1024.0 / elapsed);
+  printf("status   ");
+  for (auto &kv : statuses) {
+    if (kv.first) printf(" %d: %llu", kv.first, (unsigned long long)kv.second);
+    else printf(" failed: %llu", (unsigned long long)kv.second);
+  }
+  printf("\nlatency   p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.1f ms\n", pct(50), pct(90), pct(99),
+         latencies.empty() ? 0.0 : latencies.back());
+
+  if (o.metrics && !before.empty()) {
+    std::map<std::string, double> after = scrape(o, ai);
+    if (after.empty()) {
+      printf("device    no /metrics after the run\n");
+    } else {
+      printf("device    heap free %.0f -> %.0f B, lowest while serving %.0f B, lowest since boot %.0f B\n",
+             metric(before, "cyd_shunt_heap_free_bytes"), metric(after, "cyd_shunt_heap_free_bytes"),
+             metric(after, "cyd_shunt_http_heap_low_bytes"), metric(after, "cyd_shunt_heap_min_free_bytes"));
+      printf("device    largest block %.0f -> %.0f B, peak %.0f responses in flight, %.0f refused (503)\n",
+             metric(before, "cyd_shunt_heap_largest_block_bytes"), metric(after, "cyd_shunt_heap_largest_block_bytes"),
+             metric(after, "cyd_shunt_http_active_peak"),
+             metric(after, "cyd_shunt_http_rejected_total") - metric(before, "cyd_shunt_http_rejected_total"));
+    }
+  }
+  freeaddrinfo(ai);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+/**
+ * @file influx_standin.cpp
+ * Local stand-in for an InfluxDB server, for trying the device's uploader (docs/INFLUX.md) without
+ * one. Takes writes on /api/v2/write and /write (precision=ms), answers /ping with a Date header, and
+ * every 10 s prints what arrived: points, body bytes per second, points that are live (stamped in the
+ * last minute) or from the backlog, and timestamps seen twice in a series. It can fake outages: answer 503,
+ * or drop connections, for a while in every cycle, so the spool and the catch-up can be watched.
+ * Lines can be appended to a file for a closer look.
+ *
+ * Build: make -C tools/influx_standin   (Linux, C++17, no dependencies)
+ */
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct Options {
+  int port = 8086;
+  int up_s = 0;            /* outage cycle: up for up_s, then down for down_s; 0 = never down */
+  int down_s = 0;
+  bool drop = false;       /* during an outage, close connections instead of answering 503 */
+  const char *out = NULL;  /* append received lines here */
+};
+
+static Options s_opt;
+static std::mutex s_mu;
+static FILE *s_out = NULL;
+static std::atomic<bool> s_stop{false};
+static const auto s_start = std::chrono::steady_clock::now();
+
+/* Per interval */
+static uint64_t s_points, s_bytes, s_posts, s_refused, s_live, s_backlog, s_dups, s_bad;
+/* Whole run: timestamps seen per series, to spot repeats */
+static std::map<std::string, std::set<int64_t>> s_seen;
+static uint64_t s_total_points, s_total_dups;
+
+static int64_t unix_ms(void) {
+  return (int64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+static bool outage_now(void) {
+  if (!s_opt.down_s) return false;
+  int t = (int)std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - s_start).count();
+  return t % (s_opt.up_s + s_opt.down_s) >= s_opt.up_s;
+}
+
+static void take_body(const std::string &body) {
+  int64_t now = unix_ms();
+  std::lock_guard<std::mutex> lock(s_mu);
+  s_posts++;
+  s_bytes += body.size();
+  size_t pos = 0;
+  while (pos < body.size()) {
+    size_t nl = body.find('\n', pos);
+    if (nl == std::string::npos) nl = body.size();
+    std::string line = body.substr(pos, nl - pos);
+    pos = nl + 1;
+    if (line.empty()) continue;
+    size_t sp1 = line.find(' ');
+    size_t sp2 = line.rfind(' ');
+    if (sp1 == std::string::npos || sp2 == sp1) {
+      s_bad++;
+      continue;
+    }
+    int64_t ts = strtoll(line.c_str() + sp2 + 1, NULL, 10);
+    s_points++;
+    s_total_points++;
+    if (now - ts <= 60000) s_live++;
+    else s_backlog++;
+    if (!s_seen[line.substr(0, sp1)].insert(ts).second) {
+      s_dups++;
+      s_total_dups++;
+    }
+    if (s_out) fprintf(s_out, "%s\n", line.c_str());
+  }
+  if (s_out) fflush(s_out);
+}
+
+static void serve(int fd) {
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  timeval tv = {120, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  std::string buf;
+  char tmp[8192];
+  while (!s_stop) {
+    size_t end;
+    while ((end = buf.find("\r\n\r\n")) == std::string::npos) {
+      ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+      if (n <= 0) goto done;
+      buf.append(tmp, (size_t)n);
+    }
+    std::string head = buf.substr(0, end);
+    size_t clen = 0;
+    const char *cl = strcasestr(head.c_str(), "Content-Length:");
+    if (cl) clen = strtoul(cl + 15, NULL, 10);
+    while (buf.size() < end + 4 + clen) {
+      ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+      if (n <= 0) goto done;
+      buf.append(tmp, (size_t)n);
+    }
+    std::string body = buf.substr(end + 4, clen);
+    buf.erase(0, end + 4 + clen);
+
+    int status;
+    bool is_write = !head.compare(0, 19, "POST /api/v2/write?") || !head.compare(0, 12, "POST /write?");
+    if (is_write && outage_now()) {
+      std::lock_guard<std::mutex> lock(s_mu);
+      s_refused++;
+      if (s_opt.drop) goto done;
+      status = 503;
+    } else if (is_write) {
+      status = head.find("precision=ms") == std::string::npos ? 400 : 204;
+      if (status == 204) take_body(body);
+    } else if (!head.compare(0, 10, "GET /ping ") || !head.compare(0, 11, "HEAD /ping ")) {
+      status = 204;
+    } else {
+      status = 404;
+    }
+    char date[64], resp[192];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", gmtime(&now));
+    int n = snprintf(resp, sizeof(resp), "HTTP/1.1 %d %s\r\nDate: %s\r\nContent-Length: 0\r\n\r\n", status,
+                     status == 204 ? "No Content" : status == 400 ? "Bad Request" : status == 503 ? "Service Unavailable" : "Not Found",
+                     date);
+    if (send(fd, resp, (size_t)n, MSG_NOSIGNAL) != n) break;
+  }
+done:
+  close(fd);
+}
+
+static void report(void) {
+  double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - s_start).count();
+  std::lock_guard<std::mutex> lock(s_mu);
+  printf("%7.0f s %s  %5llu points (%llu live, %llu backlog) in %llu posts, %6.0f B/s, %llu refused, %llu dup, "
+         "%llu bad | total %llu points, %llu dup\n",
+         t, outage_now() ? "DOWN" : "up  ", (unsigned long long)s_points, (unsigned long long)s_live,
+         (unsigned long long)s_backlog, (unsigned long long)s_posts, (double)s_bytes / 10.0,
+         (unsigned long long)s_refused, (unsigned long long)s_dups, (unsigned long long)s_bad,
+         (unsigned long long)s_total_points, (unsigned long long)s_total_dups);
+  fflush(stdout);
+  s_points = s_bytes = s_posts = s_refused = s_live = s_backlog = s_dups = s_bad = 0;
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: influx_standin [-p port] [-o lines.txt] [-u up_s -d down_s [-x]]\n"
+          "  -p  listen port (8086)\n"
+          "  -o  append the received lines to a file\n"
+          "  -u, -d  outage cycle: take writes for up_s, then refuse them for down_s\n"
+          "  -x  during an outage, drop the connection instead of answering 503\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  int c;
+  while ((c = getopt(argc, argv, "p:o:u:d:xh")) != -1) {
+    switch (c) {
+      case 'p': s_opt.port = atoi(optarg); break;
+      case 'o': s_opt.out = optarg; break;
+      case 'u': s_opt.up_s = atoi(optarg); break;
+      case 'd': s_opt.down_s = atoi(optarg); break;
+      case 'x': s_opt.drop = true; break;
+      default: usage();
+    }
+  }
+  if (s_opt.down_s < 0 || s_opt.up_s < 0 || (s_opt.down_s && !s_opt.up_s)) usage();
+  if (s_opt.out && !(s_out = fopen(s_opt.out, "a"))) {
+    perror(s_opt.out);
+    return 1;
+  }
+
+  int ls = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(INADDR_ANY);
+  a.sin_port = htons((uint16_t)s_opt.port);
+  if (bind(ls, (sockaddr *)&a, sizeof(a)) || listen(ls, 8)) {
+    perror("listen");
+    return 1;
+  }
+  printf("listening on :%d; on the device: influx url http://<this host>:%d/api/v2/write?org=o&bucket=b\n",
+         s_opt.port, s_opt.port);
+  if (s_opt.down_s) printf("outages: up %d s, down %d s (%s)\n", s_opt.up_s, s_opt.down_s, s_opt.drop ? "drop" : "503");
+  fflush(stdout);
+
+  std::thread([] {
+    while (!s_stop) {
+      std::this_thread::sleep_for(std::chrono::seconds(10));
+      report();
+    }
+  }).detach();
+
+  signal(SIGPIPE, SIG_IGN);
+  for (;;) {
+    int fd = accept(ls, NULL, NULL);
+    if (fd < 0) continue;
+    std::thread(serve, fd).detach();
+  }
+}
@@ -0,0 +1,315 @@
+/**
+ * @file modbus_bench.cpp
+ * Modbus request latency benchmark for the device (docs/MODBUS.md). Sends N read requests one after
+ * the other over Modbus TCP, or over RTU on a serial port, and reports answers, exceptions, timeouts
+ * and latency percentiles. Then reads the whole register map once and prints it decoded, as a
+ * check that the map and the device agree.
+ *
+ * Build: make -C tools/modbus_bench   (Linux, C++17, no dependencies)
+ */
+#include "modbus_regs.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string target;      /* host[:port], or a serial device path for RTU */
+  std::string port = "502";
+  bool rtu = false;
+  unsigned baud = 19200;
+  char parity = 'E';
+  unsigned unit = 1;
+  int count = 1000;
+  unsigned fc = MB_FC_READ_INPUT;
+  unsigned addr = 0;
+  unsigned qty = 64;
+  int interval_ms = 0;
+  int timeout_ms = 1000;
+};
+
+static double pct(std::vector<double> v, double p) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[(size_t)(p / 100.0 * (double)(v.size() - 1) + 0.5)];
+}
+
+/* Read exactly n bytes or until the deadline */
+static bool read_full(int fd, uint8_t *p, size_t n, Clock::time_point deadline) {
+  while (n) {
+    int left = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+    if (left <= 0) return false;
+    pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, left) <= 0) return false;
+    ssize_t r = read(fd, p, n);
+    if (r <= 0) return false;
+    p += r;
+    n -= (size_t)r;
+  }
+  return true;
+}
+
+/* ─── Transports: send one request PDU, return the answer PDU ─── */
+enum Result { OK, EXCEPTION, TIMEOUT, BAD_REPLY };
+
+static Result tcp_request(int fd, uint16_t tid, uint8_t unit, const uint8_t *pdu, size_t n, const Options &o,
+                          std::vector<uint8_t> &resp) {
+  uint8_t a[MB_TCP_ADU_MAX];
+  MbPutU16BE(a, tid);
+  MbPutU16BE(a + 2, 0);
+  MbPutU16BE(a + 4, (uint16_t)(n + 1));
+  a[6] = unit;
+  memcpy(a + MB_TCP_MBAP, pdu, n);
+  if (write(fd, a, MB_TCP_MBAP + n) != (ssize_t)(MB_TCP_MBAP + n)) return TIMEOUT;
+  auto deadline = Clock::now() + std::chrono::milliseconds(o.timeout_ms);
+  uint8_t h[MB_TCP_MBAP];
+  if (!read_full(fd, h, sizeof(h), deadline)) return TIMEOUT;
+  uint16_t len = MbGetU16BE(h + 4);
+  if (MbGetU16BE(h) != tid || MbGetU16BE(h + 2) != 0 || len < 2 || len > 1 + MB_PDU_MAX) return BAD_REPLY;
+  resp.resize(len - 1u);
+  if (!read_full(fd, resp.data(), resp.size(), deadline)) return TIMEOUT;
+  return resp[0] & 0x80 ? EXCEPTION : OK;
+}
+
+static Result rtu_request(int fd, uint8_t unit, const uint8_t *pdu, size_t n, const Options &o,
+                          std::vector<uint8_t> &resp) {
+  uint8_t f[MB_RTU_ADU_MAX];
+  f[0] = unit;
+  memcpy(f + 1, pdu, n);
+  uint16_t c = MbCrc16(f, n + 1);
+  f[n + 1] = (uint8_t)c;
+  f[n + 2] = (uint8_t)(c >> 8);
+  tcflush(fd, TCIFLUSH);
+  if (write(fd, f, n + 3) != (ssize_t)(n + 3)) return TIMEOUT;
+  auto deadline = Clock::now() + std::chrono::milliseconds(o.timeout_ms);
+  uint8_t r[MB_RTU_ADU_MAX];
+  if (!read_full(fd, r, 3, deadline)) return TIMEOUT;  /* address, function, byte count or exception */
+  size_t total;
+  if (r[1] & 0x80) total = 5;
+  else if (r[1] == MB_FC_READ_HOLDING || r[1] == MB_FC_READ_INPUT) total = 5 + (size_t)r[2];
+  else total = 8;  /* write echoes */
+  if (!read_full(fd, r + 3, total - 3, deadline)) return TIMEOUT;
+  if (r[0] != unit || MbCrc16(r, total - 2) != (uint16_t)(r[total - 2] | (r[total - 1] << 8))) return BAD_REPLY;
+  resp.assign(r + 1, r + total - 2);
+  return resp[0] & 0x80 ? EXCEPTION : OK;
+}
+
+static int open_tcp(const Options &o) {
+  addrinfo hints, *ai = nullptr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  int rc = getaddrinfo(o.target.c_str(), o.port.c_str(), &hints, &ai);
+  if (rc != 0) {
+    fprintf(stderr, "%s: %s\n", o.target.c_str(), gai_strerror(rc));
+    return -1;
+  }
+  int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+  if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+    perror("connect");
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(ai);
+  if (fd >= 0) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  }
+  return fd;
+}
+
+static speed_t baud_flag(unsigned baud) {
+  switch (baud) {
+    case 1200: return B1200;
+    case 2400: return B2400;
+    case 4800: return B4800;
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return 0;
+  }
+}
+
+static int open_rtu(const Options &o) {
+  speed_t sp = baud_flag(o.baud);
+  if (!sp) {
+    fprintf(stderr, "unsupported baud rate %u\n", o.baud);
+    return -1;
+  }
+  int fd = open(o.target.c_str(), O_RDWR | O_NOCTTY);
+  if (fd < 0) {
+    perror(o.target.c_str());
+    return -1;
+  }
+  termios t;
+  tcgetattr(fd, &t);
+  cfmakeraw(&t);
+  cfsetispeed(&t, sp);
+  cfsetospeed(&t, sp);
+  t.c_cflag |= CLOCAL | CREAD;
+  t.c_cflag &= ~(CSTOPB | PARENB | PARODD | CRTSCTS);
+  if (o.parity != 'N') t.c_cflag |= PARENB | (o.parity == 'O' ? PARODD : 0);
+  t.c_cc[VMIN] = 0;
+  t.c_cc[VTIME] = 0;
+  tcsetattr(fd, TCSANOW, &t);
+  return fd;
+}
+
+/* ─── Decoded register map ─── */
+static void print_stats(const char *name, const uint16_t *b) {
+  printf("%-9s Ah in %.3f, out %.3f, peak %.2f W, V %.3f..%.3f (mean %.3f), I %.3f..%.3f (mean %.3f)\n", name,
+         MbGet32(b + MB_ST_AH_IN) / 1e3, MbGet32(b + MB_ST_AH_OUT) / 1e3,
+         (int32_t)MbGet32(b + MB_ST_PEAK_POWER) / 1e3, (int32_t)MbGet32(b + MB_ST_V_MIN) / 1e3,
+         (int32_t)MbGet32(b + MB_ST_V_MAX) / 1e3, (int32_t)MbGet32(b + MB_ST_V_MEAN) / 1e3,
+         (int32_t)MbGet32(b + MB_ST_I_MIN) / 1e3, (int32_t)MbGet32(b + MB_ST_I_MAX) / 1e3,
+         (int32_t)MbGet32(b + MB_ST_I_MEAN) / 1e3);
+  printf("          charging %lu s, discharging %lu s, idle %lu s, %lu samples since %lu s\n",
+         (unsigned long)MbGet32(b + MB_ST_CHARGE_S), (unsigned long)MbGet32(b + MB_ST_DISCHARGE_S),
+         (unsigned long)MbGet32(b + MB_ST_IDLE_S), (unsigned long)MbGet32(b + MB_ST_SAMPLES),
+         (unsigned long)MbGet32(b + MB_ST_START_S));
+}
+
+static void print_map(const uint16_t *r) {
+  uint16_t st = r[MB_REG_STATUS];
+  printf("map       version %u, status 0x%04X%s%s%s, age %u ms, %u Hz, seq %lu, operating %lu s\n",
+         r[MB_REG_MAP_VERSION], st, st & MB_STATUS_SENSOR ? " sensor" : " no-sensor",
+         st & MB_STATUS_STALE ? " stale" : "", st & MB_STATUS_NO_DATA ? " no-data" : "", r[MB_REG_AGE_MS],
+         r[MB_REG_RATE_HZ], (unsigned long)MbGet32(r + MB_REG_SEQ), (unsigned long)MbGet32(r + MB_REG_OP_S));
+  char soc[16] = "unknown", temp[16] = "unknown";
+  if (r[MB_REG_SOC] != 0xFFFF) snprintf(soc, sizeof(soc), "%.2f %%", r[MB_REG_SOC] / 100.0);
+  if (r[MB_REG_TEMPERATURE] != 0x8000) snprintf(temp, sizeof(temp), "%.2f C", (int16_t)r[MB_REG_TEMPERATURE] / 100.0);
+  printf("live      %.3f V, %.3f A, %.3f W, %.3f Wh, SOC %s, temperature %s\n",
+         (int32_t)MbGet32(r + MB_REG_VOLTAGE) / 1e3, (int32_t)MbGet32(r + MB_REG_CURRENT) / 1e3,
+         (int32_t)MbGet32(r + MB_REG_POWER) / 1e3, (int32_t)MbGet32(r + MB_REG_ENERGY) / 1e3, soc, temp);
+  printf("float     %.4f V, %.4f A, %.4f W, %.4f Wh\n", MbGetFloat(r + MB_REG_F_VOLTAGE),
+         MbGetFloat(r + MB_REG_F_CURRENT), MbGetFloat(r + MB_REG_F_POWER), MbGetFloat(r + MB_REG_F_ENERGY));
+  print_stats("session", r + MB_REG_SESSION);
+  print_stats("lifetime", r + MB_REG_LIFETIME);
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: modbus_bench [options] host[:port]      Modbus TCP (default port 502)\n"
+          "       modbus_bench [options] /dev/ttyUSB0     Modbus RTU\n"
+          "  -n N       requests (default 1000)\n"
+          "  -f 3|4     function: read holding or input registers (default 4)\n"
+          "  -a ADDR    first register (default 0)\n"
+          "  -q N       registers per request, 1..125 (default 64)\n"
+          "  -u UNIT    unit id (default 1)\n"
+          "  -i MS      pause between requests (default 0)\n"
+          "  -w MS      answer timeout (default 1000)\n"
+          "  -b BAUD    RTU baud rate (default 19200)\n"
+          "  -p N|E|O   RTU parity (default E)\n");
+}
+
+int main(int argc, char **argv) {
+  Options o;
+  for (int k = 1; k < argc; k++) {
+    std::string a = argv[k];
+    if (a == "-n" && k + 1 < argc) o.count = atoi(argv[++k]);
+    else if (a == "-f" && k + 1 < argc) o.fc = (unsigned)atoi(argv[++k]);
+    else if (a == "-a" && k + 1 < argc) o.addr = (unsigned)strtoul(argv[++k], NULL, 0);
+    else if (a == "-q" && k + 1 < argc) o.qty = (unsigned)atoi(argv[++k]);
+    else if (a == "-u" && k + 1 < argc) o.unit = (unsigned)atoi(argv[++k]);
+    else if (a == "-i" && k + 1 < argc) o.interval_ms = atoi(argv[++k]);
+    else if (a == "-w" && k + 1 < argc) o.timeout_ms = atoi(argv[++k]);
+    else if (a == "-b" && k + 1 < argc) o.baud = (unsigned)atoi(argv[++k]);
+    else if (a == "-p" && k + 1 < argc) o.parity = argv[++k][0];
+    else if (a[0] != '-' && o.target.empty()) {
+      o.target = a;
+      o.rtu = a[0] == '/';
+      size_t colon = a.find(':');
+      if (!o.rtu && colon != std::string::npos) {
+        o.target = a.substr(0, colon);
+        o.port = a.substr(colon + 1);
+      }
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (o.target.empty() || o.count < 1 || (o.fc != 3 && o.fc != 4) || o.qty < 1 || o.qty > MB_READ_MAX ||
+      o.unit > 247 || (o.parity != 'N' && o.parity != 'E' && o.parity != 'O')) {
+    usage();
+    return 2;
+  }
+
+  int fd = o.rtu ? open_rtu(o) : open_tcp(o);
+  if (fd < 0) return 1;
+
+  uint8_t pdu[5] = {(uint8_t)o.fc};
+  MbPutU16BE(pdu + 1, (uint16_t)o.addr);
+  MbPutU16BE(pdu + 3, (uint16_t)o.qty);
+  std::vector<uint8_t> resp;
+  std::vector<double> ms;
+  ms.reserve((size_t)o.count);
+  int ok = 0, exc = 0, timeouts = 0, bad = 0;
+  uint8_t last_exc = 0;
+  auto t_start = Clock::now();
+  for (int k = 0; k < o.count; k++) {
+    auto t0 = Clock::now();
+    Result r = o.rtu ? rtu_request(fd, (uint8_t)o.unit, pdu, sizeof(pdu), o, resp)
+                     : tcp_request(fd, (uint16_t)k, (uint8_t)o.unit, pdu, sizeof(pdu), o, resp);
+    double dt = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    if (r == OK && resp.size() == 2 + 2 * o.qty) {
+      ok++;
+      ms.push_back(dt);
+    } else if (r == EXCEPTION) {
+      exc++;
+      last_exc = resp.size() > 1 ? resp[1] : 0;
+      ms.push_back(dt);
+    } else if (r == TIMEOUT) {
+      timeouts++;
+      if (!o.rtu) break;  /* the TCP stream is out of step now */
+    } else {
+      bad++;
+    }
+    if (o.interval_ms) usleep((useconds_t)o.interval_ms * 1000);
+  }
+  double elapsed = std::chrono::duration<double>(Clock::now() - t_start).count();
+
+  printf("%s%s%s, FC %u, %u registers from %u, unit %u\n", o.target.c_str(), o.rtu ? "" : ":",
+         o.rtu ? "" : o.port.c_str(), o.fc, o.qty, o.addr, o.unit);
+  if (o.rtu) printf("line      %u 8%c1\n", o.baud, o.parity);
+  printf("requests  %d answered (%.1f/s), %d exceptions", ok + exc, (ok + exc) / elapsed, exc);
+  if (exc) printf(" (last code %u)", last_exc);
+  printf(", %d timeouts, %d bad replies\n", timeouts, bad);
+  if (!ms.empty())
+    printf("latency   p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n", pct(ms, 50), pct(ms, 90), pct(ms, 99),
+           pct(ms, 100));
+
+  /* Whole map: two reads of at most MB_READ_MAX registers */
+  uint16_t regs[MB_REG_COUNT];
+  bool got = true;
+  for (unsigned a = 0; a < MB_REG_COUNT && got; a += 64) {
+    uint8_t rd[5] = {MB_FC_READ_INPUT};
+    MbPutU16BE(rd + 1, (uint16_t)a);
+    MbPutU16BE(rd + 3, 64);
+    Result r = o.rtu ? rtu_request(fd, (uint8_t)o.unit, rd, sizeof(rd), o, resp)
+                     : tcp_request(fd, 0xFFFF, (uint8_t)o.unit, rd, sizeof(rd), o, resp);
+    got = r == OK && resp.size() == 2 + 128;
+    for (unsigned k = 0; got && k < 64; k++) regs[a + k] = MbGetU16BE(resp.data() + 2 + 2 * k);
+  }
+  if (got) print_map(regs);
+  else printf("map       not read\n");
+  close(fd);
+  return ok + exc == o.count ? 0 : 1;
+}
@@ -0,0 +1,388 @@
+/**
+ * @file sdlog_decode.cpp
+ * Host decoder for the microSD sample log (docs/SD_LOG.md): validates blocks, reports gaps, and
+ * exports samples as CSV or as one binary column file per field. --bench measures the block codec
+ * (compression ratio, encode/decode cost per sample) on recorded traces.
+ *
+ * Build: make -C tools/sdlog_decode   (Linux/macOS, C++17, no dependencies)
+ */
+#include "crc32.h"
+#include "sample_codec.h"
+#include "sd_log_format.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <strings.h>
+
+/* ─── Decoded data ─── */
+struct Sample {
+  uint32_t file_index;
+  uint32_t block_no;
+  uint32_t seq;
+  uint32_t op_time_s;  /* of the block's first record */
+  uint32_t t_ms;
+  float    voltage_V;
+  float    current_A;
+};
+
+struct Summary {
+  uint32_t files = 0;
+  uint32_t blocks = 0;
+  uint32_t blocks_v1 = 0;
+  uint32_t seq_gaps = 0;
+  uint64_t seq_lost = 0;
+  uint32_t time_gaps = 0;  /* sampler pauses: step > 2x the median step */
+  uint64_t file_bytes = 0;
+};
+
+static bool read_file(const char *path, std::vector<uint8_t> &out) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+/* File index from ".../00000012.BIN" */
+static bool file_index_from_name(const char *path, uint32_t *idx) {
+  const char *base = strrchr(path, '/');
+  base = base ? base + 1 : path;
+  char *end = nullptr;
+  unsigned long v = strtoul(base, &end, 10);
+  if (end == base) return false;
+  *idx = (uint32_t)v;
+  return true;
+}
+
+/* ─── Block parsing ─── */
+/* Appends the block's samples; false at the end of valid data (stale, torn or pre-allocated space) */
+static bool decode_block(const uint8_t *blk, size_t block_bytes, uint32_t file_index, uint32_t block_no,
+                         std::vector<Sample> &out, Summary &sum) {
+  uint32_t magic;
+  uint16_t version;
+  memcpy(&magic, blk, 4);
+  memcpy(&version, blk + 4, 2);
+  if (magic != SDLOG_MAGIC) return false;
+
+  if (version == 1) {
+    SdLogBlockHeaderV1 h;
+    memcpy(&h, blk, sizeof(h));
+    size_t used = (size_t)h.count * sizeof(SdLogRecordV1);
+    if (h.record_size != sizeof(SdLogRecordV1) || sizeof(h) + used > block_bytes) return false;
+    uint32_t crc = Crc32Update(Crc32(blk, offsetof(SdLogBlockHeaderV1, crc)), blk + sizeof(h), used);
+    if (crc != h.crc || h.file_index != file_index || h.block_no != block_no) return false;
+    for (uint16_t k = 0; k < h.count; k++) {
+      SdLogRecordV1 r;
+      memcpy(&r, blk + sizeof(h) + k * sizeof(r), sizeof(r));
+      out.push_back({file_index, block_no, h.first_seq + k, h.op_time_s, r.t_ms, r.voltage_V, r.current_A});
+    }
+    sum.blocks_v1++;
+    return true;
+  }
+
+  if (version == 2) {
+    SdLogBlockHeaderV2 h;
+    memcpy(&h, blk, sizeof(h));
+    if (sizeof(h) + h.payload_len > block_bytes || h.count == 0 || !h.v_lsb_uv || !h.i_lsb_ua) return false;
+    uint32_t crc = Crc32Update(Crc32(blk, offsetof(SdLogBlockHeaderV2, crc)), blk + sizeof(h), h.payload_len);
+    if (crc != h.crc || h.file_index != file_index || h.block_no != block_no) return false;
+    SampleCodecPoint p = {h.key_t_ms, h.key_v, h.key_i};
+    const uint8_t *in = blk + sizeof(h);
+    size_t avail = h.payload_len;
+    for (uint16_t k = 0; k < h.count; k++) {
+      if (k > 0) {
+        SampleCodecPoint next;
+        size_t n = SampleCodecDecode(&p, in, avail, &next);
+        if (!n) return false;
+        in += n;
+        avail -= n;
+        p = next;
+      }
+      out.push_back({file_index, block_no, h.first_seq + k, h.op_time_s, p.t_ms,
+                     SampleCodecDequantise(p.v, h.v_lsb_uv), SampleCodecDequantise(p.i, h.i_lsb_ua)});
+    }
+    return avail == 0;
+  }
+  return false;
+}
+
+static bool decode_file(const char *path, size_t block_bytes, std::vector<Sample> &out, Summary &sum) {
+  uint32_t file_index;
+  if (!file_index_from_name(path, &file_index)) {
+    fprintf(stderr, "%s: name is not NNNNNNNN.BIN\n", path);
+    return false;
+  }
+  std::vector<uint8_t> data;
+  if (!read_file(path, data)) {
+    fprintf(stderr, "%s: cannot read\n", path);
+    return false;
+  }
+  sum.files++;
+  sum.file_bytes += data.size();
+  uint32_t block_no = 0;
+  for (size_t off = 0; off + block_bytes <= data.size(); off += block_bytes, block_no++) {
+    size_t before = out.size();
+    if (!decode_block(&data[off], block_bytes, file_index, block_no, out, sum)) {
+      out.resize(before);
+      break;
+    }
+    sum.blocks++;
+  }
+  return true;
+}
+
+/* Recorded traces from elsewhere: CSV with t_ms, voltage_V and current_A columns (any order) */
+static bool read_csv(const char *path, std::vector<Sample> &out) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "%s: cannot read\n", path);
+    return false;
+  }
+  char line[512];
+  int col_t = -1, col_v = -1, col_i = -1;
+  if (fgets(line, sizeof(line), f)) {
+    int col = 0;
+    for (char *tok = strtok(line, ",\r\n"); tok; tok = strtok(nullptr, ",\r\n"), col++) {
+      if (!strcmp(tok, "t_ms")) col_t = col;
+      else if (!strcmp(tok, "voltage_V")) col_v = col;
+      else if (!strcmp(tok, "current_A")) col_i = col;
+    }
+  }
+  if (col_t < 0 || col_v < 0 || col_i < 0) {
+    fprintf(stderr, "%s: header needs t_ms, voltage_V and current_A\n", path);
+    fclose(f);
+    return false;
+  }
+  uint32_t seq = 0;
+  while (fgets(line, sizeof(line), f)) {
+    Sample s = {};
+    int col = 0, found = 0;
+    for (char *tok = strtok(line, ",\r\n"); tok; tok = strtok(nullptr, ",\r\n"), col++) {
+      if (col == col_t) s.t_ms = (uint32_t)strtoul(tok, nullptr, 10), found++;
+      else if (col == col_v) s.voltage_V = strtof(tok, nullptr), found++;
+      else if (col == col_i) s.current_A = strtof(tok, nullptr), found++;
+    }
+    if (found != 3) continue;
+    s.seq = seq++;
+    out.push_back(s);
+  }
+  fclose(f);
+  return true;
+}
+
+static void scan_gaps(const std::vector<Sample> &s, Summary &sum) {
+  std::vector<uint32_t> steps;
+  for (size_t k = 1; k < s.size(); k++) steps.push_back(s[k].t_ms - s[k - 1].t_ms);
+  if (steps.empty()) return;
+  std::vector<uint32_t> sorted = steps;
+  std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+  uint32_t median = sorted[sorted.size() / 2];
+  for (size_t k = 1; k < s.size(); k++) {
+    if (s[k].file_index != s[k - 1].file_index) continue;
+    uint32_t dseq = s[k].seq - s[k - 1].seq;
+    if (dseq != 1) {
+      sum.seq_gaps++;
+      sum.seq_lost += dseq - 1;
+    }
+    if (steps[k - 1] > 2 * median + 1) sum.time_gaps++;
+  }
+}
+
+/* ─── Export ─── */
+static void write_csv(const std::vector<Sample> &s) {
+  printf("file,block,seq,op_time_s,t_ms,voltage_V,current_A\n");
+  for (const Sample &r : s) {
+    printf("%u,%u,%u,%u,%u,%.6f,%.6f\n", r.file_index, r.block_no, r.seq, r.op_time_s, r.t_ms,
+           (double)r.voltage_V, (double)r.current_A);
+  }
+}
+
+template <typename T>
+static bool write_column(const std::string &dir, const char *name, const std::vector<Sample> &s,
+                         T Sample::*field, FILE *schema, const char *type, const char *unit) {
+  std::string path = dir + "/" + name + "." + type;
+  FILE *f = fopen(path.c_str(), "wb");
+  if (!f) {
+    fprintf(stderr, "%s: cannot write\n", path.c_str());
+    return false;
+  }
+  std::vector<T> col;
+  col.reserve(s.size());
+  for (const Sample &r : s) col.push_back(r.*field);
+  bool ok = fwrite(col.data(), sizeof(T), col.size(), f) == col.size();
+  ok = (fclose(f) == 0) && ok;
+  fprintf(schema, "%s,%s,%s,%zu,%s.%s\n", name, type, unit, s.size(), name, type);
+  return ok;
+}
+
+/* One little-endian array per field plus schema.csv: each column loads on its own, e.g.
+ * numpy.fromfile("current_A.f32", "<f4") */
+static bool write_columns(const std::string &dir, const std::vector<Sample> &s) {
+  FILE *schema = fopen((dir + "/schema.csv").c_str(), "w");
+  if (!schema) {
+    fprintf(stderr, "%s: cannot write (does the directory exist?)\n", dir.c_str());
+    return false;
+  }
+  fprintf(schema, "column,type,unit,rows,file\n");
+  bool ok = write_column(dir, "file", s, &Sample::file_index, schema, "u32", "") &&
+            write_column(dir, "seq", s, &Sample::seq, schema, "u32", "") &&
+            write_column(dir, "op_time_s", s, &Sample::op_time_s, schema, "u32", "s") &&
+            write_column(dir, "t_ms", s, &Sample::t_ms, schema, "u32", "ms") &&
+            write_column(dir, "voltage_V", s, &Sample::voltage_V, schema, "f32", "V") &&
+            write_column(dir, "current_A", s, &Sample::current_A, schema, "f32", "A");
+  fclose(schema);
+  return ok;
+}
+
+/* ─── Codec benchmark ─── */
+/* Packs the trace into blocks exactly as the firmware collector does; returns the block count */
+static size_t bench_encode(const std::vector<SampleCodecPoint> &pts, size_t payload_max, std::vector<uint8_t> &out,
+                           std::vector<uint16_t> &counts) {
+  out.clear();
+  counts.clear();
+  size_t blocks = 0, len = 0;
+  SampleCodecPoint prev = {};
+  uint8_t *payload = nullptr;
+  for (const SampleCodecPoint &p : pts) {
+    if (payload && len + SAMPLE_CODEC_MAX_RECORD <= payload_max) {
+      len += SampleCodecEncode(&prev, &p, payload + len);
+      counts.back()++;
+    } else {
+      out.resize(++blocks * payload_max);
+      payload = &out[(blocks - 1) * payload_max];
+      len = 0;
+      counts.push_back(1);
+    }
+    prev = p;
+  }
+  return blocks;
+}
+
+static void run_bench(const std::vector<Sample> &s, size_t block_bytes, uint32_t v_lsb, uint32_t i_lsb) {
+  if (s.size() < 2) {
+    fprintf(stderr, "bench: need at least 2 samples\n");
+    return;
+  }
+  std::vector<SampleCodecPoint> pts;
+  pts.reserve(s.size());
+  double err_v = 0, err_i = 0;
+  for (const Sample &r : s) {
+    SampleCodecPoint p = {r.t_ms, SampleCodecQuantise(r.voltage_V, v_lsb), SampleCodecQuantise(r.current_A, i_lsb)};
+    err_v = std::max(err_v, fabs(SampleCodecDequantise(p.v, v_lsb) - (double)r.voltage_V));
+    err_i = std::max(err_i, fabs(SampleCodecDequantise(p.i, i_lsb) - (double)r.current_A));
+    pts.push_back(p);
+  }
+
+  size_t payload_max = block_bytes - sizeof(SdLogBlockHeaderV2);
+  std::vector<uint8_t> enc;
+  std::vector<uint16_t> counts;
+  size_t blocks = 0;
+  /* Repeat until ~0.5 s has elapsed so the per-sample figure is above timer noise */
+  using clock = std::chrono::steady_clock;
+  size_t reps = 0;
+  auto t0 = clock::now();
+  do {
+    blocks = bench_encode(pts, payload_max, enc, counts);
+    reps++;
+  } while (clock::now() - t0 < std::chrono::milliseconds(500));
+  double enc_ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count() / ((double)reps * pts.size());
+
+  size_t payload_bytes = 0;
+  std::vector<SampleCodecPoint> back(pts.size());
+  reps = 0;
+  t0 = clock::now();
+  do {
+    size_t k = 0;
+    payload_bytes = 0;
+    for (size_t b = 0; b < blocks; b++) {
+      const uint8_t *in = &enc[b * payload_max];
+      size_t avail = payload_max;
+      back[k] = pts[k];  /* keyframe from the header */
+      for (uint16_t c = 1; c < counts[b]; c++, k++) {
+        size_t n = SampleCodecDecode(&back[k], in, avail, &back[k + 1]);
+        in += n;
+        avail -= n;
+      }
+      k++;
+      payload_bytes += payload_max - avail;
+    }
+    reps++;
+  } while (clock::now() - t0 < std::chrono::milliseconds(500));
+  double dec_ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count() / ((double)reps * pts.size());
+
+  size_t mismatches = 0;
+  for (size_t k = 0; k < pts.size(); k++) {
+    if (memcmp(&pts[k], &back[k], sizeof(SampleCodecPoint)) != 0) mismatches++;
+  }
+  double raw = (double)pts.size() * sizeof(SdLogRecordV1);
+  double card = (double)blocks * block_bytes;
+  printf("samples            %zu\n", pts.size());
+  printf("quantum            %u uV, %u uA (max error %.1f uV, %.1f uA)\n", v_lsb, i_lsb, err_v * 1e6, err_i * 1e6);
+  printf("raw v1 records     %.0f B (12 B/sample)\n", raw);
+  printf("encoded payload    %zu B (%.2f B/sample)\n", payload_bytes, (double)payload_bytes / pts.size());
+  printf("card, %zu B blocks %.0f B in %zu blocks (%.2f B/sample)\n", block_bytes, card, blocks, card / pts.size());
+  printf("ratio              %.2fx payload, %.2fx on card\n", raw / payload_bytes, raw / card);
+  printf("encode             %.1f ns/sample (host)\n", enc_ns);
+  printf("decode             %.1f ns/sample (host)\n", dec_ns);
+  printf("round trip         %s\n", mismatches ? "MISMATCH" : "exact");
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: sdlog_decode [options] FILE...\n"
+          "  FILE            /log/NNNNNNNN.BIN from the card, in order (or a CSV trace with --bench)\n"
+          "  --csv           write samples as CSV to stdout (default)\n"
+          "  --columns DIR   write one little-endian column file per field and DIR/schema.csv\n"
+          "  --bench         measure the block codec on the samples: ratio and ns/sample\n"
+          "  --vq UV --iq UA quantum for --bench (default %u uV, %u uA, the firmware defaults)\n"
+          "  --block BYTES   block size (default %u, SD_LOG_BLOCK_BYTES)\n",
+          100u, 10u, (unsigned)SDLOG_BLOCK_SIZE);
+}
+
+int main(int argc, char **argv) {
+  enum { OUT_CSV, OUT_COLUMNS, OUT_BENCH } mode = OUT_CSV;
+  std::string dir;
+  size_t block_bytes = SDLOG_BLOCK_SIZE;
+  uint32_t v_lsb = 100, i_lsb = 10;
+  std::vector<const char *> files;
+  for (int k = 1; k < argc; k++) {
+    std::string a = argv[k];
+    bool has_val = k + 1 < argc;
+    if (a == "--csv") mode = OUT_CSV;
+    else if (a == "--columns" && has_val) mode = OUT_COLUMNS, dir = argv[++k];
+    else if (a == "--bench") mode = OUT_BENCH;
+    else if (a == "--vq" && has_val) v_lsb = (uint32_t)strtoul(argv[++k], nullptr, 10);
+    else if (a == "--iq" && has_val) i_lsb = (uint32_t)strtoul(argv[++k], nullptr, 10);
+    else if (a == "--block" && has_val) block_bytes = strtoul(argv[++k], nullptr, 10);
+    else if (a[0] == '-') return usage(), 2;
+    else files.push_back(argv[k]);
+  }
+  if (files.empty() || block_bytes < 512 || block_bytes % 512 || !v_lsb || !i_lsb) return usage(), 2;
+
+  std::vector<Sample> samples;
+  Summary sum;
+  for (const char *f : files) {
+    size_t n = strlen(f);
+    bool csv = n > 4 && !strcasecmp(f + n - 4, ".csv");
+    if (!(csv ? read_csv(f, samples) : decode_file(f, block_bytes, samples, sum))) return 1;
+  }
+  scan_gaps(samples, sum);
+  fprintf(stderr, "%u files, %u blocks (%u v1), %zu samples, %u drop gaps (%llu samples), %u time gaps\n",
+          sum.files, sum.blocks, sum.blocks_v1, samples.size(), sum.seq_gaps, (unsigned long long)sum.seq_lost,
+          sum.time_gaps);
+
+  switch (mode) {
+    case OUT_CSV: write_csv(samples); break;
+    case OUT_COLUMNS: return write_columns(dir, samples) ? 0 : 1;
+    case OUT_BENCH: run_bench(samples, block_bytes, v_lsb, i_lsb); break;
+  }
+  return 0;
+}
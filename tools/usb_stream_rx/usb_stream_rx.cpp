@@ -0,0 +1,286 @@
+/**
+ * @file usb_stream_rx.cpp
+ * Linux receiver for the USB sample stream (docs/USB_STREAM.md): starts the stream, decodes and
+ * checks frames, writes samples to CSV, and reports throughput and loss every second. Log text the
+ * device prints while streaming is passed through to stderr.
+ *
+ * Build: make -C tools/usb_stream_rx   (Linux, C++17, no dependencies)
+ */
+#include "cobs.h"
+#include "crc32.h"
+#include "sample_codec.h"
+#include "usb_stream_format.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t s_quit = 0;
+
+/* ─── Counters ─── */
+struct Counters {
+  uint64_t wire_bytes = 0;
+  uint64_t frames = 0;
+  uint64_t samples = 0;
+  uint64_t bad_frames = 0;      /* CRC or decode failure */
+  uint64_t frames_lost = 0;     /* frame_no gaps: lost on the link */
+  uint64_t samples_lost = 0;    /* seq gaps spanning lost frames */
+  uint64_t samples_dropped = 0; /* seq gaps between consecutive frames: dropped on the device */
+  uint64_t text_lines = 0;
+};
+
+struct Receiver {
+  FILE *csv = nullptr;
+  FILE *capture = nullptr;
+  bool have_prev = false;
+  uint16_t next_frame = 0;
+  uint32_t next_seq = 0;
+  Counters c;
+  std::vector<uint8_t> chunk;
+  std::vector<uint8_t> raw;
+};
+
+static bool is_text(const std::vector<uint8_t> &b) {
+  size_t printable = 0;
+  for (uint8_t ch : b) printable += (ch >= 0x20 && ch < 0x7F) || ch == '\n' || ch == '\r' || ch == '\t' || ch >= 0x80;
+  return printable == b.size();
+}
+
+static bool handle_frame(Receiver &r, const uint8_t *f, size_t len) {
+  UsbStreamFrameHeader h;
+  if (len < sizeof(h) + 4) return false;
+  uint32_t crc;
+  memcpy(&crc, f + len - 4, 4);
+  if (Crc32(f, len - 4) != crc) return false;
+  memcpy(&h, f, sizeof(h));
+  if (h.type != USB_STREAM_FRAME_TYPE || h.version != USB_STREAM_VERSION || h.count == 0 || !h.v_lsb_uv ||
+      !h.i_lsb_ua)
+    return false;
+
+  if (r.have_prev) {
+    uint16_t frame_gap = (uint16_t)(h.frame_no - r.next_frame);
+    uint32_t seq_gap = h.first_seq - r.next_seq;
+    r.c.frames_lost += frame_gap;
+    if (frame_gap) r.c.samples_lost += seq_gap;
+    else r.c.samples_dropped += seq_gap;
+  }
+  r.have_prev = true;
+  r.next_frame = (uint16_t)(h.frame_no + 1);
+  r.next_seq = h.first_seq + h.count;
+
+  SampleCodecPoint p = {h.key_t_ms, h.key_v, h.key_i};
+  const uint8_t *in = f + sizeof(h);
+  size_t avail = len - 4 - sizeof(h);
+  for (uint16_t k = 0; k < h.count; k++) {
+    if (k > 0) {
+      SampleCodecPoint next;
+      size_t n = SampleCodecDecode(&p, in, avail, &next);
+      if (!n) return false;
+      in += n;
+      avail -= n;
+      p = next;
+    }
+    if (r.csv) {
+      fprintf(r.csv, "%u,%u,%.6f,%.6f\n", h.first_seq + k, p.t_ms, (double)SampleCodecDequantise(p.v, h.v_lsb_uv),
+              (double)SampleCodecDequantise(p.i, h.i_lsb_ua));
+    }
+  }
+  r.c.frames++;
+  r.c.samples += h.count;
+  return true;
+}
+
+/* One 0x00-delimited chunk: a frame, a run of log text, or garbage */
+static void handle_chunk(Receiver &r) {
+  if (r.chunk.empty()) return;
+  r.raw.resize(r.chunk.size());
+  size_t n = CobsDecode(r.chunk.data(), r.chunk.size(), r.raw.data());
+  bool frame = n != SIZE_MAX && handle_frame(r, r.raw.data(), n);
+  if (!frame && is_text(r.chunk)) {
+    fwrite(r.chunk.data(), 1, r.chunk.size(), stderr);
+    for (uint8_t ch : r.chunk) r.c.text_lines += ch == '\n';
+  } else if (!frame) {
+    r.c.bad_frames++;
+  }
+  r.chunk.clear();
+}
+
+static void feed(Receiver &r, const uint8_t *buf, size_t n) {
+  r.c.wire_bytes += n;
+  if (r.capture) fwrite(buf, 1, n, r.capture);
+  for (size_t k = 0; k < n; k++) {
+    if (buf[k] == 0) handle_chunk(r);
+    else r.chunk.push_back(buf[k]);
+  }
+}
+
+static void report(const Counters &now, const Counters &last, double dt, double elapsed, unsigned baud) {
+  double bps = (now.wire_bytes - last.wire_bytes) / dt;
+  fprintf(stderr,
+          "%7.1f s  %6.0f samples/s  %6.1f KB/s (%4.1f%% of link)  %5.1f B/sample  frames %llu  "
+          "lost %llu frames/%llu samples  device drops %llu  bad %llu\n",
+          elapsed, (now.samples - last.samples) / dt, bps / 1024.0, baud ? bps * 1000.0 / baud : 0.0,
+          now.samples > last.samples ? (double)(now.wire_bytes - last.wire_bytes) / (now.samples - last.samples) : 0.0,
+          (unsigned long long)now.frames, (unsigned long long)now.frames_lost, (unsigned long long)now.samples_lost,
+          (unsigned long long)now.samples_dropped, (unsigned long long)now.bad_frames);
+}
+
+/* ─── Serial port ─── */
+static speed_t baud_constant(unsigned baud) {
+  switch (baud) {
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 500000: return B500000;
+    case 921600: return B921600;
+    case 1000000: return B1000000;
+    case 1500000: return B1500000;
+    case 2000000: return B2000000;
+    case 3000000: return B3000000;
+    default: return 0;
+  }
+}
+
+static bool port_set_baud(int fd, unsigned baud) {
+  struct termios t;
+  speed_t sp = baud_constant(baud);
+  if (!sp || tcgetattr(fd, &t) != 0) return false;
+  cfmakeraw(&t);
+  t.c_cflag |= CLOCAL | CREAD;
+  t.c_cflag &= ~(CRTSCTS | HUPCL);  /* HUPCL would pulse DTR on close, which resets the board */
+  t.c_cc[VMIN] = 0;
+  t.c_cc[VTIME] = 1;
+  cfsetispeed(&t, sp);
+  cfsetospeed(&t, sp);
+  return tcsetattr(fd, TCSANOW, &t) == 0;
+}
+
+static int port_open(const char *dev) {
+  int fd = open(dev, O_RDWR | O_NOCTTY);
+  if (fd < 0) return -1;
+  /* DTR and RTS at the same level keep the auto-reset circuit from pulling EN/IO0 */
+  int lines = TIOCM_DTR | TIOCM_RTS;
+  ioctl(fd, TIOCMBIC, &lines);
+  return fd;
+}
+
+/* Start: a console line (the leading newline ends any partial input). Stop: the bare byte. */
+static void send_cmd(int fd, bool start) {
+  const char line[] = {'\n', USB_STREAM_CMD_TOGGLE, '\n'};
+  const char stop = USB_STREAM_CMD_TOGGLE;
+  ssize_t len = start ? (ssize_t)sizeof(line) : 1;
+  if (write(fd, start ? line : &stop, (size_t)len) != len) fprintf(stderr, "write: %s\n", strerror(errno));
+  tcdrain(fd);
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: usb_stream_rx [options]\n"
+          "  -d DEV          serial device (default /dev/ttyUSB0)\n"
+          "  -b BAUD         stream baud, must match USB_STREAM_BAUD (default 2000000)\n"
+          "  -o FILE         write samples as CSV (seq,t_ms,voltage_V,current_A)\n"
+          "  -c FILE         save the raw byte stream for --replay\n"
+          "  -t SECONDS      stop after this long (default: until Ctrl-C)\n"
+          "  --no-start      the device is already streaming: do not send the start/stop command\n"
+          "  --replay FILE   decode a saved raw stream instead of a device\n");
+}
+
+static void on_signal(int) {
+  s_quit = 1;
+}
+
+int main(int argc, char **argv) {
+  const char *dev = "/dev/ttyUSB0";
+  const char *out = nullptr, *cap = nullptr, *replay = nullptr;
+  unsigned baud = 2000000;
+  double limit_s = 0;
+  bool start = true;
+  for (int k = 1; k < argc; k++) {
+    std::string a = argv[k];
+    bool has_val = k + 1 < argc;
+    if (a == "-d" && has_val) dev = argv[++k];
+    else if (a == "-b" && has_val) baud = (unsigned)strtoul(argv[++k], nullptr, 10);
+    else if (a == "-o" && has_val) out = argv[++k];
+    else if (a == "-c" && has_val) cap = argv[++k];
+    else if (a == "-t" && has_val) limit_s = strtod(argv[++k], nullptr);
+    else if (a == "--no-start") start = false;
+    else if (a == "--replay" && has_val) replay = argv[++k];
+    else return usage(), 2;
+  }
+
+  Receiver r;
+  if (out && !(r.csv = fopen(out, "w"))) return fprintf(stderr, "%s: %s\n", out, strerror(errno)), 1;
+  if (cap && !(r.capture = fopen(cap, "wb"))) return fprintf(stderr, "%s: %s\n", cap, strerror(errno)), 1;
+  if (r.csv) fprintf(r.csv, "seq,t_ms,voltage_V,current_A\n");
+
+  int fd = -1;
+  if (replay) {
+    fd = open(replay, O_RDONLY);
+    if (fd < 0) return fprintf(stderr, "%s: %s\n", replay, strerror(errno)), 1;
+    baud = 0;
+  } else {
+    if (!baud_constant(baud)) return fprintf(stderr, "unsupported baud %u\n", baud), 2;
+    fd = port_open(dev);
+    if (fd < 0) return fprintf(stderr, "%s: %s\n", dev, strerror(errno)), 1;
+    if (start) {
+      port_set_baud(fd, 115200);
+      tcflush(fd, TCIOFLUSH);
+      send_cmd(fd, true);
+      usleep(100000);  /* the device prints a notice, flushes and switches */
+    }
+    if (!port_set_baud(fd, baud)) return fprintf(stderr, "%s: cannot set %u baud\n", dev, baud), 1;
+    tcflush(fd, TCIFLUSH);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+  }
+
+  using clock = std::chrono::steady_clock;
+  auto t0 = clock::now(), last_t = t0;
+  Counters last;
+  uint8_t buf[16384];
+  while (!s_quit) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n < 0 && errno != EINTR) {
+      fprintf(stderr, "read: %s\n", strerror(errno));
+      break;
+    }
+    if (n > 0) feed(r, buf, (size_t)n);
+    if (n == 0 && replay) break;
+    auto now = clock::now();
+    double dt = std::chrono::duration<double>(now - last_t).count();
+    double elapsed = std::chrono::duration<double>(now - t0).count();
+    if (!replay && dt >= 1.0) {
+      report(r.c, last, dt, elapsed, baud);
+      last = r.c;
+      last_t = now;
+    }
+    if (limit_s > 0 && elapsed >= limit_s) break;
+  }
+
+  if (!replay && start) send_cmd(fd, false);  /* back to 115200 on the device */
+  close(fd);
+  if (r.csv) fclose(r.csv);
+  if (r.capture) fclose(r.capture);
+
+  double elapsed = std::chrono::duration<double>(clock::now() - t0).count();
+  const Counters &c = r.c;
+  uint64_t expected = c.samples + c.samples_lost + c.samples_dropped;
+  fprintf(stderr,
+          "total: %llu samples in %llu frames, %llu B on the wire (%.2f B/sample), %.1f s\n"
+          "loss:  %llu frames / %llu samples on the link, %llu samples dropped on the device, "
+          "%llu bad frames (%.4f%% of samples missing)\n",
+          (unsigned long long)c.samples, (unsigned long long)c.frames, (unsigned long long)c.wire_bytes,
+          c.samples ? (double)c.wire_bytes / c.samples : 0.0, elapsed, (unsigned long long)c.frames_lost,
+          (unsigned long long)c.samples_lost, (unsigned long long)c.samples_dropped, (unsigned long long)c.bad_frames,
+          expected ? 100.0 * (expected - c.samples) / expected : 0.0);
+  return 0;
+}
@@ -0,0 +1,343 @@
+/**
+ * @file ws_bench.cpp
+ * WebSocket stream benchmark for the device (docs/WS_STREAM.md): N clients subscribe to /ws at a
+ * chosen rate for a fixed time, then report frames and points per second, sequence gaps, the
+ * decimation each client ended up with, round-trip time (WebSocket ping) and delivery delay.
+ * Some clients can be made slow readers to check that they are decimated while the others keep
+ * their rate. Device heap and stream counters are read from /metrics before and after.
+ *
+ * Build: make -C tools/ws_bench   (Linux, C++17, no dependencies)
+ */
+#include "ws_stream_format.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string host;
+  std::string port = "80";
+  int clients = 1;
+  int slow = 0;          /* how many of the clients read slowly */
+  int slow_ms = 500;     /* pause between reads of a slow client */
+  double rate = 100;
+  double seconds = 10;
+  bool metrics = true;
+};
+
+struct ClientResult {
+  bool connected = false;
+  bool slow = false;
+  std::string hello;
+  uint64_t frames = 0, points = 0, samples = 0, gaps = 0, bytes = 0;
+  unsigned decim_min = 0, decim_max = 0, decim_last = 0;
+  std::vector<double> rtt_ms;     /* ping -> pong */
+  std::vector<double> delay_ms;   /* host receive - device send, offset unknown: reported above the minimum */
+  std::vector<double> age_ms;     /* device: send - newest sample in the frame */
+  double elapsed = 0;
+};
+
+static double ms_since(Clock::time_point t0) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static double pct(std::vector<double> v, double p) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[(size_t)(p / 100.0 * (double)(v.size() - 1) + 0.5)];
+}
+
+static int tcp_connect(const addrinfo *ai, int rcvbuf) {
+  int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+  if (fd < 0) return -1;
+  if (rcvbuf) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));  /* before connect: sets the window */
+  timeval tv = {0, 100000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  timeval stv = {5, 0};
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &stv, sizeof(stv));
+  if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/* ─── WebSocket client frames (RFC 6455): client frames are masked, server frames are not ─── */
+static bool ws_send(int fd, uint8_t opcode, const void *data, size_t len) {
+  std::string f;
+  f.push_back((char)(0x80 | opcode));
+  if (len < 126) {
+    f.push_back((char)(0x80 | len));
+  } else {
+    f.push_back((char)(0x80 | 126));
+    f.push_back((char)(len >> 8));
+    f.push_back((char)len);
+  }
+  const uint8_t mask[4] = {0x12, 0x34, 0x56, 0x78};
+  f.append((const char *)mask, 4);
+  for (size_t k = 0; k < len; k++) f.push_back((char)(((const uint8_t *)data)[k] ^ mask[k & 3]));
+  return send(fd, f.data(), f.size(), MSG_NOSIGNAL) == (ssize_t)f.size();
+}
+
+/* Take one complete frame off the front of buf; false if it is not all there yet */
+static bool ws_parse(std::string &buf, uint8_t *opcode, std::string *payload) {
+  if (buf.size() < 2) return false;
+  const uint8_t *p = (const uint8_t *)buf.data();
+  uint64_t len = p[1] & 0x7F;
+  size_t hdr = 2;
+  if (len == 126) {
+    if (buf.size() < 4) return false;
+    len = ((uint64_t)p[2] << 8) | p[3];
+    hdr = 4;
+  } else if (len == 127) {
+    if (buf.size() < 10) return false;
+    len = 0;
+    for (int k = 0; k < 8; k++) len = (len << 8) | p[2 + k];
+    hdr = 10;
+  }
+  if (p[1] & 0x80) hdr += 4;  /* masked (not expected from a server) */
+  if (buf.size() < hdr + len) return false;
+  *opcode = p[0] & 0x0F;
+  payload->assign(buf, hdr, (size_t)len);
+  if (p[1] & 0x80) {
+    const uint8_t *m = p + hdr - 4;
+    for (size_t k = 0; k < payload->size(); k++) (*payload)[k] ^= (char)m[k & 3];
+  }
+  buf.erase(0, hdr + (size_t)len);
+  return true;
+}
+
+static void run_client(const Options &o, const addrinfo *ai, bool slow, ClientResult *r) {
+  r->slow = slow;
+  int fd = tcp_connect(ai, slow ? 4096 : 0);
+  if (fd < 0) return;
+  std::string req = "GET /ws HTTP/1.1\r\nHost: " + o.host +
+                    "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+  if (send(fd, req.data(), req.size(), MSG_NOSIGNAL) != (ssize_t)req.size()) {
+    close(fd);
+    return;
+  }
+  std::string buf;
+  char tmp[8192];
+  auto t_start = Clock::now();
+  while (buf.find("\r\n\r\n") == std::string::npos && ms_since(t_start) < 5000) {
+    ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+    if (n == 0) break;
+    if (n > 0) buf.append(tmp, (size_t)n);
+  }
+  size_t hdr_end = buf.find("\r\n\r\n");
+  if (hdr_end == std::string::npos || buf.compare(0, 12, "HTTP/1.1 101") != 0) {
+    close(fd);
+    return;
+  }
+  buf.erase(0, hdr_end + 4);
+  r->connected = true;
+  char cmd[32];
+  snprintf(cmd, sizeof(cmd), "rate %g", o.rate);
+  ws_send(fd, 0x1, cmd, strlen(cmd));
+
+  auto t0 = Clock::now();
+  auto deadline = t0 + std::chrono::duration<double>(o.seconds);
+  auto next_ping = t0;
+  bool have_next = false;
+  uint32_t next_seq = 0;
+  bool open = true;
+  while (open && Clock::now() < deadline) {
+    if (Clock::now() >= next_ping) {
+      double now = ms_since(t0);
+      ws_send(fd, 0x9, &now, sizeof(now));
+      next_ping += std::chrono::seconds(1);
+    }
+    uint8_t op;
+    std::string pl;
+    if (!ws_parse(buf, &op, &pl)) {
+      if (slow) std::this_thread::sleep_for(std::chrono::milliseconds(o.slow_ms));
+      ssize_t n = recv(fd, tmp, slow ? 512 : sizeof(tmp), 0);
+      if (n == 0) break;
+      if (n > 0) buf.append(tmp, (size_t)n);
+      continue;
+    }
+    double host_ms = ms_since(t0);
+    if (op == 0x1) {
+      r->hello = pl;
+    } else if (op == 0xA && pl.size() == sizeof(double)) {
+      double sent;
+      memcpy(&sent, pl.data(), sizeof(sent));
+      r->rtt_ms.push_back(host_ms - sent);
+    } else if (op == 0x9) {
+      ws_send(fd, 0xA, pl.data(), pl.size());
+    } else if (op == 0x8) {
+      open = false;
+    } else if (op == 0x2 && pl.size() >= sizeof(WsStreamFrameHeader) && (uint8_t)pl[0] == WS_STREAM_FRAME_TYPE) {
+      WsStreamFrameHeader h;
+      memcpy(&h, pl.data(), sizeof(h));
+      if (pl.size() < sizeof(h) + (size_t)h.count * sizeof(WsStreamPoint)) continue;
+      if ((have_next && h.first_seq != next_seq) || (h.flags & WS_STREAM_FLAG_GAP)) r->gaps++;
+      next_seq = h.first_seq + h.samples;
+      have_next = true;
+      r->frames++;
+      r->points += h.count;
+      r->samples += h.samples;
+      r->bytes += pl.size();
+      r->decim_last = h.decim;
+      if (!r->decim_min || h.decim < r->decim_min) r->decim_min = h.decim;
+      if (h.decim > r->decim_max) r->decim_max = h.decim;
+      r->delay_ms.push_back(host_ms - (double)h.sent_ms);
+      if (h.count) {
+        WsStreamPoint last;
+        memcpy(&last, pl.data() + sizeof(h) + (size_t)(h.count - 1) * sizeof(WsStreamPoint), sizeof(last));
+        r->age_ms.push_back((double)(int32_t)(h.sent_ms - last.t_ms));
+      }
+    }
+  }
+  r->elapsed = ms_since(t0) / 1000.0;
+  uint16_t code = htons(1000);
+  ws_send(fd, 0x8, &code, sizeof(code));
+  close(fd);
+}
+
+/* ─── /metrics scrape, one plain HTTP/1.1 request ─── */
+static std::map<std::string, double> scrape(const Options &o, const addrinfo *ai) {
+  std::map<std::string, double> m;
+  int fd = tcp_connect(ai, 0);
+  if (fd < 0) return m;
+  std::string req = "GET /metrics HTTP/1.1\r\nHost: " + o.host + "\r\nConnection: close\r\n\r\n";
+  send(fd, req.data(), req.size(), MSG_NOSIGNAL);
+  std::string resp;
+  char tmp[4096];
+  auto t0 = Clock::now();
+  while (ms_since(t0) < 5000) {
+    ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+    if (n == 0) break;
+    if (n > 0) resp.append(tmp, (size_t)n);
+  }
+  close(fd);
+  if (resp.compare(0, 12, "HTTP/1.1 200") != 0) return m;
+  /* Chunk-size lines do not parse as "name value" pairs, so the chunked body needs no decoding */
+  size_t pos = resp.find("\r\n\r\n");
+  while (pos != std::string::npos && pos < resp.size()) {
+    size_t eol = resp.find('\n', pos);
+    if (eol == std::string::npos) eol = resp.size();
+    std::string line = resp.substr(pos, eol - pos);
+    pos = eol + 1;
+    if (line.compare(0, 10, "cyd_shunt_") != 0) continue;
+    size_t sp = line.rfind(' ');
+    if (sp != std::string::npos) m[line.substr(0, sp)] = strtod(line.c_str() + sp + 1, nullptr);
+  }
+  return m;
+}
+
+static double metric(const std::map<std::string, double> &m, const char *key) {
+  auto it = m.find(key);
+  return it == m.end() ? -1 : it->second;
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: ws_bench [options] host[:port]\n"
+          "  -c N       clients (default 1)\n"
+          "  -r HZ      requested point rate per client (default 100)\n"
+          "  -t S       run time in seconds (default 10)\n"
+          "  -s K       make K of the clients slow readers (default 0)\n"
+          "  -d MS      pause between reads of a slow client (default 500)\n"
+          "  --no-metrics  do not read /metrics before and after\n");
+}
+
+int main(int argc, char **argv) {
+  Options o;
+  for (int k = 1; k < argc; k++) {
+    std::string a = argv[k];
+    if (a == "-c" && k + 1 < argc) o.clients = atoi(argv[++k]);
+    else if (a == "-r" && k + 1 < argc) o.rate = atof(argv[++k]);
+    else if (a == "-t" && k + 1 < argc) o.seconds = atof(argv[++k]);
+    else if (a == "-s" && k + 1 < argc) o.slow = atoi(argv[++k]);
+    else if (a == "-d" && k + 1 < argc) o.slow_ms = atoi(argv[++k]);
+    else if (a == "--no-metrics") o.metrics = false;
+    else if (a[0] != '-' && o.host.empty()) {
+      size_t colon = a.find(':');
+      o.host = a.substr(0, colon);
+      if (colon != std::string::npos) o.port = a.substr(colon + 1);
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (o.host.empty() || o.clients < 1 || o.slow < 0 || o.slow > o.clients || o.seconds <= 0 || o.rate <= 0) {
+    usage();
+    return 2;
+  }
+
+  addrinfo hints, *ai = nullptr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  int rc = getaddrinfo(o.host.c_str(), o.port.c_str(), &hints, &ai);
+  if (rc != 0) {
+    fprintf(stderr, "%s: %s\n", o.host.c_str(), gai_strerror(rc));
+    return 1;
+  }
+
+  std::map<std::string, double> before;
+  if (o.metrics) {
+    before = scrape(o, ai);
+    if (before.empty()) fprintf(stderr, "warning: no /metrics from %s\n", o.host.c_str());
+  }
+
+  std::vector<ClientResult> res((size_t)o.clients);
+  std::vector<std::thread> threads;
+  for (int c = 0; c < o.clients; c++)
+    threads.emplace_back(run_client, std::cref(o), ai, c >= o.clients - o.slow, &res[(size_t)c]);
+  for (auto &t : threads) t.join();
+
+  printf("%s:%s, %d clients (%d slow), %.0f Hz requested, %.1f s\n", o.host.c_str(), o.port.c_str(), o.clients,
+         o.slow, o.rate, o.seconds);
+  int ok = 0;
+  for (size_t c = 0; c < res.size(); c++) {
+    const ClientResult &r = res[c];
+    if (!r.connected) {
+      printf("client %zu  not connected (refused or no /ws)\n", c);
+      continue;
+    }
+    ok++;
+    double el = r.elapsed > 0 ? r.elapsed : 1;
+    double dmin = r.delay_ms.empty() ? 0 : *std::min_element(r.delay_ms.begin(), r.delay_ms.end());
+    std::vector<double> jitter;
+    for (double d : r.delay_ms) jitter.push_back(d - dmin);
+    printf("client %zu%s  %.1f frames/s, %.1f points/s (%.1f samples/s), %.1f KB/s, %llu gaps, decim %u..%u (end %u)\n",
+           c, r.slow ? " slow" : "", (double)r.frames / el, (double)r.points / el, (double)r.samples / el,
+           (double)r.bytes / 1024.0 / el, (unsigned long long)r.gaps, r.decim_min, r.decim_max, r.decim_last);
+    printf("          rtt p50 %.1f / p99 %.1f ms, delay above min p50 %.1f / p99 %.1f ms, "
+           "sample age at send p50 %.0f / max %.0f ms\n",
+           pct(r.rtt_ms, 50), pct(r.rtt_ms, 99), pct(jitter, 50), pct(jitter, 99), pct(r.age_ms, 50),
+           pct(r.age_ms, 100));
+  }
+
+  if (o.metrics && !before.empty()) {
+    std::map<std::string, double> after = scrape(o, ai);
+    if (!after.empty()) {
+      printf("device    heap free %.0f -> %.0f B, largest block %.0f -> %.0f B, lowest since boot %.0f B\n",
+             metric(before, "cyd_shunt_heap_free_bytes"), metric(after, "cyd_shunt_heap_free_bytes"),
+             metric(before, "cyd_shunt_heap_largest_block_bytes"),
+             metric(after, "cyd_shunt_heap_largest_block_bytes"), metric(after, "cyd_shunt_heap_min_free_bytes"));
+      printf("device    %.0f frames sent, decimation raised %.0f times\n",
+             metric(after, "cyd_shunt_ws_frames_total") - metric(before, "cyd_shunt_ws_frames_total"),
+             metric(after, "cyd_shunt_ws_coarsened_total") - metric(before, "cyd_shunt_ws_coarsened_total"));
+    }
+  }
+  freeaddrinfo(ai);
+  return ok ? 0 : 1;
+}